@@ -34,6 +34,7 @@
 #include "loopdev.h"
 #include "closestream.h"
 #include "optutils.h"
+#include "fileutils.h"
 
 /* this is the default upper limit, could be modified by --nr */
 #define SLICES_MAX	256
@@ -450,7 +451,11 @@ static void upd_parts_warnx(const char *device, int first, int last)
 				device, first, last);
 }
 
-static int upd_parts(int fd, const char *device, dev_t devno,
+/*
+ * Old-style update, delete and add (or resize) all partitions in the range
+ * one by one. It's used only if the partitions are not readable from /sys.
+ */
+static int upd_parts_by_sweep(int fd, const char *device, dev_t devno,
 		     blkid_partlist ls, int lower, int upper)
 {
 	int n, nparts, rc = 0, errfirst = 0, errlast = 0, err;
@@ -536,6 +541,282 @@ static int upd_parts(int fd, const char *device, dev_t devno,
 	return rc;
 }
 
+/* partition as known by kernel or as described by on-disk PT */
+struct partinfo {
+	int		partno;
+	uintmax_t	start;		/* in 512-byte sectors */
+	uintmax_t	size;
+};
+
+static int cmp_partinfo(const void *a, const void *b)
+{
+	return ((const struct partinfo *) a)->partno -
+	       ((const struct partinfo *) b)->partno;
+}
+
+/*
+ * Reads all partitions of the whole-disk from /sys in one pass.
+ * Returns number of partitions (the array is sorted by partno) or <0 on error.
+ */
+static int read_kernel_parts(dev_t devno, struct partinfo **res)
+{
+	struct path_cxt *pc;
+	struct partinfo *parts = NULL;
+	struct dirent *d;
+	size_t n = 0, max = 0;
+	DIR *dir;
+
+	pc = ul_new_sysfs_path(devno, NULL, NULL);
+	if (!pc)
+		return -ENODEV;
+	dir = ul_path_opendir(pc, NULL);
+	if (!dir) {
+		ul_unref_path(pc);
+		return -errno;
+	}
+
+	while ((d = xreaddir(dir))) {
+		struct partinfo *pi;
+		uint64_t start, size;
+		int partno;
+
+		if (!sysfs_blkdev_is_partition_dirent(dir, d, NULL))
+			continue;
+		if (ul_path_readf_s32(pc, &partno, "%s/partition", d->d_name) ||
+		    ul_path_readf_u64(pc, &start, "%s/start", d->d_name) ||
+		    ul_path_readf_u64(pc, &size, "%s/size", d->d_name))
+			continue;
+
+		if (n == max) {
+			max = max ? max * 2 : 32;
+			parts = xrealloc(parts, max * sizeof(struct partinfo));
+		}
+		pi = &parts[n++];
+		pi->partno = partno;
+		pi->start = start;
+		pi->size = size;
+	}
+
+	closedir(dir);
+	ul_unref_path(pc);
+
+	if (n)
+		qsort(parts, n, sizeof(struct partinfo), cmp_partinfo);
+	*res = parts;
+	return n;
+}
+
+/* returns on-disk partitions sorted by partno */
+static size_t get_disk_parts(blkid_partlist ls, struct partinfo **res)
+{
+	int i, nparts = blkid_partlist_numof_partitions(ls);
+	struct partinfo *parts;
+
+	parts = xcalloc(nparts > 0 ? nparts : 1, sizeof(struct partinfo));
+
+	for (i = 0; i < nparts; i++) {
+		blkid_partition par = blkid_partlist_get_partition(ls, i);
+
+		parts[i].partno = blkid_partition_get_partno(par);
+		parts[i].start = blkid_partition_get_start(par);
+		parts[i].size = blkid_partition_get_size(par);
+		if (blkid_partition_is_extended(par))
+			/*
+			 * Let's follow the Linux kernel and reduce
+			 * DOS extended partition to 1 or 2 sectors.
+			 */
+			parts[i].size = min(parts[i].size, (uintmax_t) 2);
+	}
+
+	if (nparts > 0)
+		qsort(parts, nparts, sizeof(struct partinfo), cmp_partinfo);
+	*res = parts;
+	return nparts > 0 ? nparts : 0;
+}
+
+enum {
+	UPD_KEEP,
+	UPD_ADD,
+	UPD_DEL,
+	UPD_RESIZE,
+	UPD_REPLACE		/* delete and add (start has been changed) */
+};
+
+struct partupd {
+	int		partno;
+	int		action;		/* UPD_* */
+	uintmax_t	start;
+	uintmax_t	size;
+	uintmax_t	oldsize;
+	unsigned int	failed : 1;
+};
+
+/*
+ * Compares partitions known by kernel with the on-disk partition table and
+ * uses only the necessary BLKPG operations to update kernel. Unchanged
+ * partitions are not touched at all (so no udev events for them).
+ *
+ * The operations are ordered to avoid overlaps: all deletes first, then
+ * shrinks, grows and adds.
+ */
+static int upd_parts(int fd, const char *device, dev_t devno,
+		     blkid_partlist ls, int lower, int upper)
+{
+	struct partinfo *kparts = NULL, *dparts = NULL;
+	struct partupd *upd;
+	size_t nk, nd, nupd = 0, i, k, d;
+	int rc = 0, n, pass, errfirst = 0, errlast = 0;
+	struct stat st;
+
+	assert(fd >= 0);
+	assert(device);
+	assert(ls);
+
+	if (!devno && fstat(fd, &st) == 0 && S_ISBLK(st.st_mode))
+		devno = st.st_rdev;
+
+	n = devno ? read_kernel_parts(devno, &kparts) : -ENODEV;
+	if (n < 0) {
+		if (verbose)
+			printf(_("%s: cannot read partitions from /sys, "
+				 "updating one by one\n"), device);
+		return upd_parts_by_sweep(fd, device, devno, ls, lower, upper);
+	}
+	nk = n;
+	nd = get_disk_parts(ls, &dparts);
+
+	/* recount range, negative numbers are relative to the kernel setting */
+	n = nk ? kparts[nk - 1].partno : 0;
+	if (!lower)
+		lower = 1;
+	else if (lower < 0)
+		lower = n + lower + 1;
+	if (!upper)
+		upper = INT_MAX;
+	else if (upper < 0)
+		upper = n + upper + 1;
+	if (lower > upper) {
+		warnx(_("specified range <%d:%d> "
+			"does not make sense"), lower, upper);
+		free(kparts);
+		free(dparts);
+		return -1;
+	}
+
+	/* merge both sorted arrays */
+	upd = xcalloc(nk + nd + 1, sizeof(struct partupd));
+
+	for (k = 0, d = 0; k < nk || d < nd; ) {
+		struct partinfo *kp = k < nk ? &kparts[k] : NULL,
+				*dp = d < nd ? &dparts[d] : NULL;
+		struct partupd *u = &upd[nupd];
+
+		memset(u, 0, sizeof(*u));
+		if (kp && dp && kp->partno == dp->partno) {
+			u->partno = dp->partno;
+			u->start = dp->start;
+			u->size = dp->size;
+			u->oldsize = kp->size;
+			if (kp->start != dp->start)
+				u->action = UPD_REPLACE;
+			else if (kp->size != dp->size)
+				u->action = UPD_RESIZE;
+			else
+				u->action = UPD_KEEP;
+			k++, d++;
+		} else if (kp && (!dp || kp->partno < dp->partno)) {
+			u->partno = kp->partno;
+			u->action = UPD_DEL;
+			k++;
+		} else {
+			u->partno = dp->partno;
+			u->start = dp->start;
+			u->size = dp->size;
+			u->action = UPD_ADD;
+			d++;
+		}
+		if (u->partno >= lower && u->partno <= upper)
+			nupd++;
+	}
+
+	for (pass = 0; pass < 4; pass++) {
+		for (i = 0; i < nupd; i++) {
+			struct partupd *u = &upd[i];
+
+			if (u->failed)
+				continue;
+
+			switch (pass) {
+			case 0:		/* delete */
+				if (u->action != UPD_DEL && u->action != UPD_REPLACE)
+					continue;
+				if (partx_del_partition(fd, u->partno) == 0
+				    || errno == ENXIO) {
+					if (verbose)
+						printf(_("%s: partition #%d removed\n"),
+								device, u->partno);
+					continue;
+				}
+				break;
+			case 1:		/* shrink */
+			case 2:		/* grow */
+				if (u->action != UPD_RESIZE
+				    || (pass == 1) != (u->size < u->oldsize))
+					continue;
+				if (partx_resize_partition(fd, u->partno,
+							u->start, u->size) == 0) {
+					if (verbose)
+						printf(_("%s: partition #%d resized\n"),
+								device, u->partno);
+					continue;
+				}
+				break;
+			case 3:		/* add */
+				if (u->action != UPD_ADD && u->action != UPD_REPLACE)
+					continue;
+				if (partx_add_partition(fd, u->partno,
+							u->start, u->size) == 0) {
+					if (verbose)
+						printf(_("%s: partition #%d added\n"),
+								device, u->partno);
+					continue;
+				}
+				break;
+			}
+
+			if (verbose)
+				warn(_("%s: updating partition #%d failed"),
+						device, u->partno);
+			u->failed = 1;
+			rc = -1;
+		}
+	}
+
+	for (i = 0; i < nupd; i++) {
+		struct partupd *u = &upd[i];
+
+		if (u->action == UPD_KEEP && verbose)
+			printf(_("%s: partition #%d unchanged\n"), device, u->partno);
+		if (!u->failed)
+			continue;
+		if (!errfirst)
+			errlast = errfirst = u->partno;
+		else if (errlast + 1 == u->partno)
+			errlast++;
+		else {
+			upd_parts_warnx(device, errfirst, errlast);
+			errlast = errfirst = u->partno;
+		}
+	}
+	if (errfirst)
+		upd_parts_warnx(device, errfirst, errlast);
+
+	free(upd);
+	free(kparts);
+	free(dparts);
+	return rc;
+}
+
 static int list_parts(blkid_partlist ls, int lower, int upper)
 {
 	int i, nparts, rc;
@@ -31,6 +31,9 @@
 #include <sys/stat.h>
 #include <assert.h>
 #include <fcntl.h>
+#include <glob.h>
+#include <pthread.h>
+#include <time.h>
 #include <libsmartcols.h>
 #ifdef HAVE_LIBREADLINE
 # define _FUNCTION_DEF
@@ -88,7 +91,8 @@ enum {
 	ACT_PARTLABEL,
 	ACT_PARTATTRS,
 	ACT_DISKID,
-	ACT_DELETE
+	ACT_DELETE,
+	ACT_BATCH
 };
 
 struct sfdisk {
@@ -102,6 +106,7 @@ struct sfdisk {
 	const char	*backup_file;	/* -O <path> */
 	const char	*move_typescript; /* --movedata <typescript> */
 	char		*prompt;
+	size_t		njobs;		/* --jobs <num> for --batch */
 
 	struct fdisk_context	*cxt;		/* libfdisk context */
 	struct fdisk_partition  *orig_pa;	/* -N <partno> before the change */
@@ -118,6 +123,7 @@ struct sfdisk {
 		     json : 1,		/* JSON dump */
 		     movedata: 1,	/* move data after resize */
 		     movefsync: 1,	/* use fsync() after each write() */
+		     directwrite : 1,	/* write disk label by O_DIRECT */
 		     notell : 1,	/* don't tell kernel aout new PT */
 		     noact  : 1;	/* do not write to device */
 };
@@ -231,6 +237,7 @@ static void sfdisk_init(struct sfdisk *sf)
 		err(EXIT_FAILURE, _("failed to allocate libfdisk context"));
 	fdisk_set_ask(sf->cxt, ask_callback, (void *) sf);
 	fdisk_enable_bootbits_protection(sf->cxt, 1);
+	fdisk_enable_direct_write(sf->cxt, sf->directwrite);
 
 	if (sf->label_nested) {
 		struct fdisk_context *x = fdisk_new_nested_context(sf->cxt,
@@ -1992,6 +1999,314 @@ static int command_fdisk(struct sfdisk *sf, int argc, char **argv)
 	return rc;
 }
 
+/*
+ * sfdisk --batch <dev|glob> [...]
+ *
+ * The script from stdin is applied to all the devices. The new disk labels
+ * are prepared in memory one by one and then written to the devices by
+ * a pool of threads. The kernel is informed about the changes by BLKPG
+ * ioctls for the modified partitions only, so there is no full re-read
+ * (and udev storm) for each device.
+ */
+#define SFDISK_BATCH_JOBS	16
+
+struct sfdisk_job {
+	char			*devname;
+	struct fdisk_context	*cxt;
+	struct fdisk_table	*org;	/* partitions before the change */
+	double			prepare_time;
+	double			write_time;
+	int			rc;
+};
+
+struct sfdisk_batch {
+	struct sfdisk		*sf;
+	struct sfdisk_job	*jobs;
+	size_t			njobs;
+	size_t			next;	/* the next job for a worker */
+	pthread_mutex_t		lock;
+};
+
+static double batch_elapsed(const struct timespec *begin)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - begin->tv_sec) +
+	       (now.tv_nsec - begin->tv_nsec) / 1000000000.0;
+}
+
+static void batch_add_device(struct sfdisk_job **jobs, size_t *njobs, const char *name)
+{
+	*jobs = xrealloc(*jobs, (*njobs + 1) * sizeof(struct sfdisk_job));
+	memset(&(*jobs)[*njobs], 0, sizeof(struct sfdisk_job));
+	(*jobs)[*njobs].devname = xstrdup(name);
+	(*njobs)++;
+}
+
+/* read the whole script to memory, it's parsed for each device separately,
+ * because sizes in the script depend on device sector size */
+static char *batch_read_script(FILE *f, size_t *len)
+{
+	char *buf = NULL;
+	size_t sz = 0;
+
+	*len = 0;
+	do {
+		if (*len == sz) {
+			sz = sz ? sz * 2 : BUFSIZ;
+			buf = xrealloc(buf, sz);
+		}
+		*len += fread(buf + *len, 1, sz - *len, f);
+	} while (!feof(f) && !ferror(f));
+
+	if (ferror(f))
+		err(EXIT_FAILURE, _("cannot read script"));
+	return buf;
+}
+
+/* open the device and create the new disk label in memory */
+static int batch_prepare(struct sfdisk *sf, struct sfdisk_job *job,
+			 char *script, size_t scriptsz)
+{
+	struct fdisk_context *cxt, *orgcxt = sf->cxt;
+	struct fdisk_script *dp = NULL;
+	struct timespec begin;
+	FILE *f = NULL;
+	int rc;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	cxt = job->cxt = fdisk_new_context();
+	if (!cxt)
+		err(EXIT_FAILURE, _("failed to allocate libfdisk context"));
+	fdisk_set_ask(cxt, ask_callback, (void *) sf);
+	fdisk_enable_bootbits_protection(cxt, 1);
+	fdisk_enable_direct_write(cxt, sf->directwrite);
+
+	/* the helpers below work with the current context */
+	sf->cxt = cxt;
+
+	rc = fdisk_assign_device(cxt, job->devname, sf->noact);
+	if (rc) {
+		warn(_("cannot open %s"), job->devname);
+		goto done;
+	}
+	if (!sf->noact) {
+		rc = blkdev_lock(fdisk_get_devfd(cxt), job->devname, sf->lockmode);
+		if (rc)
+			goto done;
+	}
+	if (!sf->noact && !sf->noreread && fdisk_device_is_used(cxt)) {
+		warnx(_("%s: device is currently in use"), job->devname);
+		if (!sf->force) {
+			rc = -EBUSY;
+			goto done;
+		}
+	}
+	if (sf->backup)
+		backup_partition_table(sf, job->devname);
+	if (fdisk_has_label(cxt))
+		fdisk_get_partitions(cxt, &job->org);
+	if (sf->append && !fdisk_has_label(cxt)) {
+		warnx(_("%s: cannot append partitions: no partition table was found"),
+				job->devname);
+		rc = -EINVAL;
+		goto done;
+	}
+
+	dp = fdisk_new_script(cxt);
+	f = fmemopen(script, scriptsz, "r");
+	if (!dp || !f)
+		err(EXIT_FAILURE, _("failed to allocate script handler"));
+
+	rc = fdisk_script_read_file(dp, f);
+	if (rc) {
+		warnx(_("%s: failed to parse script"), job->devname);
+		goto done;
+	}
+	if (!fdisk_script_get_header(dp, "label")) {
+		const char *label = sf->label;
+
+		if (!label && fdisk_has_label(cxt))
+			label = fdisk_label_get_name(fdisk_get_label(cxt, NULL));
+		rc = fdisk_script_set_header(dp, "label", label ? label : "dos");
+		if (rc)
+			goto done;
+	}
+
+	if (fdisk_get_collision(cxt))
+		follow_wipe_mode(sf);
+
+	if (sf->append)
+		rc = fdisk_apply_table(cxt, fdisk_script_get_table(dp));
+	else
+		rc = fdisk_apply_script(cxt, dp);
+	if (rc) {
+		errno = -rc;
+		warn(_("%s: failed to apply script"), job->devname);
+		goto done;
+	}
+
+	if (fdisk_get_collision(cxt))
+		follow_wipe_mode(sf);
+
+	/* -W always for the new partitions; the automatic mode asks user,
+	 * it's impossible here */
+	if (sf->pwipemode == WIPEMODE_ALWAYS) {
+		struct fdisk_table *parts = NULL;
+		struct fdisk_partition *pa;
+		struct fdisk_iter *itr = fdisk_new_iter(FDISK_ITER_FORWARD);
+
+		if (itr && fdisk_get_partitions(cxt, &parts) == 0) {
+			while (fdisk_table_next_partition(parts, itr, &pa) == 0) {
+				size_t partno = fdisk_partition_get_partno(pa);
+
+				if (sf->append && job->org &&
+				    fdisk_table_get_partition_by_partno(job->org, partno))
+					continue;
+				fdisk_wipe_partition(cxt, partno, TRUE);
+			}
+		}
+		fdisk_free_iter(itr);
+		fdisk_unref_table(parts);
+	}
+done:
+	if (f)
+		fclose(f);
+	fdisk_unref_script(dp);
+	sf->cxt = orgcxt;
+	job->prepare_time = batch_elapsed(&begin);
+	job->rc = rc;
+	return rc;
+}
+
+/* write the new disk label and tell kernel about the new partitions */
+static void batch_write(struct sfdisk *sf, struct sfdisk_job *job)
+{
+	struct fdisk_context *cxt = job->cxt;
+	struct timespec begin;
+	int noreread = sf->noact || sf->notell || fdisk_is_regfile(cxt);
+	int rc = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	if (!sf->noact)
+		rc = fdisk_write_disklabel(cxt);
+	if (rc) {
+		errno = -rc;
+		warn(_("%s: failed to write disk label"), job->devname);
+	}
+	if (!rc && !noreread)
+		rc = fdisk_reread_changes(cxt, job->org);
+	if (!rc)
+		rc = fdisk_deassign_device(cxt,
+				sf->noact || sf->notell);	/* no-sync */
+
+	job->write_time = batch_elapsed(&begin);
+	job->rc = rc;
+}
+
+static void *batch_worker(void *data)
+{
+	struct sfdisk_batch *b = (struct sfdisk_batch *) data;
+
+	do {
+		struct sfdisk_job *job = NULL;
+
+		pthread_mutex_lock(&b->lock);
+		while (b->next < b->njobs && !job) {
+			job = &b->jobs[b->next++];
+			if (job->rc)
+				job = NULL;	/* preparation failed */
+		}
+		pthread_mutex_unlock(&b->lock);
+
+		if (!job)
+			break;
+		batch_write(b->sf, job);
+	} while (1);
+
+	return NULL;
+}
+
+static int command_batch(struct sfdisk *sf, int argc, char **argv)
+{
+	struct sfdisk_batch batch = { .sf = sf };
+	pthread_t *threads;
+	size_t i, nthreads, scriptsz, nfails = 0;
+	char *script;
+	int quiet = sf->quiet;
+
+	if (!argc)
+		errx(EXIT_FAILURE, _("no disk device specified"));
+	if (sf->partno >= 0 || sf->label_nested || sf->movedata)
+		errx(EXIT_FAILURE, _("--batch is incompatible with -N, --label-nested and --move-data"));
+	if (isatty(STDIN_FILENO))
+		errx(EXIT_FAILURE, _("--batch requires script on standard input"));
+
+	for (i = 0; i < (size_t) argc; i++) {
+		glob_t gl;
+		size_t n;
+
+		if (!strpbrk(argv[i], "*?[")) {
+			batch_add_device(&batch.jobs, &batch.njobs, argv[i]);
+			continue;
+		}
+		if (glob(argv[i], 0, NULL, &gl) != 0)
+			errx(EXIT_FAILURE, _("no device matches '%s'"), argv[i]);
+		for (n = 0; n < gl.gl_pathc; n++)
+			batch_add_device(&batch.jobs, &batch.njobs, gl.gl_pathv[n]);
+		globfree(&gl);
+	}
+
+	script = batch_read_script(stdin, &scriptsz);
+	if (!scriptsz)
+		errx(EXIT_FAILURE, _("empty script"));
+
+	/* the messages from libfdisk would be mixed for all devices */
+	sf->quiet = 1;
+	for (i = 0; i < batch.njobs; i++)
+		batch_prepare(sf, &batch.jobs[i], script, scriptsz);
+
+	nthreads = min(sf->njobs ? sf->njobs : SFDISK_BATCH_JOBS, batch.njobs);
+	threads = xcalloc(nthreads, sizeof(pthread_t));
+	pthread_mutex_init(&batch.lock, NULL);
+
+	for (i = 0; i < nthreads; i++) {
+		errno = pthread_create(&threads[i], NULL, batch_worker, &batch);
+		if (errno)
+			err(EXIT_FAILURE, _("failed to create thread"));
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&batch.lock);
+	sf->quiet = quiet;
+
+	for (i = 0; i < batch.njobs; i++) {
+		struct sfdisk_job *job = &batch.jobs[i];
+
+		if (job->rc)
+			nfails++;
+		if (!sf->quiet || job->rc)
+			printf(_("%s: %s (prepare %.3f s, write %.3f s)\n"),
+				job->devname,
+				job->rc ? _("FAILED") :
+				sf->noact ? _("unchanged (--no-act)") : _("altered"),
+				job->prepare_time, job->write_time);
+
+		fdisk_unref_table(job->org);
+		fdisk_unref_context(job->cxt);
+		free(job->devname);
+	}
+
+	free(threads);
+	free(script);
+	free(batch.jobs);
+	return nfails ? -EIO : 0;
+}
+
 static void __attribute__((__noreturn__)) usage(void)
 {
 	FILE *out = stdout;
@@ -2026,6 +2341,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(USAGE_SEPARATOR, out);
 	fputs(_(" --disk-id <dev> [<str>]           print or change disk label ID (UUID)\n"), out);
 	fputs(_(" --relocate <oper> <dev>           move partition header\n"), out);
+	fputs(_(" --batch <dev> [<dev> ...]         apply script to all devices in parallel\n"), out);
 
 	fputs(USAGE_ARGUMENTS, out);
 	fputs(_(" <dev>                     device (usually disk) path\n"), out);
@@ -2038,7 +2354,9 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_("     --bytes               print SIZE in bytes rather than in human readable format\n"), out);
 	fputs(_("     --move-data[=<typescript>] move partition data after relocation (requires -N)\n"), out);
 	fputs(_("     --move-use-fsync      use fsync after each write when move data\n"), out);
+	fputs(_("     --direct-write        write partition table by direct I/O\n"), out);
 	fputs(_(" -f, --force               disable all consistency checking\n"), out);
+	fputs(_("     --jobs <num>          number of parallel writes for --batch\n"), out);
 
 	fprintf(out,
 	      _("     --color[=<when>]      colorize output (%s, %s or %s)\n"), "auto", "always", "never");
@@ -2105,6 +2423,9 @@ int main(int argc, char *argv[])
 		OPT_NOTELL,
 		OPT_RELOCATE,
 		OPT_LOCK,
+		OPT_BATCH,
+		OPT_JOBS,
+		OPT_DIRECTWRITE,
 	};
 
 	static const struct option longopts[] = {
@@ -2112,13 +2433,16 @@ int main(int argc, char *argv[])
 		{ "append",  no_argument,       NULL, 'a' },
 		{ "backup",  no_argument,       NULL, 'b' },
 		{ "backup-file", required_argument, NULL, 'O' },
+		{ "batch",   no_argument,	NULL, OPT_BATCH },
 		{ "bytes",   no_argument,	NULL, OPT_BYTES },
 		{ "color",   optional_argument, NULL, OPT_COLOR },
 		{ "lock",    optional_argument, NULL, OPT_LOCK },
 		{ "delete",  no_argument,	NULL, OPT_DELETE },
+		{ "direct-write", no_argument,	NULL, OPT_DIRECTWRITE },
 		{ "dump",    no_argument,	NULL, 'd' },
 		{ "help",    no_argument,       NULL, 'h' },
 		{ "force",   no_argument,       NULL, 'f' },
+		{ "jobs",    required_argument, NULL, OPT_JOBS },
 		{ "json",    no_argument,	NULL, 'J' },
 		{ "label",   required_argument, NULL, 'X' },
 		{ "label-nested", required_argument, NULL, 'Y' },
@@ -2311,6 +2635,9 @@ int main(int argc, char *argv[])
 		case OPT_MOVEFSYNC:
 			sf->movefsync = 1;
 			break;
+		case OPT_DIRECTWRITE:
+			sf->directwrite = 1;
+			break;
 		case OPT_DELETE:
 			sf->act = ACT_DELETE;
 			break;
@@ -2320,6 +2647,14 @@ int main(int argc, char *argv[])
 		case OPT_RELOCATE:
 			sf->act = ACT_RELOCATE;
 			break;
+		case OPT_BATCH:
+			sf->act = ACT_BATCH;
+			break;
+		case OPT_JOBS:
+			sf->njobs = strtou32_or_err(optarg, _("failed to parse number of jobs"));
+			if (!sf->njobs)
+				errx(EXIT_FAILURE, _("failed to parse number of jobs"));
+			break;
 		case OPT_LOCK:
 			sf->lockmode = "1";
 			if (optarg) {
@@ -2418,6 +2753,10 @@ int main(int argc, char *argv[])
 	case ACT_RELOCATE:
 		rc = command_relocate(sf, argc - optind, argv + optind);
 		break;
+
+	case ACT_BATCH:
+		rc = command_batch(sf, argc - optind, argv + optind);
+		break;
 	}
 
 	sfdisk_deinit(sf);
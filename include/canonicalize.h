@@ -17,6 +17,19 @@
 
 extern char *canonicalize_path(const char *path);
 extern char *canonicalize_path_restricted(const char *path);
+
+struct canonicalize_entry;
+struct canonicalize_cache {
+	struct canonicalize_entry **hash;
+	size_t hashsz;
+	size_t nents;
+};
+
+extern struct canonicalize_cache *new_canonicalize_cache(void);
+extern void free_canonicalize_cache(struct canonicalize_cache *cc);
+extern void reset_canonicalize_cache(struct canonicalize_cache *cc);
+extern char *canonicalize_path_cached(const char *path,
+				      struct canonicalize_cache *cc);
 extern char *canonicalize_dm_name(const char *ptname);
 extern char *__canonicalize_dm_name(const char *prefix, const char *ptname);
 
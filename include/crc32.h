@@ -4,6 +4,45 @@
 #include <sys/types.h>
 #include <stdint.h>
 
+#include "c.h"
+
+/*
+ * Hardware accelerated kernels are compiled in by __attribute__((target))
+ * and selected at runtime, so the rest of the code does not need any special
+ * compiler flags.
+ */
+#if defined(__x86_64__) && (defined(__clang__) || __GNUC_PREREQ(4, 9))
+# define UL_CRC_ACCEL_X86	1
+#endif
+#if defined(__aarch64__) && defined(HAVE_SYS_AUXV_H) && \
+    (defined(__clang__) || __GNUC_PREREQ(6, 0))
+# define UL_CRC_ACCEL_ARM	1
+#endif
+
+/*
+ * CRC implementation (kernel). The kernels update the raw CRC register, the
+ * pre and post inversion is up to the caller. The arrays of the kernels are
+ * terminated by an entry with name == NULL and sorted from the fastest to the
+ * slowest; the first usable kernel is used by ul_crc32() and crc32c().
+ */
+struct ul_crc_kernel {
+	const char *name;
+	uint32_t (*func)(uint32_t crc, const unsigned char *buf, size_t len);
+	int (*usable)(void);		/* NULL means always usable */
+};
+
+extern const struct ul_crc_kernel ul_crc32_kernels[];
+
+static inline const struct ul_crc_kernel *ul_crc_best_kernel(
+				const struct ul_crc_kernel *k)
+{
+	for (; k->name; k++) {
+		if (!k->usable || k->usable())
+			return k;
+	}
+	return NULL;
+}
+
 extern uint32_t ul_crc32(uint32_t seed, const unsigned char *buf, size_t len);
 extern uint32_t ul_crc32_exclude_offset(uint32_t seed, const unsigned char *buf, size_t len,
 		                              size_t exclude_off, size_t exclude_len);
@@ -9,18 +9,28 @@
 struct identry {
 	unsigned long int	id;
 	char			*name;
-	struct identry		*next;
+	struct identry		*next;		/* next in the hash bucket */
+	int			width;		/* name width */
+
+	unsigned int		numeric : 1;	/* not found, @name is the ID */
 };
 
 struct idcache {
-	struct identry	*ent;	/* first entry */
-	int		width;	/* name width */
+	struct identry	**tab;		/* hash table */
+	size_t		size;		/* number of buckets */
+	size_t		nents;		/* number of entries */
+	size_t		nmisses;	/* number of getpwuid()/getgrgid() calls */
+	int		width;		/* max. width of the requested names */
+
+	unsigned int	complete : 1;	/* all entries enumerated */
 };
 
 
 extern struct idcache *new_idcache(void);
 extern void add_gid(struct idcache *cache, unsigned long int id);
 extern void add_uid(struct idcache *cache, unsigned long int id);
+extern void add_all_uids(struct idcache *cache);
+extern void add_all_gids(struct idcache *cache);
 
 extern void free_idcache(struct idcache *ic);
 extern struct identry *get_id(struct idcache *ic, unsigned long int id);
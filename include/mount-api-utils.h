@@ -0,0 +1,155 @@
+/*
+ * No copyright is claimed.  This code is in the public domain; do with
+ * it what you wish.
+ *
+ * statmount(2) and listmount(2) (Linux 6.8) definitions. The structs are
+ * copied from linux/mount.h with ul_ prefix to avoid collisions with the
+ * kernel and libc headers.
+ */
+#ifndef UTIL_LINUX_MOUNT_API_UTILS
+#define UTIL_LINUX_MOUNT_API_UTILS
+
+#if defined(__linux__)
+# include <stdint.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+
+# ifndef SYS_statmount
+#  ifdef __alpha__
+#   define SYS_statmount	567
+#  else
+#   define SYS_statmount	457
+#  endif
+# endif
+
+# ifndef SYS_listmount
+#  ifdef __alpha__
+#   define SYS_listmount	568
+#  else
+#   define SYS_listmount	458
+#  endif
+# endif
+
+struct ul_mnt_id_req {
+	uint32_t size;
+	uint32_t spare;
+	uint64_t mnt_id;
+	uint64_t param;
+};
+
+#define UL_MNT_ID_REQ_SIZE_VER0	24
+
+struct ul_statmount {
+	uint32_t size;			/* total size, including strings */
+	uint32_t mnt_opts;		/* [str] options (comma separated, escaped) */
+	uint64_t mask;			/* what results were written */
+	uint32_t sb_dev_major;		/* device ID */
+	uint32_t sb_dev_minor;
+	uint64_t sb_magic;		/* ..._SUPER_MAGIC */
+	uint32_t sb_flags;		/* SB_{RDONLY,SYNCHRONOUS,DIRSYNC,LAZYTIME} */
+	uint32_t fs_type;		/* [str] filesystem type */
+	uint64_t mnt_id;		/* unique ID of mount */
+	uint64_t mnt_parent_id;		/* unique ID of parent */
+	uint32_t mnt_id_old;		/* reused IDs used in proc/.../mountinfo */
+	uint32_t mnt_parent_id_old;
+	uint64_t mnt_attr;		/* MOUNT_ATTR_... */
+	uint64_t mnt_propagation;	/* MS_{SHARED,SLAVE,PRIVATE,UNBINDABLE} */
+	uint64_t mnt_peer_group;	/* ID of shared peer group */
+	uint64_t mnt_master;		/* mount receives propagation from this ID */
+	uint64_t propagate_from;	/* propagation from in current namespace */
+	uint32_t mnt_root;		/* [str] root of mount relative to root of fs */
+	uint32_t mnt_point;		/* [str] mountpoint relative to current root */
+	uint64_t mnt_ns_id;		/* ID of the mount namespace */
+	uint32_t fs_subtype;		/* [str] subtype of fs_type (if any) */
+	uint32_t sb_source;		/* [str] source string of the mount */
+	uint32_t opt_num;
+	uint32_t opt_array;
+	uint32_t opt_sec_num;
+	uint32_t opt_sec_array;
+	uint64_t supported_mask;	/* mask of supported STATMOUNT_* flags */
+	uint32_t mnt_uidmap_num;
+	uint32_t mnt_uidmap;
+	uint32_t mnt_gidmap_num;
+	uint32_t mnt_gidmap;
+	uint64_t __spare2[43];
+	char str[];			/* variable size part containing strings */
+};
+
+#define UL_STATMOUNT_SB_BASIC		0x00000001U	/* want/got sb_... */
+#define UL_STATMOUNT_MNT_BASIC		0x00000002U	/* want/got mnt_... */
+#define UL_STATMOUNT_PROPAGATE_FROM	0x00000004U	/* want/got propagate_from */
+#define UL_STATMOUNT_MNT_ROOT		0x00000008U	/* want/got mnt_root  */
+#define UL_STATMOUNT_MNT_POINT		0x00000010U	/* want/got mnt_point */
+#define UL_STATMOUNT_FS_TYPE		0x00000020U	/* want/got fs_type */
+#define UL_STATMOUNT_MNT_NS_ID		0x00000040U	/* want/got mnt_ns_id */
+#define UL_STATMOUNT_MNT_OPTS		0x00000080U	/* want/got mnt_opts */
+#define UL_STATMOUNT_FS_SUBTYPE		0x00000100U	/* want/got fs_subtype */
+#define UL_STATMOUNT_SB_SOURCE		0x00000200U	/* want/got sb_source */
+#define UL_STATMOUNT_SUPPORTED_MASK	0x00001000U	/* want/got supported mask flags */
+
+/* listmount(2) @mnt_id for the whole namespace */
+#define UL_LSMT_ROOT		0xffffffffffffffffULL
+
+/* mnt_attr */
+#ifndef MOUNT_ATTR_RDONLY
+# define MOUNT_ATTR_RDONLY	0x00000001
+#endif
+#ifndef MOUNT_ATTR_NOSUID
+# define MOUNT_ATTR_NOSUID	0x00000002
+#endif
+#ifndef MOUNT_ATTR_NODEV
+# define MOUNT_ATTR_NODEV	0x00000004
+#endif
+#ifndef MOUNT_ATTR_NOEXEC
+# define MOUNT_ATTR_NOEXEC	0x00000008
+#endif
+#ifndef MOUNT_ATTR__ATIME
+# define MOUNT_ATTR__ATIME	0x00000070
+#endif
+#ifndef MOUNT_ATTR_RELATIME
+# define MOUNT_ATTR_RELATIME	0x00000000
+#endif
+#ifndef MOUNT_ATTR_NOATIME
+# define MOUNT_ATTR_NOATIME	0x00000010
+#endif
+#ifndef MOUNT_ATTR_STRICTATIME
+# define MOUNT_ATTR_STRICTATIME	0x00000020
+#endif
+#ifndef MOUNT_ATTR_NODIRATIME
+# define MOUNT_ATTR_NODIRATIME	0x00000080
+#endif
+#ifndef MOUNT_ATTR_IDMAP
+# define MOUNT_ATTR_IDMAP	0x00100000
+#endif
+#ifndef MOUNT_ATTR_NOSYMFOLLOW
+# define MOUNT_ATTR_NOSYMFOLLOW	0x00200000
+#endif
+
+static inline int ul_statmount(uint64_t mnt_id, uint64_t mask,
+			       struct ul_statmount *buf, size_t bufsize)
+{
+	struct ul_mnt_id_req req = {
+		.size = UL_MNT_ID_REQ_SIZE_VER0,
+		.mnt_id = mnt_id,
+		.param = mask
+	};
+
+	return syscall(SYS_statmount, &req, buf, bufsize, 0);
+}
+
+/* returns number of IDs after @last_id in the current namespace */
+static inline ssize_t ul_listmount(uint64_t last_id, uint64_t *ids, size_t nids)
+{
+	struct ul_mnt_id_req req = {
+		.size = UL_MNT_ID_REQ_SIZE_VER0,
+		.mnt_id = UL_LSMT_ROOT,
+		.param = last_id
+	};
+
+	return syscall(SYS_listmount, &req, ids, nids, 0);
+}
+
+# define UL_HAVE_STATMOUNT 1
+
+#endif /* __linux__ */
+#endif /* UTIL_LINUX_MOUNT_API_UTILS */
@@ -62,6 +62,9 @@ struct ul_pty_callbacks {
 	int (*flush_logs)(void *);
 };
 
+/* I/O buffer, large enough to not split high-rate output to many small reads */
+#define UL_PTY_BUFSIZ	(64 * 1024)
+
 struct ul_pty {
 	struct termios	stdin_attrs;	/* stdin and slave terminal runtime attributes */
 	int		master;		/* parent side */
@@ -80,6 +83,8 @@ struct ul_pty {
 
 	struct timeval	next_callback_time;
 
+	char		iobuf[UL_PTY_BUFSIZ];	/* handle_io() buffer */
+
 	unsigned int isterm:1,		/* is stdin terminal? */
 		     slave_echo:1;	/* keep ECHO on stdin */
 };
@@ -7,6 +7,7 @@
    100% Public Domain
  */
 
+#include <stddef.h>
 #include "stdint.h"
 
 #define UL_SHA1LENGTH		20
@@ -24,4 +25,28 @@ void ul_SHA1Update(UL_SHA1_CTX *context, const unsigned char *data, uint32_t len
 void ul_SHA1Final(unsigned char digest[UL_SHA1LENGTH], UL_SHA1_CTX *context);
 void ul_SHA1(char *hash_out, const char *str, unsigned len);
 
+/*
+ * Hash @n messages at once; the message i is @prefix (may be NULL if
+ * @prefixlen is zero) followed by @len[i] bytes from @data[i].
+ */
+void ul_SHA1Multi(unsigned char (*digests)[UL_SHA1LENGTH], size_t n,
+		  const unsigned char *prefix, size_t prefixlen,
+		  const unsigned char *const *data, const size_t *len);
+
+/*
+ * Block functions, the first usable is used by ul_SHA1Update(). The array is
+ * terminated by an entry with name == NULL.
+ */
+struct ul_sha1_kernel {
+	const char *name;
+	void (*blocks)(uint32_t state[5], const unsigned char *data, size_t nblocks);
+	int (*usable)(void);		/* NULL means always usable */
+};
+
+extern const struct ul_sha1_kernel ul_sha1_kernels[];
+
+/* Use the kernel @k rather than the best one (for tests), returns -1 if the
+ * kernel is not usable on the CPU. */
+extern int ul_sha1_set_kernel(const struct ul_sha1_kernel *k);
+
 #endif /* UTIL_LINUX_SHA1_H */
@@ -140,6 +140,262 @@ char *canonicalize_path(const char *path)
 	return canonical;
 }
 
+/*
+ * Component cache for canonicalize_path_cached(). The key is a canonical
+ * path of the component (resolved parent + "/" + name), the value is the
+ * symlink content or the type of the component. The result of lstat() and
+ * readlink() is so shared by all paths with the same prefix.
+ */
+struct canonicalize_entry {
+	struct canonicalize_entry *next;
+	char	*link;		/* symlink content or NULL */
+	int	isdir;
+	char	key[];
+};
+
+static unsigned int canonicalize_hash(const char *str, size_t len)
+{
+	unsigned int h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= (unsigned char) str[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+struct canonicalize_cache *new_canonicalize_cache(void)
+{
+	return calloc(1, sizeof(struct canonicalize_cache));
+}
+
+/* removes all entries, the cache is stale after mount or umount */
+void reset_canonicalize_cache(struct canonicalize_cache *cc)
+{
+	size_t i;
+
+	if (!cc)
+		return;
+
+	for (i = 0; i < cc->hashsz; i++) {
+		struct canonicalize_entry *e = cc->hash[i];
+
+		while (e) {
+			struct canonicalize_entry *next = e->next;
+
+			free(e->link);
+			free(e);
+			e = next;
+		}
+		cc->hash[i] = NULL;
+	}
+	cc->nents = 0;
+}
+
+void free_canonicalize_cache(struct canonicalize_cache *cc)
+{
+	if (!cc)
+		return;
+
+	reset_canonicalize_cache(cc);
+	free(cc->hash);
+	free(cc);
+}
+
+static int canonicalize_cache_resize(struct canonicalize_cache *cc)
+{
+	size_t i, sz = cc->hashsz ? cc->hashsz * 2 : 256;
+	struct canonicalize_entry **hash;
+
+	hash = calloc(sz, sizeof(struct canonicalize_entry *));
+	if (!hash)
+		return -ENOMEM;
+
+	for (i = 0; i < cc->hashsz; i++) {
+		struct canonicalize_entry *e = cc->hash[i];
+
+		while (e) {
+			struct canonicalize_entry *next = e->next;
+			unsigned int h = canonicalize_hash(e->key, strlen(e->key));
+
+			e->next = hash[h & (sz - 1)];
+			hash[h & (sz - 1)] = e;
+			e = next;
+		}
+	}
+	free(cc->hash);
+	cc->hash = hash;
+	cc->hashsz = sz;
+	return 0;
+}
+
+/* returns cached or newly lstat()-ed component @path, NULL on error */
+static struct canonicalize_entry *canonicalize_cache_get(
+				struct canonicalize_cache *cc,
+				const char *path, size_t len)
+{
+	struct canonicalize_entry *e;
+	struct stat st;
+	unsigned int h = canonicalize_hash(path, len);
+
+	if (cc->hashsz) {
+		for (e = cc->hash[h & (cc->hashsz - 1)]; e; e = e->next) {
+			if (strcmp(e->key, path) == 0)
+				return e;
+		}
+	}
+
+	if (lstat(path, &st) != 0)
+		return NULL;
+
+	if (cc->nents >= cc->hashsz / 4 * 3 && canonicalize_cache_resize(cc) != 0)
+		return NULL;
+
+	e = malloc(sizeof(*e) + len + 1);
+	if (!e)
+		return NULL;
+	memcpy(e->key, path, len + 1);
+	e->link = NULL;
+	e->isdir = S_ISDIR(st.st_mode);
+
+	if (S_ISLNK(st.st_mode)) {
+		char buf[PATH_MAX];
+		ssize_t sz = readlink(path, buf, sizeof(buf) - 1);
+
+		if (sz <= 0 || !(e->link = strndup(buf, sz))) {
+			free(e);
+			if (sz == 0)
+				errno = ENOENT;
+			return NULL;
+		}
+	}
+
+	e->next = cc->hash[h & (cc->hashsz - 1)];
+	cc->hash[h & (cc->hashsz - 1)] = e;
+	cc->nents++;
+	return e;
+}
+
+/*
+ * The same as realpath(), but the path components are resolved by @cc. The
+ * cache is not invalidated automatically, the caller has to use
+ * reset_canonicalize_cache() after mount or umount. Returns NULL on error.
+ */
+static char *realpath_cached(const char *path, struct canonicalize_cache *cc)
+{
+	char res[PATH_MAX], *todo, *next;
+	size_t reslen = 0;
+	int nlinks = 0;
+
+	todo = strdup(path);
+	if (!todo)
+		return NULL;
+
+	if (is_relative_path(path)) {
+		if (!getcwd(res, sizeof(res)))
+			goto err;
+		reslen = strlen(res);
+		if (reslen == 1)
+			reslen = 0;		/* "/" */
+	}
+
+	for (next = todo; *next; ) {
+		struct canonicalize_entry *e;
+		char *name = next;
+		size_t namesz;
+
+		while (*name == '/')
+			name++;
+		namesz = strcspn(name, "/");
+		next = name + namesz;
+
+		if (namesz == 0 || (namesz == 1 && *name == '.'))
+			continue;
+		if (namesz == 2 && name[0] == '.' && name[1] == '.') {
+			while (reslen && res[--reslen] != '/');
+			continue;
+		}
+
+		if (reslen + 1 + namesz >= sizeof(res)) {
+			errno = ENAMETOOLONG;
+			goto err;
+		}
+		res[reslen] = '/';
+		memcpy(res + reslen + 1, name, namesz);
+		res[reslen + 1 + namesz] = '\0';
+
+		e = canonicalize_cache_get(cc, res, reslen + 1 + namesz);
+		if (!e)
+			goto err;
+
+		if (e->link) {
+			/* replace the symlink by its content in @todo */
+			size_t linksz = strlen(e->link), restsz = strlen(next);
+			char *x;
+
+			if (++nlinks > 40) {
+				errno = ELOOP;
+				goto err;
+			}
+			x = malloc(linksz + restsz + 1);
+			if (!x)
+				goto err;
+			memcpy(x, e->link, linksz);
+			memcpy(x + linksz, next, restsz + 1);
+			free(todo);
+			next = todo = x;
+
+			if (*e->link == '/')
+				reslen = 0;
+			continue;
+		}
+
+		if (!e->isdir && *next) {
+			errno = ENOTDIR;
+			goto err;
+		}
+		reslen += 1 + namesz;
+	}
+
+	free(todo);
+	if (!reslen)
+		return strdup("/");
+	res[reslen] = '\0';
+	return strdup(res);
+err:
+	free(todo);
+	return NULL;
+}
+
+/*
+ * Like canonicalize_path(), but the path components are cached in @cc, so
+ * paths with a common prefix don't lstat() and readlink() the prefix again.
+ */
+char *canonicalize_path_cached(const char *path, struct canonicalize_cache *cc)
+{
+	char *canonical, *dmname;
+
+	if (!cc)
+		return canonicalize_path(path);
+	if (!path || !*path)
+		return NULL;
+
+	canonical = realpath_cached(path, cc);
+	if (!canonical)
+		return strdup(path);
+
+	if (is_dm_devname(canonical, &dmname)) {
+		char *dm = canonicalize_dm_name(dmname);
+		if (dm) {
+			free(canonical);
+			return dm;
+		}
+	}
+
+	return canonical;
+}
+
 char *canonicalize_path_restricted(const char *path)
 {
 	char *canonical = NULL;
@@ -239,10 +495,32 @@ done:
 int main(int argc, char **argv)
 {
 	if (argc < 2) {
-		fprintf(stderr, "usage: %s <device>\n", argv[0]);
+		fprintf(stderr, "usage: %s <device> [<device> ...]\n", argv[0]);
 		exit(EXIT_FAILURE);
 	}
 
+	if (argc > 2) {
+		/* compare cached and uncached results for all the paths */
+		struct canonicalize_cache *cc = new_canonicalize_cache();
+		int i, rc = EXIT_SUCCESS;
+
+		if (!cc)
+			exit(EXIT_FAILURE);
+		for (i = 1; i < argc; i++) {
+			char *a = canonicalize_path(argv[i]);
+			char *b = canonicalize_path_cached(argv[i], cc);
+
+			fprintf(stdout, "%s: %s%s\n", argv[i], b,
+				a && b && strcmp(a, b) == 0 ? "" : " [mismatch]");
+			if (!a || !b || strcmp(a, b) != 0)
+				rc = EXIT_FAILURE;
+			free(a);
+			free(b);
+		}
+		free_canonicalize_cache(cc);
+		exit(rc);
+	}
+
 	fprintf(stdout, "orig: %s\n", argv[1]);
 	fprintf(stdout, "real: %s\n", canonicalize_path(argv[1]));
 	exit(EXIT_SUCCESS);
@@ -7,19 +7,34 @@
 #include <wchar.h>
 #include <pwd.h>
 #include <grp.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 #include "c.h"
 #include "idcache.h"
 
+#define IDCACHE_INIT_SIZE	64	/* must be power of 2 */
+
+/*
+ * Number of IDs not found in the cache before add_uid()/add_gid() switch to
+ * one getpwent()/getgrent() enumeration rather than per-ID NSS lookups. Tools
+ * with a few distinct owners never enumerate a (possibly huge) directory.
+ */
+#define IDCACHE_PREFETCH_MISSES	64
+
+static inline size_t id_hash(const struct idcache *ic, unsigned long int id)
+{
+	return (size_t) (((uint64_t) id * 0x9E3779B97F4A7C15ULL) >> 32) & (ic->size - 1);
+}
+
 struct identry *get_id(struct idcache *ic, unsigned long int id)
 {
 	struct identry *ent;
 
-	if (!ic)
+	if (!ic || !ic->tab)
 		return NULL;
 
-	for (ent = ic->ent; ent; ent = ent->next) {
+	for (ent = ic->tab[id_hash(ic, id)]; ent; ent = ent->next) {
 		if (ent->id == id)
 			return ent;
 	}
@@ -34,26 +49,68 @@ struct idcache *new_idcache(void)
 
 void free_idcache(struct idcache *ic)
 {
-	struct identry *ent = ic->ent;
+	size_t i;
+
+	if (!ic)
+		return;
+
+	for (i = 0; i < ic->size; i++) {
+		struct identry *ent = ic->tab[i];
 
-	while (ent) {
-		struct identry *next = ent->next;
-		free(ent->name);
-		free(ent);
-		ent = next;
+		while (ent) {
+			struct identry *next = ent->next;
+			free(ent->name);
+			free(ent);
+			ent = next;
+		}
 	}
 
+	free(ic->tab);
 	free(ic);
 }
 
-static void add_id(struct idcache *ic, char *name, unsigned long int id)
+static int resize_idcache(struct idcache *ic)
 {
-	struct identry *ent, *x;
+	struct identry **tab, **old = ic->tab;
+	size_t i, oldsz = ic->size;
+
+	tab = calloc(oldsz ? oldsz * 2 : IDCACHE_INIT_SIZE, sizeof(*tab));
+	if (!tab)
+		return -ENOMEM;
+
+	ic->tab = tab;
+	ic->size = oldsz ? oldsz * 2 : IDCACHE_INIT_SIZE;
+
+	for (i = 0; i < oldsz; i++) {
+		struct identry *ent = old[i];
+
+		while (ent) {
+			struct identry *next = ent->next;
+			size_t h = id_hash(ic, ent->id);
+
+			ent->next = tab[h];
+			tab[h] = ent;
+			ent = next;
+		}
+	}
+
+	free(old);
+	return 0;
+}
+
+static struct identry *add_id(struct idcache *ic, const char *name,
+			      unsigned long int id)
+{
+	struct identry *ent;
+	size_t h;
 	int w = 0;
 
+	if (ic->nents >= ic->size && resize_idcache(ic) != 0 && !ic->tab)
+		return NULL;
+
 	ent = calloc(1, sizeof(struct identry));
 	if (!ent)
-		return;
+		return NULL;
 	ent->id = id;
 
 	if (name) {
@@ -74,44 +131,170 @@ static void add_id(struct idcache *ic, char *name, unsigned long int id)
 		ent->name = strdup(name);
 		if (!ent->name) {
 			free(ent);
-			return;
+			return NULL;
 		}
 	} else {
 		if (asprintf(&ent->name, "%lu", id) < 0) {
 			free(ent);
-			return;
+			return NULL;
 		}
+		ent->numeric = 1;
 	}
 
-	for (x = ic->ent; x && x->next; x = x->next);
-
-	if (x)
-		x->next = ent;
-	else
-		ic->ent = ent;
+	h = id_hash(ic, id);
+	ent->next = ic->tab[h];
+	ic->tab[h] = ent;
+	ic->nents++;
 
 	if (w <= 0)
 		w = ent->name ? strlen(ent->name) : 0;
-	ic->width = ic->width < w ? w : ic->width;
+	ent->width = w;
+	return ent;
+}
+
+/*
+ * The width is updated only for the requested IDs, the entries added by
+ * add_all_uids()/add_all_gids() don't affect it.
+ */
+static void use_id(struct idcache *ic, const struct identry *ent)
+{
+	if (ent && ic->width < ent->width)
+		ic->width = ent->width;
+}
+
+/*
+ * Adds all users known to NSS. It's one enumeration rather than a lookup for
+ * each ID, with the "files" backend it's a single read of /etc/passwd.
+ */
+void add_all_uids(struct idcache *cache)
+{
+	struct passwd *pw;
+
+	if (!cache || cache->complete)
+		return;
+
+	setpwent();
+	while ((pw = getpwent())) {
+		if (!get_id(cache, pw->pw_uid))
+			add_id(cache, pw->pw_name, pw->pw_uid);
+	}
+	endpwent();
+
+	cache->complete = 1;
+}
+
+void add_all_gids(struct idcache *cache)
+{
+	struct group *gr;
+
+	if (!cache || cache->complete)
+		return;
+
+	setgrent();
+	while ((gr = getgrent())) {
+		if (!get_id(cache, gr->gr_gid))
+			add_id(cache, gr->gr_name, gr->gr_gid);
+	}
+	endgrent();
+
+	cache->complete = 1;
 }
 
 void add_uid(struct idcache *cache, unsigned long int id)
 {
-	struct identry *ent= get_id(cache, id);
+	struct identry *ent = get_id(cache, id);
+	struct passwd *pw;
+
+	if (!ent && !cache->complete && ++cache->nmisses > IDCACHE_PREFETCH_MISSES) {
+		add_all_uids(cache);
+		ent = get_id(cache, id);
+	}
 
+	/* the enumeration does not have to return everything (e.g. LDAP) */
 	if (!ent) {
-		struct passwd *pw = getpwuid((uid_t) id);
-		add_id(cache, pw ? pw->pw_name : NULL, id);
+		pw = getpwuid((uid_t) id);
+		ent = add_id(cache, pw ? pw->pw_name : NULL, id);
 	}
+	use_id(cache, ent);
 }
 
 void add_gid(struct idcache *cache, unsigned long int id)
 {
 	struct identry *ent = get_id(cache, id);
+	struct group *gr;
+
+	if (!ent && !cache->complete && ++cache->nmisses > IDCACHE_PREFETCH_MISSES) {
+		add_all_gids(cache);
+		ent = get_id(cache, id);
+	}
 
 	if (!ent) {
-		struct group *gr = getgrgid((gid_t) id);
-		add_id(cache, gr ? gr->gr_name : NULL, id);
+		gr = getgrgid((gid_t) id);
+		ent = add_id(cache, gr ? gr->gr_name : NULL, id);
 	}
+	use_id(cache, ent);
 }
 
+#ifdef TEST_PROGRAM
+#include <getopt.h>
+#include "strutils.h"
+
+int main(int argc, char *argv[])
+{
+	struct idcache *ic;
+	int c, groups = 0, all = 0;
+
+	static const struct option longopts[] = {
+		{ "all",    no_argument, NULL, 'a' },
+		{ "groups", no_argument, NULL, 'g' },
+		{ NULL, 0, NULL, 0 }
+	};
+
+	while ((c = getopt_long(argc, argv, "ag", longopts, NULL)) != -1) {
+		switch (c) {
+		case 'a':
+			all = 1;
+			break;
+		case 'g':
+			groups = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [--all] [--groups] [id ...]\n",
+					program_invocation_short_name);
+			return EXIT_FAILURE;
+		}
+	}
+
+	ic = new_idcache();
+	if (!ic)
+		err(EXIT_FAILURE, "cannot allocate cache");
+
+	if (all) {
+		if (groups)
+			add_all_gids(ic);
+		else
+			add_all_uids(ic);
+	}
+
+	for (; optind < argc; optind++) {
+		unsigned long int id = strtoul_or_err(argv[optind], "failed to parse ID");
+		struct identry *ent;
+
+		if (groups)
+			add_gid(ic, id);
+		else
+			add_uid(ic, id);
+
+		ent = get_id(ic, id);
+		if (ent)
+			printf("%lu: %s%s\n", id, ent->name,
+					ent->numeric ? " (unknown)" : "");
+	}
+
+	printf("entries: %zu, buckets: %zu, width: %d\n",
+			ic->nents, ic->size, ic->width);
+
+	free_idcache(ic);
+	return EXIT_SUCCESS;
+}
+#endif /* TEST_PROGRAM */
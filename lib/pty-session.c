@@ -337,7 +337,7 @@ static int mainloop_callback(struct ul_pty *pty)
 
 static int handle_io(struct ul_pty *pty, int fd, int *eof)
 {
-	char buf[BUFSIZ];
+	char *buf = pty->iobuf;
 	ssize_t bytes;
 	int rc = 0;
 
@@ -345,7 +345,7 @@ static int handle_io(struct ul_pty *pty, int fd, int *eof)
 	*eof = 0;
 
 	/* read from active FD */
-	bytes = read(fd, buf, sizeof(buf));
+	bytes = read(fd, buf, sizeof(pty->iobuf));
 	if (bytes < 0) {
 		if (errno == EAGAIN || errno == EINTR)
 			return 0;
@@ -365,8 +365,10 @@ static int handle_io(struct ul_pty *pty, int fd, int *eof)
 			return -errno;
 
 		/* without sync write_output() will write both input &
-		 * shell output that looks like double echoing */
-		fdatasync(pty->master);
+		 * shell output that looks like double echoing; it's
+		 * relevant only if the slave echoes the input */
+		if (pty->slave_echo)
+			fdatasync(pty->master);
 
 	/* from command (master) to stdout */
 	} else if (fd == pty->master) {
@@ -14,6 +14,7 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "c.h"
 #include "sha1.h"
 
 #define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
@@ -159,6 +160,213 @@ void ul_SHA1Transform(uint32_t state[5], const unsigned char buffer[64])
 #endif
 }
 
+static void sha1_blocks_generic(uint32_t state[5], const unsigned char *data, size_t nblocks)
+{
+	for (; nblocks; nblocks--, data += 64)
+		ul_SHA1Transform(state, data);
+}
+
+/*
+ * SHA extensions (x86_64 SHA-NI and ARMv8 crypto extensions) are compiled in
+ * by __attribute__((target)) and used only if supported by the CPU.
+ */
+#if defined(__x86_64__) && (defined(__clang__) || __GNUC_PREREQ(5, 0))
+# define UL_SHA1_ACCEL_X86	1
+# include <cpuid.h>
+# include <immintrin.h>
+# ifndef bit_SHA
+#  define bit_SHA	(1 << 29)
+# endif
+
+static int sha1_shani_usable(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (__get_cpuid_max(0, NULL) < 7)
+		return 0;
+	__cpuid(1, eax, ebx, ecx, edx);
+	if (!(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+		return 0;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	return (ebx & bit_SHA) ? 1 : 0;
+}
+
+/*
+ * The message words are kept in the reversed order (W[0] in the highest
+ * lane), that's what the SHA instructions expect. The schedule is
+ * W[i] = sha1msg2(sha1msg1(W[i-16..], W[i-12..]) ^ W[i-8..], W[i-4..]).
+ *
+ * Four rounds; @i is the index of the group of rounds, @f the function.
+ */
+#define SHANI_ROUNDS4(i, f) do { \
+	if (i < 4) \
+		w[i & 3] = _mm_shuffle_epi8(_mm_loadu_si128( \
+				(const __m128i *) (data + i * 16)), mask); \
+	else \
+		w[i & 3] = _mm_sha1msg2_epu32( \
+				_mm_xor_si128( \
+					_mm_sha1msg1_epu32(w[i & 3], w[(i + 1) & 3]), \
+					w[(i + 2) & 3]), \
+				w[(i + 3) & 3]); \
+	e = i == 0 ? _mm_add_epi32(e0, w[0]) : _mm_sha1nexte_epu32(prev, w[i & 3]); \
+	prev = abcd; \
+	abcd = _mm_sha1rnds4_epu32(abcd, e, f); \
+} while (0)
+
+static void __attribute__((target("sha,ssse3,sse4.1")))
+sha1_blocks_shani(uint32_t state[5], const unsigned char *data, size_t nblocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+	__m128i abcd, e0;
+
+	abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) state), 0x1B);
+	e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	for (; nblocks; nblocks--, data += 64) {
+		__m128i w[4], e, prev = abcd, abcd_save = abcd;
+
+		SHANI_ROUNDS4(0, 0);
+		SHANI_ROUNDS4(1, 0);
+		SHANI_ROUNDS4(2, 0);
+		SHANI_ROUNDS4(3, 0);
+		SHANI_ROUNDS4(4, 0);
+		SHANI_ROUNDS4(5, 1);
+		SHANI_ROUNDS4(6, 1);
+		SHANI_ROUNDS4(7, 1);
+		SHANI_ROUNDS4(8, 1);
+		SHANI_ROUNDS4(9, 1);
+		SHANI_ROUNDS4(10, 2);
+		SHANI_ROUNDS4(11, 2);
+		SHANI_ROUNDS4(12, 2);
+		SHANI_ROUNDS4(13, 2);
+		SHANI_ROUNDS4(14, 2);
+		SHANI_ROUNDS4(15, 3);
+		SHANI_ROUNDS4(16, 3);
+		SHANI_ROUNDS4(17, 3);
+		SHANI_ROUNDS4(18, 3);
+		SHANI_ROUNDS4(19, 3);
+
+		e0 = _mm_sha1nexte_epu32(prev, e0);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	_mm_storeu_si128((__m128i *) state, _mm_shuffle_epi32(abcd, 0x1B));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+#endif /* x86_64 */
+
+#if defined(__aarch64__) && defined(HAVE_SYS_AUXV_H) && \
+    (defined(__clang__) || __GNUC_PREREQ(6, 0))
+# define UL_SHA1_ACCEL_ARM	1
+# include <sys/auxv.h>
+# include <arm_neon.h>
+# ifndef HWCAP_SHA1
+#  define HWCAP_SHA1	(1 << 5)
+# endif
+# ifdef __clang__
+#  define UL_SHA1_ARM_TARGET	__attribute__((target("crypto")))
+# else
+#  define UL_SHA1_ARM_TARGET	__attribute__((target("+crypto")))
+# endif
+
+static int sha1_armv8_usable(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_SHA1) ? 1 : 0;
+}
+
+static void UL_SHA1_ARM_TARGET
+sha1_blocks_armv8(uint32_t state[5], const unsigned char *data, size_t nblocks)
+{
+	static const uint32_t k[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+	uint32x4_t abcd = vld1q_u32(state);
+	uint32_t e0 = state[4];
+
+	for (; nblocks; nblocks--, data += 64) {
+		uint32x4_t abcd_save = abcd, w[4], tmp;
+		uint32_t e = e0, e_next;
+		int i;
+
+		for (i = 0; i < 20; i++) {
+			if (i < 4)
+				w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+			else
+				w[i & 3] = vsha1su1q_u32(
+						vsha1su0q_u32(w[i & 3], w[(i + 1) & 3], w[(i + 2) & 3]),
+						w[(i + 3) & 3]);
+
+			tmp = vaddq_u32(w[i & 3], vdupq_n_u32(k[i / 5]));
+			e_next = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+
+			switch (i / 5) {
+			case 0:
+				abcd = vsha1cq_u32(abcd, e, tmp);
+				break;
+			case 2:
+				abcd = vsha1mq_u32(abcd, e, tmp);
+				break;
+			default:
+				abcd = vsha1pq_u32(abcd, e, tmp);
+				break;
+			}
+			e = e_next;
+		}
+
+		abcd = vaddq_u32(abcd, abcd_save);
+		e0 += e;
+	}
+
+	vst1q_u32(state, abcd);
+	state[4] = e0;
+}
+#endif /* aarch64 */
+
+const struct ul_sha1_kernel ul_sha1_kernels[] = {
+#ifdef UL_SHA1_ACCEL_X86
+	{ "sha-ni",	sha1_blocks_shani,	sha1_shani_usable },
+#endif
+#ifdef UL_SHA1_ACCEL_ARM
+	{ "armv8",	sha1_blocks_armv8,	sha1_armv8_usable },
+#endif
+	{ "generic",	sha1_blocks_generic,	NULL },
+	{ NULL }
+};
+
+typedef void (*sha1_blocks_fn)(uint32_t state[5], const unsigned char *data, size_t nblocks);
+
+static void sha1_blocks_dispatch(uint32_t state[5], const unsigned char *data, size_t nblocks);
+
+/* The first call replaces the pointer by the best kernel for the CPU; all
+ * threads store the same value, so the race is harmless. */
+static sha1_blocks_fn sha1_blocks = sha1_blocks_dispatch;
+
+static sha1_blocks_fn sha1_resolve_blocks(void)
+{
+	const struct ul_sha1_kernel *k;
+
+	if (sha1_blocks != sha1_blocks_dispatch)
+		return sha1_blocks;
+
+	for (k = ul_sha1_kernels; k->name; k++) {
+		if (!k->usable || k->usable())
+			break;
+	}
+	sha1_blocks = k->blocks;
+	return sha1_blocks;
+}
+
+static void sha1_blocks_dispatch(uint32_t state[5], const unsigned char *data, size_t nblocks)
+{
+	sha1_resolve_blocks()(state, data, nblocks);
+}
+
+int ul_sha1_set_kernel(const struct ul_sha1_kernel *k)
+{
+	if (k->usable && !k->usable())
+		return -1;
+	sha1_blocks = k->blocks;
+	return 0;
+}
+
 /* SHA1Init - Initialize new context */
 
 void ul_SHA1Init(UL_SHA1_CTX *context)
@@ -187,9 +395,10 @@ void ul_SHA1Update(UL_SHA1_CTX *context, const unsigned char *data, uint32_t len
 	j = (j >> 3) & 63;
 	if ((j + len) > 63) {
 		memcpy(&context->buffer[j], data, (i = 64 - j));
-		ul_SHA1Transform(context->state, context->buffer);
-		for (; i + 63 < len; i += 64) {
-			ul_SHA1Transform(context->state, &data[i]);
+		sha1_blocks(context->state, context->buffer, 1);
+		if (len - i >= 64) {
+			sha1_blocks(context->state, &data[i], (len - i) / 64);
+			i += (len - i) & ~63U;
 		}
 		j = 0;
 	} else
@@ -201,38 +410,19 @@ void ul_SHA1Update(UL_SHA1_CTX *context, const unsigned char *data, uint32_t len
 
 void ul_SHA1Final(unsigned char digest[20], UL_SHA1_CTX *context)
 {
+	static const unsigned char padding[64] = { 0200 };
 	unsigned i;
 
 	unsigned char finalcount[8];
 
-	unsigned char c;
-
-#if 0				/* untested "improvement" by DHR */
-	/* Convert context->count to a sequence of bytes
-	 * in finalcount.  Second element first, but
-	 * big-endian order within element.
-	 * But we do it all backwards.
-	 */
-	unsigned char *fcp = &finalcount[8];
-
-	for (i = 0; i < 2; i++) {
-		uint32_t t = context->count[i];
-
-		int j;
+	uint32_t used;
 
-		for (j = 0; j < 4; t >>= 8, j++)
-			*--fcp = (unsigned char)t}
-#else
 	for (i = 0; i < 8; i++) {
 		finalcount[i] = (unsigned char)((context->count[(i >= 4 ? 0 : 1)] >> ((3 - (i & 3)) * 8)) & 255);	/* Endian independent */
 	}
-#endif
-	c = 0200;
-	ul_SHA1Update(context, &c, 1);
-	while ((context->count[0] & 504) != 448) {
-		c = 0000;
-		ul_SHA1Update(context, &c, 1);
-	}
+	/* 0x80 and zeros up to 56 mod 64 bytes */
+	used = (context->count[0] >> 3) & 63;
+	ul_SHA1Update(context, padding, used < 56 ? 56 - used : 120 - used);
 	ul_SHA1Update(context, finalcount, 8);	/* Should cause a SHA1Transform() */
 	for (i = 0; i < 20; i++) {
 		digest[i] = (unsigned char)
@@ -246,11 +436,215 @@ void ul_SHA1Final(unsigned char digest[20], UL_SHA1_CTX *context)
 void ul_SHA1(char *hash_out, const char *str, unsigned len)
 {
 	UL_SHA1_CTX ctx;
-	unsigned int ii;
 
 	ul_SHA1Init(&ctx);
-	for (ii = 0; ii < len; ii += 1)
-		ul_SHA1Update(&ctx, (const unsigned char *)str + ii, 1);
+	ul_SHA1Update(&ctx, (const unsigned char *)str, len);
 	ul_SHA1Final((unsigned char *)hash_out, &ctx);
 	hash_out[20] = '\0';
 }
+
+/*
+ * Multi-buffer hashing. The message i is the common @prefix followed by
+ * @data[i]. The padded blocks are built directly from the message parts, so
+ * there is no per-message context and no copying of the whole messages.
+ */
+struct sha1_mb_msg {
+	const unsigned char *prefix;
+	size_t prefixlen;
+	const unsigned char *data;
+	size_t len;
+	size_t nblocks;
+};
+
+static void sha1_mb_init_msg(struct sha1_mb_msg *m,
+			const unsigned char *prefix, size_t prefixlen,
+			const unsigned char *data, size_t len)
+{
+	m->prefix = prefix;
+	m->prefixlen = prefixlen;
+	m->data = data;
+	m->len = len;
+	/* message, 0x80 and 64-bit length */
+	m->nblocks = (prefixlen + len + 8) / 64 + 1;
+}
+
+/* Fill @out with the padded block @b of the message */
+static void sha1_mb_get_block(const struct sha1_mb_msg *m, size_t b, unsigned char out[64])
+{
+	size_t off = b * 64, total = m->prefixlen + m->len, start, end;
+
+	memset(out, 0, 64);
+
+	if (off < m->prefixlen)
+		memcpy(out, m->prefix + off,
+		       m->prefixlen - off < 64 ? m->prefixlen - off : 64);
+
+	start = off > m->prefixlen ? off : m->prefixlen;
+	end = total < off + 64 ? total : off + 64;
+	if (start < end)
+		memcpy(out + (start - off), m->data + (start - m->prefixlen), end - start);
+
+	if (total >= off && total < off + 64)
+		out[total - off] = 0x80;
+
+	if (b == m->nblocks - 1) {
+		uint64_t bits = (uint64_t) total << 3;
+		int i;
+
+		for (i = 0; i < 8; i++)
+			out[56 + i] = (unsigned char) (bits >> ((7 - i) * 8));
+	}
+}
+
+static void sha1_put_digest(unsigned char digest[UL_SHA1LENGTH], const uint32_t state[5])
+{
+	int i;
+
+	for (i = 0; i < UL_SHA1LENGTH; i++)
+		digest[i] = (unsigned char) (state[i >> 2] >> ((3 - (i & 3)) * 8));
+}
+
+static void sha1_mb_one(unsigned char digest[UL_SHA1LENGTH], const struct sha1_mb_msg *m)
+{
+	uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+	unsigned char block[64];
+	size_t b, full = m->prefixlen ? 0 : m->len / 64;
+
+	/* the complete blocks of the data (without prefix) directly */
+	if (full)
+		sha1_blocks(state, m->data, full);
+	for (b = full; b < m->nblocks; b++) {
+		sha1_mb_get_block(m, b, block);
+		sha1_blocks(state, block, 1);
+	}
+	sha1_put_digest(digest, state);
+}
+
+#if defined(__clang__) || __GNUC_PREREQ(4, 8)
+/*
+ * Four messages in parallel, one message in one lane of the vector. The
+ * compiler uses SSE2 or NEON for the vectors.
+ */
+# define UL_SHA1_MB_LANES	4
+
+typedef uint32_t sha1_v4 __attribute__((vector_size(16)));
+
+# define vrol(v, n)	(((v) << (n)) | ((v) >> (32 - (n))))
+
+static inline uint32_t get_be32(const unsigned char *p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+	       ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static void sha1_transform_x4(sha1_v4 state[5], unsigned char blocks[4][64])
+{
+	sha1_v4 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+	sha1_v4 w[16], f, t;
+	uint32_t k;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = (sha1_v4) { get_be32(blocks[0] + i * 4), get_be32(blocks[1] + i * 4),
+				   get_be32(blocks[2] + i * 4), get_be32(blocks[3] + i * 4) };
+
+	for (i = 0; i < 80; i++) {
+		if (i >= 16) {
+			t = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15];
+			w[i & 15] = vrol(t, 1);
+		}
+		if (i < 20) {
+			f = (b & (c ^ d)) ^ d;
+			k = 0x5A827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ED9EBA1;
+		} else if (i < 60) {
+			f = (b & c) | (d & (b | c));
+			k = 0x8F1BBCDC;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xCA62C1D6;
+		}
+		t = vrol(a, 5) + f + e + k + w[i & 15];
+		e = d;
+		d = c;
+		c = vrol(b, 30);
+		b = a;
+		a = t;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+static void sha1_mb_x4(unsigned char (*digests)[UL_SHA1LENGTH],
+		       const struct sha1_mb_msg *msgs, size_t n)
+{
+	sha1_v4 state[5];
+	unsigned char blocks[4][64];
+	size_t b, maxblocks = 0, l;
+
+	state[0] = (sha1_v4) { 0, 0, 0, 0 } + 0x67452301;
+	state[1] = (sha1_v4) { 0, 0, 0, 0 } + 0xEFCDAB89;
+	state[2] = (sha1_v4) { 0, 0, 0, 0 } + 0x98BADCFE;
+	state[3] = (sha1_v4) { 0, 0, 0, 0 } + 0x10325476;
+	state[4] = (sha1_v4) { 0, 0, 0, 0 } + 0xC3D2E1F0;
+
+	for (l = 0; l < n; l++)
+		if (msgs[l].nblocks > maxblocks)
+			maxblocks = msgs[l].nblocks;
+
+	memset(blocks, 0, sizeof(blocks));
+
+	for (b = 0; b < maxblocks; b++) {
+		for (l = 0; l < n; l++)
+			if (b < msgs[l].nblocks)
+				sha1_mb_get_block(&msgs[l], b, blocks[l]);
+
+		sha1_transform_x4(state, blocks);
+
+		/* save results of the messages finished by this block */
+		for (l = 0; l < n; l++) {
+			if (msgs[l].nblocks == b + 1) {
+				uint32_t s[5];
+				int i;
+
+				for (i = 0; i < 5; i++)
+					s[i] = state[i][l];
+				sha1_put_digest(digests[l], s);
+			}
+		}
+	}
+}
+#endif /* vector extensions */
+
+void ul_SHA1Multi(unsigned char (*digests)[UL_SHA1LENGTH], size_t n,
+		  const unsigned char *prefix, size_t prefixlen,
+		  const unsigned char *const *data, const size_t *len)
+{
+	struct sha1_mb_msg msgs[4];
+	size_t i;
+
+#ifdef UL_SHA1_MB_LANES
+	/* the SHA instructions are faster than the vector code */
+	if (sha1_resolve_blocks() == sha1_blocks_generic) {
+		for (i = 0; i < n; i += UL_SHA1_MB_LANES) {
+			size_t l, nl = n - i < UL_SHA1_MB_LANES ? n - i : UL_SHA1_MB_LANES;
+
+			for (l = 0; l < nl; l++)
+				sha1_mb_init_msg(&msgs[l], prefix, prefixlen,
+						 data[i + l], len[i + l]);
+			sha1_mb_x4(digests + i, msgs, nl);
+		}
+		return;
+	}
+#endif
+	for (i = 0; i < n; i++) {
+		sha1_mb_init_msg(&msgs[0], prefix, prefixlen, data[i], len[i]);
+		sha1_mb_one(digests[i], &msgs[0]);
+	}
+}
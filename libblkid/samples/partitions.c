@@ -11,9 +11,104 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <string.h>
+#include <time.h>
 
 #include <blkid.h>
 #include "c.h"
+#include "all-io.h"
+#include "bitops.h"
+
+/* sectors for every EBR and logical partition in the benchmark image */
+#define BENCH_STEP	64
+
+static void write_ebr(int fd, uint64_t sector, uint32_t type,
+		      uint32_t start, uint32_t size,
+		      uint32_t next_start, uint32_t next_size)
+{
+	unsigned char buf[512];
+	unsigned char *p = buf + 0x1be;
+
+	memset(buf, 0, sizeof(buf));
+	start = cpu_to_le32(start);
+	size = cpu_to_le32(size);
+	next_start = cpu_to_le32(next_start);
+	next_size = cpu_to_le32(next_size);
+
+	if (size) {
+		p[4] = type;
+		memcpy(p + 8, &start, 4);
+		memcpy(p + 12, &size, 4);
+	}
+	if (next_size) {
+		p[16 + 4] = 0x05;		/* extended */
+		memcpy(p + 16 + 8, &next_start, 4);
+		memcpy(p + 16 + 12, &next_size, 4);
+	}
+	buf[510] = 0x55;
+	buf[511] = 0xaa;
+
+	if (lseek(fd, sector << 9, SEEK_SET) == (off_t) -1
+	    || write_all(fd, buf, sizeof(buf)) != 0)
+		err(EXIT_FAILURE, "write failed");
+}
+
+/*
+ * Creates sparse MBR image with one extended partition and @nlogical logical
+ * partitions, and measures binary partitions probing of the image.
+ */
+static int bench(const char *filename, uint32_t nlogical, unsigned int loops)
+{
+	uint32_t ext_size = nlogical * BENCH_STEP, i;
+	struct timespec a, b;
+	unsigned int n;
+	double sec;
+	int fd, nparts = 0;
+
+	if (!nlogical)
+		errx(EXIT_FAILURE, "invalid number of partitions");
+
+	fd = open(filename, O_RDWR|O_CREAT|O_TRUNC, 0644);
+	if (fd < 0)
+		err(EXIT_FAILURE, "%s: open failed", filename);
+
+	/* MBR: primary extended partition */
+	write_ebr(fd, 0, 0, 0, 0, BENCH_STEP, ext_size);
+
+	/* EBR chain; links are relative to the begin of the extended partition */
+	for (i = 0; i < nlogical; i++)
+		write_ebr(fd, BENCH_STEP + (uint64_t) i * BENCH_STEP, 0x83,
+			  1, BENCH_STEP - 1,
+			  (i + 1) * BENCH_STEP,
+			  i + 1 < nlogical ? BENCH_STEP : 0);
+
+	if (ftruncate(fd, ((uint64_t) ext_size + BENCH_STEP) << 9) != 0)
+		err(EXIT_FAILURE, "%s: truncate failed", filename);
+	close(fd);
+
+	clock_gettime(CLOCK_MONOTONIC, &a);
+	for (n = 0; n < loops; n++) {
+		blkid_probe pr = blkid_new_probe_from_filename(filename);
+		blkid_partlist ls;
+
+		if (!pr)
+			err(EXIT_FAILURE, "%s: failed to create a new libblkid probe",
+					filename);
+		ls = blkid_probe_get_partitions(pr);
+		if (!ls)
+			errx(EXIT_FAILURE, "%s: failed to read partitions", filename);
+		nparts = blkid_partlist_numof_partitions(ls);
+		blkid_free_probe(pr);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &b);
+
+	sec = (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+	printf("partitions: %d, loops: %u, %.3f ms per probe\n",
+			nparts, loops, sec * 1000 / loops);
+
+	unlink(filename);
+	return nparts == (int) nlogical + 1 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
 int main(int argc, char *argv[])
 {
@@ -23,9 +118,16 @@ int main(int argc, char *argv[])
 	blkid_partlist ls;
 	blkid_parttable root_tab;
 
+	if (argc > 3 && strcmp(argv[1], "--bench") == 0)
+		return bench(argv[2], strtoul(argv[3], NULL, 10),
+			     argc > 4 ? strtoul(argv[4], NULL, 10) : 10);
+
 	if (argc < 2) {
 		fprintf(stderr, "usage: %s <device|file>  "
-				"-- prints partitions\n",
+				"-- prints partitions\n"
+				"       %s --bench <file> <nlogical> [<loops>]  "
+				"-- benchmark with logical partitions\n",
+				program_invocation_short_name,
 				program_invocation_short_name);
 		return EXIT_FAILURE;
 	}
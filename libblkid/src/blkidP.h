@@ -176,6 +176,12 @@ struct blkid_idinfo
  */
 #define BLKID_IDINFO_TOLERANT	(1 << 1)
 
+/* area read by probing functions, see probecache.c */
+struct blkid_area {
+	uint64_t		off;
+	uint64_t		len;
+};
+
 struct blkid_bufinfo {
 	unsigned char		*data;
 	uint64_t		off;
@@ -205,6 +211,7 @@ struct blkid_struct_probe
 	struct blkid_chain	*wipe_chain;	/* superblock, partition, ... */
 
 	struct list_head	buffers;	/* list of buffers */
+	uint64_t		buffers_end;	/* max. end of the buffers */
 
 	struct blkid_chain	chains[BLKID_NCHAINS];	/* array of chains */
 	struct blkid_chain	*cur_chain;		/* current chain */
@@ -213,6 +220,12 @@ struct blkid_struct_probe
 
 	struct blkid_struct_probe *parent;	/* for clones */
 	struct blkid_struct_probe *disk_probe;	/* whole-disk probing */
+
+	char			**cache_names;	/* value names read from probing cache */
+	size_t			ncache_names;
+
+	struct blkid_area	*cache_areas;	/* areas read by probing functions */
+	size_t			ncache_areas;
 };
 
 /* private flags library flags */
@@ -221,11 +234,15 @@ struct blkid_struct_probe
 #define BLKID_FL_CDROM_DEV	(1 << 3)	/* is a CD/DVD drive */
 #define BLKID_FL_NOSCAN_DEV	(1 << 4)	/* do not scan this device */
 #define BLKID_FL_MODIF_BUFF	(1 << 5)	/* cached buffers has been modified */
+#define BLKID_FL_PROBE_CACHE	(1 << 6)	/* use persistent probing cache */
+#define BLKID_FL_CACHE_AREAS	(1 << 7)	/* record areas for probing cache */
 
 /* private per-probing flags */
 #define BLKID_PROBE_FL_IGNORE_PT (1 << 1)	/* ignore partition table */
 
 extern blkid_probe blkid_clone_probe(blkid_probe parent);
+extern void blkid_probe_sync_clone(blkid_probe pr)
+			__attribute__((nonnull));
 extern blkid_probe blkid_probe_get_wholedisk_probe(blkid_probe pr);
 
 /*
@@ -294,6 +311,10 @@ struct blkid_struct_cache
 #define BLKID_RUNTIME_DIR	BLKID_RUNTIME_TOPDIR "/blkid"
 #define BLKID_CACHE_FILE	BLKID_RUNTIME_DIR "/blkid.tab"
 
+/* low-level probing cache, see probecache.c */
+#define BLKID_PROBE_CACHE_DIR	BLKID_RUNTIME_DIR "/probe"
+#define BLKID_PROBE_CACHE_KEYSZ	20	/* SHA1 */
+
 /* old systems */
 #define BLKID_CACHE_FILE_OLD	"/etc/blkid.tab"
 
@@ -450,6 +471,18 @@ extern void blkid_probe_append_values_list(blkid_probe pr,
 
 extern void blkid_probe_free_values_list(struct list_head *vals);
 
+/* probecache.c */
+extern int blkid_probe_cache_lookup(blkid_probe pr, unsigned char *key, int *res)
+			__attribute__((nonnull));
+extern void blkid_probe_cache_store(blkid_probe pr, const unsigned char *key, int res)
+			__attribute__((nonnull));
+extern void blkid_probe_free_cache_names(blkid_probe pr)
+			__attribute__((nonnull));
+extern void blkid_probe_cache_add_area(blkid_probe pr, uint64_t off, uint64_t len)
+			__attribute__((nonnull));
+extern void blkid_probe_cache_reset(blkid_probe pr)
+			__attribute__((nonnull));
+
 extern struct blkid_chain *blkid_probe_get_chain(blkid_probe pr)
 			__attribute__((nonnull))
 			__attribute__((warn_unused_result));
@@ -198,8 +198,12 @@ struct blkid_struct_partlist {
 	int		nparts;		/* number of partitions */
 	int		nparts_max;	/* max.number of partitions */
 	blkid_partition	parts;		/* array of partitions */
+	int		unsorted;	/* parts[] not sorted by start */
 
 	struct list_head l_tabs;	/* list of partition tables */
+
+	blkid_probe	subprobe;	/* reused prober for nested PTs */
+	int		subprobe_busy;
 };
 
 static int blkid_partitions_probe_partition(blkid_probe pr);
@@ -354,11 +358,13 @@ static void reset_partlist(blkid_partlist ls)
 		/* already initialized - reset */
 		int tmp_nparts = ls->nparts_max;
 		blkid_partition tmp_parts = ls->parts;
+		blkid_probe tmp_subprobe = ls->subprobe;
 
 		memset(ls, 0, sizeof(struct blkid_struct_partlist));
 
 		ls->nparts_max = tmp_nparts;
 		ls->parts = tmp_parts;
+		ls->subprobe = tmp_subprobe;
 	}
 
 	ls->nparts = 0;
@@ -397,6 +403,7 @@ static void partitions_free_data(blkid_probe pr __attribute__((__unused__)),
 		return;
 
 	free_parttables(ls);
+	blkid_free_probe(ls->subprobe);
 
 	/* deallocate partitions and partlist */
 	free(ls->parts);
@@ -429,14 +436,16 @@ static blkid_partition new_partition(blkid_partlist ls, blkid_parttable tab)
 
 	if (ls->nparts + 1 > ls->nparts_max) {
 		/* Linux kernel has DISK_MAX_PARTS=256, but it's too much for
-		 * generic Linux machine -- let start with 32 partitions.
+		 * generic Linux machine -- let start with 32 partitions and
+		 * double the array for huge EBR chains.
 		 */
-		void *tmp = realloc(ls->parts, (ls->nparts_max + 32) *
+		int max = ls->nparts_max ? ls->nparts_max * 2 : 32;
+		void *tmp = realloc(ls->parts, max *
 					sizeof(struct blkid_struct_partition));
 		if (!tmp)
 			return NULL;
 		ls->parts = tmp;
-		ls->nparts_max += 32;
+		ls->nparts_max = max;
 	}
 
 	par = &ls->parts[ls->nparts++];
@@ -460,6 +469,9 @@ blkid_partition blkid_partlist_add_partition(blkid_partlist ls,
 	par->start = start;
 	par->size = size;
 
+	if (ls->nparts > 1 && (par - 1)->start > start)
+		ls->unsorted = 1;
+
 	DBG(LOWPROBE, ul_debug("parts: add partition (start=%"
 		PRIu64 ", size=%" PRIu64 ")",
 		par->start, par->size));
@@ -688,10 +700,25 @@ int blkid_partitions_do_subprobe(blkid_probe pr, blkid_partition parent,
 		return -ENOSPC;
 	}
 
-	/* create private prober */
-	prc = blkid_clone_probe(pr);
-	if (!prc)
-		return -ENOMEM;
+	ls = blkid_probe_get_partlist(pr);
+
+	/*
+	 * Private prober. The clone reads data from the parent's buffers, so
+	 * it's kept in the list of partitions and reused for all nested
+	 * partition tables rather than allocated for each of them.
+	 */
+	if (ls && ls->subprobe && !ls->subprobe_busy && ls->subprobe->parent == pr) {
+		prc = ls->subprobe;
+		blkid_probe_sync_clone(prc);
+	} else {
+		prc = blkid_clone_probe(pr);
+		if (!prc)
+			return -ENOMEM;
+		if (ls && !ls->subprobe)
+			ls->subprobe = prc;
+	}
+	if (ls && prc == ls->subprobe)
+		ls->subprobe_busy = 1;
 
 	blkid_probe_set_dimension(prc, off, sz);
 
@@ -703,7 +730,6 @@ int blkid_partitions_do_subprobe(blkid_probe pr, blkid_partition parent,
 	 * in cloned prober (so the cloned prober will extend the current list
 	 * of partitions rather than create a new).
 	 */
-	ls = blkid_probe_get_partlist(pr);
 	blkid_partlist_set_parent(ls, parent);
 
 	blkid_probe_set_partlist(prc, ls);
@@ -713,7 +739,10 @@ int blkid_partitions_do_subprobe(blkid_probe pr, blkid_partition parent,
 	blkid_probe_set_partlist(prc, NULL);
 	blkid_partlist_set_parent(ls, NULL);
 
-	blkid_free_probe(prc);	/* free cloned prober */
+	if (ls && prc == ls->subprobe)
+		ls->subprobe_busy = 0;	/* keep it for the next nested PT */
+	else
+		blkid_free_probe(prc);	/* free cloned prober */
 
 	DBG(LOWPROBE, ul_debug(
 		"parts: <---- %s subprobe done (rc=%d)",
@@ -962,6 +991,22 @@ blkid_partition blkid_partlist_get_partition_by_start(blkid_partlist ls, uint64_
 	int i, nparts;
 	blkid_partition par;
 
+	if (!ls->unsorted) {
+		/* usual case, partitions added in on-disk order */
+		int lo = 0, hi = ls->nparts;
+
+		while (lo < hi) {
+			int mid = lo + (hi - lo) / 2;
+
+			if (ls->parts[mid].start < start)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo < ls->nparts && ls->parts[lo].start == start ?
+				&ls->parts[lo] : NULL;
+	}
+
 	nparts = blkid_partlist_numof_partitions(ls);
 	for (i = 0; i < nparts; i++) {
 		par = blkid_partlist_get_partition(ls, i);
@@ -169,6 +169,24 @@ blkid_probe blkid_clone_probe(blkid_probe parent)
 	if (!pr)
 		return NULL;
 
+	pr->parent = parent;
+	blkid_probe_sync_clone(pr);
+
+	return pr;
+}
+
+/*
+ * Resets the clone and updates it from the parent, so it's possible to reuse
+ * the clone rather than allocate a new one (the parent's device, area or
+ * flags may be changed after the clone has been created).
+ */
+void blkid_probe_sync_clone(blkid_probe pr)
+{
+	blkid_probe parent = pr->parent;
+
+	blkid_reset_probe(pr);
+	blkid_probe_reset_buffers(pr);
+
 	pr->fd = parent->fd;
 	pr->off = parent->off;
 	pr->size = parent->size;
@@ -176,11 +194,8 @@ blkid_probe blkid_clone_probe(blkid_probe parent)
 	pr->disk_devno = parent->disk_devno;
 	pr->blkssz = parent->blkssz;
 	pr->flags = parent->flags;
-	pr->parent = parent;
 
 	pr->flags &= ~BLKID_FL_PRIVATE_FD;
-
-	return pr;
 }
 
 
@@ -248,6 +263,8 @@ void blkid_free_probe(blkid_probe pr)
 		close(pr->fd);
 	blkid_probe_reset_buffers(pr);
 	blkid_probe_reset_values(pr);
+	blkid_probe_free_cache_names(pr);
+	blkid_probe_cache_reset(pr);
 	blkid_free_probe(pr->disk_probe);
 
 	DBG(LOWPROBE, ul_debug("free probe"));
@@ -584,6 +601,10 @@ static struct blkid_bufinfo *get_cached_buffer(blkid_probe pr, uint64_t off, uin
 	uint64_t real_off = pr->off + off;
 	struct list_head *p;
 
+	/* behind all buffers, typical for sequentially read EBR chains */
+	if (real_off + len > pr->buffers_end)
+		return NULL;
+
 	list_for_each(p, &pr->buffers) {
 		struct blkid_bufinfo *x =
 				list_entry(p, struct blkid_bufinfo, bufs);
@@ -657,6 +678,9 @@ unsigned char *blkid_probe_get_buffer(blkid_probe pr, uint64_t off, uint64_t len
 		return NULL;
 	}
 
+	if (pr->flags & BLKID_FL_CACHE_AREAS)
+		blkid_probe_cache_add_area(pr, off, len);
+
 	if (pr->parent &&
 	    pr->parent->devno == pr->devno &&
 	    pr->parent->off <= pr->off &&
@@ -680,6 +704,8 @@ unsigned char *blkid_probe_get_buffer(blkid_probe pr, uint64_t off, uint64_t len
 			return NULL;
 
 		list_add_tail(&bf->bufs, &pr->buffers);
+		if (bf->off + bf->len > pr->buffers_end)
+			pr->buffers_end = bf->off + bf->len;
 	}
 
 	assert(bf->off <= real_off);
@@ -727,6 +753,7 @@ int blkid_probe_reset_buffers(blkid_probe pr)
 			len, ct));
 
 	INIT_LIST_HEAD(&pr->buffers);
+	pr->buffers_end = 0;
 
 	return 0;
 }
@@ -1364,11 +1391,20 @@ int blkid_probe_step_back(blkid_probe pr)
  */
 int blkid_do_safeprobe(blkid_probe pr)
 {
-	int i, count = 0, rc = 0;
+	unsigned char key[BLKID_PROBE_CACHE_KEYSZ];
+	int i, count = 0, rc = 0, cache = 0;
 
 	if (pr->flags & BLKID_FL_NOSCAN_DEV)
 		return 1;
 
+	if (pr->flags & BLKID_FL_PROBE_CACHE) {
+		cache = blkid_probe_cache_lookup(pr, key, &rc);
+		if (cache == 0)
+			return rc;
+		cache = cache == 1;
+		rc = 0;
+	}
+
 	blkid_probe_start(pr);
 
 	for (i = 0; i < BLKID_NCHAINS; i++) {
@@ -1399,11 +1435,42 @@ int blkid_do_safeprobe(blkid_probe pr)
 
 done:
 	blkid_probe_end(pr);
+	if (cache && rc >= 0)
+		blkid_probe_cache_store(pr, key, count ? 0 : 1);
+	if (cache)
+		blkid_probe_cache_reset(pr);
 	if (rc < 0)
 		return rc;
 	return count ? 0 : 1;
 }
 
+/**
+ * blkid_probe_enable_cache:
+ * @pr: prober
+ * @enable: 1 or 0
+ *
+ * Enables persistent cache for blkid_do_safeprobe() results. The results are
+ * stored in /run/blkid/probe/ and reused if the probing setup (enabled chains,
+ * flags and filters) is the same and the device has not been changed since the
+ * last probing. The change is detected by device size, kernel disk sequence
+ * number and checksum of all the areas read by the previous probing.
+ *
+ * The cache is used for block devices only and the results are stored only
+ * if the caller has write access to the directory.
+ *
+ * Returns: 0 on success, or -1 in case of error.
+ *
+ * Since: 2.37
+ */
+int blkid_probe_enable_cache(blkid_probe pr, int enable)
+{
+	if (enable)
+		pr->flags |= BLKID_FL_PROBE_CACHE;
+	else
+		pr->flags &= ~BLKID_FL_PROBE_CACHE;
+	return 0;
+}
+
 /**
  * blkid_do_fullprobe:
  * @pr: prober
@@ -0,0 +1,508 @@
+/*
+ * probecache.c - persistent cache for low-level probing results
+ *
+ * The result of blkid_do_safeprobe() is stored in BLKID_PROBE_CACHE_DIR/<devno>
+ * together with a key and a list of the areas read by the probing functions.
+ * The key is a hash of the probing setup (chains, flags, filters), device
+ * geometry and kernel disk sequence number. The result depends only on the
+ * setup and on the data the probing functions have read, so the result is up
+ * to date if the checksum of the same areas is unchanged.
+ *
+ * The areas are read by the usual probing buffers, so they are reused by the
+ * probing functions if the cache is not up to date.
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#include "blkidP.h"
+#include "sha1.h"
+#include "sysfs.h"
+#include "fileutils.h"
+#include "closestream.h"
+
+/* areas closer than this are merged to one read */
+#define PROBE_CACHE_GAP		(64 * 1024)
+
+static uint64_t get_diskseq(blkid_probe pr)
+{
+	dev_t disk = blkid_probe_get_wholedisk_devno(pr);
+	struct path_cxt *pc;
+	uint64_t seq = 0;
+
+	if (!disk)
+		return 0;
+	pc = ul_new_sysfs_path(disk, NULL, NULL);
+	if (!pc)
+		return 0;
+	if (ul_path_read_u64(pc, &seq, "diskseq") != 0)
+		seq = 0;	/* not supported by kernel */
+	ul_unref_path(pc);
+	return seq;
+}
+
+/*
+ * Called by blkid_probe_get_buffer() for every request when the areas are
+ * recorded. The probing functions usually read the same area more times, so
+ * extend the last area if possible.
+ */
+void blkid_probe_cache_add_area(blkid_probe pr, uint64_t off, uint64_t len)
+{
+	struct blkid_area *a;
+
+	if (pr->ncache_areas) {
+		a = &pr->cache_areas[pr->ncache_areas - 1];
+		if (off >= a->off && off <= a->off + a->len + PROBE_CACHE_GAP) {
+			a->len = max(a->len, off + len - a->off);
+			return;
+		}
+	}
+
+	/* power of 2 allocation */
+	if ((pr->ncache_areas & (pr->ncache_areas - 1)) == 0) {
+		size_t n = pr->ncache_areas ? pr->ncache_areas * 2 : 16;
+
+		a = realloc(pr->cache_areas, n * sizeof(struct blkid_area));
+		if (!a) {
+			/* incomplete list is useless */
+			pr->flags &= ~BLKID_FL_CACHE_AREAS;
+			pr->ncache_areas = 0;
+			return;
+		}
+		pr->cache_areas = a;
+	}
+	a = &pr->cache_areas[pr->ncache_areas++];
+	a->off = off;
+	a->len = len;
+}
+
+void blkid_probe_cache_reset(blkid_probe pr)
+{
+	pr->flags &= ~BLKID_FL_CACHE_AREAS;
+	free(pr->cache_areas);
+	pr->cache_areas = NULL;
+	pr->ncache_areas = 0;
+
+	if (pr->disk_probe)
+		blkid_probe_cache_reset(pr->disk_probe);
+}
+
+static int cmp_areas(const void *a, const void *b)
+{
+	const struct blkid_area *aa = a, *bb = b;
+
+	return aa->off < bb->off ? -1 : aa->off > bb->off;
+}
+
+/* sorts the areas and merges overlapping and close areas */
+static void merge_areas(blkid_probe pr)
+{
+	size_t i, n = 0;
+
+	if (pr->ncache_areas < 2)
+		return;
+
+	qsort(pr->cache_areas, pr->ncache_areas, sizeof(struct blkid_area), cmp_areas);
+
+	for (i = 1; i < pr->ncache_areas; i++) {
+		struct blkid_area *last = &pr->cache_areas[n],
+				  *a = &pr->cache_areas[i];
+
+		if (a->off <= last->off + last->len + PROBE_CACHE_GAP)
+			last->len = max(last->len, a->off + a->len - last->off);
+		else
+			pr->cache_areas[++n] = *a;
+	}
+	pr->ncache_areas = n + 1;
+}
+
+/* whole-disk probe if PART_ENTRY_* values are read from the whole-disk */
+static blkid_probe get_disk_probe(blkid_probe pr)
+{
+	if (pr->chains[BLKID_CHAIN_PARTS].enabled
+	    && (pr->chains[BLKID_CHAIN_PARTS].flags & BLKID_PARTS_ENTRY_DETAILS)
+	    && !blkid_probe_is_wholedisk(pr))
+		return blkid_probe_get_wholedisk_probe(pr);
+	return NULL;
+}
+
+static int hash_area(blkid_probe pr, UL_SHA1_CTX *ctx, uint64_t off, uint64_t len)
+{
+	unsigned char *buf = blkid_probe_get_buffer(pr, off, len);
+
+	if (!buf)
+		return -1;
+	ul_SHA1Update(ctx, buf, len);
+	return 0;
+}
+
+static void key_to_string(const unsigned char *key, char *str)
+{
+	size_t i;
+
+	for (i = 0; i < BLKID_PROBE_CACHE_KEYSZ; i++)
+		sprintf(str + i * 2, "%02x", key[i]);
+}
+
+static int get_key(blkid_probe pr, unsigned char *key)
+{
+	UL_SHA1_CTX ctx;
+	struct {
+		uint64_t devno, off, size, diskseq;
+		uint32_t blkssz;
+	} id;
+	int i;
+
+	memset(&id, 0, sizeof(id));
+	id.devno = pr->devno;
+	id.off = pr->off;
+	id.size = pr->size;
+	id.diskseq = get_diskseq(pr);
+	id.blkssz = blkid_probe_get_sectorsize(pr);
+
+	ul_SHA1Init(&ctx);
+	ul_SHA1Update(&ctx, (unsigned char *) &id, sizeof(id));
+
+	for (i = 0; i < BLKID_NCHAINS; i++) {
+		struct blkid_chain *chn = &pr->chains[i];
+		int setup[2] = { chn->enabled, chn->flags };
+
+		ul_SHA1Update(&ctx, (unsigned char *) setup, sizeof(setup));
+		if (chn->enabled && chn->fltr)
+			ul_SHA1Update(&ctx, (unsigned char *) chn->fltr,
+				blkid_bmp_nbytes(chn->driver->nidinfos));
+	}
+
+	ul_SHA1Final(key, &ctx);
+	return 0;
+}
+
+static char *get_filename(blkid_probe pr, char *buf, size_t bufsz)
+{
+	snprintf(buf, bufsz, BLKID_PROBE_CACHE_DIR "/%u:%u",
+			major(pr->devno), minor(pr->devno));
+	return buf;
+}
+
+/* value names in the probing result are not allocated, keep them in @pr */
+static const char *get_name(blkid_probe pr, const char *name)
+{
+	size_t i;
+	char **names;
+
+	for (i = 0; i < pr->ncache_names; i++) {
+		if (strcmp(pr->cache_names[i], name) == 0)
+			return pr->cache_names[i];
+	}
+
+	names = realloc(pr->cache_names, (pr->ncache_names + 1) * sizeof(char *));
+	if (!names)
+		return NULL;
+	pr->cache_names = names;
+	names[pr->ncache_names] = strdup(name);
+	if (!names[pr->ncache_names])
+		return NULL;
+	return names[pr->ncache_names++];
+}
+
+void blkid_probe_free_cache_names(blkid_probe pr)
+{
+	size_t i;
+
+	for (i = 0; i < pr->ncache_names; i++)
+		free(pr->cache_names[i]);
+	free(pr->cache_names);
+	pr->cache_names = NULL;
+	pr->ncache_names = 0;
+}
+
+static int hex_to_data(const char *hex, unsigned char *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		unsigned int x;
+
+		if (sscanf(hex + i * 2, "%2x", &x) != 1)
+			return -1;
+		data[i] = x;
+	}
+	return 0;
+}
+
+/*
+ * Reads "VAL <chain> <name> <hex>" line and adds the value to @vals.
+ */
+static int parse_value(blkid_probe pr, char *line, struct list_head *vals)
+{
+	struct blkid_prval *v;
+	char *name, *hex, *end = NULL;
+	size_t len;
+	long chain;
+
+	chain = strtol(line, &end, 10);
+	if (!end || *end != ' ' || chain < 0 || chain >= BLKID_NCHAINS
+	    || !pr->chains[chain].enabled)
+		return -1;
+
+	name = end + 1;
+	hex = strchr(name, ' ');
+	if (!hex)
+		return -1;
+	*hex++ = '\0';
+	hex[strcspn(hex, "\n")] = '\0';
+
+	len = strlen(hex);
+	if (len % 2)
+		return -1;
+	len /= 2;
+
+	v = calloc(1, sizeof(struct blkid_prval));
+	if (!v)
+		return -ENOMEM;
+	INIT_LIST_HEAD(&v->prvals);
+	list_add_tail(&v->prvals, vals);
+
+	v->name = get_name(pr, name);
+	v->chain = &pr->chains[chain];
+	if (!v->name)
+		return -ENOMEM;
+
+	v->data = calloc(1, len + 1);	/* always terminate by \0 */
+	if (!v->data)
+		return -ENOMEM;
+	v->len = len;
+	return hex_to_data(hex, v->data, len);
+}
+
+/*
+ * Reads "AREA <probe> <offset> <length>" line and adds the area data to the
+ * checksum. The <probe> is 0 for the device and 1 for the whole-disk. The
+ * areas are read by the usual probing buffers.
+ */
+static int parse_area(blkid_probe pr, char *line, UL_SHA1_CTX *ctx)
+{
+	blkid_probe p = pr;
+	uint64_t off, len;
+	int n;
+
+	if (sscanf(line, "%d %"SCNu64" %"SCNu64, &n, &off, &len) != 3)
+		return -1;
+	if (n == 1)
+		p = get_disk_probe(pr);
+	else if (n != 0)
+		return -1;
+
+	return p ? hash_area(p, ctx, off, len) : -1;
+}
+
+/* the next blkid_do_safeprobe() records the areas for the cache */
+static void start_areas(blkid_probe pr)
+{
+	blkid_probe disk;
+
+	blkid_probe_cache_reset(pr);
+	pr->flags |= BLKID_FL_CACHE_AREAS;
+
+	disk = get_disk_probe(pr);
+	if (disk)
+		disk->flags |= BLKID_FL_CACHE_AREAS;
+}
+
+/*
+ * Returns: 0 if the probing result has been read from the cache, 1 if not in
+ * the cache (@key is valid and usable for blkid_probe_cache_store()), or <0 if
+ * the cache cannot be used for the device.
+ */
+int blkid_probe_cache_lookup(blkid_probe pr, unsigned char *key, int *res)
+{
+	char filename[sizeof(BLKID_PROBE_CACHE_DIR) + 32];
+	char *line = NULL, keystr[BLKID_PROBE_CACHE_KEYSZ * 2 + 1];
+	unsigned char sum[BLKID_PROBE_CACHE_KEYSZ];
+	char sumstr[BLKID_PROBE_CACHE_KEYSZ * 2 + 1];
+	struct list_head vals;
+	UL_SHA1_CTX ctx;
+	size_t sz = 0, i;
+	struct stat st;
+	FILE *f;
+	int rc = 1, keyok = 0, result = -1;
+
+	if (!S_ISBLK(pr->mode) || !pr->devno || !pr->size
+	    || (pr->flags & (BLKID_FL_MODIF_BUFF | BLKID_FL_CDROM_DEV)))
+		return -EINVAL;
+
+	if (get_key(pr, key) != 0)
+		return -EINVAL;
+
+	f = fopen(get_filename(pr, filename, sizeof(filename)), "r" UL_CLOEXECSTR);
+	if (!f)
+		goto miss;
+
+	/* don't trust files writable by others */
+	if (fstat(fileno(f), &st) != 0
+	    || (st.st_uid != 0 && st.st_uid != geteuid())
+	    || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+		fclose(f);
+		goto miss;
+	}
+
+	key_to_string(key, keystr);
+	INIT_LIST_HEAD(&vals);
+
+	while (getline(&line, &sz, f) >= 0) {
+		if (*line == '#')
+			continue;
+		if (!keyok && strncmp(line, "KEY ", 4) == 0) {
+			if (strncmp(line + 4, keystr, sizeof(keystr) - 1) != 0)
+				break;
+			keyok = 1;
+			ul_SHA1Init(&ctx);
+		} else if (keyok && rc == 1 && strncmp(line, "AREA ", 5) == 0) {
+			if (parse_area(pr, line + 5, &ctx) != 0)
+				break;
+		} else if (keyok && rc == 1 && strncmp(line, "SUM ", 4) == 0) {
+			ul_SHA1Final(sum, &ctx);
+			key_to_string(sum, sumstr);
+			if (strncmp(line + 4, sumstr, sizeof(sumstr) - 1) != 0)
+				break;
+			rc = 0;
+		} else if (rc == 0 && strncmp(line, "RC ", 3) == 0) {
+			result = atoi(line + 3);
+		} else if (rc == 0 && strncmp(line, "VAL ", 4) == 0) {
+			if (parse_value(pr, line + 4, &vals) != 0) {
+				rc = 1;
+				break;
+			}
+		} else {
+			rc = 1;
+			break;
+		}
+	}
+	free(line);
+	fclose(f);
+
+	if (rc != 0 || (result != 0 && result != 1)) {
+		DBG(LOWPROBE, ul_debug("probe cache: %s out of date", filename));
+		blkid_probe_free_values_list(&vals);
+		goto miss;
+	}
+
+	DBG(LOWPROBE, ul_debug("probe cache: using %s", filename));
+
+	for (i = 0; i < BLKID_NCHAINS; i++) {
+		if (pr->chains[i].enabled)
+			blkid_probe_chain_reset_values(pr, &pr->chains[i]);
+	}
+	blkid_probe_append_values_list(pr, &vals);
+	*res = result;
+	return 0;
+miss:
+	start_areas(pr);
+	return 1;
+}
+
+/* writes AREA lines for @pr and adds the areas to the checksum */
+static int write_areas(blkid_probe pr, int n, FILE *f, UL_SHA1_CTX *ctx)
+{
+	size_t i;
+
+	/* incomplete list of the areas */
+	if (!(pr->flags & BLKID_FL_CACHE_AREAS))
+		return -1;
+
+	pr->flags &= ~BLKID_FL_CACHE_AREAS;
+	merge_areas(pr);
+
+	for (i = 0; i < pr->ncache_areas; i++) {
+		struct blkid_area *a = &pr->cache_areas[i];
+
+		if (hash_area(pr, ctx, a->off, a->len) != 0)
+			return -1;
+		fprintf(f, "AREA %d %"PRIu64" %"PRIu64"\n", n, a->off, a->len);
+	}
+	return 0;
+}
+
+/*
+ * Stores the current probing result to the cache. The errors are ignored,
+ * the cache is optional.
+ */
+void blkid_probe_cache_store(blkid_probe pr, const unsigned char *key, int res)
+{
+	char filename[sizeof(BLKID_PROBE_CACHE_DIR) + 32];
+	char *tmp = NULL, str[BLKID_PROBE_CACHE_KEYSZ * 2 + 1];
+	unsigned char sum[BLKID_PROBE_CACHE_KEYSZ];
+	blkid_probe disk;
+	struct list_head *p;
+	UL_SHA1_CTX ctx;
+	FILE *f = NULL;
+	size_t i;
+	int fd;
+
+	if ((mkdir(BLKID_RUNTIME_DIR, 0755) != 0 && errno != EEXIST)
+	    || (mkdir(BLKID_PROBE_CACHE_DIR, 0755) != 0 && errno != EEXIST)) {
+		DBG(LOWPROBE, ul_debug("probe cache: cannot create directory"));
+		return;
+	}
+
+	get_filename(pr, filename, sizeof(filename));
+	if (asprintf(&tmp, "%s-XXXXXX", filename) < 0)
+		return;
+
+	fd = mkstemp_cloexec(tmp);
+	if (fd < 0)
+		goto done;
+	if (fchmod(fd, 0644) != 0 || !(f = fdopen(fd, "w" UL_CLOEXECSTR))) {
+		close(fd);
+		goto fail;
+	}
+
+	key_to_string(key, str);
+	fprintf(f, "# libblkid probing cache, don't edit\nKEY %s\n", str);
+
+	ul_SHA1Init(&ctx);
+	disk = get_disk_probe(pr);
+	if (write_areas(pr, 0, f, &ctx) != 0
+	    || (disk && write_areas(disk, 1, f, &ctx) != 0)) {
+		DBG(LOWPROBE, ul_debug("probe cache: cannot get probing areas"));
+		fclose(f);
+		goto fail;
+	}
+	ul_SHA1Final(sum, &ctx);
+	key_to_string(sum, str);
+	fprintf(f, "SUM %s\nRC %d\n", str, res);
+
+	list_for_each(p, &pr->values) {
+		struct blkid_prval *v = list_entry(p, struct blkid_prval, prvals);
+
+		fprintf(f, "VAL %d %s ", (int) (v->chain - pr->chains), v->name);
+		for (i = 0; i < v->len; i++)
+			fprintf(f, "%02x", v->data[i]);
+		fputc('\n', f);
+	}
+
+	if (close_stream(f) != 0)
+		goto fail;
+	if (rename(tmp, filename) != 0)
+		goto fail;
+
+	DBG(LOWPROBE, ul_debug("probe cache: %s updated", filename));
+	goto done;
+fail:
+	DBG(LOWPROBE, ul_debug("probe cache: failed to write %s", filename));
+	unlink(tmp);
+done:
+	free(tmp);
+}
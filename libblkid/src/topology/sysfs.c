@@ -15,104 +15,143 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
+#include <stddef.h>
 
-#include "sysfs.h"
+#include "all-io.h"
+#include "pathnames.h"
 #include "topology.h"
 
 /*
  * Sysfs topology values (since 2.6.31, May 2009).
+ *
+ * All the values except alignment_offset are in the queue/ directory of the
+ * whole-disk device. The directories are opened only once and the attributes
+ * are read relative to the directory file descriptors.
  */
-static struct topology_val {
+enum {
+	TP_ALIGNMENT_OFFSET = 0,
+	TP_MINIMUM_IO_SIZE,
+	TP_OPTIMAL_IO_SIZE,
+	TP_PHYSICAL_BLOCK_SIZE,
+	TP_LOGICAL_BLOCK_SIZE,
+	TP_DAX
+};
 
-	/* /sys/dev/block/<maj>:<min>/<ATTR> */
-	const char *attr;
+static const struct topology_attr {
+	const char	*name;
+	int		in_queue;	/* queue/<name> */
+	size_t		structoff;	/* offset in struct blkid_struct_topology */
+} topology_attrs[] = {
+	[TP_ALIGNMENT_OFFSET]    = { "alignment_offset", 0,
+			offsetof(struct blkid_struct_topology, alignment_offset) },
+	[TP_MINIMUM_IO_SIZE]     = { "minimum_io_size", 1,
+			offsetof(struct blkid_struct_topology, minimum_io_size) },
+	[TP_OPTIMAL_IO_SIZE]     = { "optimal_io_size", 1,
+			offsetof(struct blkid_struct_topology, optimal_io_size) },
+	[TP_PHYSICAL_BLOCK_SIZE] = { "physical_block_size", 1,
+			offsetof(struct blkid_struct_topology, physical_sector_size) },
+	[TP_LOGICAL_BLOCK_SIZE]  = { "logical_block_size", 1,
+			offsetof(struct blkid_struct_topology, logical_sector_size) },
+	[TP_DAX]                 = { "dax", 1,
+			offsetof(struct blkid_struct_topology, dax) }
+};
 
-	/* functions to set probing result */
-	int (*set_ulong)(blkid_probe, unsigned long);
-	int (*set_int)(blkid_probe, int);
+static int read_attr(int dirfd, const char *name, int64_t *res)
+{
+	char buf[32], *end = NULL;
+	ssize_t sz;
+	int fd;
+
+	fd = openat(dirfd, name, O_RDONLY|O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	sz = read_all(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (sz <= 0)
+		return -EINVAL;
+	buf[sz] = '\0';
+
+	errno = 0;
+	*res = strtoll(buf, &end, 10);
+	if (errno || end == buf)
+		return -EINVAL;
+	return 0;
+}
 
-} topology_vals[] = {
-	{ "alignment_offset", NULL, blkid_topology_set_alignment_offset },
-	{ "queue/minimum_io_size", blkid_topology_set_minimum_io_size },
-	{ "queue/optimal_io_size", blkid_topology_set_optimal_io_size },
-	{ "queue/physical_block_size", blkid_topology_set_physical_sector_size },
-	{ "queue/dax", blkid_topology_set_dax },
-};
+/*
+ * Reads all topology attributes for @devno from sysfs to @tp. The negative
+ * alignment offset (misaligned stacked devices) is reported as zero.
+ *
+ * Returns: number of the read attributes or <0 on error.
+ */
+int sysfs_read_topology(dev_t devno, struct blkid_struct_topology *tp)
+{
+	char path[sizeof(_PATH_SYS_DEVBLOCK) + 32];
+	int dirfd, qfd, count = 0;
+	size_t i;
+
+	snprintf(path, sizeof(path), _PATH_SYS_DEVBLOCK "/%u:%u",
+			major(devno), minor(devno));
+	dirfd = open(path, O_RDONLY|O_CLOEXEC|O_DIRECTORY);
+	if (dirfd < 0)
+		return -errno;
+
+	/* partitions use queue/ from the parental whole-disk directory */
+	qfd = openat(dirfd, "queue", O_RDONLY|O_CLOEXEC|O_DIRECTORY);
+	if (qfd < 0 && errno == ENOENT && faccessat(dirfd, "partition", F_OK, 0) == 0)
+		qfd = openat(dirfd, "../queue", O_RDONLY|O_CLOEXEC|O_DIRECTORY);
+
+	for (i = 0; i < ARRAY_SIZE(topology_attrs); i++) {
+		const struct topology_attr *attr = &topology_attrs[i];
+		unsigned long val;
+		int64_t data = 0;
+
+		if (attr->in_queue && qfd < 0)
+			continue;
+		if (read_attr(attr->in_queue ? qfd : dirfd, attr->name, &data) != 0)
+			continue;
+
+		val = data < 0 ? 0 : (unsigned long) data;
+		memcpy((char *) tp + attr->structoff, &val, sizeof(val));
+		count++;
+	}
+
+	if (qfd >= 0)
+		close(qfd);
+	close(dirfd);
+
+	DBG(LOWPROBE, ul_debug("sysfs topology: %d attributes for %u:%u",
+				count, major(devno), minor(devno)));
+	return count;
+}
 
 static int probe_sysfs_tp(blkid_probe pr,
 		const struct blkid_idmag *mag __attribute__((__unused__)))
 {
+	struct blkid_struct_topology tp;
 	dev_t dev;
-	int rc, set_parent = 1;
-	struct path_cxt *pc;
-	size_t i, count = 0;
+	int rc;
 
 	dev = blkid_probe_get_devno(pr);
 	if (!dev)
 		return 1;
-	pc = ul_new_sysfs_path(dev, NULL, NULL);
-	if (!pc)
-		return 1;
 
-	rc = 1;		/* nothing (default) */
-
-	for (i = 0; i < ARRAY_SIZE(topology_vals); i++) {
-		struct topology_val *val = &topology_vals[i];
-		int ok = ul_path_access(pc, F_OK, val->attr) == 0;
-
-		rc = 1;	/* nothing */
-
-		if (!ok && set_parent) {
-			dev_t disk = blkid_probe_get_wholedisk_devno(pr);
-			set_parent = 0;
-
-			/*
-			 * Read attributes from "disk" if the current device is
-			 * a partition. Note that sysfs ul_path_* API is able
-			 * to redirect requests to attributes if parent is set.
-			 */
-			if (disk && disk != dev) {
-				struct path_cxt *parent = ul_new_sysfs_path(disk, NULL, NULL);
-				if (!parent)
-					goto done;
-
-				sysfs_blkdev_set_parent(pc, parent);
-				ul_unref_path(parent);
-
-				/* try it again */
-				ok = ul_path_access(pc, F_OK, val->attr) == 0;
-			}
-		}
-		if (!ok)
-			continue;	/* attribute does not exist */
-
-		if (val->set_ulong) {
-			uint64_t data;
-
-			if (ul_path_read_u64(pc, &data, val->attr) != 0)
-				continue;
-			rc = val->set_ulong(pr, (unsigned long) data);
-
-		} else if (val->set_int) {
-			int64_t data;
-
-			if (ul_path_read_s64(pc, &data, val->attr) != 0)
-				continue;
-			rc = val->set_int(pr, (int) data);
-		}
-
-		if (rc < 0)
-			goto done;	/* error */
-		if (rc == 0)
-			count++;
-	}
+	memset(&tp, 0, sizeof(tp));
+	rc = sysfs_read_topology(dev, &tp);
+	if (rc <= 0)
+		return 1;	/* nothing */
+
+	/* logical sector size is set by BLKSSZGET in topology.c */
+	if (blkid_topology_set_alignment_offset(pr, (int) tp.alignment_offset) < 0
+	    || blkid_topology_set_minimum_io_size(pr, tp.minimum_io_size) < 0
+	    || blkid_topology_set_optimal_io_size(pr, tp.optimal_io_size) < 0
+	    || blkid_topology_set_physical_sector_size(pr, tp.physical_sector_size) < 0
+	    || blkid_topology_set_dax(pr, tp.dax) < 0)
+		return -1;
 
-done:
-	ul_unref_path(pc);		/* unref pc and parent */
-	if (count)
-		return 0;		/* success */
-	return rc;			/* error or nothing */
+	return 0;
 }
 
 const struct blkid_idinfo sysfs_tp_idinfo =
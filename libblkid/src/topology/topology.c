@@ -52,24 +52,16 @@
  * blkid_probe_get_topology()
  *
  * blkid_topology_get_'VALUENAME'()
+ *
+ * The topology of a device may be also read directly from sysfs by
+ * blkid_new_topology_from_devno(), without a probe and without opening the
+ * device.
  */
 static int topology_probe(blkid_probe pr, struct blkid_chain *chn);
 static void topology_free(blkid_probe pr, void *data);
 static int topology_is_complete(blkid_probe pr);
 static int topology_set_logical_sector_size(blkid_probe pr);
 
-/*
- * Binary interface
- */
-struct blkid_struct_topology {
-	unsigned long	alignment_offset;
-	unsigned long	minimum_io_size;
-	unsigned long	optimal_io_size;
-	unsigned long	logical_sector_size;
-	unsigned long	physical_sector_size;
-	unsigned long   dax;
-};
-
 /*
  * Topology chain probing functions
  */
@@ -138,6 +130,52 @@ blkid_topology blkid_probe_get_topology(blkid_probe pr)
 			&pr->chains[BLKID_CHAIN_TOPLGY]);
 }
 
+/**
+ * blkid_new_topology_from_devno:
+ * @devno: device number
+ *
+ * Reads all topology values for the device from sysfs at once. All the
+ * attributes are read relative to the device sysfs directory, so this is
+ * cheaper than to read the attributes one by one, and the device does not
+ * have to be opened. The logical sector size is read from sysfs too.
+ *
+ * The returned object is independent on probing; use blkid_free_topology()
+ * to deallocate it.
+ *
+ * Returns: new blkid_topology, or NULL in case of error (e.g. sysfs does not
+ *          provide any topology values for the device).
+ *
+ * Since: 2.37
+ */
+blkid_topology blkid_new_topology_from_devno(dev_t devno)
+{
+	blkid_topology tp;
+
+	tp = calloc(1, sizeof(struct blkid_struct_topology));
+	if (!tp)
+		return NULL;
+
+	if (sysfs_read_topology(devno, tp) <= 0) {
+		free(tp);
+		return NULL;
+	}
+	return tp;
+}
+
+/**
+ * blkid_free_topology:
+ * @tp: topology from blkid_new_topology_from_devno()
+ *
+ * Deallocates the topology. Don't use it for topology returned by
+ * blkid_probe_get_topology().
+ *
+ * Since: 2.37
+ */
+void blkid_free_topology(blkid_topology tp)
+{
+	free(tp);
+}
+
 /*
  * The blkid_do_probe() backend.
  */
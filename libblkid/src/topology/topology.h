@@ -3,12 +3,27 @@
 
 #include "blkidP.h"
 
+/*
+ * Binary interface
+ */
+struct blkid_struct_topology {
+	unsigned long	alignment_offset;
+	unsigned long	minimum_io_size;
+	unsigned long	optimal_io_size;
+	unsigned long	logical_sector_size;
+	unsigned long	physical_sector_size;
+	unsigned long   dax;
+};
+
 extern int blkid_topology_set_alignment_offset(blkid_probe pr, int val);
 extern int blkid_topology_set_minimum_io_size(blkid_probe pr, unsigned long val);
 extern int blkid_topology_set_optimal_io_size(blkid_probe pr, unsigned long val);
 extern int blkid_topology_set_physical_sector_size(blkid_probe pr, unsigned long val);
 extern int blkid_topology_set_dax(blkid_probe pr, unsigned long val);
 
+/* sysfs.c */
+extern int sysfs_read_topology(dev_t devno, struct blkid_struct_topology *tp);
+
 /*
  * topology probers
  */
@@ -56,12 +56,13 @@ int main(int argc, char *argv[])
 	struct fdisk_context *cxt;
 	struct fdisk_partition *pa;
 	const char *label = NULL, *device = NULL;
-	int c;
+	int c, direct = 0;
 	size_t n = 1;
 
 	static const struct option longopts[] = {
 		{ "label",  required_argument, NULL, 'x' },
 		{ "device", required_argument, NULL, 'd' },
+		{ "direct-write", no_argument, NULL, 'D' },
 		{ "help",   no_argument, NULL, 'h' },
 		{ NULL, 0, NULL, 0 },
 	};
@@ -70,7 +71,7 @@ int main(int argc, char *argv[])
 
 	fdisk_init_debug(0);
 
-	while((c = getopt_long(argc, argv, "x:d:h", longopts, NULL)) != -1) {
+	while((c = getopt_long(argc, argv, "x:d:Dh", longopts, NULL)) != -1) {
 		switch(c) {
 		case 'x':
 			label = optarg;
@@ -78,6 +79,9 @@ int main(int argc, char *argv[])
 		case 'd':
 			device = optarg;
 			break;
+		case 'D':
+			direct = 1;
+			break;
 		case 'h':
 			printf("%s [options] -- <partno,start,size> ...", program_invocation_short_name);
 			fputs(USAGE_SEPARATOR, stdout);
@@ -88,6 +92,7 @@ int main(int argc, char *argv[])
 			fputs(USAGE_OPTIONS, stdout);
 			puts(" -x, --label <dos,gpt,...>    disk label type (default MBR)");
 			puts(" -d, --device <path>          block device");
+			puts(" -D, --direct-write           write disk label by O_DIRECT");
 			puts(" -h, --help                   this help");
 			fputs(USAGE_SEPARATOR, stdout);
 			return EXIT_SUCCESS;
@@ -103,6 +108,7 @@ int main(int argc, char *argv[])
 	if (!cxt)
 		err_oom();
 	fdisk_set_ask(cxt, ask_callback, NULL);
+	fdisk_enable_direct_write(cxt, direct);
 
 	pa = fdisk_new_partition();
 	if (!pa)
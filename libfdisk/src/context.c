@@ -117,6 +117,7 @@ static int init_nested_from_parent(struct fdisk_context *cxt, int isnew)
 		cxt->display_details =	parent->display_details;
 		cxt->display_in_cyl_units = parent->display_in_cyl_units;
 		cxt->protect_bootbits = parent->protect_bootbits;
+		cxt->direct_write = parent->direct_write;
 	}
 
 	free(cxt->dev_model);
@@ -347,6 +348,43 @@ int fdisk_enable_bootbits_protection(struct fdisk_context *cxt, int enable)
 	cxt->protect_bootbits = enable ? 1 : 0;
 	return 0;
 }
+
+/**
+ * fdisk_has_direct_write:
+ * @cxt: fdisk context
+ *
+ * Returns: return 1 if O_DIRECT writes are enabled.
+ *
+ * Since: 2.37
+ */
+int fdisk_has_direct_write(struct fdisk_context *cxt)
+{
+	return cxt && cxt->direct_write;
+}
+
+/**
+ * fdisk_enable_direct_write:
+ * @cxt: fdisk context
+ * @enable: 1 or 0
+ *
+ * The library writes the disk label by buffered I/O and syncs the device
+ * after that. If enabled, the label is written by O_DIRECT, which bypasses
+ * page cache and is usually faster on high-latency devices (iSCSI, etc.).
+ * The library silently falls back to buffered I/O if O_DIRECT is not
+ * supported by the device.
+ *
+ * Returns: 0 on success, < 0 on error.
+ *
+ * Since: 2.37
+ */
+int fdisk_enable_direct_write(struct fdisk_context *cxt, int enable)
+{
+	if (!cxt)
+		return -EINVAL;
+	cxt->direct_write = enable ? 1 : 0;
+	return 0;
+}
+
 /**
  * fdisk_disable_dialogs
  * @cxt: fdisk context
@@ -567,6 +605,7 @@ static void reset_context(struct fdisk_context *cxt)
 	cxt->label = NULL;
 
 	fdisk_free_wipe_areas(cxt);
+	fdisk_free_writes(cxt);
 }
 
 /* fdisk_assign_device() body */
@@ -734,6 +773,8 @@ int fdisk_deassign_device(struct fdisk_context *cxt, int nosync)
 
 	DBG(CXT, ul_debugobj(cxt, "de-assigning device %s", cxt->dev_path));
 
+	fdisk_free_writes(cxt);
+
 	if (cxt->readonly && cxt->private_fd)
 		close(cxt->dev_fd);
 	else {
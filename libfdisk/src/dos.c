@@ -1959,28 +1959,22 @@ done:
 	return rc;
 }
 
+/*
+ * Queue the sector to write, see fdisk_flush_writes() in dos_write_disklabel().
+ */
 static int write_sector(struct fdisk_context *cxt, fdisk_sector_t secno,
 			       unsigned char *buf)
 {
-	int rc;
-
-	rc = seek_sector(cxt, secno);
-	if (rc != 0) {
-		fdisk_warn(cxt, _("Cannot write sector %jd: seek failed"),
-				(uintmax_t) secno);
-		return rc;
-	}
-
 	DBG(LABEL, ul_debug("DOS: writing to sector %ju", (uintmax_t) secno));
 
-	if (write(cxt->dev_fd, buf, cxt->sector_size) != (ssize_t) cxt->sector_size)
-		return -errno;
-	return 0;
+	return fdisk_queue_write(cxt, (uint64_t) secno * cxt->sector_size,
+				 buf, cxt->sector_size);
 }
 
 static int dos_write_disklabel(struct fdisk_context *cxt)
 {
 	struct fdisk_dos_label *l = self_label(cxt);
+	unsigned char *empty = NULL;
 	size_t i;
 	int rc = 0, mbr_changed = 0;
 
@@ -2015,10 +2009,14 @@ static int dos_write_disklabel(struct fdisk_context *cxt)
 		/* we have empty extended partition, check if the partition has
 		 * been modified and then cleanup possible remaining EBR  */
 		struct pte *pe = self_pte(cxt, l->ext_index);
-		unsigned char empty[512] = { 0 };
 		fdisk_sector_t off = pe ? get_abs_partition_start(pe) : 0;
 
 		if (off && pe->changed) {
+			empty = calloc(1, cxt->sector_size);
+			if (!empty) {
+				rc = -ENOMEM;
+				goto done;
+			}
 			mbr_set_magic(empty);
 			write_sector(cxt, off, empty);
 		}
@@ -2038,7 +2036,11 @@ static int dos_write_disklabel(struct fdisk_context *cxt)
 			goto done;
 	}
 
+	rc = fdisk_flush_writes(cxt);
 done:
+	if (rc)
+		fdisk_free_writes(cxt);
+	free(empty);
 	return rc;
 }
 
@@ -212,6 +212,15 @@ struct fdisk_geometry {
 	fdisk_sector_t cylinders;
 };
 
+/*
+ * Area used by a partition, see get_used_ranges label operation
+ */
+struct fdisk_range {
+	fdisk_sector_t	start;		/* first sector */
+	fdisk_sector_t	end;		/* last sector */
+	size_t		partno;		/* partition number */
+};
+
 /*
  * Label specific operations
  */
@@ -253,6 +262,10 @@ struct fdisk_label_operations {
 
 	int (*part_toggle_flag)(struct fdisk_context *cxt, size_t i, unsigned long flag);
 
+	/* return used areas sorted by start (optional, the array is owned by label) */
+	int (*get_used_ranges)(struct fdisk_context *cxt,
+			       const struct fdisk_range **ranges, size_t *nranges);
+
 	/* refresh alignment setting */
 	int (*reset_alignment)(struct fdisk_context *cxt);
 
@@ -377,6 +390,13 @@ struct fdisk_ask {
 	} data;
 };
 
+/* pending device write, see fdisk_queue_write() */
+struct fdisk_wreq {
+	uint64_t	offset;		/* in bytes */
+	size_t		size;
+	const void	*data;		/* owned by caller, valid until flush */
+};
+
 struct fdisk_context {
 	int dev_fd;         /* device descriptor */
 	char *dev_path;     /* device path */
@@ -405,11 +425,16 @@ struct fdisk_context {
 		     no_disalogs : 1,		/* disable dialog-driven partititoning */
 		     dev_model_probed : 1,	/* tried to read from sys */
 		     private_fd : 1,		/* open by libfdisk */
-		     listonly : 1;		/* list partition, nothing else */
+		     listonly : 1,		/* list partition, nothing else */
+		     direct_write : 1;		/* write by O_DIRECT */
 
 	char *collision;			/* name of already existing FS/PT */
 	struct list_head wipes;			/* list of areas to wipe before write */
 
+	struct fdisk_wreq *wreqs;		/* queued writes */
+	size_t nwreqs;
+	size_t wreqs_max;
+
 	int sizeunit;				/* SIZE fields, FDISK_SIZEUNIT_* */
 
 	/* alignment */
@@ -475,6 +500,10 @@ extern void fdisk_zeroize_device_properties(struct fdisk_context *cxt);
 extern int fdisk_init_firstsector_buffer(struct fdisk_context *cxt,
 			unsigned int protect_off, unsigned int protect_size);
 extern int fdisk_read_firstsector(struct fdisk_context *cxt);
+extern int fdisk_queue_write(struct fdisk_context *cxt, uint64_t offset,
+			const void *data, size_t size);
+extern int fdisk_flush_writes(struct fdisk_context *cxt);
+extern void fdisk_free_writes(struct fdisk_context *cxt);
 
 /* label.c */
 extern int fdisk_probe_labels(struct fdisk_context *cxt);
@@ -184,8 +184,14 @@ struct fdisk_gpt_label {
 
 	unsigned char *ents;			/* entries (partitions) */
 
+	/* sorted index of the used entries, see gpt_update_ranges() */
+	struct fdisk_range *ranges;		/* used areas sorted by start */
+	struct fdisk_range *extents;		/* ranges merged if overlap or touch */
+	size_t nranges, nextents, ranges_max;
+
 	unsigned int no_relocate :1,		/* do not fix backup location */
-		     minimize :1;
+		     minimize :1,
+		     ranges_valid :1;		/* ranges[] and extents[] up-to-date */
 };
 
 static void gpt_deinit(struct fdisk_label *lb);
@@ -1359,41 +1365,140 @@ static uint32_t check_start_after_end_partitions(struct fdisk_gpt_label *gpt)
 }
 
 /*
- * Check if partition e1 overlaps with partition e2.
+ * The used entries are indexed in two arrays sorted by start: @ranges (one
+ * item for each used entry) and @extents (the ranges merged where they
+ * overlap or touch each other), so a sector is allocated if it is within an
+ * extent. The index is lazily rebuilt after gpt_entries_changed(). The arrays
+ * are allocated by gpt_alloc_ranges() together with the entries, so the
+ * rebuild does not allocate and the lookups cannot fail.
+ *
+ * The entries are indexed if used in the gpt_part_is_used() sense, except
+ * entries that end before they start, see check_start_after_end_partitions().
  */
-static inline int partition_overlap(struct gpt_entry *e1, struct gpt_entry *e2)
+static int gpt_alloc_ranges(struct fdisk_gpt_label *gpt, size_t n)
+{
+	struct fdisk_range *r;
+
+	gpt->ranges_valid = 0;
+	if (n <= gpt->ranges_max)
+		return 0;
+
+	r = realloc(gpt->ranges, 2 * n * sizeof(struct fdisk_range));
+	if (!r)
+		return -ENOMEM;
+
+	gpt->ranges = r;
+	gpt->extents = r + n;
+	gpt->ranges_max = n;
+	return 0;
+}
+
+/* has to be called after any change of the entries array */
+static void gpt_entries_changed(struct fdisk_gpt_label *gpt)
+{
+	gpt_recompute_crc(gpt->pheader, gpt->ents);
+	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt->ranges_valid = 0;
+}
+
+static int cmp_ranges(const void *a, const void *b)
+{
+	const struct fdisk_range *x = a, *y = b;
+
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+	return x->partno < y->partno ? -1 : x->partno > y->partno;
+}
+
+static void gpt_update_ranges(struct fdisk_gpt_label *gpt)
+{
+	size_t i, n = 0, nents = gpt_get_nentries(gpt);
+	struct fdisk_range *x = NULL;
+
+	if (gpt->ranges_valid)
+		return;
+
+	assert(nents <= gpt->ranges_max);
+
+	for (i = 0; i < nents; i++) {
+		struct gpt_entry *e = gpt_get_entry(gpt, i);
+
+		if ((!gpt_entry_is_used(e) && !gpt_partition_start(e))
+		    || gpt_partition_start(e) > gpt_partition_end(e))
+			continue;
+		gpt->ranges[n].start = gpt_partition_start(e);
+		gpt->ranges[n].end = gpt_partition_end(e);
+		gpt->ranges[n].partno = i;
+		n++;
+	}
+	qsort(gpt->ranges, n, sizeof(struct fdisk_range), cmp_ranges);
+	gpt->nranges = n;
+
+	gpt->nextents = 0;
+	for (i = 0; i < n; i++) {
+		struct fdisk_range *r = &gpt->ranges[i];
+
+		if (x && (r->start <= x->end || r->start - 1 == x->end)) {
+			if (r->end > x->end)
+				x->end = r->end;
+			continue;
+		}
+		x = &gpt->extents[gpt->nextents++];
+		*x = *r;
+	}
+
+	DBG(GPT, ul_debug("ranges updated [ranges=%zu, extents=%zu]",
+				gpt->nranges, gpt->nextents));
+	gpt->ranges_valid = 1;
+}
+
+/* returns number of items in the sorted @r with start <= @x */
+static size_t ranges_count_upto(const struct fdisk_range *r, size_t n, uint64_t x)
 {
-	uint64_t start1 = gpt_partition_start(e1);
-	uint64_t end1   = gpt_partition_end(e1);
-	uint64_t start2 = gpt_partition_start(e2);
-	uint64_t end2   = gpt_partition_end(e2);
+	size_t lo = 0, hi = n;
 
-	return (start1 && start2 && (start1 <= end2) != (end1 < start2));
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (r[mid].start <= x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
 }
 
 /*
- * Find any partitions that overlap.
+ * Find any partitions that overlap. Returns the higher partition number of
+ * the first overlapping pair (in disk order) and the other one in @other.
  */
-static uint32_t check_overlap_partitions(struct fdisk_gpt_label *gpt)
+static uint32_t check_overlap_partitions(struct fdisk_gpt_label *gpt, uint32_t *other)
 {
-	size_t i, j;
+	const struct fdisk_range *cover = NULL;
+	size_t i;
 
 	assert(gpt);
 	assert(gpt->pheader);
 	assert(gpt->ents);
 
-	for (i = 0; i < gpt_get_nentries(gpt); i++)
-		for (j = 0; j < i; j++) {
-			struct gpt_entry *ei = gpt_get_entry(gpt, i);
-			struct gpt_entry *ej = gpt_get_entry(gpt, j);
+	gpt_update_ranges(gpt);
 
-			if (!gpt_entry_is_used(ei) || !gpt_entry_is_used(ej))
-				continue;
-			if (partition_overlap(ei, ej)) {
-				DBG(GPT, ul_debug("partitions overlap detected [%zu vs. %zu]", i, j));
-				return i + 1;
-			}
+	/* @cover is the range with the highest end so far */
+	for (i = 0; i < gpt->nranges; i++) {
+		const struct fdisk_range *r = &gpt->ranges[i];
+
+		if (!r->start)
+			continue;
+		if (cover && r->start <= cover->end) {
+			DBG(GPT, ul_debug("partitions overlap detected [%zu vs. %zu]",
+						r->partno, cover->partno));
+			if (other)
+				*other = min(r->partno, cover->partno) + 1;
+			return max(r->partno, cover->partno) + 1;
 		}
+		if (!cover || r->end > cover->end)
+			cover = r;
+	}
 
 	return 0;
 }
@@ -1404,9 +1509,9 @@ static uint32_t check_overlap_partitions(struct fdisk_gpt_label *gpt)
  */
 static uint64_t find_first_available(struct fdisk_gpt_label *gpt, uint64_t start)
 {
-	int first_moved = 0;
 	uint64_t first;
 	uint64_t fu, lu;
+	size_t i;
 
 	assert(gpt);
 	assert(gpt->pheader);
@@ -1422,29 +1527,13 @@ static uint64_t find_first_available(struct fdisk_gpt_label *gpt, uint64_t start
 	first = start < fu ? fu : start;
 
 	/*
-	 * Now search through all partitions; if first is within an
-	 * existing partition, move it to the next sector after that
-	 * partition and repeat. If first was moved, set firstMoved
-	 * flag; repeat until firstMoved is not set, so as to catch
-	 * cases where partitions are out of sequential order....
+	 * ...if first is within an extent of the existing partitions, move
+	 * it to the next sector after the extent.
 	 */
-	do {
-		size_t i;
-
-		first_moved = 0;
-		for (i = 0; i < gpt_get_nentries(gpt); i++) {
-			struct gpt_entry *e = gpt_get_entry(gpt, i);
-
-			if (!gpt_entry_is_used(e))
-				continue;
-			if (first < gpt_partition_start(e))
-				continue;
-			if (first <= gpt_partition_end(e)) {
-				first = gpt_partition_end(e) + 1;
-				first_moved = 1;
-			}
-		}
-	} while (first_moved == 1);
+	gpt_update_ranges(gpt);
+	i = ranges_count_upto(gpt->extents, gpt->nextents, first);
+	if (i && first <= gpt->extents[i - 1].end)
+		first = gpt->extents[i - 1].end + 1;
 
 	if (first > lu)
 		first = 0;
@@ -1456,31 +1545,29 @@ static uint64_t find_first_available(struct fdisk_gpt_label *gpt, uint64_t start
 /* Returns last available sector in the free space pointed to by start. From gdisk. */
 static uint64_t find_last_free(struct fdisk_gpt_label *gpt, uint64_t start)
 {
+	uint64_t lu;
 	size_t i;
-	uint64_t nearest_start;
 
 	assert(gpt);
 	assert(gpt->pheader);
 	assert(gpt->ents);
 
-	nearest_start = le64_to_cpu(gpt->pheader->last_usable_lba);
-
-	for (i = 0; i < gpt_get_nentries(gpt); i++) {
-		struct gpt_entry *e = gpt_get_entry(gpt, i);
-		uint64_t ps = gpt_partition_start(e);
+	lu = le64_to_cpu(gpt->pheader->last_usable_lba);
 
-		if (nearest_start > ps && ps > start)
-			nearest_start = ps - 1ULL;
-	}
+	/* the nearest partition behind start */
+	gpt_update_ranges(gpt);
+	i = ranges_count_upto(gpt->ranges, gpt->nranges, start);
+	if (i < gpt->nranges && gpt->ranges[i].start <= lu)
+		return gpt->ranges[i].start - 1ULL;
 
-	return nearest_start;
+	return lu;
 }
 
 /* Returns the last free sector on the disk. From gdisk. */
 static uint64_t find_last_free_sector(struct fdisk_gpt_label *gpt)
 {
-	int last_moved;
 	uint64_t last = 0;
+	size_t i;
 
 	assert(gpt);
 	assert(gpt->pheader);
@@ -1488,20 +1575,11 @@ static uint64_t find_last_free_sector(struct fdisk_gpt_label *gpt)
 
 	/* start by assuming the last usable LBA is available */
 	last = le64_to_cpu(gpt->pheader->last_usable_lba);
-	do {
-		size_t i;
-
-		last_moved = 0;
-		for (i = 0; i < gpt_get_nentries(gpt); i++) {
-			struct gpt_entry *e = gpt_get_entry(gpt, i);
 
-			if (last >= gpt_partition_start(e) &&
-			    last <= gpt_partition_end(e)) {
-				last = gpt_partition_start(e) - 1ULL;
-				last_moved = 1;
-			}
-		}
-	} while (last_moved == 1);
+	gpt_update_ranges(gpt);
+	i = ranges_count_upto(gpt->extents, gpt->nextents, last);
+	if (i && last <= gpt->extents[i - 1].end)
+		last = gpt->extents[i - 1].start - 1ULL;
 
 	return last;
 }
@@ -1659,6 +1737,9 @@ static int gpt_probe_label(struct fdisk_context *cxt)
 	if (gpt->minimize && gpt_possible_minimize(cxt, gpt))
 		fdisk_label_set_changed(cxt->label, 1);
 
+	if (gpt_alloc_ranges(gpt, gpt_get_nentries(gpt)) != 0)
+		goto failed;
+
 	cxt->label->nparts_max = gpt_get_nentries(gpt);
 	cxt->label->nparts_cur = partitions_in_use(gpt);
 	return 1;
@@ -1897,6 +1978,7 @@ static int gpt_set_partition(struct fdisk_context *cxt, size_t n,
 
 	gpt = self_label(cxt);
 	e = gpt_get_entry(gpt, n);
+	gpt->ranges_valid = 0;		/* see gpt_entries_changed() */
 
 	if (pa->uuid) {
 		char new_u[UUID_STR_LEN], old_u[UUID_STR_LEN];
@@ -1961,26 +2043,20 @@ static int gpt_set_partition(struct fdisk_context *cxt, size_t n,
 		}
 		e->lba_end = cpu_to_le64(end);
 	}
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_entries_changed(gpt);
 
 	fdisk_label_set_changed(cxt->label, 1);
 	return rc;
 }
 
+/*
+ * Queue the area to write, the real write is done by fdisk_flush_writes().
+ */
 static int gpt_write(struct fdisk_context *cxt, off_t offset, void *buf, size_t count)
 {
-	if (offset != lseek(cxt->dev_fd, offset, SEEK_SET))
-		return -errno;
-
-	if (write_all(cxt->dev_fd, buf, count))
-		return -errno;
-
-	fsync(cxt->dev_fd);
-
-	DBG(GPT, ul_debug("  write OK [offset=%zu, size=%zu]",
+	DBG(GPT, ul_debug("  queue write [offset=%zu, size=%zu]",
 				(size_t) offset, count));
-	return 0;
+	return fdisk_queue_write(cxt, offset, buf, count);
 }
 
 /*
@@ -2083,7 +2159,7 @@ static int gpt_write_disklabel(struct fdisk_context *cxt)
 	if (le64_to_cpu(gpt->pheader->alternative_lba) < cxt->total_sectors - 1ULL)
 		goto err0;
 
-	if (check_overlap_partitions(gpt))
+	if (check_overlap_partitions(gpt, NULL))
 		goto err0;
 
 	if (gpt->minimize)
@@ -2101,6 +2177,14 @@ static int gpt_write_disklabel(struct fdisk_context *cxt)
 	 *   4) primary GPT header
 	 *   5) protective MBR
 	 *
+	 * We keep only the backup/primary part of the order: the backup
+	 * (1 and 2) is flushed (written and synced) before we touch the
+	 * primary. fdisk_flush_writes() sorts the areas by offset, so within
+	 * one flush the header may reach the disk before the entries. That's
+	 * fine, an incomplete primary is detected by CRC and the valid backup
+	 * is used. The areas are usually contiguous, so it's two writes and
+	 * two syncs for the whole label.
+	 *
 	 * If any write fails, we abort the rest.
 	 */
 	if (gpt_write_partitions(cxt, gpt->bheader, gpt->ents) != 0)
@@ -2108,6 +2192,9 @@ static int gpt_write_disklabel(struct fdisk_context *cxt)
 	if (gpt_write_header(cxt, gpt->bheader,
 			     le64_to_cpu(gpt->pheader->alternative_lba)) != 0)
 		goto err1;
+	if (fdisk_flush_writes(cxt) != 0)
+		goto err1;
+
 	if (gpt_write_partitions(cxt, gpt->pheader, gpt->ents) != 0)
 		goto err1;
 	if (gpt_write_header(cxt, gpt->pheader, GPT_PRIMARY_PARTITION_TABLE_LBA) != 0)
@@ -2117,6 +2204,8 @@ static int gpt_write_disklabel(struct fdisk_context *cxt)
 		fdisk_warnx(cxt, _("The device contains hybrid MBR -- writing GPT only."));
 	else if (gpt_write_pmbr(cxt) != 0)
 		goto err1;
+	if (fdisk_flush_writes(cxt) != 0)
+		goto err1;
 
 	DBG(GPT, ul_debug("...write success"));
 	return 0;
@@ -2126,6 +2215,7 @@ err0:
 	return -EINVAL;
 err1:
 	DBG(GPT, ul_debug("...write failed: %m"));
+	fdisk_free_writes(cxt);
 	return -errno;
 }
 
@@ -2138,6 +2228,7 @@ static int gpt_verify_disklabel(struct fdisk_context *cxt)
 {
 	int nerror = 0;
 	unsigned int ptnum;
+	uint32_t other = 0;
 	struct fdisk_gpt_label *gpt;
 
 	assert(cxt);
@@ -2200,11 +2291,11 @@ static int gpt_verify_disklabel(struct fdisk_context *cxt)
 		fdisk_warnx(cxt, _("Primary and backup header mismatch."));
 	}
 
-	ptnum = check_overlap_partitions(gpt);
+	ptnum = check_overlap_partitions(gpt, &other);
 	if (ptnum) {
 		nerror++;
 		fdisk_warnx(cxt, _("Partition %u overlaps with partition %u."),
-				ptnum, ptnum+1);
+				ptnum, other);
 	}
 
 	ptnum = check_too_big_partitions(gpt, cxt->total_sectors);
@@ -2273,8 +2364,7 @@ static int gpt_delete_partition(struct fdisk_context *cxt,
 	/* hasta la vista, baby! */
 	gpt_zeroize_entry(gpt, partnum);
 
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_entries_changed(gpt);
 	cxt->label->nparts_cur--;
 	fdisk_label_set_changed(cxt->label, 1);
 
@@ -2500,6 +2590,7 @@ static int gpt_add_partition(
 	assert(partnum < gpt_get_nentries(gpt));
 
 	e = gpt_get_entry(gpt, partnum);
+	gpt->ranges_valid = 0;		/* see gpt_entries_changed() */
 	e->lba_end = cpu_to_le64(user_l);
 	e->lba_start = cpu_to_le64(user_f);
 
@@ -2535,8 +2626,7 @@ static int gpt_add_partition(
 				gpt_partition_end(e),
 				gpt_partition_size(e)));
 
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_entries_changed(gpt);
 
 	/* report result */
 	{
@@ -2619,8 +2709,10 @@ static int gpt_create_disklabel(struct fdisk_context *cxt)
 		rc = -ENOMEM;
 		goto done;
 	}
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	rc = gpt_alloc_ranges(gpt, gpt_get_nentries(gpt));
+	if (rc)
+		goto done;
+	gpt_entries_changed(gpt);
 
 	cxt->label->nparts_max = gpt_get_nentries(gpt);
 	cxt->label->nparts_cur = 0;
@@ -2785,6 +2877,10 @@ int fdisk_gpt_set_npartitions(struct fdisk_context *cxt, uint32_t nents)
 		memset(ents + old_size, 0, new_size - old_size);
 		gpt->ents = ents;
 	}
+	if (gpt_alloc_ranges(gpt, nents) != 0) {
+		fdisk_warnx(cxt, _("Cannot allocate memory!"));
+		return -ENOMEM;
+	}
 
 	/* everything's ok, apply the new size */
 	gpt->pheader->npartition_entries = cpu_to_le32(nents);
@@ -2802,8 +2898,7 @@ int fdisk_gpt_set_npartitions(struct fdisk_context *cxt, uint32_t nents)
 	gpt_mknew_header_common(cxt, gpt->bheader, le64_to_cpu(gpt->pheader->alternative_lba));
 
 	/* CRCs will have changed */
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_entries_changed(gpt);
 
 	/* update library info */
 	cxt->label->nparts_max = gpt_get_nentries(gpt);
@@ -2834,6 +2929,29 @@ static int gpt_part_is_used(struct fdisk_context *cxt, size_t i)
 	return gpt_entry_is_used(e) || gpt_partition_start(e);
 }
 
+static int gpt_get_used_ranges(struct fdisk_context *cxt,
+			       const struct fdisk_range **ranges, size_t *nranges)
+{
+	struct fdisk_gpt_label *gpt;
+
+	assert(cxt);
+	assert(cxt->label);
+	assert(fdisk_is_label(cxt, GPT));
+
+	gpt = self_label(cxt);
+
+	if (!gpt->pheader || !gpt->ents) {
+		*ranges = NULL;
+		*nranges = 0;
+		return 0;
+	}
+
+	gpt_update_ranges(gpt);
+	*ranges = gpt->ranges;
+	*nranges = gpt->nranges;
+	return 0;
+}
+
 /**
  * fdisk_gpt_is_hybrid:
  * @cxt: context
@@ -3054,8 +3172,7 @@ static int gpt_reorder(struct fdisk_context *cxt)
 	qsort(gpt->ents, nparts, sizeof(struct gpt_entry),
 			gpt_entry_cmp_start);
 
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_entries_changed(gpt);
 	fdisk_label_set_changed(cxt->label, 1);
 
 	return 0;
@@ -3104,10 +3221,14 @@ static void gpt_deinit(struct fdisk_label *lb)
 	free(gpt->ents);
 	free(gpt->pheader);
 	free(gpt->bheader);
+	free(gpt->ranges);
 
 	gpt->ents = NULL;
 	gpt->pheader = NULL;
 	gpt->bheader = NULL;
+	gpt->ranges = gpt->extents = NULL;
+	gpt->nranges = gpt->nextents = gpt->ranges_max = 0;
+	gpt->ranges_valid = 0;
 }
 
 static const struct fdisk_label_operations gpt_operations =
@@ -3128,6 +3249,7 @@ static const struct fdisk_label_operations gpt_operations =
 
 	.part_is_used	= gpt_part_is_used,
 	.part_toggle_flag = gpt_toggle_partition_flag,
+	.get_used_ranges = gpt_get_used_ranges,
 
 	.deinit		= gpt_deinit,
 
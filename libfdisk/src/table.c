@@ -568,6 +568,67 @@ done:
 }
 
 
+/* add free space in front of a partition which starts at @start; we ignore
+ * small free spaces (smaller than grain) to keep partitions aligned, the
+ * exception is space before the first partition when cxt->first_lba is
+ * aligned. If @append is true then @tb contains only the free space
+ * previously added in the disk order and the new one belongs to the end. */
+static int add_gap_freespace(struct fdisk_context *cxt,
+			     struct fdisk_table *tb,
+			     fdisk_sector_t last,
+			     fdisk_sector_t start,
+			     fdisk_sector_t grain,
+			     size_t nparts,
+			     int append)
+{
+	struct fdisk_partition *pa = NULL;
+	int rc;
+
+	if (!(last + grain < start
+	      || (nparts == 0 &&
+		  (fdisk_align_lba(cxt, last, FDISK_ALIGN_UP) < start))))
+		return 0;
+
+	if (!append)
+		return table_add_freespace(cxt, tb,
+				last + (nparts == 0 ? 0 : 1), start - 1, NULL);
+
+	rc = new_freespace(cxt, last + (nparts == 0 ? 0 : 1), start - 1, NULL, &pa);
+	if (pa) {
+		rc = fdisk_table_add_partition(tb, pa);
+		fdisk_unref_partition(pa);
+	}
+	return rc;
+}
+
+/* analyze gaps between the used areas as returned by label get_used_ranges
+ * operation, the ranges are already sorted and no partition is nested */
+static int ranges_freespace(struct fdisk_context *cxt,
+			    struct fdisk_table *tb,
+			    fdisk_sector_t grain,
+			    fdisk_sector_t *last,
+			    size_t *nparts)
+{
+	const struct fdisk_range *ranges = NULL;
+	int append = fdisk_table_is_empty(tb);
+	size_t i, n = 0;
+	int rc;
+
+	rc = cxt->label->op->get_used_ranges(cxt, &ranges, &n);
+
+	for (i = 0; rc == 0 && i < n; i++) {
+		const struct fdisk_range *r = &ranges[i];
+
+		rc = add_gap_freespace(cxt, tb, *last, r->start, grain,
+				       *nparts, append);
+		if (r->end > *last)
+			*last = r->end;
+		(*nparts)++;
+	}
+
+	return rc;
+}
+
 /**
  * fdisk_get_freespaces
  * @cxt: fdisk context
@@ -597,17 +658,24 @@ int fdisk_get_freespaces(struct fdisk_context *cxt, struct fdisk_table **tb)
 	if (!*tb && !(*tb = fdisk_new_table()))
 		return -ENOMEM;
 
+	last = cxt->first_lba;
+	grain = cxt->grain > cxt->sector_size ?	cxt->grain / cxt->sector_size : 1;
+
+	DBG(CXT, ul_debugobj(cxt, "initialized:  last=%ju, grain=%ju",
+	                     (uintmax_t)last,  (uintmax_t)grain));
+
+	/* the label maintains sorted used areas, don't create partitions */
+	if (cxt->label->op->get_used_ranges) {
+		rc = ranges_freespace(cxt, *tb, grain, &last, &nparts);
+		goto tail;
+	}
+
 	rc = fdisk_get_partitions(cxt, &parts);
 	if (rc)
 		goto done;
 
 	fdisk_table_sort_partitions(parts, fdisk_partition_cmp_start);
 	fdisk_reset_iter(&itr, FDISK_ITER_FORWARD);
-	last = cxt->first_lba;
-	grain = cxt->grain > cxt->sector_size ?	cxt->grain / cxt->sector_size : 1;
-
-	DBG(CXT, ul_debugobj(cxt, "initialized:  last=%ju, grain=%ju",
-	                     (uintmax_t)last,  (uintmax_t)grain));
 
 	/* analyze gaps between partitions */
 	while (rc == 0 && fdisk_table_next_partition(parts, &itr, &pa) == 0) {
@@ -623,17 +691,8 @@ int fdisk_get_freespaces(struct fdisk_context *cxt, struct fdisk_table **tb)
 					(uintmax_t) fdisk_partition_get_start(pa),
 					(uintmax_t) fdisk_partition_get_end(pa)));
 
-		/* We ignore small free spaces (smaller than grain) to keep partitions
-		 * aligned, the exception is space before the first partition when
-		 * cxt->first_lba is aligned. */
-		if (last + grain < pa->start
-		    || (nparts == 0 &&
-		        (fdisk_align_lba(cxt, last, FDISK_ALIGN_UP) <
-			 pa->start))) {
-			rc = table_add_freespace(cxt, *tb,
-				last + (nparts == 0 ? 0 : 1),
-				pa->start - 1, NULL);
-		}
+		rc = add_gap_freespace(cxt, *tb, last, pa->start, grain, nparts, 0);
+
 		/* add gaps between logical partitions */
 		if (fdisk_partition_is_container(pa))
 			rc = check_container_freespace(cxt, parts, *tb, pa);
@@ -646,6 +705,7 @@ int fdisk_get_freespaces(struct fdisk_context *cxt, struct fdisk_table **tb)
 		nparts++;
 	}
 
+tail:
 	/* add free-space behind last partition to the end of the table (so
 	 * don't use table_add_freespace()) */
 	if (rc == 0 && last + grain < cxt->last_lba - 1) {
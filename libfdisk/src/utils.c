@@ -4,6 +4,13 @@
 #include "canonicalize.h"
 
 #include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+
+#ifndef IOV_MAX
+# define IOV_MAX	1024
+#endif
 
 /**
  * SECTION: utils
@@ -105,6 +112,236 @@ int fdisk_read_firstsector(struct fdisk_context *cxt)
 	return  read_from_device(cxt, cxt->firstsector, 0, cxt->sector_size);
 }
 
+/*
+ * Add area to the list of the pending writes. The @data are not copied, the
+ * buffer has to be valid until fdisk_flush_writes() is called.
+ *
+ * The label drivers queue all the sectors (headers, entries, EBRs, ...) which
+ * could be written together and then call fdisk_flush_writes(). The flush is
+ * also a barrier; areas which have to be on disk before anything else (e.g.
+ * GPT backup before primary) have to be flushed separately.
+ */
+int fdisk_queue_write(struct fdisk_context *cxt, uint64_t offset,
+			const void *data, size_t size)
+{
+	struct fdisk_wreq *w;
+
+	assert(cxt);
+	assert(data);
+
+	if (!size)
+		return 0;
+
+	if (cxt->nwreqs == cxt->wreqs_max) {
+		size_t max = cxt->wreqs_max ? cxt->wreqs_max * 2 : 8;
+
+		w = realloc(cxt->wreqs, max * sizeof(struct fdisk_wreq));
+		if (!w)
+			return -ENOMEM;
+		cxt->wreqs = w;
+		cxt->wreqs_max = max;
+	}
+
+	DBG(CXT, ul_debugobj(cxt, "queue write: offset=%ju, size=%zu",
+				(uintmax_t) offset, size));
+
+	w = &cxt->wreqs[cxt->nwreqs++];
+	w->offset = offset;
+	w->size = size;
+	w->data = data;
+	return 0;
+}
+
+void fdisk_free_writes(struct fdisk_context *cxt)
+{
+	free(cxt->wreqs);
+	cxt->wreqs = NULL;
+	cxt->nwreqs = cxt->wreqs_max = 0;
+}
+
+static int cmp_wreqs(const void *a, const void *b)
+{
+	const struct fdisk_wreq *wa = a, *wb = b;
+
+	return wa->offset < wb->offset ? -1 : wa->offset > wb->offset;
+}
+
+/* writes @iovcnt buffers to @offset, restarts on short write */
+static int pwritev_all(int fd, struct iovec *iov, size_t iovcnt, uint64_t offset)
+{
+	while (iovcnt) {
+		ssize_t r = pwritev(fd, iov, min(iovcnt, (size_t) IOV_MAX), offset);
+
+		if (r < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			return -errno;
+		}
+		if (r == 0)
+			return -EIO;
+
+		offset += r;
+		while (iovcnt && (size_t) r >= iov->iov_len) {
+			r -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt && r) {
+			iov->iov_base = (char *) iov->iov_base + r;
+			iov->iov_len -= r;
+		}
+	}
+	return 0;
+}
+
+/*
+ * O_DIRECT write of the contiguous run by one aligned bounce buffer. Returns
+ * 1 if the run cannot be written in this way (unaligned, not supported), the
+ * caller falls back to the buffered I/O.
+ */
+static int write_run_direct(struct fdisk_context *cxt, int fd,
+			struct iovec *iov, size_t iovcnt,
+			uint64_t offset, size_t size,
+			unsigned char **buf, size_t *bufsz)
+{
+	unsigned char *p;
+	size_t i;
+
+	if (offset % cxt->sector_size || size % cxt->sector_size)
+		return 1;
+
+	if (*bufsz < size) {
+		void *tmp = NULL;
+
+		if (posix_memalign(&tmp, max((size_t) getpagesize(),
+					     (size_t) cxt->sector_size), size))
+			return -ENOMEM;
+		free(*buf);
+		*buf = tmp;
+		*bufsz = size;
+	}
+
+	for (p = *buf, i = 0; i < iovcnt; i++) {
+		memcpy(p, iov[i].iov_base, iov[i].iov_len);
+		p += iov[i].iov_len;
+	}
+
+	for (p = *buf; size; ) {
+		ssize_t r = pwrite(fd, p, size, offset);
+
+		if (r < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			if (errno == EINVAL && p == *buf)
+				return 1;	/* O_DIRECT unsupported */
+			return -errno;
+		}
+		if (r == 0)
+			return -EIO;
+		p += r;
+		offset += r;
+		size -= r;
+	}
+	return 0;
+}
+
+/*
+ * Write all queued areas to the device. The areas are sorted, contiguous
+ * areas are merged and written by one pwritev() (or one O_DIRECT write if
+ * enabled by fdisk_enable_direct_write()), and the device is synced once at
+ * the end. The queue is always emptied.
+ *
+ * Returns: 0 on success, <0 on error.
+ */
+int fdisk_flush_writes(struct fdisk_context *cxt)
+{
+	struct iovec *iov = NULL;
+	unsigned char *dbuf = NULL;
+	size_t i, n, dbufsz = 0, nruns = 0;
+	int rc = 0, dfd = -1;
+
+	assert(cxt);
+	assert(cxt->dev_fd >= 0);
+
+	if (!cxt->nwreqs)
+		return 0;
+
+	qsort(cxt->wreqs, cxt->nwreqs, sizeof(struct fdisk_wreq), cmp_wreqs);
+
+	for (i = 1; i < cxt->nwreqs; i++) {
+		if (cxt->wreqs[i - 1].offset + cxt->wreqs[i - 1].size
+		    > cxt->wreqs[i].offset) {
+			DBG(CXT, ul_debugobj(cxt, "overlapping writes at offset %ju",
+					(uintmax_t) cxt->wreqs[i].offset));
+			rc = -EINVAL;
+			goto done;
+		}
+	}
+
+	iov = malloc(cxt->nwreqs * sizeof(struct iovec));
+	if (!iov) {
+		rc = -ENOMEM;
+		goto done;
+	}
+
+	if (cxt->direct_write && cxt->dev_path) {
+		dfd = open(cxt->dev_path, O_WRONLY | O_DIRECT | O_CLOEXEC);
+		if (dfd < 0)
+			DBG(CXT, ul_debugobj(cxt, "cannot open %s for O_DIRECT: %m",
+					cxt->dev_path));
+	}
+
+	for (i = 0; i < cxt->nwreqs; i += n) {
+		uint64_t offset = cxt->wreqs[i].offset, end = offset;
+
+		for (n = 0; i + n < cxt->nwreqs
+			    && cxt->wreqs[i + n].offset == end; n++) {
+			iov[n].iov_base = (void *) cxt->wreqs[i + n].data;
+			iov[n].iov_len = cxt->wreqs[i + n].size;
+			end += cxt->wreqs[i + n].size;
+		}
+
+		DBG(CXT, ul_debugobj(cxt, "writing: offset=%ju, size=%ju [%zu areas%s]",
+				(uintmax_t) offset, (uintmax_t) (end - offset), n,
+				dfd >= 0 ? ", direct" : ""));
+		rc = 1;
+		if (dfd >= 0) {
+			rc = write_run_direct(cxt, dfd, iov, n, offset,
+					end - offset, &dbuf, &dbufsz);
+			if (rc == 1 && offset % cxt->sector_size == 0
+				    && (end - offset) % cxt->sector_size == 0) {
+				/* aligned and still refused, don't try again */
+				close(dfd);
+				dfd = -1;
+			}
+		}
+		if (rc == 1)
+			rc = pwritev_all(cxt->dev_fd, iov, n, offset);
+		if (rc) {
+			DBG(CXT, ul_debugobj(cxt, "write failed: %s", strerror(-rc)));
+			goto done;
+		}
+		nruns++;
+	}
+
+	/* fsync() on the block device also flushes the device cache, so it
+	 * covers the O_DIRECT writes too */
+	if (fsync(cxt->dev_fd) && errno != EINVAL)
+		rc = -errno;
+
+	DBG(CXT, ul_debugobj(cxt, "flushed %zu areas by %zu writes",
+				cxt->nwreqs, nruns));
+done:
+	if (dfd >= 0)
+		close(dfd);
+	free(dbuf);
+	free(iov);
+	cxt->nwreqs = 0;
+	if (rc)
+		errno = -rc;
+	return rc;
+}
+
 /**
  * fdisk_partname:
  * @dev: device name
@@ -69,6 +69,9 @@ struct libmnt_cache {
 	blkid_cache		bc;
 
 	struct libmnt_table	*mtab;
+
+	/* resolved path components shared by all canonicalized paths */
+	struct canonicalize_cache *canon;
 };
 
 /**
@@ -111,6 +114,7 @@ void mnt_free_cache(struct libmnt_cache *cache)
 	free(cache->ents);
 	if (cache->bc)
 		blkid_put_cache(cache->bc);
+	free_canonicalize_cache(cache->canon);
 	free(cache);
 }
 
@@ -500,7 +504,10 @@ static char *canonicalize_path_and_cache(const char *path,
 	char *value;
 
 	DBG(CACHE, ul_debugobj(cache, "canonicalize path %s", path));
-	p = canonicalize_path(path);
+
+	if (cache && !cache->canon)
+		cache->canon = new_canonicalize_cache();
+	p = canonicalize_path_cached(path, cache ? cache->canon : NULL);
 
 	if (p && cache) {
 		value = p;
@@ -522,6 +529,20 @@ error:
 	return NULL;
 }
 
+/*
+ * Drops the resolved path components. The mount and umount change the paths
+ * below the mountpoint, so the components are stale after a successful
+ * mount(2) or umount(2).
+ */
+void mnt_cache_reset_components(struct libmnt_cache *cache)
+{
+	if (!cache || !cache->canon || !cache->canon->nents)
+		return;
+
+	DBG(CACHE, ul_debugobj(cache, "reset path components"));
+	reset_canonicalize_cache(cache->canon);
+}
+
 /**
  * mnt_resolve_path:
  * @path: "native" path
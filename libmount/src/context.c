@@ -1640,8 +1640,7 @@ int mnt_context_set_mflags(struct libmnt_context *cxt, unsigned long flags)
 		/*
 		 * the final mount options are already generated, refresh...
 		 */
-		return mnt_optstr_apply_flags(
-				&cxt->fs->vfs_optstr,
+		return mnt_fs_apply_optflags(cxt->fs, MNT_FS_OPTVEC_VFS,
 				cxt->mountflags,
 				mnt_get_builtin_optmap(MNT_LINUX_MAP));
 
@@ -1669,9 +1668,13 @@ int mnt_context_get_mflags(struct libmnt_context *cxt, unsigned long *flags)
 	*flags = 0;
 	if (!(cxt->flags & MNT_FL_MOUNTFLAGS_MERGED) && cxt->fs) {
 		const char *o = mnt_fs_get_options(cxt->fs);
-		if (o)
-			rc = mnt_optstr_get_flags(o, flags,
-				    mnt_get_builtin_optmap(MNT_LINUX_MAP));
+		if (o) {
+			struct libmnt_optvec *vec = mnt_fs_get_optvec(cxt->fs,
+							MNT_FS_OPTVEC_ALL);
+			rc = vec ? mnt_optvec_get_flags(vec, flags,
+					mnt_get_builtin_optmap(MNT_LINUX_MAP)) :
+				   -ENOMEM;
+		}
 	}
 
 	list_for_each(p, &cxt->addmounts) {
@@ -1725,9 +1728,13 @@ int mnt_context_get_user_mflags(struct libmnt_context *cxt, unsigned long *flags
 	*flags = 0;
 	if (!(cxt->flags & MNT_FL_MOUNTFLAGS_MERGED) && cxt->fs) {
 		const char *o = mnt_fs_get_user_options(cxt->fs);
-		if (o)
-			rc = mnt_optstr_get_flags(o, flags,
-				mnt_get_builtin_optmap(MNT_USERSPACE_MAP));
+		if (o) {
+			struct libmnt_optvec *vec = mnt_fs_get_optvec(cxt->fs,
+							MNT_FS_OPTVEC_USER);
+			rc = vec ? mnt_optvec_get_flags(vec, flags,
+					mnt_get_builtin_optmap(MNT_USERSPACE_MAP)) :
+				   -ENOMEM;
+		}
 	}
 	if (!rc)
 		*flags |= cxt->user_mountflags;
@@ -2531,6 +2538,7 @@ int mnt_context_apply_fstab(struct libmnt_context *cxt)
 
 		/* remove "bind" from fstab (or no-op if not present) */
 		mnt_optstr_remove_option(&cxt->fs->optstr, "bind");
+		mnt_fs_reset_optvecs(cxt->fs);
 	}
 	return rc;
 }
@@ -0,0 +1,349 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * This file is part of libmount from util-linux project.
+ *
+ * libmount is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Scheduler for mnt_context_mount_all() and mnt_context_umount_tree().
+ *
+ * Every job is one filesystem. The job is ready when all the jobs it depends
+ * on are done (job->nwait is zero), the ready jobs are started in FIFO order
+ * and every job runs in a separate child process. The context is not
+ * thread-safe, so fork() is the only way to run the mount(2) and umount(2)
+ * syscalls and the /sbin/[u]mount.<type> helpers concurrently.
+ *
+ * If nofork is requested the jobs are executed one by one in the current
+ * process (still in the dependency order).
+ */
+#include <sys/wait.h>
+#include <poll.h>
+
+#include "mountP.h"
+#include "monotonic.h"
+#include "pidfd-utils.h"
+
+struct libmnt_job *mnt_jobs_add(struct libmnt_jobs *js, struct libmnt_fs *fs)
+{
+	struct libmnt_job *job;
+
+	if ((js->njobs % 64) == 0) {
+		job = realloc(js->jobs, (js->njobs + 64) * sizeof(struct libmnt_job));
+		if (!job)
+			return NULL;
+		js->jobs = job;
+	}
+
+	job = &js->jobs[js->njobs++];
+	memset(job, 0, sizeof(*job));
+	job->fs = fs;
+	job->pidfd = -1;
+	mnt_ref_fs(fs);
+	return job;
+}
+
+/* @next waits for @job */
+int mnt_jobs_add_dependency(struct libmnt_jobs *js, size_t job, size_t next)
+{
+	struct libmnt_job *j = &js->jobs[job];
+
+	if ((j->nnext % 8) == 0) {
+		size_t *x = realloc(j->next, (j->nnext + 8) * sizeof(size_t));
+		if (!x)
+			return -ENOMEM;
+		j->next = x;
+	}
+	j->next[j->nnext++] = next;
+	js->jobs[next].nwait++;
+	return 0;
+}
+
+void mnt_jobs_deinit(struct libmnt_jobs *js)
+{
+	size_t i;
+
+	for (i = 0; i < js->njobs; i++) {
+		struct libmnt_job *job = &js->jobs[i];
+
+		/* after error, don't leave zombies */
+		if (job->state == MNT_JOB_RUNNING) {
+			int ret;
+			while (waitpid(job->pid, &ret, 0) == -1 && errno == EINTR);
+		}
+		if (job->pidfd >= 0)
+			close(job->pidfd);
+		mnt_unref_fs(job->fs);
+		free(job->next);
+	}
+	free(js->jobs);
+	free(js->ready);
+	free(js->running);
+
+	js->jobs = NULL;
+	js->ready = js->running = NULL;
+	js->njobs = js->nready = js->nrunning = 0;
+}
+
+/* executes the job in the current process, returns job status */
+static int exec_job(struct libmnt_context *cxt, struct libmnt_jobs *js,
+		    struct libmnt_job *job)
+{
+	struct libmnt_table *mtab;
+	int rc;
+
+	/* reset context, but protect mtab */
+	mtab = cxt->mtab;
+	cxt->mtab = NULL;
+	mnt_reset_context(cxt);
+	cxt->mtab = mtab;
+
+	rc = js->op(cxt, job->fs);
+	if (js->child_cb)
+		return js->child_cb(cxt, job->fs, rc);
+
+	return rc == 0 ? 0 : 1;
+}
+
+static int start_job(struct libmnt_context *cxt, struct libmnt_jobs *js,
+		     struct libmnt_job *job)
+{
+	int rc;
+
+	DBG(CXT, ul_debugobj(cxt, "jobs: starting %s", mnt_fs_get_target(job->fs)));
+
+	/* don't duplicate unflushed output in the child */
+	fflush(stdout);
+	DBG_FLUSH;
+
+	gettime_monotonic(&job->start);
+	job->pid = fork();
+
+	switch (job->pid) {
+	case -1:
+		return -errno;
+	case 0:
+		break;
+	default:
+		job->state = MNT_JOB_RUNNING;
+#ifdef UL_HAVE_PIDFD
+		job->pidfd = pidfd_open(job->pid, 0);
+#endif
+		js->running[js->nrunning++] = job - js->jobs;
+		return 0;
+	}
+
+	/* child */
+	cxt->pid = getpid();
+	mnt_context_enable_fork(cxt, FALSE);
+
+	rc = exec_job(cxt, js, job);
+
+	DBG(CXT, ul_debugobj(cxt, "jobs: child exit [rc=%d]", rc));
+	DBG_FLUSH;
+	fflush(stdout);
+	fflush(stderr);
+	_exit(rc);
+}
+
+/*
+ * Reaps running job @i, returns NULL if the job is not finished yet and
+ * WNOHANG is specified in @flags.
+ */
+static struct libmnt_job *reap_job(struct libmnt_context *cxt,
+				   struct libmnt_jobs *js, size_t i,
+				   int flags, int *status)
+{
+	struct libmnt_job *job = &js->jobs[js->running[i]];
+	int ret = 0;
+	pid_t pid;
+
+	while ((pid = waitpid(job->pid, &ret, flags)) == -1 && errno == EINTR);
+	if (pid != job->pid)
+		return NULL;
+
+	if (job->pidfd >= 0) {
+		close(job->pidfd);
+		job->pidfd = -1;
+	}
+	js->running[i] = js->running[--js->nrunning];
+	*status = WIFEXITED(ret) ? WEXITSTATUS(ret) : -EINTR;
+	DBG(CXT, ul_debugobj(cxt, "jobs: %s done [status=%d]",
+				mnt_fs_get_target(job->fs), *status));
+	return job;
+}
+
+/* waits for any running job by poll() on the job pidfds */
+static struct libmnt_job *poll_job(struct libmnt_context *cxt,
+				   struct libmnt_jobs *js, int *status)
+{
+	struct libmnt_job *job = NULL;
+	struct pollfd *fds;
+	size_t i;
+
+	fds = calloc(js->nrunning, sizeof(struct pollfd));
+	if (!fds)
+		return NULL;
+
+	while (!job) {
+		for (i = 0; i < js->nrunning; i++) {
+			fds[i].fd = js->jobs[js->running[i]].pidfd;
+			fds[i].events = POLLIN;
+			fds[i].revents = 0;
+		}
+		if (poll(fds, js->nrunning, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (i = 0; i < js->nrunning && !job; i++) {
+			if (fds[i].revents)
+				job = reap_job(cxt, js, i, WNOHANG, status);
+		}
+	}
+
+	free(fds);
+	return job;
+}
+
+/*
+ * Waits for any of the running jobs. Other children of the process are not
+ * reaped.
+ */
+static struct libmnt_job *wait_job(struct libmnt_context *cxt,
+				   struct libmnt_jobs *js, int *status)
+{
+	siginfo_t info;
+	size_t i;
+
+	for (i = 0; i < js->nrunning; i++) {
+		if (js->jobs[js->running[i]].pidfd < 0)
+			break;
+	}
+	if (i == js->nrunning)
+		return poll_job(cxt, js, status);
+
+	/* no pidfds, peek at the first exited child */
+	memset(&info, 0, sizeof(info));
+	while (waitid(P_ALL, 0, &info, WEXITED | WNOWAIT) != 0) {
+		if (errno != EINTR)
+			return NULL;
+	}
+
+	for (i = 0; i < js->nrunning; i++) {
+		if (info.si_pid == js->jobs[js->running[i]].pid)
+			return reap_job(cxt, js, i, 0, status);
+	}
+
+	/* not our child, block on one of our jobs */
+	return reap_job(cxt, js, 0, 0, status);
+}
+
+static void finish_job(struct libmnt_context *cxt, struct libmnt_jobs *js,
+		       struct libmnt_job *job, int status, unsigned long long usec)
+{
+	size_t i;
+
+	job->state = MNT_JOB_DONE;
+	js->ndone++;
+
+	for (i = 0; i < job->nnext; i++) {
+		struct libmnt_job *x = &js->jobs[job->next[i]];
+
+		if (status != 0 && js->cancel_next)
+			x->canceled = 1;
+		if (--x->nwait == 0)
+			js->ready[js->nready++] = job->next[i];
+	}
+
+	if (js->done)
+		js->done(cxt, js, job, status, usec);
+}
+
+static unsigned long long job_usec(struct libmnt_job *job)
+{
+	struct timeval now;
+
+	gettime_monotonic(&now);
+	return (unsigned long long) (now.tv_sec - job->start.tv_sec) * 1000000
+		+ now.tv_usec - job->start.tv_usec;
+}
+
+/*
+ * Runs all jobs, returns 0 on success or <0 on error (fork or wait failed).
+ * The job exit status is reported by js->done() only.
+ */
+int mnt_context_run_jobs(struct libmnt_context *cxt, struct libmnt_jobs *js)
+{
+	size_t i;
+	int rc = 0;
+
+	if (!cxt || !js || !js->op)
+		return -EINVAL;
+	if (!js->njobs)
+		return 0;
+
+	js->ready = malloc(js->njobs * sizeof(size_t));
+	js->running = malloc(js->njobs * sizeof(size_t));
+	if (!js->ready || !js->running)
+		return -ENOMEM;
+
+	js->ndone = js->nready = js->iready = js->nrunning = 0;
+	for (i = 0; i < js->njobs; i++) {
+		if (!js->jobs[i].nwait)
+			js->ready[js->nready++] = i;
+	}
+
+	DBG(CXT, ul_debugobj(cxt, "jobs: %zu entries, max %zu jobs%s",
+				js->njobs, js->maxjobs,
+				js->nofork ? " (nofork)" : ""));
+
+	while (js->ndone < js->njobs) {
+		struct libmnt_job *job;
+		int status = 0;
+
+		/* start ready jobs */
+		while (js->iready < js->nready) {
+			job = &js->jobs[js->ready[js->iready]];
+			if (job->canceled) {
+				js->iready++;
+				finish_job(cxt, js, job, -ECANCELED, 0);
+				continue;
+			}
+			if (js->nofork
+			    || (js->maxjobs && js->nrunning >= js->maxjobs))
+				break;
+
+			rc = start_job(cxt, js, job);
+			if (rc) {
+				DBG(CXT, ul_debugobj(cxt, "jobs: fork failed [rc=%d]", rc));
+				if (!js->nrunning)
+					return rc;	/* nothing to wait for */
+				rc = 0;
+				break;			/* try it later */
+			}
+			js->iready++;
+		}
+		if (js->ndone == js->njobs)
+			break;
+
+		if (js->nofork && js->iready < js->nready) {
+			job = &js->jobs[js->ready[js->iready++]];
+			gettime_monotonic(&job->start);
+			status = exec_job(cxt, js, job);
+
+		} else if (js->nrunning) {
+			job = wait_job(cxt, js, &status);
+			if (!job)
+				return -errno;
+		} else
+			return -EINVAL;		/* dependency cycle */
+
+		finish_job(cxt, js, job, status, job_usec(job));
+	}
+
+	return rc;
+}
@@ -71,6 +71,7 @@ int mnt_context_is_loopdev(struct libmnt_context *cxt)
 			DBG(LOOP, ul_debugobj(cxt, "automatically enabling loop= option"));
 			cxt->user_mountflags |= MNT_MS_LOOP;
 			mnt_optstr_append_option(&cxt->fs->user_optstr, "loop", NULL);
+			mnt_fs_reset_optvecs(cxt->fs);
 			return 1;
 		}
 	}
@@ -365,6 +366,7 @@ success:
 			DBG(LOOP, ul_debugobj(cxt, "removing unnecessary loop= from mtab"));
 			cxt->user_mountflags &= ~MNT_MS_LOOP;
 			mnt_optstr_remove_option(&cxt->fs->user_optstr, "loop");
+			mnt_fs_reset_optvecs(cxt->fs);
 		}
 
 		if (!(cxt->mountflags & MS_RDONLY) &&
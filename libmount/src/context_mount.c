@@ -253,13 +253,13 @@ static int fix_optstr(struct libmnt_context *cxt)
 	 * Sync mount options with mount flags
 	 */
 	DBG(CXT, ul_debugobj(cxt, "mount: fixing vfs optstr"));
-	rc = mnt_optstr_apply_flags(&fs->vfs_optstr, cxt->mountflags,
+	rc = mnt_fs_apply_optflags(fs, MNT_FS_OPTVEC_VFS, cxt->mountflags,
 				mnt_get_builtin_optmap(MNT_LINUX_MAP));
 	if (rc)
 		goto done;
 
 	DBG(CXT, ul_debugobj(cxt, "mount: fixing user optstr"));
-	rc = mnt_optstr_apply_flags(&fs->user_optstr, cxt->user_mountflags,
+	rc = mnt_fs_apply_optflags(fs, MNT_FS_OPTVEC_USER, cxt->user_mountflags,
 				mnt_get_builtin_optmap(MNT_USERSPACE_MAP));
 	if (rc)
 		goto done;
@@ -370,6 +370,8 @@ static int fix_optstr(struct libmnt_context *cxt)
 	fs->optstr = NULL;
 	fs->optstr = mnt_fs_strdup_options(fs);
 done:
+	/* the options strings are modified in place */
+	mnt_fs_reset_optvecs(fs);
 	cxt->flags |= MNT_FL_MOUNTOPTS_FIXED;
 
 	DBG(CXT, ul_debugobj(cxt, "fixed options [rc=%d]: "
@@ -1109,6 +1111,10 @@ int mnt_context_do_mount(struct libmnt_context *cxt)
 	}
 #endif
 
+	/* the paths below the mountpoint are different now */
+	if (mnt_context_get_status(cxt) && !mnt_context_is_fake(cxt))
+		mnt_cache_reset_components(cxt->cache);
+
 	/* Cleanup will be immediate on failure, and deferred to umount on success */
 	if (mnt_context_is_veritydev(cxt))
 		mnt_context_deferred_delete_veritydev(cxt);
@@ -1294,6 +1300,97 @@ again:
 	return rc;
 }
 
+/*
+ * Checks if @fs from fstab is usable for mount -a. Sets @ignored to 1 for
+ * not-matching and to 2 for already mounted filesystems. The mount options
+ * template is saved on the first call.
+ */
+static int check_mount_all_fs(struct libmnt_context *cxt,
+			      struct libmnt_fs *fs, int *ignored)
+{
+	const char *o, *tgt;
+	int rc, mounted = 0;
+
+	o = mnt_fs_get_user_options(fs);
+	tgt = mnt_fs_get_target(fs);
+
+	DBG(CXT, ul_debugobj(cxt, "next-mount: trying %s", tgt));
+
+	/*  ignore swap */
+	if (mnt_fs_is_swaparea(fs) ||
+
+	/* ignore root filesystem */
+	   (tgt && (strcmp(tgt, "/") == 0 || strcmp(tgt, "root") == 0)) ||
+
+	/* ignore noauto filesystems */
+	   (o && mnt_optstr_get_option(o, "noauto", NULL, NULL) == 0) ||
+
+	/* ignore filesystems which don't match options patterns */
+	   (cxt->fstype_pattern && !mnt_fs_match_fstype(fs,
+					cxt->fstype_pattern)) ||
+
+	/* ignore filesystems which don't match type patterns */
+	   (cxt->optstr_pattern && !mnt_fs_match_options(fs,
+					cxt->optstr_pattern))) {
+		*ignored = 1;
+		DBG(CXT, ul_debugobj(cxt, "next-mount: not-match "
+				"[fstype: %s, t-pattern: %s, options: %s, O-pattern: %s]",
+				mnt_fs_get_fstype(fs),
+				cxt->fstype_pattern,
+				mnt_fs_get_options(fs),
+				cxt->optstr_pattern));
+		return 0;
+	}
+
+	/* ignore already mounted filesystems */
+	rc = mnt_context_is_fs_mounted(cxt, fs, &mounted);
+	if (rc)
+		return rc;
+	if (mounted) {
+		*ignored = 2;
+		return 0;
+	}
+
+	/* Save mount options, etc. -- this is effective for the first
+	 * mnt_context_next_mount() call only. Make sure that cxt has not set
+	 * source, target or fstype.
+	 */
+	if (!mnt_context_has_template(cxt)) {
+		mnt_context_set_source(cxt, NULL);
+		mnt_context_set_target(cxt, NULL);
+		mnt_context_set_fstype(cxt, NULL);
+		mnt_context_save_template(cxt);
+	}
+	return 0;
+}
+
+/*
+ * Copies @fs from fstab to the context and mounts it.
+ */
+static int mount_all_fs(struct libmnt_context *cxt, struct libmnt_fs *fs)
+{
+	char *pattern;
+	int rc;
+
+	/* copy stuff from fstab to context */
+	rc = mnt_context_apply_fs(cxt, fs);
+	if (rc)
+		return rc;
+
+	/*
+	 * "-t <pattern>" is used to filter out fstab entries, but for ordinary
+	 * mount operation -t means "-t <type>". We have to zeroize the pattern
+	 * to avoid misinterpretation.
+	 */
+	pattern = cxt->fstype_pattern;
+	cxt->fstype_pattern = NULL;
+
+	rc = mnt_context_mount(cxt);
+
+	cxt->fstype_pattern = pattern;
+	return rc;
+}
+
 /**
  * mnt_context_next_mount:
  * @cxt: context
@@ -1332,11 +1429,12 @@ int mnt_context_next_mount(struct libmnt_context *cxt,
 			   int *ignored)
 {
 	struct libmnt_table *fstab, *mtab;
-	const char *o, *tgt;
-	int rc, mounted = 0;
+	int rc, dummy = 0;
 
 	if (ignored)
 		*ignored = 0;
+	else
+		ignored = &dummy;
 	if (mntrc)
 		*mntrc = 0;
 
@@ -1351,58 +1449,9 @@ int mnt_context_next_mount(struct libmnt_context *cxt,
 	if (rc != 0)
 		return rc;	/* more filesystems (or error) */
 
-	o = mnt_fs_get_user_options(*fs);
-	tgt = mnt_fs_get_target(*fs);
-
-	DBG(CXT, ul_debugobj(cxt, "next-mount: trying %s", tgt));
-
-	/*  ignore swap */
-	if (mnt_fs_is_swaparea(*fs) ||
-
-	/* ignore root filesystem */
-	   (tgt && (strcmp(tgt, "/") == 0 || strcmp(tgt, "root") == 0)) ||
-
-	/* ignore noauto filesystems */
-	   (o && mnt_optstr_get_option(o, "noauto", NULL, NULL) == 0) ||
-
-	/* ignore filesystems which don't match options patterns */
-	   (cxt->fstype_pattern && !mnt_fs_match_fstype(*fs,
-					cxt->fstype_pattern)) ||
-
-	/* ignore filesystems which don't match type patterns */
-	   (cxt->optstr_pattern && !mnt_fs_match_options(*fs,
-					cxt->optstr_pattern))) {
-		if (ignored)
-			*ignored = 1;
-		DBG(CXT, ul_debugobj(cxt, "next-mount: not-match "
-				"[fstype: %s, t-pattern: %s, options: %s, O-pattern: %s]",
-				mnt_fs_get_fstype(*fs),
-				cxt->fstype_pattern,
-				mnt_fs_get_options(*fs),
-				cxt->optstr_pattern));
-		return 0;
-	}
-
-	/* ignore already mounted filesystems */
-	rc = mnt_context_is_fs_mounted(cxt, *fs, &mounted);
-	if (rc)
+	rc = check_mount_all_fs(cxt, *fs, ignored);
+	if (rc || (ignored && *ignored))
 		return rc;
-	if (mounted) {
-		if (ignored)
-			*ignored = 2;
-		return 0;
-	}
-
-	/* Save mount options, etc. -- this is effective for the first
-	 * mnt_context_next_mount() call only. Make sure that cxt has not set
-	 * source, target or fstype.
-	 */
-	if (!mnt_context_has_template(cxt)) {
-		mnt_context_set_source(cxt, NULL);
-		mnt_context_set_target(cxt, NULL);
-		mnt_context_set_fstype(cxt, NULL);
-		mnt_context_save_template(cxt);
-	}
 
 	/* reset context, but protect mtab */
 	mtab = cxt->mtab;
@@ -1424,24 +1473,9 @@ int mnt_context_next_mount(struct libmnt_context *cxt,
 	 * child or non-forked
 	 */
 
-	/* copy stuff from fstab to context */
-	rc = mnt_context_apply_fs(cxt, *fs);
-	if (!rc) {
-		/*
-		 * "-t <pattern>" is used to filter out fstab entries, but for ordinary
-		 * mount operation -t means "-t <type>". We have to zeroize the pattern
-		 * to avoid misinterpretation.
-		 */
-		char *pattern = cxt->fstype_pattern;
-		cxt->fstype_pattern = NULL;
-
-		rc = mnt_context_mount(cxt);
-
-		cxt->fstype_pattern = pattern;
-
-		if (mntrc)
-			*mntrc = rc;
-	}
+	rc = mount_all_fs(cxt, *fs);
+	if (mntrc)
+		*mntrc = rc;
 
 	if (mnt_context_is_child(cxt)) {
 		DBG(CXT, ul_debugobj(cxt, "next-mount: child exit [rc=%d]", rc));
@@ -1452,6 +1486,156 @@ int mnt_context_next_mount(struct libmnt_context *cxt,
 }
 
 
+/*
+ * mount -a scheduler, see context_jobs.c
+ */
+
+/* returns 1 if @path is @dir or it's somewhere below @dir */
+static int is_path_below(const char *path, const char *dir)
+{
+	size_t sz;
+
+	if (!path || !dir || *path != '/' || *dir != '/')
+		return 0;
+
+	sz = strlen(dir);
+	while (sz > 1 && dir[sz - 1] == '/')
+		sz--;
+	if (sz == 1)
+		return 1;	/* "/" */
+
+	return strncmp(path, dir, sz) == 0 && (path[sz] == '\0' || path[sz] == '/');
+}
+
+/*
+ * Returns 1 if the later fstab entry @b has to wait for @a. The order of the
+ * overlapping mountpoints has to be the same as in fstab, and the source path
+ * (e.g. loop image or bind mount) may be on a filesystem mounted by @a.
+ */
+static int mountall_depends(struct libmnt_fs *a, struct libmnt_fs *b)
+{
+	const char *atgt = mnt_fs_get_target(a),
+		   *btgt = mnt_fs_get_target(b),
+		   *bsrc = mnt_fs_get_srcpath(b);
+
+	return is_path_below(btgt, atgt)
+	    || is_path_below(atgt, btgt)
+	    || is_path_below(bsrc, atgt);
+}
+
+struct mount_all {
+	struct libmnt_jobs js;
+	void (*done_cb)(struct libmnt_context *, struct libmnt_fs *,
+			int, int, unsigned long long);
+};
+
+static void mount_all_done(struct libmnt_context *cxt, struct libmnt_jobs *js,
+			   struct libmnt_job *job, int status,
+			   unsigned long long usec)
+{
+	struct mount_all *ma = container_of(js, struct mount_all, js);
+
+	if (ma->done_cb)
+		ma->done_cb(cxt, job->fs, status, 0, usec);
+}
+
+/**
+ * mnt_context_mount_all:
+ * @cxt: mount context
+ * @maxjobs: maximal number of concurrent mounts, 0 for unlimited
+ * @child_cb: function called in the child process after mount or NULL
+ * @done_cb: function called in the parent process for each entry or NULL
+ *
+ * Mounts all filesystems from fstab, like mnt_context_next_mount() but every
+ * filesystem is mounted in a separate child process and independent
+ * filesystems are mounted concurrently. An fstab entry waits for all previous
+ * entries with overlapping mountpoints (e.g. /mnt/a/b waits for /mnt/a) and
+ * for entries with mountpoint above the entry's source path (e.g. loop image
+ * on a mounted filesystem), so the result is the same as for the sequential
+ * mount.
+ *
+ * The @child_cb is called with the result of mnt_context_mount() in the child
+ * process; the returned value is used as the exit status of the child (e.g.
+ * the value from mnt_context_get_excode()). Without the callback the status
+ * is 0 on success and 1 on error.
+ *
+ * The @done_cb is called in the parent process with the exit status of the
+ * child (or negative errno if the child has not been started or has been
+ * killed) and with the time of the mount in microseconds. The not-matching
+ * and already mounted filesystems are reported by @done_cb too, in this case
+ * the @ignored argument is 1 or 2 (see mnt_context_next_mount()).
+ *
+ * The function is not usable if the context is already a child of
+ * mnt_fork_context().
+ *
+ * Returns: 0 on success, <0 in case of error (the errors of the mounts are
+ *          reported by the callbacks only).
+ *
+ * Since: 2.37
+ */
+int mnt_context_mount_all(struct libmnt_context *cxt, size_t maxjobs,
+		int (*child_cb)(struct libmnt_context *, struct libmnt_fs *, int),
+		void (*done_cb)(struct libmnt_context *, struct libmnt_fs *,
+				int status, int ignored, unsigned long long usec))
+{
+	struct libmnt_table *fstab;
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+	struct mount_all ma = {
+		.js = {
+			.maxjobs = maxjobs,
+			.op = mount_all_fs,
+			.child_cb = child_cb,
+			.done = mount_all_done
+		},
+		.done_cb = done_cb
+	};
+	size_t i, j;
+	int rc;
+
+	if (!cxt || mnt_context_is_child(cxt))
+		return -EINVAL;
+
+	rc = mnt_context_get_fstab(cxt, &fstab);
+	if (rc)
+		return rc;
+
+	/* collect entries to mount */
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(fstab, &itr, &fs) == 0) {
+		int ignored = 0;
+
+		rc = check_mount_all_fs(cxt, fs, &ignored);
+		if (rc)
+			goto done;
+		if (ignored) {
+			if (done_cb)
+				done_cb(cxt, fs, 0, ignored, 0);
+			continue;
+		}
+		if (!mnt_jobs_add(&ma.js, fs)) {
+			rc = -ENOMEM;
+			goto done;
+		}
+	}
+
+	/* dependencies, always from the previous to the next entries */
+	for (i = 0; i < ma.js.njobs; i++) {
+		for (j = i + 1; j < ma.js.njobs; j++) {
+			if (!mountall_depends(ma.js.jobs[i].fs, ma.js.jobs[j].fs))
+				continue;
+			rc = mnt_jobs_add_dependency(&ma.js, i, j);
+			if (rc)
+				goto done;
+		}
+	}
+
+	rc = mnt_context_run_jobs(cxt, &ma.js);
+done:
+	mnt_jobs_deinit(&ma.js);
+	return rc;
+}
+
 /**
  * mnt_context_next_remount:
  * @cxt: context
@@ -365,6 +365,12 @@ static int lookup_umount_fs(struct libmnt_context *cxt)
 		return -EINVAL;
 	}
 
+	/* already applied by mnt_context_umount_tree() */
+	if (mnt_context_tab_applied(cxt)) {
+		DBG(CXT, ul_debugobj(cxt, " already applied"));
+		return 0;
+	}
+
 	/* try get fs type by statfs() */
 	rc = lookup_umount_fs_by_statfs(cxt, tgt);
 	if (rc <= 0)
@@ -1030,6 +1036,8 @@ int mnt_context_do_umount(struct libmnt_context *cxt)
 		goto end;
 
 	if (mnt_context_get_status(cxt) && !mnt_context_is_fake(cxt)) {
+		mnt_cache_reset_components(cxt->cache);
+
 		/*
 		 * Umounted, do some post-umount operations
 		 *	- remove loopdev
@@ -1227,6 +1235,213 @@ int mnt_context_next_umount(struct libmnt_context *cxt,
 	return 0;
 }
 
+/*
+ * umount -R and umount -a scheduler, see context_jobs.c
+ */
+struct umount_tree {
+	struct libmnt_jobs js;
+	void (*done_cb)(struct libmnt_context *, struct libmnt_fs *,
+			int, size_t, size_t);
+};
+
+static int cmp_fs_ids(const void *a, const void *b)
+{
+	int x = mnt_fs_get_id(*(struct libmnt_fs * const *) a),
+	    y = mnt_fs_get_id(*(struct libmnt_fs * const *) b);
+
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/* returns index of the parent of byid[@i] or -1 */
+static ssize_t get_parent_fs(struct libmnt_fs **byid, size_t nfs, size_t i)
+{
+	struct libmnt_fs key, *pkey = &key, **res;
+
+	if (mnt_fs_get_parent_id(byid[i]) == mnt_fs_get_id(byid[i]))
+		return -1;
+
+	key.id = mnt_fs_get_parent_id(byid[i]);
+	res = bsearch(&pkey, byid, nfs, sizeof(struct libmnt_fs *), cmp_fs_ids);
+	return res ? res - byid : -1;
+}
+
+/* copies complete mountinfo entry to the context, so lookup_umount_fs() is
+ * unnecessary */
+static int umount_tree_fs(struct libmnt_context *cxt, struct libmnt_fs *fs)
+{
+	struct libmnt_fs *cfs = mnt_context_get_fs(cxt);
+
+	if (!cfs || !mnt_copy_fs(cfs, fs))
+		return -ENOMEM;
+	cxt->flags |= MNT_FL_TAB_APPLIED;
+
+	return mnt_context_umount(cxt);
+}
+
+static void umount_tree_done(struct libmnt_context *cxt, struct libmnt_jobs *js,
+			     struct libmnt_job *job, int status,
+			     unsigned long long usec __attribute__((__unused__)))
+{
+	struct umount_tree *ut = container_of(js, struct umount_tree, js);
+
+	if (ut->done_cb)
+		ut->done_cb(cxt, job->fs, status, js->ndone, js->njobs);
+}
+
+/**
+ * mnt_context_umount_tree:
+ * @cxt: umount context
+ * @target: mountpoint or NULL for all filesystems
+ * @maxjobs: maximal number of concurrent umounts, 0 for unlimited
+ * @child_cb: function called after umount or NULL
+ * @done_cb: function called in the parent process for each entry or NULL
+ *
+ * Unmounts @target and all filesystems mounted below (like umount -R), or all
+ * filesystems from mountinfo (like umount -a, see mnt_context_next_umount()
+ * for the filters) if @target is NULL.
+ *
+ * The mount tree is read only once and the filesystems are unmounted from the
+ * leaves to the root of the tree. The independent subtrees are unmounted
+ * concurrently by child processes; if @maxjobs is 1 then the filesystems are
+ * unmounted in the current process. For the recursive umount a filesystem is
+ * not unmounted if umount of any of its submounts failed.
+ *
+ * The @child_cb is called with the result of mnt_context_umount(), the
+ * returned value is the status of the umount (e.g. the value from
+ * mnt_context_get_excode()). Without the callback the status is 0 on success
+ * and 1 on error.
+ *
+ * The @done_cb is called in the parent process with the status of the umount
+ * (or negative errno if the child has been killed or the umount has been
+ * canceled) and with the number of already finished and all umounts.
+ *
+ * Returns: 0 on success, 1 if @target is not mounted, <0 in case of error
+ *          (the errors of the umounts are reported by the callbacks only).
+ *
+ * Since: 2.37
+ */
+int mnt_context_umount_tree(struct libmnt_context *cxt, const char *target,
+		size_t maxjobs,
+		int (*child_cb)(struct libmnt_context *, struct libmnt_fs *, int),
+		void (*done_cb)(struct libmnt_context *, struct libmnt_fs *,
+				int status, size_t ndone, size_t ntotal))
+{
+	struct libmnt_table *mtab = NULL;
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs, *root = NULL, **byid = NULL;
+	struct umount_tree ut = {
+		.js = {
+			.maxjobs = maxjobs,
+			.op = umount_tree_fs,
+			.child_cb = child_cb,
+			.done = umount_tree_done,
+			.nofork = maxjobs == 1,
+			.cancel_next = target != NULL
+		},
+		.done_cb = done_cb
+	};
+	size_t nfs = 0, *jobidx = NULL, i;
+	ssize_t x, rootidx = -1;
+	int rc;
+
+	if (!cxt || mnt_context_is_child(cxt))
+		return -EINVAL;
+
+	rc = mnt_context_get_mtab(cxt, &mtab);
+	if (rc)
+		return rc;
+
+	/* the table is used by jobs after mnt_reset_context() */
+	mnt_ref_table(mtab);
+
+	if (target) {
+		root = mnt_table_find_target(mtab, target, MNT_ITER_BACKWARD);
+		if (!root) {
+			rc = 1;
+			goto done;
+		}
+	}
+
+	nfs = mnt_table_get_nents(mtab);
+	byid = malloc(nfs * sizeof(struct libmnt_fs *));
+	jobidx = calloc(nfs, sizeof(size_t));	/* job index + 1 */
+	if (!byid || !jobidx) {
+		rc = -ENOMEM;
+		goto done;
+	}
+
+	i = 0;
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(mtab, &itr, &fs) == 0 && i < nfs) {
+		if (mnt_fs_get_id(fs) <= 0) {
+			DBG(CXT, ul_debugobj(cxt, "umount-tree: mount IDs unsupported"));
+			rc = -ENOTSUP;
+			goto done;
+		}
+		byid[i++] = fs;
+	}
+	nfs = i;
+	qsort(byid, nfs, sizeof(struct libmnt_fs *), cmp_fs_ids);
+
+	/* select filesystems, the last mounted (highest ID) is the first job */
+	for (i = nfs; i > 0; i--) {
+		size_t n = 0;
+
+		fs = byid[i - 1];
+		if (root) {
+			for (x = i - 1; x >= 0 && byid[x] != root && n++ < nfs; )
+				x = get_parent_fs(byid, nfs, x);
+			if (x < 0 || byid[x] != root)
+				continue;
+			if (fs == root)
+				rootidx = i - 1;
+
+		} else if (!mnt_fs_get_target(fs)
+			   || (cxt->fstype_pattern && !mnt_fs_match_fstype(fs,
+							cxt->fstype_pattern))
+			   || (cxt->optstr_pattern && !mnt_fs_match_options(fs,
+							cxt->optstr_pattern)))
+			continue;
+
+		if (!mnt_jobs_add(&ut.js, fs)) {
+			rc = -ENOMEM;
+			goto done;
+		}
+		jobidx[i - 1] = ut.js.njobs;
+	}
+
+	/* the nearest selected parent waits for the job */
+	for (i = 0; i < nfs; i++) {
+		size_t n = 0;
+
+		if (!jobidx[i] || (ssize_t) i == rootidx)
+			continue;
+
+		x = i;
+		do {
+			x = get_parent_fs(byid, nfs, x);
+		} while (x >= 0 && !jobidx[x] && n++ < nfs);
+
+		if (x >= 0 && jobidx[x]) {
+			rc = mnt_jobs_add_dependency(&ut.js,
+					jobidx[i] - 1, jobidx[x] - 1);
+			if (rc)
+				goto done;
+		}
+	}
+
+	rc = mnt_context_run_jobs(cxt, &ut.js);
+done:
+	mnt_jobs_deinit(&ut.js);
+	free(jobidx);
+	free(byid);
+
+	/* the mount table is out of date now */
+	mnt_reset_context(cxt);
+	mnt_unref_table(mtab);
+	return rc;
+}
+
 
 int mnt_context_get_umount_excode(
 			struct libmnt_context *cxt,
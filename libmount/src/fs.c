@@ -79,6 +79,7 @@ void mnt_reset_fs(struct libmnt_fs *fs)
 	ref = fs->refcount;
 
 	list_del(&fs->ents);
+	mnt_fs_reset_optvecs(fs);
 	free(fs->source);
 	free(fs->bindsrc);
 	free(fs->tagname);
@@ -194,10 +195,14 @@ struct libmnt_fs *mnt_copy_fs(struct libmnt_fs *dest,
 		dest->tab	 = NULL;
 	}
 
+	mnt_fs_reset_optvecs(dest);
+
 	dest->id         = src->id;
 	dest->parent     = src->parent;
 	dest->devno      = src->devno;
 	dest->tid        = src->tid;
+	dest->uniq_id    = src->uniq_id;
+	dest->stmnt_todo = src->stmnt_todo;
 
 	if (cpy_str_at_offset(dest, src, offsetof(struct libmnt_fs, source)))
 		goto err;
@@ -344,6 +349,8 @@ const char *mnt_fs_get_srcpath(struct libmnt_fs *fs)
 	if (!fs)
 		return NULL;
 
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_SOURCE);
+
 	/* fstab-like fs */
 	if (fs->tagname)
 		return NULL;	/* the source contains a "NAME=value" */
@@ -359,6 +366,7 @@ const char *mnt_fs_get_srcpath(struct libmnt_fs *fs)
  */
 const char *mnt_fs_get_source(struct libmnt_fs *fs)
 {
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_SOURCE);
 	return fs ? fs->source : NULL;
 }
 
@@ -388,6 +396,10 @@ int __mnt_fs_set_source_ptr(struct libmnt_fs *fs, char *source)
 	fs->source = source;
 	fs->tagname = t;
 	fs->tagval = v;
+	fs->stmnt_todo &= ~MNT_STATMOUNT_SOURCE;
+
+	if (fs->tab)
+		mnt_table_drop_index(fs->tab);
 	return 0;
 }
 
@@ -518,6 +530,8 @@ int mnt_fs_streq_target(struct libmnt_fs *fs, const char *path)
  */
 int mnt_fs_get_tag(struct libmnt_fs *fs, const char **name, const char **value)
 {
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_SOURCE);
+
 	if (fs == NULL || !fs->tagname)
 		return -EINVAL;
 	if (name)
@@ -535,6 +549,7 @@ int mnt_fs_get_tag(struct libmnt_fs *fs, const char **name, const char **value)
  */
 const char *mnt_fs_get_target(struct libmnt_fs *fs)
 {
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_TARGET);
 	return fs ? fs->target : NULL;
 }
 
@@ -549,6 +564,10 @@ const char *mnt_fs_get_target(struct libmnt_fs *fs)
  */
 int mnt_fs_set_target(struct libmnt_fs *fs, const char *tgt)
 {
+	if (fs && fs->tab)
+		mnt_table_drop_index(fs->tab);
+	if (fs)
+		fs->stmnt_todo &= ~MNT_STATMOUNT_TARGET;
 	return strdup_to_struct_member(fs, target, tgt);
 }
 
@@ -611,6 +630,7 @@ int mnt_fs_is_kernel(struct libmnt_fs *fs)
  */
 int mnt_fs_is_swaparea(struct libmnt_fs *fs)
 {
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_FSTYPE);
 	return mnt_fs_get_flags(fs) & MNT_FS_SWAP;
 }
 
@@ -622,6 +642,7 @@ int mnt_fs_is_swaparea(struct libmnt_fs *fs)
  */
 int mnt_fs_is_pseudofs(struct libmnt_fs *fs)
 {
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_FSTYPE);
 	return mnt_fs_get_flags(fs) & MNT_FS_PSEUDO;
 }
 
@@ -633,6 +654,7 @@ int mnt_fs_is_pseudofs(struct libmnt_fs *fs)
  */
 int mnt_fs_is_netfs(struct libmnt_fs *fs)
 {
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_FSTYPE);
 	return mnt_fs_get_flags(fs) & MNT_FS_NET;
 }
 
@@ -644,6 +666,7 @@ int mnt_fs_is_netfs(struct libmnt_fs *fs)
  */
 const char *mnt_fs_get_fstype(struct libmnt_fs *fs)
 {
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_FSTYPE);
 	return fs ? fs->fstype : NULL;
 }
 
@@ -656,6 +679,7 @@ int __mnt_fs_set_fstype_ptr(struct libmnt_fs *fs, char *fstype)
 		free(fs->fstype);
 
 	fs->fstype = fstype;
+	fs->stmnt_todo &= ~MNT_STATMOUNT_FSTYPE;
 	fs->flags &= ~MNT_FS_PSEUDO;
 	fs->flags &= ~MNT_FS_NET;
 	fs->flags &= ~MNT_FS_SWAP;
@@ -765,6 +789,8 @@ char *mnt_fs_strdup_options(struct libmnt_fs *fs)
 	if (!fs)
 		return NULL;
 
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_OPTIONS);
+
 	errno = 0;
 	if (fs->optstr)
 		return strdup(fs->optstr);
@@ -788,6 +814,7 @@ char *mnt_fs_strdup_options(struct libmnt_fs *fs)
  */
 const char *mnt_fs_get_options(struct libmnt_fs *fs)
 {
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_OPTIONS);
 	return fs ? fs->optstr : NULL;
 }
 
@@ -837,6 +864,8 @@ int mnt_fs_set_options(struct libmnt_fs *fs, const char *optstr)
 	free(fs->user_optstr);
 	free(fs->optstr);
 
+	mnt_fs_reset_optvecs(fs);
+	fs->stmnt_todo &= ~MNT_STATMOUNT_OPTIONS;
 	fs->fs_optstr = f;
 	fs->vfs_optstr = v;
 	fs->user_optstr = u;
@@ -867,10 +896,14 @@ int mnt_fs_append_options(struct libmnt_fs *fs, const char *optstr)
 	if (!optstr)
 		return 0;
 
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_OPTIONS);
+
 	rc = mnt_split_optstr(optstr, &u, &v, &f, 0, 0);
 	if (rc)
 		return rc;
 
+	mnt_fs_reset_optvecs(fs);
+
 	if (!rc && v)
 		rc = mnt_optstr_append_option(&fs->vfs_optstr, v, NULL);
 	if (!rc && f)
@@ -909,10 +942,14 @@ int mnt_fs_prepend_options(struct libmnt_fs *fs, const char *optstr)
 	if (!optstr)
 		return 0;
 
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_OPTIONS);
+
 	rc = mnt_split_optstr(optstr, &u, &v, &f, 0, 0);
 	if (rc)
 		return rc;
 
+	mnt_fs_reset_optvecs(fs);
+
 	if (!rc && v)
 		rc = mnt_optstr_prepend_option(&fs->vfs_optstr, v, NULL);
 	if (!rc && f)
@@ -937,6 +974,7 @@ int mnt_fs_prepend_options(struct libmnt_fs *fs, const char *optstr)
  */
 const char *mnt_fs_get_fs_options(struct libmnt_fs *fs)
 {
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_OPTIONS);
 	return fs ? fs->fs_optstr : NULL;
 }
 
@@ -962,6 +1000,115 @@ const char *mnt_fs_get_user_options(struct libmnt_fs *fs)
 	return fs ? fs->user_optstr : NULL;
 }
 
+/*
+ * Returns options string @id (MNT_FS_OPTVEC_*) parsed and resolved by the
+ * builtin maps, or NULL if the string is not set. The vector is cached in @fs
+ * and it's valid until the string is modified -- all code that modifies the
+ * options strings has to call mnt_fs_reset_optvecs().
+ */
+struct libmnt_optvec *mnt_fs_get_optvec(struct libmnt_fs *fs, int id)
+{
+	struct libmnt_optmap const *maps[2];
+	struct libmnt_optvec *vec;
+	const char *optstr;
+
+	if (!fs)
+		return NULL;
+
+	switch (id) {
+	case MNT_FS_OPTVEC_ALL:
+		optstr = mnt_fs_get_options(fs);
+		break;
+	case MNT_FS_OPTVEC_VFS:
+		optstr = mnt_fs_get_vfs_options(fs);
+		break;
+	case MNT_FS_OPTVEC_FS:
+		optstr = mnt_fs_get_fs_options(fs);
+		break;
+	case MNT_FS_OPTVEC_USER:
+		optstr = mnt_fs_get_user_options(fs);
+		break;
+	default:
+		return NULL;
+	}
+	if (!optstr)
+		return NULL;
+	if (fs->optvecs[id]) {
+		if (fs->optvecs[id]->optstr == optstr)
+			return fs->optvecs[id];
+		mnt_fs_reset_optvecs(fs);	/* paranoid, the string replaced */
+	}
+
+	vec = malloc(sizeof(*vec));
+	if (!vec)
+		return NULL;
+
+	maps[0] = mnt_get_builtin_optmap(MNT_LINUX_MAP);
+	maps[1] = mnt_get_builtin_optmap(MNT_USERSPACE_MAP);
+
+	/* parse error is not fatal, like for the strings */
+	if (mnt_optvec_parse(vec, optstr, maps, 2) == -ENOMEM) {
+		mnt_optvec_deinit(vec);
+		free(vec);
+		return NULL;
+	}
+
+	DBG(FS, ul_debugobj(fs, "parsed options [%d]: %zu", id, vec->nopts));
+	fs->optvecs[id] = vec;
+	return vec;
+}
+
+static void drop_optvec(struct libmnt_fs *fs, int id)
+{
+	if (!fs->optvecs[id])
+		return;
+	mnt_optvec_deinit(fs->optvecs[id]);
+	free(fs->optvecs[id]);
+	fs->optvecs[id] = NULL;
+}
+
+/* Drops the parsed options, must be called when an options string is modified. */
+void mnt_fs_reset_optvecs(struct libmnt_fs *fs)
+{
+	int i;
+
+	for (i = 0; i < MNT_FS_NOPTVECS; i++)
+		drop_optvec(fs, i);
+}
+
+/*
+ * Applies @flags to VFS (MNT_FS_OPTVEC_VFS) or userspace (MNT_FS_OPTVEC_USER)
+ * options string by the parsed options, see mnt_optstr_apply_flags(). The
+ * merged options string is not updated.
+ */
+int mnt_fs_apply_optflags(struct libmnt_fs *fs, int id, unsigned long flags,
+			  const struct libmnt_optmap *map)
+{
+	struct libmnt_optvec *vec;
+	char **optstr;
+	int rc;
+
+	switch (id) {
+	case MNT_FS_OPTVEC_VFS:
+		optstr = &fs->vfs_optstr;
+		break;
+	case MNT_FS_OPTVEC_USER:
+		optstr = &fs->user_optstr;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	vec = mnt_fs_get_optvec(fs, id);
+	if (vec)
+		rc = mnt_optvec_apply_flags(vec, optstr, flags, map);
+	else
+		rc = mnt_optstr_apply_flags(optstr, flags, map);
+
+	drop_optvec(fs, id);
+	return rc;
+}
+
 /**
  * mnt_fs_get_attributes:
  * @fs: fstab/mtab entry pointer
@@ -1090,6 +1237,7 @@ int mnt_fs_set_passno(struct libmnt_fs *fs, int passno)
  */
 const char *mnt_fs_get_root(struct libmnt_fs *fs)
 {
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_ROOT);
 	return fs ? fs->root : NULL;
 }
 
@@ -1102,6 +1250,8 @@ const char *mnt_fs_get_root(struct libmnt_fs *fs)
  */
 int mnt_fs_set_root(struct libmnt_fs *fs, const char *path)
 {
+	if (fs)
+		fs->stmnt_todo &= ~MNT_STATMOUNT_ROOT;
 	return strdup_to_struct_member(fs, root, path);
 }
 
@@ -1249,6 +1399,9 @@ int mnt_fs_get_option(struct libmnt_fs *fs, const char *name,
 
 	if (!fs)
 		return -EINVAL;
+
+	mnt_fs_fetch_lazy(fs, MNT_STATMOUNT_OPTIONS);
+
 	if (fs->fs_optstr)
 		rc = mnt_optstr_get_option(fs->fs_optstr, name, value, valsz);
 	if (rc == 1 && fs->vfs_optstr)
@@ -1352,7 +1505,7 @@ int mnt_fs_match_target(struct libmnt_fs *fs, const char *target,
 {
 	int rc = 0;
 
-	if (!fs || !target || !fs->target)
+	if (!fs || !target || !mnt_fs_get_target(fs))
 		return 0;
 
 	/* 1) native paths */
@@ -1403,7 +1556,7 @@ int mnt_fs_match_source(struct libmnt_fs *fs, const char *source,
 	if (mnt_fs_streq_srcpath(fs, source) == 1)
 		return 1;
 
-	if (!source || !fs->source)
+	if (!source || !mnt_fs_get_source(fs))
 		return 0;
 
 	/* ... and tags */
@@ -1412,7 +1565,7 @@ int mnt_fs_match_source(struct libmnt_fs *fs, const char *source,
 
 	if (!cache)
 		return 0;
-	if (fs->flags & (MNT_FS_NET | MNT_FS_PSEUDO))
+	if (mnt_fs_is_netfs(fs) || mnt_fs_is_pseudofs(fs))
 		return 0;
 
 	cn = mnt_resolve_spec(source, cache);
@@ -1469,7 +1622,7 @@ int mnt_fs_match_source(struct libmnt_fs *fs, const char *source,
  */
 int mnt_fs_match_fstype(struct libmnt_fs *fs, const char *types)
 {
-	return mnt_match_fstype(fs->fstype, types);
+	return mnt_match_fstype(mnt_fs_get_fstype(fs), types);
 }
 
 /**
@@ -1484,6 +1637,12 @@ int mnt_fs_match_fstype(struct libmnt_fs *fs, const char *types)
  */
 int mnt_fs_match_options(struct libmnt_fs *fs, const char *options)
 {
+	struct libmnt_optvec *vec = mnt_fs_get_optvec(fs, MNT_FS_OPTVEC_ALL);
+
+	/* the options are parsed only once for all patterns */
+	if (vec && options)
+		return mnt_optvec_match_options(vec, options);
+
 	return mnt_match_options(mnt_fs_get_options(fs), options);
 }
 
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/vfs.h>
 #include <unistd.h>
@@ -171,6 +172,18 @@ struct libmnt_iter {
 				(itr)->p->next : (itr)->p->prev; \
 	} while(0)
 
+/*
+ * Options strings in struct libmnt_fs with a cached parsed vector, see
+ * mnt_fs_get_optvec().
+ */
+enum {
+	MNT_FS_OPTVEC_ALL = 0,	/* optstr */
+	MNT_FS_OPTVEC_VFS,	/* vfs_optstr */
+	MNT_FS_OPTVEC_FS,	/* fs_optstr */
+	MNT_FS_OPTVEC_USER,	/* user_optstr */
+
+	MNT_FS_NOPTVECS
+};
 
 /*
  * This struct represents one entry in a mtab/fstab/mountinfo file.
@@ -203,6 +216,8 @@ struct libmnt_fs {
 	char		*user_optstr;	/* userspace mount options */
 	char		*attrs;		/* mount attributes */
 
+	struct libmnt_optvec *optvecs[MNT_FS_NOPTVECS];	/* parsed options strings */
+
 	int		freq;		/* fstab[5]: dump frequency in days */
 	int		passno;		/* fstab[6]: pass number on parallel fsck */
 
@@ -215,6 +230,9 @@ struct libmnt_fs {
 	int		flags;		/* MNT_FS_* flags */
 	pid_t		tid;		/* /proc/<tid>/mountinfo otherwise zero */
 
+	uint64_t	uniq_id;	/* statmount(): unique mount ID */
+	int		stmnt_todo;	/* MNT_STATMOUNT_* not fetched yet */
+
 	char		*comment;	/* fstab comment */
 
 	void		*userdata;	/* library independent data */
@@ -255,9 +273,25 @@ struct libmnt_table {
 
 	struct list_head	ents;	/* list of entries (libmnt_fs) */
 	void		*userdata;
+
+	struct libmnt_tabidx	*idx;	/* lookup index, see tab.c */
+
+	int		stmnt_lazy;	/* MNT_STATMOUNT_* fetched on demand */
+	int		listmount;	/* use listmount() for mtab */
 };
 
 extern struct libmnt_table *__mnt_new_table_from_file(const char *filename, int fmt, int empty_for_enoent);
+extern void mnt_table_drop_index(struct libmnt_table *tb);
+
+/* tab_listmount.c */
+extern int __mnt_table_parse_listmount(struct libmnt_table *tb);
+
+/* fetches the fields skipped by the listmount() parser */
+static inline void mnt_fs_fetch_lazy(struct libmnt_fs *fs, int mask)
+{
+	if (fs && (fs->stmnt_todo & mask))
+		mnt_fs_fetch_statmount(fs, fs->stmnt_todo & mask);
+}
 
 /*
  * Tab file format
@@ -401,6 +435,38 @@ extern const struct libmnt_optmap *mnt_optmap_get_entry(
 			     const struct libmnt_optmap **mapent);
 
 /* optstr.c */
+struct libmnt_optent {
+	char		*name;
+	size_t		namesz;
+	char		*value;		/* NULL if no value */
+	size_t		valsz;
+	const struct libmnt_optmap *map;	/* NULL if not found in the maps */
+	const struct libmnt_optmap *ent;
+};
+
+/*
+ * Parsed options string. The options are resolved against the maps only once,
+ * the vector is usable for more lookups as long as the string is not modified.
+ */
+struct libmnt_optvec {
+	const char		*optstr;	/* parsed string */
+	struct libmnt_optent	*opts;
+	size_t			nopts;
+	struct libmnt_optent	buf[32];	/* avoid malloc() for usual strings */
+	int			rc;		/* parse error */
+};
+
+extern int mnt_optvec_parse(struct libmnt_optvec *vec, const char *optstr,
+			    struct libmnt_optmap const **maps, int nmaps);
+extern void mnt_optvec_deinit(struct libmnt_optvec *vec);
+extern struct libmnt_optent *mnt_optvec_find(struct libmnt_optvec *vec,
+			    const char *name, size_t namesz);
+extern int mnt_optvec_get_flags(struct libmnt_optvec *vec, unsigned long *flags,
+			    const struct libmnt_optmap *map);
+extern int mnt_optvec_apply_flags(struct libmnt_optvec *vec, char **optstr,
+			    unsigned long flags, const struct libmnt_optmap *map);
+extern int mnt_optvec_match_options(struct libmnt_optvec *vec, const char *pattern);
+
 extern int mnt_optstr_remove_option_at(char **optstr, char *begin, char *end);
 extern int mnt_optstr_fix_gid(char **optstr, char *value, size_t valsz, char **next);
 extern int mnt_optstr_fix_uid(char **optstr, char *value, size_t valsz, char **next);
@@ -414,6 +480,13 @@ extern int __mnt_fs_set_source_ptr(struct libmnt_fs *fs, char *source)
 			__attribute__((nonnull(1)));
 extern int __mnt_fs_set_fstype_ptr(struct libmnt_fs *fs, char *fstype)
 			__attribute__((nonnull(1)));
+extern struct libmnt_optvec *mnt_fs_get_optvec(struct libmnt_fs *fs, int id);
+extern void mnt_fs_reset_optvecs(struct libmnt_fs *fs);
+extern int mnt_fs_apply_optflags(struct libmnt_fs *fs, int id, unsigned long flags,
+			  const struct libmnt_optmap *map);
+
+/* cache.c */
+extern void mnt_cache_reset_components(struct libmnt_cache *cache);
 
 /* context.c */
 extern struct libmnt_context *mnt_copy_context(struct libmnt_context *o);
@@ -471,6 +544,56 @@ extern int mnt_context_is_veritydev(struct libmnt_context *cxt)
 extern int mnt_context_setup_veritydev(struct libmnt_context *cxt);
 extern int mnt_context_deferred_delete_veritydev(struct libmnt_context *cxt);
 
+/* context_jobs.c -- mount -a and umount -R/-a scheduler */
+enum {
+	MNT_JOB_WAITING = 0,
+	MNT_JOB_RUNNING,
+	MNT_JOB_DONE
+};
+
+struct libmnt_job {
+	struct libmnt_fs	*fs;
+	pid_t			pid;
+	int			pidfd;		/* -1 if unsupported */
+	int			state;
+	struct timeval		start;
+
+	size_t			nwait;		/* number of unfinished dependencies */
+	size_t			*next;		/* jobs waiting for this job */
+	size_t			nnext;
+
+	unsigned int		canceled : 1;	/* a dependency failed */
+};
+
+struct libmnt_jobs {
+	struct libmnt_job	*jobs;
+	size_t			njobs;
+	size_t			ndone;
+	size_t			maxjobs;	/* 0 = unlimited */
+
+	/* called in child (or in the current process if nofork) */
+	int (*op)(struct libmnt_context *, struct libmnt_fs *);
+	int (*child_cb)(struct libmnt_context *, struct libmnt_fs *, int);
+
+	/* called in the current process when the job is done */
+	void (*done)(struct libmnt_context *, struct libmnt_jobs *,
+		     struct libmnt_job *, int status, unsigned long long usec);
+
+	size_t			*ready;		/* FIFO of the jobs without dependencies */
+	size_t			nready;
+	size_t			iready;
+	size_t			*running;
+	size_t			nrunning;
+
+	unsigned int		nofork : 1,	/* don't fork, one job at time */
+				cancel_next : 1; /* don't start jobs waiting for failed job */
+};
+
+extern struct libmnt_job *mnt_jobs_add(struct libmnt_jobs *js, struct libmnt_fs *fs);
+extern int mnt_jobs_add_dependency(struct libmnt_jobs *js, size_t job, size_t next);
+extern int mnt_context_run_jobs(struct libmnt_context *cxt, struct libmnt_jobs *js);
+extern void mnt_jobs_deinit(struct libmnt_jobs *js);
+
 /* tab_update.c */
 extern int mnt_update_set_filename(struct libmnt_update *upd,
 				   const char *filename, int userspace_only);
@@ -0,0 +1,608 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * This file is part of libmount from util-linux project.
+ *
+ * libmount is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ */
+
+/**
+ * SECTION: nscache
+ * @title: Namespaces cache
+ * @short_description: shared mount tables for processes in mount namespaces
+ *
+ * The tools which read mount tables of many processes (e.g. all processes on
+ * a system with many containers) usually parse the same /proc/#/mountinfo
+ * again and again, because the processes share a few mount namespaces. The
+ * cache keeps one parsed table for every mount namespace and the table is
+ * parsed again only if the kernel reports a change in the namespace.
+ *
+ * <informalexample>
+ *   <programlisting>
+ * struct libmnt_nscache *nc = mnt_new_nscache();
+ * struct libmnt_table *tb;
+ *
+ * for (each pid) {
+ *    if (mnt_nscache_get_table(nc, pid, &tb) == 0)
+ *       printf("%d: %d mounts\n", pid, mnt_table_get_nents(tb));
+ * }
+ * mnt_unref_nscache(nc);
+ *   </programlisting>
+ * </informalexample>
+ */
+
+/*
+ * The namespace is identified by stat() of /proc/#/ns/mnt and the mountinfo
+ * paths are relative to the process root, so the table is cached for the
+ * namespace and stat() of /proc/#/root (e.g. chroot-ed processes in the same
+ * namespace have different tables). Every cached
+ * namespace has open /proc/#/mountinfo of the first process seen in the
+ * namespace. The file descriptor keeps a reference to the namespace (so the
+ * inode number cannot be reused) and poll() on the file returns POLLPRI when
+ * the namespace has been modified -- it's the same thing as
+ * mnt_monitor_enable_kernel() does for the current namespace.
+ */
+#include <poll.h>
+
+#include "mountP.h"
+#include "fileutils.h"
+
+struct nscache_key {
+	dev_t			dev;		/* nsfs device */
+	ino_t			ino;		/* namespace inode */
+	dev_t			root_dev;	/* process root directory */
+	ino_t			root_ino;
+};
+
+struct nscache_entry {
+	struct nscache_key	key;
+	int			fd;		/* /proc/#/mountinfo */
+	pid_t			pid;		/* the first process in the namespace */
+	struct libmnt_table	*tb;
+};
+
+struct libmnt_nscache {
+	int			refcount;
+
+	struct nscache_entry	*ents;		/* sorted by key */
+	size_t			nents;
+
+	struct libmnt_table	*uncached;	/* the last table without namespace */
+	struct libmnt_cache	*cache;		/* paths cache for the tables */
+};
+
+/**
+ * mnt_new_nscache:
+ *
+ * The initial refcount is 1, and needs to be decremented to
+ * release the resources of the cache.
+ *
+ * Returns: newly allocated struct libmnt_nscache.
+ *
+ * Since: 2.37
+ */
+struct libmnt_nscache *mnt_new_nscache(void)
+{
+	struct libmnt_nscache *nc = calloc(1, sizeof(*nc));
+	if (!nc)
+		return NULL;
+
+	nc->refcount = 1;
+	DBG(TAB, ul_debugobj(nc, "nscache: alloc"));
+	return nc;
+}
+
+/**
+ * mnt_ref_nscache:
+ * @nc: namespaces cache
+ *
+ * Increments reference counter.
+ *
+ * Since: 2.37
+ */
+void mnt_ref_nscache(struct libmnt_nscache *nc)
+{
+	if (nc)
+		nc->refcount++;
+}
+
+/**
+ * mnt_unref_nscache:
+ * @nc: namespaces cache
+ *
+ * Decrements reference counter, on zero the @nc is automatically
+ * deallocated together with all the cached tables (see mnt_ref_table()
+ * if you want to keep a table).
+ *
+ * Since: 2.37
+ */
+void mnt_unref_nscache(struct libmnt_nscache *nc)
+{
+	size_t i;
+
+	if (!nc)
+		return;
+	nc->refcount--;
+	if (nc->refcount > 0)
+		return;
+
+	DBG(TAB, ul_debugobj(nc, "nscache: free [%zu namespaces]", nc->nents));
+
+	for (i = 0; i < nc->nents; i++) {
+		close(nc->ents[i].fd);
+		mnt_unref_table(nc->ents[i].tb);
+	}
+	free(nc->ents);
+	mnt_unref_table(nc->uncached);
+	mnt_unref_cache(nc->cache);
+	free(nc);
+}
+
+/**
+ * mnt_nscache_set_cache:
+ * @nc: namespaces cache
+ * @mpc: paths cache or NULL
+ *
+ * Sets the paths cache for the newly parsed tables, see mnt_table_set_cache().
+ * The tables already in @nc are not modified.
+ *
+ * Returns: 0 on success or negative number in case of error.
+ *
+ * Since: 2.37
+ */
+int mnt_nscache_set_cache(struct libmnt_nscache *nc, struct libmnt_cache *mpc)
+{
+	if (!nc)
+		return -EINVAL;
+
+	mnt_ref_cache(mpc);
+	mnt_unref_cache(nc->cache);
+	nc->cache = mpc;
+	return 0;
+}
+
+/**
+ * mnt_nscache_get_nnamespaces:
+ * @nc: namespaces cache
+ *
+ * Returns: number of the cached mount namespaces (a namespace is counted
+ * once for every process root directory).
+ *
+ * Since: 2.37
+ */
+size_t mnt_nscache_get_nnamespaces(struct libmnt_nscache *nc)
+{
+	return nc ? nc->nents : 0;
+}
+
+static int cmp_keys(const struct nscache_key *a, const struct nscache_key *b)
+{
+	if (a->dev != b->dev)
+		return a->dev < b->dev ? -1 : 1;
+	if (a->ino != b->ino)
+		return a->ino < b->ino ? -1 : 1;
+	if (a->root_dev != b->root_dev)
+		return a->root_dev < b->root_dev ? -1 : 1;
+	if (a->root_ino != b->root_ino)
+		return a->root_ino < b->root_ino ? -1 : 1;
+	return 0;
+}
+
+/* returns 0 if the namespace and root of @pid are available */
+static int get_key(pid_t pid, struct nscache_key *key)
+{
+	char path[sizeof("/proc//ns/mnt") + sizeof(stringify_value(INT_MAX))];
+	struct stat st;
+
+	snprintf(path, sizeof(path), "/proc/%d/ns/mnt", (int) pid);
+	if (stat(path, &st) != 0)
+		return -errno;
+	key->dev = st.st_dev;
+	key->ino = st.st_ino;
+
+	snprintf(path, sizeof(path), "/proc/%d/root", (int) pid);
+	if (stat(path, &st) != 0)
+		return -errno;
+	key->root_dev = st.st_dev;
+	key->root_ino = st.st_ino;
+	return 0;
+}
+
+/* returns index of the entry or index where the entry has to be inserted */
+static size_t find_entry(struct libmnt_nscache *nc, const struct nscache_key *key)
+{
+	size_t lo = 0, hi = nc->nents;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		int x = cmp_keys(&nc->ents[mid].key, key);
+
+		if (x == 0)
+			return mid;
+		if (x < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static struct nscache_entry *add_entry(struct libmnt_nscache *nc, size_t idx,
+				       const struct nscache_key *key)
+{
+	struct nscache_entry *e;
+
+	if ((nc->nents % 32) == 0) {
+		e = realloc(nc->ents, (nc->nents + 32) * sizeof(*e));
+		if (!e)
+			return NULL;
+		nc->ents = e;
+	}
+
+	e = &nc->ents[idx];
+	memmove(e + 1, e, (nc->nents - idx) * sizeof(*e));
+	nc->nents++;
+
+	memset(e, 0, sizeof(*e));
+	e->key = *key;
+	e->fd = -1;
+	return e;
+}
+
+static void remove_entry(struct libmnt_nscache *nc, size_t idx)
+{
+	struct nscache_entry *e = &nc->ents[idx];
+
+	if (e->fd >= 0)
+		close(e->fd);
+	mnt_unref_table(e->tb);
+
+	nc->nents--;
+	memmove(e, e + 1, (nc->nents - idx) * sizeof(*e));
+}
+
+/* returns 1 if the namespace has been modified since the last call */
+static int is_modified(struct nscache_entry *e)
+{
+	struct pollfd pfd = { .fd = e->fd, .events = POLLPRI };
+
+	if (poll(&pfd, 1, 0) < 0)
+		return 1;
+	return pfd.revents & (POLLPRI | POLLERR) ? 1 : 0;
+}
+
+static struct libmnt_table *read_table(struct libmnt_nscache *nc,
+				       int fd, pid_t pid)
+{
+	char filename[sizeof("/proc//mountinfo") + sizeof(stringify_value(INT_MAX))];
+	struct libmnt_table *tb;
+	FILE *f;
+	int rc = -ENOMEM, x;
+
+	snprintf(filename, sizeof(filename), "/proc/%d/mountinfo", (int) pid);
+
+	x = dup_fd_cloexec(fd, STDERR_FILENO + 1);
+	if (x < 0)
+		return NULL;
+	f = fdopen(x, "r" UL_CLOEXECSTR);
+	if (!f) {
+		close(x);
+		return NULL;
+	}
+	if (lseek(x, 0, SEEK_SET) != 0) {
+		fclose(f);
+		return NULL;
+	}
+
+	tb = mnt_new_table();
+	if (tb) {
+		tb->fmt = MNT_FMT_MOUNTINFO;
+		mnt_table_set_cache(tb, nc->cache);
+
+		rc = mnt_table_parse_stream(tb, f, filename);
+		if (rc) {
+			mnt_unref_table(tb);
+			tb = NULL;
+		}
+	}
+	fclose(f);
+	if (!tb)
+		errno = -rc;
+	return tb;
+}
+
+/**
+ * mnt_nscache_get_table:
+ * @nc: namespaces cache
+ * @pid: process ID or 0 for the current process
+ * @tb: returns the mount table
+ *
+ * Returns the mount table of the mount namespace of the @pid. The
+ * /proc/#/mountinfo is parsed only if the namespace is not in the cache yet
+ * or the namespace has been modified since the last call, so the processes
+ * in the same namespace share the table. The table entries describe the
+ * namespace rather than the process (e.g. mnt_fs_get_tid() returns PID of the
+ * first process seen in the namespace).
+ *
+ * The table is owned by @nc and it's deallocated when the namespace is
+ * modified. Use mnt_ref_table() to keep the table.
+ *
+ * If the namespace of the process is not accessible (the process is owned by
+ * another user) then the table is parsed on every call.
+ *
+ * Every cached namespace uses one file descriptor and the namespace is not
+ * deallocated by kernel until @nc is deallocated.
+ *
+ * Returns: 0 on success or negative number in case of error.
+ *
+ * Since: 2.37
+ */
+int mnt_nscache_get_table(struct libmnt_nscache *nc, pid_t pid,
+			  struct libmnt_table **tb)
+{
+	char filename[sizeof("/proc//mountinfo") + sizeof(stringify_value(INT_MAX))];
+	struct nscache_entry *e = NULL;
+	struct nscache_key key;
+	struct libmnt_table *x;
+	size_t idx;
+	int fd;
+
+	if (!nc || !tb || pid < 0)
+		return -EINVAL;
+	if (!pid)
+		pid = getpid();
+
+	*tb = NULL;
+	snprintf(filename, sizeof(filename), "/proc/%d/mountinfo", (int) pid);
+
+	if (get_key(pid, &key) == 0) {
+		idx = find_entry(nc, &key);
+		if (idx < nc->nents && cmp_keys(&nc->ents[idx].key, &key) == 0)
+			e = &nc->ents[idx];
+
+		if (e && !is_modified(e)) {
+			DBG(TAB, ul_debugobj(nc, "nscache: %d: use table of %d",
+						(int) pid, (int) e->pid));
+			*tb = e->tb;
+			return 0;
+		}
+		if (e) {
+			DBG(TAB, ul_debugobj(nc, "nscache: %d: namespace modified",
+						(int) e->pid));
+			x = read_table(nc, e->fd, e->pid);
+			if (!x) {
+				remove_entry(nc, idx);
+				return -errno;
+			}
+			mnt_unref_table(e->tb);
+			e->tb = *tb = x;
+			return 0;
+		}
+	} else {
+		DBG(TAB, ul_debugobj(nc, "nscache: %d: namespace not available",
+					(int) pid));
+		idx = (size_t) -1;
+	}
+
+	fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	/* new namespace; the file refers to the namespace and root of the
+	 * process when opened, so stat() again to be sure the process has not
+	 * been moved or chroot-ed */
+	if (idx != (size_t) -1) {
+		struct nscache_key key2;
+
+		if (get_key(pid, &key2) != 0 || cmp_keys(&key, &key2) != 0)
+			idx = (size_t) -1;
+	}
+
+	/* drain the initial event (if any) */
+	if (idx != (size_t) -1) {
+		struct pollfd pfd = { .fd = fd, .events = POLLPRI };
+		ignore_result( poll(&pfd, 1, 0) );
+	}
+
+	x = read_table(nc, fd, pid);
+	if (!x) {
+		int rc = -errno;
+		close(fd);
+		return rc;
+	}
+
+	if (idx != (size_t) -1)
+		e = add_entry(nc, idx, &key);
+	if (!e) {
+		/* not cached */
+		close(fd);
+		mnt_unref_table(nc->uncached);
+		nc->uncached = *tb = x;
+		return 0;
+	}
+
+	DBG(TAB, ul_debugobj(nc, "nscache: %d: new namespace [%zu cached]",
+				(int) pid, nc->nents));
+	e->fd = fd;
+	e->pid = pid;
+	e->tb = *tb = x;
+	return 0;
+}
+
+#ifdef TEST_PROGRAM
+#include <sched.h>
+#include <signal.h>
+#include <sys/mount.h>
+#include <sys/wait.h>
+
+/*
+ * Reads tables of all the PIDs twice. The first pass reports whether the
+ * table is shared with the first PID, the second pass whether the table has
+ * been reused.
+ */
+static int test_pids(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_nscache *nc = mnt_new_nscache();
+	struct libmnt_table **tabs = calloc(argc, sizeof(struct libmnt_table *));
+	int i, loop, rc = 0;
+
+	if (!nc || !tabs)
+		return -ENOMEM;
+
+	for (loop = 0; rc == 0 && loop < 2; loop++) {
+		for (i = 1; rc == 0 && i < argc; i++) {
+			struct libmnt_table *tb;
+			const char *res;
+
+			rc = mnt_nscache_get_table(nc, atoi(argv[i]), &tb);
+			if (rc) {
+				warnx("%s: failed [rc=%d]", argv[i], rc);
+				break;
+			}
+			if (loop == 0) {
+				res = i == 1 ? "parsed" :
+				      tb == tabs[1] ? "shared" : "other";
+				tabs[i] = tb;
+			} else
+				res = tb == tabs[i] ? "cached" : "parsed";
+
+			printf("%s: %s\n", argv[i], res);
+		}
+	}
+
+	if (rc == 0)
+		printf("namespaces: %zu\n", mnt_nscache_get_nnamespaces(nc));
+	free(tabs);
+	mnt_unref_nscache(nc);
+	return rc;
+}
+
+/*
+ * Modifies the current (private) namespace and checks that the table is
+ * updated.
+ */
+static int test_modify(struct libmnt_test *ts, int argc, char *argv[])
+{
+	char dir[] = "/tmp/libmount-nscache-XXXXXX";
+	struct libmnt_nscache *nc;
+	struct libmnt_table *a, *b, *c;
+	int rc;
+
+	if (!mkdtemp(dir))
+		return -errno;
+	if (unshare(CLONE_NEWNS) != 0
+	    || mount("none", "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) {
+		warn("cannot create mount namespace");
+		rmdir(dir);
+		return -errno;
+	}
+
+	nc = mnt_new_nscache();
+	if (!nc)
+		return -ENOMEM;
+
+	rc = mnt_nscache_get_table(nc, 0, &a);
+	if (!rc)
+		mnt_ref_table(a);
+	if (!rc)
+		rc = mnt_nscache_get_table(nc, 0, &b);
+	if (!rc) {
+		printf("unmodified: %s\n", a == b ? "cached" : "parsed");
+		rc = mount("nscache", dir, "tmpfs", 0, NULL);
+	}
+	if (!rc)
+		rc = mnt_nscache_get_table(nc, 0, &c);
+	if (!rc) {
+		printf("modified: %s\n", a == c ? "cached" : "parsed");
+		printf("new entries: %d\n",
+				mnt_table_get_nents(c) - mnt_table_get_nents(a));
+		printf("old table: %s\n",
+				mnt_table_find_target(a, dir, MNT_ITER_FORWARD) ?
+				"modified" : "unmodified");
+		umount(dir);
+	}
+
+	mnt_unref_table(a);
+	mnt_unref_nscache(nc);
+	rmdir(dir);
+	return rc;
+}
+
+/*
+ * Reads the table of the current process and of a child chroot-ed to a
+ * directory in the same namespace; the tables have to differ.
+ */
+static int test_chroot(struct libmnt_test *ts, int argc, char *argv[])
+{
+	char dir[] = "/tmp/libmount-nscache-XXXXXX";
+	struct libmnt_nscache *nc;
+	struct libmnt_table *a = NULL, *b = NULL;
+	int rc = 0, pipefd[2];
+	pid_t pid;
+	char c;
+
+	if (!mkdtemp(dir))
+		return -errno;
+	if (pipe(pipefd) != 0) {
+		rmdir(dir);
+		return -errno;
+	}
+
+	pid = fork();
+	switch (pid) {
+	case -1:
+		rc = -errno;
+		close(pipefd[0]);
+		close(pipefd[1]);
+		rmdir(dir);
+		return rc;
+	case 0:
+		close(pipefd[0]);
+		if (chroot(dir) != 0 || chdir("/") != 0)
+			_exit(EXIT_FAILURE);
+		ignore_result( write(pipefd[1], "x", 1) );
+		close(pipefd[1]);
+		pause();
+		_exit(EXIT_SUCCESS);
+	}
+
+	close(pipefd[1]);
+	if (read(pipefd[0], &c, 1) != 1) {
+		warnx("cannot chroot to %s", dir);
+		rc = -EINVAL;
+	}
+	close(pipefd[0]);
+
+	nc = mnt_new_nscache();
+	if (!nc)
+		rc = -ENOMEM;
+	if (!rc)
+		rc = mnt_nscache_get_table(nc, getpid(), &a);
+	if (!rc)
+		rc = mnt_nscache_get_table(nc, pid, &b);
+	if (!rc) {
+		printf("chroot: %s\n", a == b ? "shared" : "other");
+		printf("namespaces: %zu\n", mnt_nscache_get_nnamespaces(nc));
+	}
+
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	mnt_unref_nscache(nc);
+	rmdir(dir);
+	return rc;
+}
+
+int main(int argc, char *argv[])
+{
+	struct libmnt_test tss[] = {
+	{ "--pids",   test_pids,   "<pid> [...] read tables of the processes" },
+	{ "--modify", test_modify, "modify private namespace and read the table" },
+	{ "--chroot", test_chroot, "read tables of the process and a chroot-ed child" },
+	{ NULL }
+	};
+
+	return mnt_run_test(tss, argc, argv);
+}
+#endif /* TEST_PROGRAM */
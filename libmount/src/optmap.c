@@ -214,6 +214,148 @@ const struct libmnt_optmap *mnt_get_builtin_optmap(int id)
 	return NULL;
 }
 
+/*
+ * Hash index for the built-in maps. The maps depend on the MS_* macros
+ * available at compile time, so the index is built on the first lookup. The
+ * slot contains the index of the first map entry with the given name plus one;
+ * the prefix entries (e.g. "x-") are not hashed and are checked separately.
+ *
+ * The library may be used by more threads. The first thread builds the index
+ * and publishes it by atomic store, the other threads use the linear scan
+ * until the index is ready.
+ */
+#define MNT_OPTMAP_HASHSZ	128	/* power of two, > 2 * map size */
+
+enum {
+	OPTMAP_INDEX_NONE = 0,
+	OPTMAP_INDEX_BUILDING,
+	OPTMAP_INDEX_READY
+};
+
+struct optmap_index {
+	const struct libmnt_optmap *map;
+	uint16_t slots[MNT_OPTMAP_HASHSZ];
+	uint16_t prefixes[4];		/* the same, but prefix entries */
+	int state;			/* OPTMAP_INDEX_* */
+};
+
+static struct optmap_index builtin_indexes[] = {
+	{ .map = linux_flags_map },
+	{ .map = userspace_opts_map }
+};
+
+/* returns length of the name without "=" or "[=]" suffix */
+static size_t optmap_entry_namesz(const struct libmnt_optmap *ent)
+{
+	return strcspn(ent->name, "=[");
+}
+
+static uint32_t optmap_hash(const char *name, size_t namelen)
+{
+	uint32_t h = 2166136261U;	/* FNV-1a */
+	size_t i;
+
+	for (i = 0; i < namelen; i++) {
+		h ^= (unsigned char) name[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static void init_optmap_index(struct optmap_index *idx)
+{
+	const struct libmnt_optmap *ent;
+	size_t np = 0;
+
+	for (ent = idx->map; ent->name; ent++) {
+		size_t namesz = optmap_entry_namesz(ent);
+		uint32_t h;
+
+		if (ent->mask & MNT_PREFIX) {
+			assert(np < ARRAY_SIZE(idx->prefixes) - 1);
+			idx->prefixes[np++] = ent - idx->map + 1;
+			continue;
+		}
+
+		h = optmap_hash(ent->name, namesz);
+		for (;;) {
+			const struct libmnt_optmap *x;
+
+			h &= MNT_OPTMAP_HASHSZ - 1;
+			if (!idx->slots[h]) {
+				idx->slots[h] = ent - idx->map + 1;
+				break;
+			}
+			x = &idx->map[idx->slots[h] - 1];
+			if (optmap_entry_namesz(x) == namesz
+			    && strncmp(x->name, ent->name, namesz) == 0)
+				break;		/* duplicate, keep the first */
+			h++;
+		}
+	}
+}
+
+static struct optmap_index *get_optmap_index(const struct libmnt_optmap *map)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(builtin_indexes); i++) {
+		struct optmap_index *idx = &builtin_indexes[i];
+		int state = OPTMAP_INDEX_NONE;
+
+		if (idx->map != map)
+			continue;
+		if (__atomic_load_n(&idx->state, __ATOMIC_ACQUIRE) == OPTMAP_INDEX_READY)
+			return idx;
+
+		/* only one thread builds the index, nobody reads it before
+		 * the state is OPTMAP_INDEX_READY */
+		if (!__atomic_compare_exchange_n(&idx->state, &state,
+					OPTMAP_INDEX_BUILDING, 0,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return NULL;
+
+		init_optmap_index(idx);
+		__atomic_store_n(&idx->state, OPTMAP_INDEX_READY, __ATOMIC_RELEASE);
+		return idx;
+	}
+	return NULL;
+}
+
+static const struct libmnt_optmap *optmap_index_lookup(
+				const struct optmap_index *idx,
+				const char *name, size_t namelen)
+{
+	const struct libmnt_optmap *res = NULL;
+	uint32_t h = optmap_hash(name, namelen);
+	size_t i;
+
+	for (;; h++) {
+		const struct libmnt_optmap *ent;
+
+		h &= MNT_OPTMAP_HASHSZ - 1;
+		if (!idx->slots[h])
+			break;
+		ent = &idx->map[idx->slots[h] - 1];
+		if (optmap_entry_namesz(ent) == namelen
+		    && strncmp(ent->name, name, namelen) == 0) {
+			res = ent;
+			break;
+		}
+	}
+
+	/* the first matching entry in the map wins */
+	for (i = 0; idx->prefixes[i]; i++) {
+		const struct libmnt_optmap *ent = &idx->map[idx->prefixes[i] - 1];
+
+		if (res && res < ent)
+			break;
+		if (startswith(name, ent->name))
+			return ent;
+	}
+	return res;
+}
+
 /*
  * Looks up the @name in @maps and returns a map and in @mapent
  * returns the map entry
@@ -238,8 +380,22 @@ const struct libmnt_optmap *mnt_optmap_get_entry(
 	for (i = 0; i < nmaps; i++) {
 		const struct libmnt_optmap *map = maps[i];
 		const struct libmnt_optmap *ent;
+		struct optmap_index *idx;
 		const char *p;
 
+		/* the name may contain '=' or '[' in the unusual case, the
+		 * index does not support it */
+		idx = get_optmap_index(map);
+		if (idx && !memchr(name, '=', namelen) && !memchr(name, '[', namelen)) {
+			ent = optmap_index_lookup(idx, name, namelen);
+			if (ent) {
+				if (mapent)
+					*mapent = ent;
+				return map;
+			}
+			continue;
+		}
+
 		for (ent = map; ent && ent->name; ent++) {
 			if (ent->mask & MNT_PREFIX) {
 				if (startswith(name, ent->name)) {
@@ -261,4 +417,3 @@ const struct libmnt_optmap *mnt_optmap_get_entry(
 	}
 	return NULL;
 }
-
@@ -174,6 +174,96 @@ int mnt_optstr_next_option(char **optstr, char **name, size_t *namesz,
 	return mnt_optstr_parse_next(optstr, name, namesz, value, valuesz);
 }
 
+/*
+ * Parses @optstr to @vec and resolves the options by @maps (@nmaps may be
+ * zero). The vector points to @optstr, the string has to be valid (and
+ * unmodified) until mnt_optvec_deinit().
+ *
+ * Returns: 0 on success or <0 on error. The error is also kept in vec->rc, the
+ * options parsed before the error are usable.
+ */
+int mnt_optvec_parse(struct libmnt_optvec *vec, const char *optstr,
+		     struct libmnt_optmap const **maps, int nmaps)
+{
+	char *str = (char *) optstr;
+	size_t nalloc = ARRAY_SIZE(vec->buf);
+
+	assert(vec);
+
+	vec->optstr = optstr;
+	vec->opts = vec->buf;
+	vec->nopts = 0;
+	vec->rc = 0;
+
+	if (!optstr)
+		return vec->rc = -EINVAL;
+
+	do {
+		struct libmnt_optent *o;
+		int rc;
+
+		if (vec->nopts == nalloc) {
+			struct libmnt_optent *x;
+
+			if (vec->opts == vec->buf) {
+				x = malloc(nalloc * 2 * sizeof(*x));
+				if (x)
+					memcpy(x, vec->buf, sizeof(vec->buf));
+			} else
+				x = realloc(vec->opts, nalloc * 2 * sizeof(*x));
+			if (!x)
+				return vec->rc = -ENOMEM;
+			vec->opts = x;
+			nalloc *= 2;
+		}
+
+		o = &vec->opts[vec->nopts];
+		rc = mnt_optstr_parse_next(&str, &o->name, &o->namesz,
+					   &o->value, &o->valsz);
+		if (rc < 0)
+			return vec->rc = rc;
+		if (rc == 1)
+			break;		/* end of optstr */
+
+		o->map = o->ent = NULL;
+		if (nmaps)
+			o->map = mnt_optmap_get_entry(maps, nmaps,
+						o->name, o->namesz, &o->ent);
+
+		/* ignore name=<value> if options map expects <name> only */
+		if (o->valsz && o->ent && o->ent->id
+		    && mnt_optmap_entry_novalue(o->ent))
+			o->map = o->ent = NULL;
+
+		vec->nopts++;
+	} while (1);
+
+	return 0;
+}
+
+void mnt_optvec_deinit(struct libmnt_optvec *vec)
+{
+	if (vec->opts != vec->buf)
+		free(vec->opts);
+	vec->opts = NULL;
+	vec->nopts = 0;
+}
+
+/* returns the first option with the @name */
+struct libmnt_optent *mnt_optvec_find(struct libmnt_optvec *vec,
+				      const char *name, size_t namesz)
+{
+	size_t i;
+
+	for (i = 0; i < vec->nopts; i++) {
+		struct libmnt_optent *o = &vec->opts[i];
+
+		if (o->namesz == namesz && strncmp(o->name, name, namesz) == 0)
+			return o;
+	}
+	return NULL;
+}
+
 static int __mnt_optstr_append_option(char **optstr,
 			const char *name, size_t nsz,
 			const char *value, size_t vsz)
@@ -526,9 +616,10 @@ int mnt_optstr_remove_option(char **optstr, const char *name)
 int mnt_split_optstr(const char *optstr, char **user, char **vfs,
 		     char **fs, int ignore_user, int ignore_vfs)
 {
-	char *name, *val, *str = (char *) optstr;
-	size_t namesz, valsz;
 	struct libmnt_optmap const *maps[2];
+	struct libmnt_optvec vec;
+	size_t i;
+	int rc = 0;
 
 	if (!optstr)
 		return -EINVAL;
@@ -543,50 +634,48 @@ int mnt_split_optstr(const char *optstr, char **user, char **vfs,
 	if (user)
 		*user = NULL;
 
-	while (!mnt_optstr_next_option(&str, &name, &namesz, &val, &valsz)) {
-		int rc = 0;
-		const struct libmnt_optmap *ent = NULL;
-		const struct libmnt_optmap *m =
-			 mnt_optmap_get_entry(maps, 2, name, namesz, &ent);
+	/* parse error is not fatal, use options before the error */
+	if (mnt_optvec_parse(&vec, optstr, maps, 2) == -ENOMEM)
+		rc = -ENOMEM;
 
-		if (ent && !ent->id)
-			continue;	/* ignore undefined options (comments) */
+	for (i = 0; rc == 0 && i < vec.nopts; i++) {
+		struct libmnt_optent *o = &vec.opts[i];
 
-		/* ignore name=<value> if options map expects <name> only */
-		if (valsz && mnt_optmap_entry_novalue(ent))
-			m = NULL;
+		if (o->ent && !o->ent->id)
+			continue;	/* ignore undefined options (comments) */
 
-		if (ent && m && m == maps[0] && vfs) {
-			if (ignore_vfs && (ent->mask & ignore_vfs))
+		if (o->map == maps[0] && vfs) {
+			if (ignore_vfs && (o->ent->mask & ignore_vfs))
 				continue;
-			rc = __mnt_optstr_append_option(vfs, name, namesz,
-								val, valsz);
-		} else if (ent && m && m == maps[1] && user) {
-			if (ignore_user && (ent->mask & ignore_user))
+			rc = __mnt_optstr_append_option(vfs, o->name, o->namesz,
+							o->value, o->valsz);
+		} else if (o->map == maps[1] && user) {
+			if (ignore_user && (o->ent->mask & ignore_user))
 				continue;
-			rc = __mnt_optstr_append_option(user, name, namesz,
-								val, valsz);
-		} else if (!m && fs)
-			rc = __mnt_optstr_append_option(fs, name, namesz,
-								val, valsz);
-		if (rc) {
-			if (vfs) {
-				free(*vfs);
-				*vfs = NULL;
-			}
-			if (fs) {
-				free(*fs);
-				*fs = NULL;
-			}
-			if (user) {
-				free(*user);
-				*user = NULL;
-			}
-			return rc;
-		}
+			rc = __mnt_optstr_append_option(user, o->name, o->namesz,
+							o->value, o->valsz);
+		} else if (!o->map && fs)
+			rc = __mnt_optstr_append_option(fs, o->name, o->namesz,
+							o->value, o->valsz);
 	}
 
-	return 0;
+	mnt_optvec_deinit(&vec);
+
+	if (rc) {
+		if (vfs) {
+			free(*vfs);
+			*vfs = NULL;
+		}
+		if (fs) {
+			free(*fs);
+			*fs = NULL;
+		}
+		if (user) {
+			free(*user);
+			*user = NULL;
+		}
+	}
+	return rc;
 }
 
 /**
@@ -611,8 +700,9 @@ int mnt_optstr_get_options(const char *optstr, char **subset,
 			    const struct libmnt_optmap *map, int ignore)
 {
 	struct libmnt_optmap const *maps[1];
-	char *name, *val, *str = (char *) optstr;
-	size_t namesz, valsz;
+	struct libmnt_optvec vec;
+	size_t i;
+	int rc = 0;
 
 	if (!optstr || !subset)
 		return -EINVAL;
@@ -620,30 +710,29 @@ int mnt_optstr_get_options(const char *optstr, char **subset,
 	maps[0] = map;
 	*subset = NULL;
 
-	while(!mnt_optstr_next_option(&str, &name, &namesz, &val, &valsz)) {
-		int rc = 0;
-		const struct libmnt_optmap *ent;
+	if (mnt_optvec_parse(&vec, optstr, maps, 1) == -ENOMEM)
+		rc = -ENOMEM;
 
-		mnt_optmap_get_entry(maps, 1, name, namesz, &ent);
+	for (i = 0; rc == 0 && i < vec.nopts; i++) {
+		struct libmnt_optent *o = &vec.opts[i];
 
-		if (!ent || !ent->id)
+		if (!o->ent || !o->ent->id)
 			continue;	/* ignore undefined options (comments) */
 
-		if (ignore && (ent->mask & ignore))
+		if (ignore && (o->ent->mask & ignore))
 			continue;
 
-		/* ignore name=<value> if options map expects <name> only */
-		if (valsz && mnt_optmap_entry_novalue(ent))
-			continue;
-
-		rc = __mnt_optstr_append_option(subset, name, namesz, val, valsz);
-		if (rc) {
-			free(*subset);
-			return rc;
-		}
+		rc = __mnt_optstr_append_option(subset, o->name, o->namesz,
+						o->value, o->valsz);
 	}
 
-	return 0;
+	mnt_optvec_deinit(&vec);
+
+	if (rc) {
+		free(*subset);
+		*subset = NULL;
+	}
+	return rc;
 }
 
 
@@ -670,9 +759,8 @@ int mnt_optstr_get_flags(const char *optstr, unsigned long *flags,
 		const struct libmnt_optmap *map)
 {
 	struct libmnt_optmap const *maps[2];
-	char *name, *str = (char *) optstr;
-	size_t namesz = 0, valsz = 0;
-	int nmaps = 0;
+	struct libmnt_optvec vec;
+	int nmaps = 0, rc;
 
 	if (!optstr || !flags || !map)
 		return -EINVAL;
@@ -686,25 +774,42 @@ int mnt_optstr_get_flags(const char *optstr, unsigned long *flags,
 		 */
 		maps[nmaps++] = mnt_get_builtin_optmap(MNT_USERSPACE_MAP);
 
-	while(!mnt_optstr_next_option(&str, &name, &namesz, NULL, &valsz)) {
-		const struct libmnt_optmap *ent;
-		const struct libmnt_optmap *m;
+	rc = mnt_optvec_parse(&vec, optstr, maps, nmaps);
+	if (rc != -ENOMEM)
+		rc = mnt_optvec_get_flags(&vec, flags, map);
 
-		m = mnt_optmap_get_entry(maps, nmaps, name, namesz, &ent);
-		if (!m || !ent || !ent->id)
-			continue;
+	mnt_optvec_deinit(&vec);
+	return rc;
+}
 
-		/* ignore name=<value> if options map expects <name> only */
-		if (valsz && mnt_optmap_entry_novalue(ent))
+/*
+ * The same as mnt_optstr_get_flags(), but for already parsed options. The
+ * @vec has to be resolved by @map (and by MNT_USERSPACE_MAP for the "user"
+ * translation if @map is MNT_LINUX_MAP).
+ */
+int mnt_optvec_get_flags(struct libmnt_optvec *vec, unsigned long *flags,
+			 const struct libmnt_optmap *map)
+{
+	const struct libmnt_optmap *umap = NULL;
+	size_t i;
+
+	if (map == mnt_get_builtin_optmap(MNT_LINUX_MAP))
+		umap = mnt_get_builtin_optmap(MNT_USERSPACE_MAP);
+
+	for (i = 0; i < vec->nopts; i++) {
+		const struct libmnt_optent *o = &vec->opts[i];
+		const struct libmnt_optmap *ent = o->ent;
+
+		if (!o->map || !ent || !ent->id)
 			continue;
 
-		if (m == map) {				/* requested map */
+		if (o->map == map) {			/* requested map */
 			if (ent->mask & MNT_INVERT)
 				*flags &= ~ent->id;
 			else
 				*flags |= ent->id;
 
-		} else if (nmaps == 2 && m == maps[1] && valsz == 0) {
+		} else if (umap && o->map == umap && o->valsz == 0) {
 			/*
 			 * Special case -- translate "user" (but no user=) to
 			 * MS_ options
@@ -737,19 +842,50 @@ int mnt_optstr_apply_flags(char **optstr, unsigned long flags,
 				const struct libmnt_optmap *map)
 {
 	struct libmnt_optmap const *maps[1];
-	char *name, *next, *val;
-	size_t namesz = 0, valsz = 0;
-	unsigned long fl;
-	int rc = 0;
+	struct libmnt_optvec vec;
+	int rc;
 
 	if (!optstr || !map)
 		return -EINVAL;
 
+	maps[0] = map;
+
+	/* parse error is not fatal, the rest of the string is kept */
+	if (mnt_optvec_parse(&vec, *optstr, maps, 1) == -ENOMEM)
+		rc = -ENOMEM;
+	else
+		rc = mnt_optvec_apply_flags(&vec, optstr, flags, map);
+
+	mnt_optvec_deinit(&vec);
+	return rc;
+}
+
+/*
+ * The same as mnt_optstr_apply_flags(), but @vec is already parsed @optstr
+ * resolved by @map (other maps are ignored). The new string is composed from
+ * the options kept in @vec, so @vec is invalid after this call.
+ */
+int mnt_optvec_apply_flags(struct libmnt_optvec *vec, char **optstr,
+			   unsigned long flags, const struct libmnt_optmap *map)
+{
+	const char *tail = *optstr;
+	char *res = NULL, *p;
+	unsigned long fl = flags;
+	size_t i = 0;
+	int rc = 0;
+
 	DBG(CXT, ul_debug("applying 0x%08lu flags to '%s'", flags, *optstr));
 
-	maps[0] = map;
-	next = *optstr;
-	fl = flags;
+	if (*optstr || map == mnt_get_builtin_optmap(MNT_LINUX_MAP)) {
+		/* the result is never longer than "ro," + @optstr */
+		res = malloc((*optstr ? strlen(*optstr) : 0) + 4);
+		if (!res) {
+			rc = -ENOMEM;
+			goto err;
+		}
+		*res = '\0';
+	}
+	p = res;
 
 	/*
 	 * There is a convention that 'rw/ro' flags are always at the beginning of
@@ -757,69 +893,75 @@ int mnt_optstr_apply_flags(char **optstr, unsigned long flags,
 	 */
 	if (map == mnt_get_builtin_optmap(MNT_LINUX_MAP)) {
 		const char *o = (fl & MS_RDONLY) ? "ro" : "rw";
+		const char *next = *optstr;
 
+		/* already set, be paranoid and fix it */
 		if (next &&
 		    (!strncmp(next, "rw", 2) || !strncmp(next, "ro", 2)) &&
-		    (*(next + 2) == '\0' || *(next + 2) == ',')) {
-
-			/* already set, be paranoid and fix it */
-			memcpy(next, o, 2);
-		} else {
-			rc = mnt_optstr_prepend_option(optstr, o, NULL);
-			if (rc)
-				goto err;
-			next = *optstr;		/* because realloc() */
-		}
+		    (*(next + 2) == '\0' || *(next + 2) == ','))
+			i = 1;
+
+		memcpy(p, o, 3);
+		p += 2;
 		fl &= ~MS_RDONLY;
-		next += 2;
-		if (*next == ',')
-			next++;
 	}
 
-	if (next && *next) {
-		/*
-		 * scan @optstr and remove options that are missing in
-		 * @flags
-		 */
-		while(!mnt_optstr_next_option(&next, &name, &namesz,
-							&val, &valsz)) {
-			const struct libmnt_optmap *ent;
-
-			if (mnt_optmap_get_entry(maps, 1, name, namesz, &ent)) {
-				/*
-				 * remove unwanted option (rw/ro is already set)
-				 */
-				if (!ent || !ent->id)
-					continue;
-				/* ignore name=<value> if options map expects <name> only */
-				if (valsz && mnt_optmap_entry_novalue(ent))
-					continue;
-
-				if (ent->id == MS_RDONLY ||
-				    (ent->mask & MNT_INVERT) ||
-				    (fl & ent->id) != (unsigned long) ent->id) {
-
-					char *end = val ? val + valsz :
-							  name + namesz;
-					next = name;
-					rc = mnt_optstr_remove_option_at(
-							optstr, name, end);
-					if (rc)
-						goto err;
-				}
-				if (!(ent->mask & MNT_INVERT)) {
-					fl &= ~ent->id;
-					if (ent->id & MS_REC)
-						fl |= MS_REC;
-				}
+	/*
+	 * copy @optstr without options that are missing in @flags
+	 */
+	for (; i < vec->nopts; i++) {
+		const struct libmnt_optent *o = &vec->opts[i];
+		const struct libmnt_optmap *ent = o->ent;
+		size_t sz = o->value ? (size_t) (o->value + o->valsz - o->name)
+				     : o->namesz;
+		int keep = 1;
+
+		if (o->map == map && ent && ent->id) {
+			/*
+			 * remove unwanted option (rw/ro is already set)
+			 */
+			if (ent->id == MS_RDONLY ||
+			    (ent->mask & MNT_INVERT) ||
+			    (fl & ent->id) != (unsigned long) ent->id)
+				keep = 0;
+
+			if (!(ent->mask & MNT_INVERT)) {
+				fl &= ~ent->id;
+				if (ent->id & MS_REC)
+					fl |= MS_REC;
 			}
 		}
+		if (keep) {
+			if (p > res)
+				*p++ = ',';
+			memcpy(p, o->name, sz);
+			p += sz;
+			*p = '\0';
+		}
+	}
+
+	/* keep the rest of the string after parse error */
+	if (vec->nopts) {
+		const struct libmnt_optent *o = &vec->opts[vec->nopts - 1];
+
+		tail = o->value ? o->value + o->valsz : o->name + o->namesz;
+	}
+	if (tail) {
+		while (*tail == ',')
+			tail++;
+		if (*tail) {
+			if (p > res)
+				*p++ = ',';
+			strcpy(p, tail);
+		}
 	}
 
+	free(*optstr);
+	*optstr = res;
+
 	/* add missing options (but ignore fl if contains MS_REC only) */
 	if (fl && fl != MS_REC) {
 		const struct libmnt_optmap *ent;
-		char *p;
 
 		for (ent = map; ent && ent->name; ent++) {
 			if ((ent->mask & MNT_INVERT)
@@ -1122,26 +1264,41 @@ int mnt_optstr_fix_user(char **optstr)
  */
 int mnt_match_options(const char *optstr, const char *pattern)
 {
-	char *name, *pat = (char *) pattern;
-	char *buf, *patval;
-	size_t namesz = 0, patvalsz = 0;
-	int match = 1;
+	struct libmnt_optvec vec;
+	int match;
 
 	if (!pattern && !optstr)
 		return 1;
 	if (!pattern)
 		return 0;
 
-	buf = malloc(strlen(pattern) + 1);
-	if (!buf)
+	/* parse @optstr only once for all the pattern items */
+	mnt_optvec_parse(&vec, optstr, NULL, 0);
+	match = mnt_optvec_match_options(&vec, pattern);
+	mnt_optvec_deinit(&vec);
+
+	return match;
+}
+
+/*
+ * The same as mnt_match_options(), but for already parsed options (e.g. the
+ * vector cached in struct libmnt_fs).
+ */
+int mnt_optvec_match_options(struct libmnt_optvec *vec, const char *pattern)
+{
+	char *name, *pat = (char *) pattern;
+	char *patval;
+	size_t namesz = 0, patvalsz = 0;
+	int match = 1;
+
+	if (!pattern)
 		return 0;
 
 	/* walk on pattern string
 	 */
 	while (match && !mnt_optstr_next_option(&pat, &name, &namesz,
 						&patval, &patvalsz)) {
-		char *val;
-		size_t sz;
+		struct libmnt_optent *o;
 		int no = 0, rc;
 
 		if (*name == '+')
@@ -1149,13 +1306,12 @@ int mnt_match_options(const char *optstr, const char *pattern)
 		else if ((no = (startswith(name, "no") != NULL)))
 			name += 2, namesz -= 2;
 
-		xstrncpy(buf, name, namesz + 1);
-
-		rc = mnt_optstr_get_option(optstr, buf, &val, &sz);
+		o = mnt_optvec_find(vec, name, namesz);
+		rc = o ? 0 : vec->rc ? vec->rc : 1;
 
 		/* check also value (if the pattern is "foo=value") */
 		if (rc == 0 && patvalsz > 0 &&
-		    (patvalsz != sz || strncmp(patval, val, sz) != 0))
+		    (patvalsz != o->valsz || strncmp(patval, o->value, o->valsz) != 0))
 			rc = 1;
 
 		switch (rc) {
@@ -1172,7 +1328,6 @@ int mnt_match_options(const char *optstr, const char *pattern)
 
 	}
 
-	free(buf);
 	return match;
 }
 
@@ -1421,6 +1576,74 @@ static int test_fix(struct libmnt_test *ts, int argc, char *argv[])
 
 }
 
+static void print_optvec(struct libmnt_fs *fs, int id, const char *what,
+			 struct libmnt_optvec *old)
+{
+	struct libmnt_optvec *vec = fs->optvecs[id];
+
+	printf("%-8s %s", what, !vec ? "not parsed" :
+				vec == old ? "reused" : "parsed");
+	if (vec)
+		printf(" (%zu options)", vec->nopts);
+	printf("\n");
+}
+
+/*
+ * The parsed options cached in struct libmnt_fs are shared by the flags and
+ * match functions and dropped when the options are modified.
+ */
+static int test_optvec(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_optvec *vec;
+	struct libmnt_fs *fs;
+	unsigned long fl = 0;
+	int rc;
+
+	if (argc < 4)
+		return -EINVAL;
+
+	fs = mnt_new_fs();
+	if (!fs)
+		return -ENOMEM;
+	rc = mnt_fs_set_options(fs, argv[1]);
+	if (rc)
+		goto done;
+
+	vec = mnt_fs_get_optvec(fs, MNT_FS_OPTVEC_ALL);
+	print_optvec(fs, MNT_FS_OPTVEC_ALL, "flags:", NULL);
+	mnt_optvec_get_flags(vec, &fl, mnt_get_builtin_optmap(MNT_LINUX_MAP));
+	printf("mountflags: 0x%08lx\n", fl);
+
+	printf("match '%s': %s\n", argv[2],
+			mnt_fs_match_options(fs, argv[2]) ? "yes" : "no");
+	print_optvec(fs, MNT_FS_OPTVEC_ALL, "match:", vec);
+
+	rc = mnt_fs_append_options(fs, argv[3]);
+	if (rc)
+		goto done;
+	print_optvec(fs, MNT_FS_OPTVEC_ALL, "append:", vec);
+
+	/* parsed again, don't compare with the old (freed) vector */
+	printf("match '%s': %s\n", argv[2],
+			mnt_fs_match_options(fs, argv[2]) ? "yes" : "no");
+	print_optvec(fs, MNT_FS_OPTVEC_ALL, "match:", NULL);
+
+	vec = mnt_fs_get_optvec(fs, MNT_FS_OPTVEC_VFS);
+	print_optvec(fs, MNT_FS_OPTVEC_VFS, "vfs:", NULL);
+	rc = mnt_fs_apply_optflags(fs, MNT_FS_OPTVEC_VFS, MS_RDONLY | MS_NOEXEC,
+				   mnt_get_builtin_optmap(MNT_LINUX_MAP));
+	if (rc)
+		goto done;
+	print_optvec(fs, MNT_FS_OPTVEC_VFS, "apply:", vec);
+	printf("vfs: %s\n", mnt_fs_get_vfs_options(fs));
+
+	rc = mnt_fs_set_options(fs, "rw");
+	print_optvec(fs, MNT_FS_OPTVEC_ALL, "set:", NULL);
+done:
+	mnt_unref_fs(fs);
+	return rc;
+}
+
 int main(int argc, char *argv[])
 {
 	struct libmnt_test tss[] = {
@@ -1434,6 +1657,7 @@ int main(int argc, char *argv[])
 		{ "--flags",  test_flags,  "<optstr>                   convert options to MS_* flags" },
 		{ "--apply",  test_apply,  "--{linux,user} <optstr> <mask>    apply mask to optstr" },
 		{ "--fix",    test_fix,    "<optstr>                   fix uid=, gid=, user, and context=" },
+		{ "--optvec", test_optvec, "<optstr> <pattern> <append>  reuse parsed options in fs" },
 
 		{ NULL }
 	};
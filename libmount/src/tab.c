@@ -167,6 +167,7 @@ void mnt_free_table(struct libmnt_table *tb)
 		return;
 
 	mnt_reset_table(tb);
+	mnt_table_drop_index(tb);
 	DBG(TAB, ul_debugobj(tb, "free [refcount=%d]", tb->refcount));
 
 	mnt_unref_cache(tb->cache);
@@ -452,6 +453,7 @@ int mnt_table_add_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 	list_add_tail(&fs->ents, &tb->ents);
 	fs->tab = tb;
 	tb->nents++;
+	mnt_table_drop_index(tb);
 
 	DBG(TAB, ul_debugobj(tb, "add entry: %s %s",
 			mnt_fs_get_source(fs), mnt_fs_get_target(fs)));
@@ -471,6 +473,7 @@ static int __table_insert_fs(
 
 	fs->tab = tb;
 	tb->nents++;
+	mnt_table_drop_index(tb);
 
 	DBG(TAB, ul_debugobj(tb, "insert entry: %s %s",
 			mnt_fs_get_source(fs), mnt_fs_get_target(fs)));
@@ -542,6 +545,7 @@ int mnt_table_move_fs(struct libmnt_table *src, struct libmnt_table *dst,
 	/* remove from source */
 	list_del_init(&fs->ents);
 	src->nents--;
+	mnt_table_drop_index(src);
 
 	/* insert to the destination */
 	return __table_insert_fs(dst, before, pos, fs);
@@ -569,6 +573,7 @@ int mnt_table_remove_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 
 	mnt_unref_fs(fs);
 	tb->nents--;
+	mnt_table_drop_index(tb);
 	return 0;
 }
 
@@ -1044,15 +1049,16 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	 */
 	mnt_reset_iter(&itr, direction);
 	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		const char *tgt = mnt_fs_get_target(fs);
 		char *p;
 
-		if (!fs->target
+		if (!tgt
 		    || mnt_fs_is_swaparea(fs)
 		    || mnt_fs_is_kernel(fs)
-		    || (*fs->target == '/' && *(fs->target + 1) == '\0'))
+		    || (*tgt == '/' && *(tgt + 1) == '\0'))
 		       continue;
 
-		p = mnt_resolve_target(fs->target, tb->cache);
+		p = mnt_resolve_target(tgt, tb->cache);
 		/* both canonicalized, strcmp() is fine here */
 		if (p && strcmp(cn, p) == 0)
 			return fs;
@@ -1102,7 +1108,9 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 
 		if (mnt_fs_streq_srcpath(fs, path)) {
 #ifdef HAVE_BTRFS_SUPPORT
-			if (fs->fstype && !strcmp(fs->fstype, "btrfs")) {
+			const char *type = mnt_fs_get_fstype(fs);
+
+			if (type && !strcmp(type, "btrfs")) {
 				uint64_t default_id = btrfs_get_default_subvol_id(mnt_fs_get_target(fs));
 				char *val;
 				size_t len;
@@ -1228,9 +1236,11 @@ struct libmnt_fs *mnt_table_find_tag(struct libmnt_table *tb, const char *tag,
 	/* look up by TAG */
 	mnt_reset_iter(&itr, direction);
 	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
-		if (fs->tagname && fs->tagval &&
-		    strcmp(fs->tagname, tag) == 0 &&
-		    strcmp(fs->tagval, val) == 0)
+		const char *t = NULL, *v = NULL;
+
+		if (mnt_fs_get_tag(fs, &t, &v) == 0 &&
+		    strcmp(t, tag) == 0 &&
+		    strcmp(v, val) == 0)
 			return fs;
 	}
 
@@ -1408,7 +1418,180 @@ static char *remove_mountpoint_from_path(const char *path, const char *mnt)
 	return res;
 }
 
+/*
+ * Lookup index for mnt_table_is_fs_mounted() and btrfs fs-root lookups.
+ *
+ * The entries are hashed by source path, target and devno, the hash chains
+ * keep the table order. The paths are hashed without redundant slashes to be
+ * compatible with streq_paths(). The index is built on demand and dropped
+ * when the table or an entry source or target is modified.
+ */
+struct tabidx_root {
+	char	*key;		/* target and options of the entry */
+	char	*root;
+	int	rc;
+	size_t	next;		/* hash chain, position + 1 */
+};
+
+struct libmnt_tabidx {
+	struct libmnt_fs **ents;	/* entries in the table order */
+	size_t		nents;
+	size_t		mask;		/* hash size - 1 */
+
+	size_t		*mem;
+	size_t		*src_head, *src_next;	/* entry position + 1 */
+	size_t		*tgt_head, *tgt_next;
+	size_t		*dev_head, *dev_next;
+	size_t		*loops;		/* entries with /dev/loop sources */
+	size_t		nloops;
+
+	struct tabidx_root *roots;	/* btrfs fs-root cache */
+	size_t		nroots;
+	size_t		*roots_head;	/* hashed by key */
+};
+
+static uint32_t path_hash(const char *p)
+{
+	uint32_t h = 2166136261U;	/* FNV-1a */
+
+	for (; *p; p++) {
+		if (*p == '/' && (*(p + 1) == '/' || *(p + 1) == '\0'))
+			continue;	/* redundant or trailing slash */
+		h ^= (unsigned char) *p;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static inline uint32_t devno_hash(dev_t devno)
+{
+	uint64_t x = (uint64_t) devno * 0x9E3779B97F4A7C15ULL;
+	return x >> 32;
+}
+
+static inline void tabidx_add(size_t *head, size_t *next, uint32_t h, size_t pos)
+{
+	next[pos - 1] = head[h];
+	head[h] = pos;
+}
+
+void mnt_table_drop_index(struct libmnt_table *tb)
+{
+	struct libmnt_tabidx *idx = tb->idx;
+	size_t i;
+
+	if (!idx)
+		return;
+
+	for (i = 0; i < idx->nroots; i++) {
+		free(idx->roots[i].key);
+		free(idx->roots[i].root);
+	}
+	free(idx->roots);
+	free(idx->roots_head);
+	free(idx->ents);
+	free(idx->mem);
+	free(idx);
+	tb->idx = NULL;
+}
+
+static struct libmnt_tabidx *get_table_index(struct libmnt_table *tb)
+{
+	struct libmnt_tabidx *idx;
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+	size_t i, hashsz, n = tb->nents;
+
+	if (tb->idx)
+		return tb->idx;
+
+	for (hashsz = 64; hashsz < 2 * n; hashsz <<= 1);
+
+	idx = calloc(1, sizeof(*idx));
+	if (!idx)
+		return NULL;
+	idx->ents = malloc((n + 1) * sizeof(struct libmnt_fs *));
+	idx->mem = calloc(3 * hashsz + 4 * n + 1, sizeof(size_t));
+	if (!idx->ents || !idx->mem) {
+		free(idx->ents);
+		free(idx->mem);
+		free(idx);
+		return NULL;
+	}
+	idx->mask = hashsz - 1;
+	idx->src_head = idx->mem;
+	idx->tgt_head = idx->src_head + hashsz;
+	idx->dev_head = idx->tgt_head + hashsz;
+	idx->src_next = idx->dev_head + hashsz;
+	idx->tgt_next = idx->src_next + n;
+	idx->dev_next = idx->tgt_next + n;
+	idx->loops = idx->dev_next + n;
+
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (idx->nents < n && mnt_table_next_fs(tb, &itr, &fs) == 0)
+		idx->ents[idx->nents++] = fs;
+
+	/* backward, the chains are in the table order */
+	for (i = idx->nents; i > 0; i--) {
+		const char *src, *tgt;
+
+		fs = idx->ents[i - 1];
+		src = mnt_fs_get_srcpath(fs);
+		tgt = mnt_fs_get_target(fs);
+
+		if (src)
+			tabidx_add(idx->src_head, idx->src_next,
+					path_hash(src) & idx->mask, i);
+		if (tgt)
+			tabidx_add(idx->tgt_head, idx->tgt_next,
+					path_hash(tgt) & idx->mask, i);
+		if (mnt_fs_get_devno(fs))
+			tabidx_add(idx->dev_head, idx->dev_next,
+					devno_hash(mnt_fs_get_devno(fs)) & idx->mask, i);
+	}
+	for (i = 0; i < idx->nents; i++) {
+		const char *src = mnt_fs_get_srcpath(idx->ents[i]);
+
+		if (src && startswith(src, "/dev/loop"))
+			idx->loops[idx->nloops++] = i + 1;
+	}
+
+	DBG(TAB, ul_debugobj(tb, "index: %zu entries, %zu loopdevs",
+				idx->nents, idx->nloops));
+	tb->idx = idx;
+	return idx;
+}
+
 #ifdef HAVE_BTRFS_SUPPORT
+/*
+ * The same as mnt_table_find_target_with_option(@tb, @path, @option, @val,
+ * MNT_ITER_BACKWARD), but uses the index if possible.
+ */
+static struct libmnt_fs *find_target_with_option(struct libmnt_table *tb,
+			const char *path, const char *option, const char *val)
+{
+	struct libmnt_tabidx *idx = get_table_index(tb);
+	struct libmnt_fs *res = NULL;
+	size_t pos, valsz = strlen(val);
+
+	if (!idx || !*path)
+		return mnt_table_find_target_with_option(tb, path, option, val,
+						MNT_ITER_BACKWARD);
+
+	for (pos = idx->tgt_head[path_hash(path) & idx->mask]; pos;
+	     pos = idx->tgt_next[pos - 1]) {
+		struct libmnt_fs *fs = idx->ents[pos - 1];
+		char *optval = NULL;
+		size_t optvalsz = 0;
+
+		if (mnt_fs_streq_target(fs, path)
+		    && mnt_fs_get_option(fs, option, &optval, &optvalsz) == 0
+		    && optvalsz == valsz && strncmp(optval, val, optvalsz) == 0)
+			res = fs;	/* the last one wins */
+	}
+	return res;
+}
+
 static int get_btrfs_fs_root(struct libmnt_table *tb, struct libmnt_fs *fs, char **root)
 {
 	char *vol = NULL, *p;
@@ -1433,9 +1616,7 @@ static int get_btrfs_fs_root(struct libmnt_table *tb, struct libmnt_fs *fs, char
 			goto err;
 
 		DBG(BTRFS, ul_debug(" trying target=%s subvolid=%s", target, subvolidstr));
-		f = mnt_table_find_target_with_option(tb, target,
-					"subvolid", subvolidstr,
-					MNT_ITER_BACKWARD);
+		f = find_target_with_option(tb, target, "subvolid", subvolidstr);
 		if (!tb->cache)
 			free(target);
 		if (!f)
@@ -1480,9 +1661,7 @@ static int get_btrfs_fs_root(struct libmnt_table *tb, struct libmnt_fs *fs, char
 		DBG(BTRFS, ul_debug(" trying target=%s default subvolid=%s",
 					target, default_id_str));
 
-		f = mnt_table_find_target_with_option(tb, target,
-					"subvolid", default_id_str,
-					MNT_ITER_BACKWARD);
+		f = find_target_with_option(tb, target, "subvolid", default_id_str);
 		if (!tb->cache)
 			free(target);
 		if (!f)
@@ -1520,6 +1699,65 @@ err:
 	DBG(BTRFS, ul_debug(" error on btrfs volume setting evaluation"));
 	return errno ? -errno : -1;
 }
+
+/* get_btrfs_fs_root() with results cached in the @tb index */
+static int get_cached_btrfs_fs_root(struct libmnt_table *tb,
+				    struct libmnt_fs *fs, char **root)
+{
+	struct libmnt_tabidx *idx = get_table_index(tb);
+	struct tabidx_root *r;
+	char *key = NULL;
+	size_t pos;
+	uint32_t h;
+	int rc;
+
+	*root = NULL;
+	if (!idx || asprintf(&key, "%s\n%s",
+			mnt_fs_get_target(fs) ? : "",
+			mnt_fs_get_options(fs) ? : "") < 0)
+		return get_btrfs_fs_root(tb, fs, root);
+
+	if (!idx->roots_head) {
+		idx->roots_head = calloc(idx->mask + 1, sizeof(size_t));
+		if (!idx->roots_head) {
+			free(key);
+			return get_btrfs_fs_root(tb, fs, root);
+		}
+	}
+
+	h = path_hash(key) & idx->mask;
+	for (pos = idx->roots_head[h]; pos; pos = r->next) {
+		r = &idx->roots[pos - 1];
+		if (strcmp(r->key, key) != 0)
+			continue;
+		free(key);
+		if (r->root && !(*root = strdup(r->root)))
+			return -ENOMEM;
+		return r->rc;
+	}
+
+	rc = get_btrfs_fs_root(tb, fs, root);
+	if (rc < 0)
+		goto done;
+
+	/* cache positive as well as negative results */
+	r = realloc(idx->roots, (idx->nroots + 1) * sizeof(*r));
+	if (!r)
+		goto done;
+	idx->roots = r;
+	r = &idx->roots[idx->nroots];
+	r->root = *root ? strdup(*root) : NULL;
+	if (*root && !r->root)
+		goto done;
+	r->key = key;
+	r->rc = rc;
+	r->next = idx->roots_head[h];
+	idx->roots_head[h] = ++idx->nroots;
+	return rc;
+done:
+	free(key);
+	return rc;
+}
 #endif /* HAVE_BTRFS_SUPPORT */
 
 static const char *get_cifs_unc_subdir_path (const char *unc)
@@ -1560,6 +1798,9 @@ struct libmnt_fs *mnt_table_get_fs_root(struct libmnt_table *tb,
 	char *root = NULL;
 	const char *mnt = NULL;
 	struct libmnt_fs *src_fs = NULL;
+#ifdef HAVE_BTRFS_SUPPORT
+	const char *type;
+#endif
 
 	assert(fs);
 	assert(fsroot);
@@ -1630,9 +1871,9 @@ struct libmnt_fs *mnt_table_get_fs_root(struct libmnt_table *tb,
 	/*
 	 * btrfs-subvolume mount -- get subvolume name and use it as a root-fs path
 	 */
-	else if (tb && fs->fstype &&
-		 (!strcmp(fs->fstype, "btrfs") || !strcmp(fs->fstype, "auto"))) {
-		if (get_btrfs_fs_root(tb, fs, &root) < 0)
+	else if (tb && (type = mnt_fs_get_fstype(fs)) &&
+		 (!strcmp(type, "btrfs") || !strcmp(type, "auto"))) {
+		if (get_cached_btrfs_fs_root(tb, fs, &root) < 0)
 			goto err;
 	}
 #endif /* HAVE_BTRFS_SUPPORT */
@@ -1654,10 +1895,69 @@ err:
 }
 
 
+/*
+ * Iterates over @tb entries which may match @src or @devno (the other entries
+ * cannot match in __mnt_table_is_fs_mounted()), all entries without index.
+ */
+struct mounted_iter {
+	struct libmnt_tabidx *idx;
+	struct libmnt_iter itr;
+	size_t src, dev, loop;
+};
+
+static void init_mounted_iter(struct mounted_iter *mi, struct libmnt_table *tb,
+			      const char *src, dev_t devno)
+{
+	memset(mi, 0, sizeof(*mi));
+	mnt_reset_iter(&mi->itr, MNT_ITER_FORWARD);
+
+	mi->idx = get_table_index(tb);
+	if (!mi->idx)
+		return;
+
+	mi->src = mi->idx->src_head[path_hash(src) & mi->idx->mask];
+	if (devno)
+		mi->dev = mi->idx->dev_head[devno_hash(devno) & mi->idx->mask];
+}
+
+static int next_mounted_iter(struct mounted_iter *mi, struct libmnt_table *tb,
+			     struct libmnt_fs **fs)
+{
+	struct libmnt_tabidx *idx = mi->idx;
+	size_t pos = 0, loop;
+
+	if (!idx)
+		return mnt_table_next_fs(tb, &mi->itr, fs);
+
+	/* merge the chains, all are in the table order */
+	loop = mi->loop < idx->nloops ? idx->loops[mi->loop] : 0;
+
+	if (mi->src)
+		pos = mi->src;
+	if (mi->dev && (!pos || mi->dev < pos))
+		pos = mi->dev;
+	if (loop && (!pos || loop < pos))
+		pos = loop;
+	if (!pos) {
+		*fs = NULL;
+		return 1;
+	}
+
+	if (mi->src == pos)
+		mi->src = idx->src_next[pos - 1];
+	if (mi->dev == pos)
+		mi->dev = idx->dev_next[pos - 1];
+	if (loop == pos)
+		mi->loop++;
+
+	*fs = idx->ents[pos - 1];
+	return 0;
+}
+
 int __mnt_table_is_fs_mounted(struct libmnt_table *tb, struct libmnt_fs *fstab_fs,
 			      const char *tgt_prefix)
 {
-	struct libmnt_iter itr;
+	struct mounted_iter mi;
 	struct libmnt_fs *fs;
 
 	char *root = NULL;
@@ -1719,11 +2019,11 @@ int __mnt_table_is_fs_mounted(struct libmnt_table *tb, struct libmnt_fs *fstab_f
 		DBG(FS, ul_debugobj(fstab_fs, "- ignore (no source/target)"));
 		goto done;
 	}
-	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	init_mounted_iter(&mi, tb, src, devno);
 
 	DBG(FS, ul_debugobj(fstab_fs, "mnt_table_is_fs_mounted: src=%s, tgt=%s, root=%s", src, tgt, root));
 
-	while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	while (next_mounted_iter(&mi, tb, &fs) == 0) {
 
 		int eq = mnt_fs_streq_srcpath(fs, src);
 
@@ -2144,6 +2444,72 @@ done:
 	return 0;
 }
 
+static void print_is_mounted(struct libmnt_table *tb, struct libmnt_table *fstab)
+{
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(fstab, &itr, &fs) == 0)
+		printf("%s %s on %s\n", mnt_fs_get_source(fs),
+				mnt_table_is_fs_mounted(tb, fs) ?
+					"already mounted" : "not mounted",
+				mnt_fs_get_target(fs));
+}
+
+/*
+ * The same as --is-mounted, but for the @mountinfo file. The mountinfo entry
+ * is modified between the checks to verify that the table index is dropped
+ * after mnt_fs_set_source() and mnt_fs_set_target().
+ */
+static int test_is_mounted_index(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_table *tb = NULL, *fstab = NULL;
+	struct libmnt_fs *fs;
+	char *src = NULL, *tgt = NULL;
+	int rc = -1;
+
+	if (argc != 6) {
+		fprintf(stderr, "try --help\n");
+		return -EINVAL;
+	}
+
+	tb = create_table(argv[1], FALSE);
+	fstab = create_table(argv[2], FALSE);
+	if (!tb || !fstab)
+		goto done;
+
+	printf("--- initial\n");
+	print_is_mounted(tb, fstab);
+
+	fs = mnt_table_find_target(tb, argv[3], MNT_ITER_BACKWARD);
+	if (!fs) {
+		fprintf(stderr, "%s: not found '%s'\n", argv[1], argv[3]);
+		goto done;
+	}
+	src = strdup(mnt_fs_get_source(fs));
+	tgt = strdup(mnt_fs_get_target(fs));
+	if (!src || !tgt)
+		goto done;
+
+	mnt_fs_set_source(fs, argv[4]);
+	mnt_fs_set_target(fs, argv[5]);
+	printf("--- modified\n");
+	print_is_mounted(tb, fstab);
+
+	mnt_fs_set_source(fs, src);
+	mnt_fs_set_target(fs, tgt);
+	printf("--- restored\n");
+	print_is_mounted(tb, fstab);
+	rc = 0;
+done:
+	free(src);
+	free(tgt);
+	mnt_unref_table(tb);
+	mnt_unref_table(fstab);
+	return rc;
+}
+
 /* returns 0 if @a and @b targets are the same */
 static int test_uniq_cmp(struct libmnt_table *tb __attribute__((__unused__)),
 			 struct libmnt_fs *a,
@@ -2197,6 +2563,7 @@ int main(int argc, char *argv[])
 	{ "--find-mountpoint", test_find_mountpoint, "<path>" },
 	{ "--copy-fs",       test_copy_fs, "<file>  copy root FS from the file" },
 	{ "--is-mounted",    test_is_mounted, "<fstab> check what from fstab is already mounted" },
+	{ "--is-mounted-index", test_is_mounted_index, "<mountinfo> <fstab> <target> <newsource> <newtarget>" },
 	{ NULL }
 	};
 
@@ -0,0 +1,741 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * This file is part of libmount from util-linux project.
+ *
+ * libmount is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * listmount(2) and statmount(2) backend for the kernel mount table.
+ *
+ * listmount() returns IDs of all mounts in the current namespace and
+ * statmount() returns mountinfo fields for one mount, so the kernel does not
+ * have to generate (and we don't have to parse) the whole mountinfo text.
+ *
+ * The fixed-size fields (IDs, devno, VFS options and propagation) are always
+ * fetched. The strings are fetched only if requested by
+ * mnt_table_set_statmount_mask(), the rest is fetched on demand by the
+ * mnt_fs_get_*() functions (see fs->stmnt_todo).
+ */
+#include <inttypes.h>
+
+#include "mountP.h"
+#include "mount-api-utils.h"
+#include "mangle.h"
+#include "pathnames.h"
+#include "strutils.h"
+
+/**
+ * mnt_table_enable_listmount:
+ * @tb: table
+ * @enable: TRUE or FALSE
+ *
+ * Enables or disables listmount(2) and statmount(2) for
+ * mnt_table_parse_mtab(). If the syscalls are not supported by the kernel
+ * (Linux 6.15 is required) then /proc/self/mountinfo is parsed.
+ *
+ * It's disabled by default. The kernel does not generate the mountinfo text
+ * and the table is not parsed, but one statmount() call per mount is usually
+ * not faster than reading the whole mountinfo file. It's an advantage if only
+ * a few fields are necessary, see mnt_table_set_statmount_mask().
+ *
+ * Returns: 0 on success or negative number in case of error.
+ *
+ * Since: 2.37
+ */
+int mnt_table_enable_listmount(struct libmnt_table *tb, int enable)
+{
+	if (!tb)
+		return -EINVAL;
+	tb->listmount = enable ? 1 : 0;
+	return 0;
+}
+
+/**
+ * mnt_table_set_statmount_mask:
+ * @tb: table
+ * @mask: MNT_STATMOUNT_* fields
+ *
+ * Sets the fields read by statmount(2) when mnt_table_parse_mtab() reads the
+ * table by listmount(2). The other fields are read later when requested by
+ * mnt_fs_get_*() functions, or by mnt_fs_fetch_statmount(). The default is
+ * MNT_STATMOUNT_ALL.
+ *
+ * The IDs, device number, VFS options and propagation flags are always
+ * read.
+ *
+ * Returns: 0 on success or negative number in case of error.
+ *
+ * Since: 2.37
+ */
+int mnt_table_set_statmount_mask(struct libmnt_table *tb, int mask)
+{
+	if (!tb)
+		return -EINVAL;
+	tb->stmnt_lazy = MNT_STATMOUNT_ALL & ~mask;
+	return 0;
+}
+
+#ifdef UL_HAVE_STATMOUNT
+
+#define LISTMOUNT_CHUNK		512
+
+/* all fields used by the parser */
+#define STATMOUNT_NEEDED	(UL_STATMOUNT_SB_BASIC | UL_STATMOUNT_MNT_BASIC | \
+				 UL_STATMOUNT_PROPAGATE_FROM | UL_STATMOUNT_MNT_ROOT | \
+				 UL_STATMOUNT_MNT_POINT | UL_STATMOUNT_FS_TYPE | \
+				 UL_STATMOUNT_MNT_OPTS | UL_STATMOUNT_FS_SUBTYPE | \
+				 UL_STATMOUNT_SB_SOURCE)
+
+static uint64_t statmount_mask(int fields)
+{
+	uint64_t mask = UL_STATMOUNT_SB_BASIC | UL_STATMOUNT_MNT_BASIC
+			| UL_STATMOUNT_PROPAGATE_FROM;
+
+	if (fields & MNT_STATMOUNT_TARGET)
+		mask |= UL_STATMOUNT_MNT_POINT;
+	if (fields & MNT_STATMOUNT_ROOT)
+		mask |= UL_STATMOUNT_MNT_ROOT;
+	if (fields & MNT_STATMOUNT_SOURCE)
+		mask |= UL_STATMOUNT_SB_SOURCE;
+	if (fields & MNT_STATMOUNT_FSTYPE)
+		mask |= UL_STATMOUNT_FS_TYPE | UL_STATMOUNT_FS_SUBTYPE;
+	if (fields & MNT_STATMOUNT_OPTIONS)
+		mask |= UL_STATMOUNT_MNT_OPTS;
+	return mask;
+}
+
+/* calls statmount(), @buf is reallocated if too small */
+static struct ul_statmount *do_statmount(uint64_t id, uint64_t mask,
+					 struct ul_statmount **buf, size_t *bufsz)
+{
+	if (!*buf) {
+		*bufsz = 4096;
+		*buf = malloc(*bufsz);
+		if (!*buf)
+			return NULL;
+	}
+
+	while (ul_statmount(id, mask, *buf, *bufsz) != 0) {
+		struct ul_statmount *x;
+
+		if (errno != EOVERFLOW)
+			return NULL;
+		x = realloc(*buf, *bufsz * 2);
+		if (!x)
+			return NULL;
+		*buf = x;
+		*bufsz *= 2;
+	}
+	return *buf;
+}
+
+/* the same as mountinfo VFS options and optional fields */
+static int set_basic(struct libmnt_fs *fs, struct ul_statmount *sm)
+{
+	char buf[128], *p = buf;
+	uint64_t attr = sm->mnt_attr;
+
+	fs->flags |= MNT_FS_KERNEL;
+	fs->uniq_id = sm->mnt_id;
+	fs->id = sm->mnt_id_old;
+	fs->parent = sm->mnt_parent_id_old;
+	fs->devno = makedev(sm->sb_dev_major, sm->sb_dev_minor);
+
+	p += sprintf(p, "%s", attr & MOUNT_ATTR_RDONLY ? "ro" : "rw");
+	if (attr & MOUNT_ATTR_NOSUID)
+		p += sprintf(p, ",nosuid");
+	if (attr & MOUNT_ATTR_NODEV)
+		p += sprintf(p, ",nodev");
+	if (attr & MOUNT_ATTR_NOEXEC)
+		p += sprintf(p, ",noexec");
+	if ((attr & MOUNT_ATTR__ATIME) == MOUNT_ATTR_NOATIME)
+		p += sprintf(p, ",noatime");
+	if (attr & MOUNT_ATTR_NODIRATIME)
+		p += sprintf(p, ",nodiratime");
+	if ((attr & MOUNT_ATTR__ATIME) == MOUNT_ATTR_RELATIME)
+		p += sprintf(p, ",relatime");
+	if (attr & MOUNT_ATTR_NOSYMFOLLOW)
+		p += sprintf(p, ",nosymfollow");
+	if (attr & MOUNT_ATTR_IDMAP)
+		sprintf(p, ",idmapped");
+
+	fs->vfs_optstr = strdup(buf);
+	if (!fs->vfs_optstr)
+		return -ENOMEM;
+
+	p = buf;
+	*p = '\0';
+	if (sm->mnt_propagation & MS_SHARED)
+		p += sprintf(p, " shared:%" PRIu64, sm->mnt_peer_group);
+	if (sm->mnt_propagation & MS_SLAVE) {
+		p += sprintf(p, " master:%" PRIu64, sm->mnt_master);
+		if (sm->propagate_from && sm->propagate_from != sm->mnt_master)
+			p += sprintf(p, " propagate_from:%" PRIu64, sm->propagate_from);
+	}
+	if (sm->mnt_propagation & MS_UNBINDABLE)
+		sprintf(p, " unbindable");
+
+	if (*buf) {
+		fs->opt_fields = strdup(buf + 1);
+		if (!fs->opt_fields)
+			return -ENOMEM;
+	}
+	return 0;
+}
+
+static int set_source(struct libmnt_fs *fs, struct ul_statmount *sm,
+		      struct libmnt_cache *cache)
+{
+	char *src;
+	int rc;
+
+	src = strdup(sm->mask & UL_STATMOUNT_SB_SOURCE ?
+			sm->str + sm->sb_source : "none");
+	if (!src)
+		return -ENOMEM;
+
+	/* convert obscure /dev/root to something more usable */
+	if (strcmp(src, "/dev/root") == 0) {
+		char *real = NULL;
+
+		rc = mnt_guess_system_root(fs->devno, cache, &real);
+		if (rc < 0) {
+			free(src);
+			return rc;
+		}
+		if (rc == 0 && real) {
+			free(src);
+			src = real;
+		}
+	}
+
+	rc = __mnt_fs_set_source_ptr(fs, src);
+	if (rc)
+		free(src);
+	return rc;
+}
+
+static int set_fs_options(struct libmnt_fs *fs, struct ul_statmount *sm)
+{
+	const char *opts = sm->mask & UL_STATMOUNT_MNT_OPTS ?
+				sm->str + sm->mnt_opts : NULL;
+	char *p;
+
+	/* "ro,sync,dirsync,lazytime," + mnt_opts */
+	p = malloc(32 + (opts ? strlen(opts) : 0));
+	if (!p)
+		return -ENOMEM;
+
+	mnt_fs_reset_optvecs(fs);
+	free(fs->fs_optstr);
+	fs->fs_optstr = p;
+
+	p += sprintf(p, "%s", sm->sb_flags & MS_RDONLY ? "ro" : "rw");
+	if (sm->sb_flags & MS_SYNCHRONOUS)
+		p += sprintf(p, ",sync");
+	if (sm->sb_flags & MS_DIRSYNC)
+		p += sprintf(p, ",dirsync");
+	if (sm->sb_flags & MS_LAZYTIME)
+		p += sprintf(p, ",lazytime");
+	if (opts) {
+		*p++ = ',';
+		strcpy(p, opts);
+		unmangle_string(p);
+	}
+
+	/* merge VFS, FS and user options (the same as after mountinfo parsing) */
+	free(fs->optstr);
+	fs->optstr = NULL;
+	fs->optstr = mnt_fs_strdup_options(fs);
+	return fs->optstr ? 0 : -ENOMEM;
+}
+
+/* remove " (deleted)" suffix like mountinfo parser */
+static char *strdup_target(const char *path)
+{
+	char *p = strdup(path);
+
+	if (p) {
+		char *x = (char *) endswith(p, PATH_DELETED_SUFFIX);
+		if (x && *x)
+			*x = '\0';
+	}
+	return p;
+}
+
+/* sets the requested strings, the missing strings are set to NULL */
+static int set_strings(struct libmnt_fs *fs, struct ul_statmount *sm,
+		       int fields, struct libmnt_cache *cache)
+{
+	int rc = 0;
+
+	fs->stmnt_todo &= ~fields;
+
+	if (fields & MNT_STATMOUNT_TARGET) {
+		free(fs->target);
+		fs->target = NULL;
+		if ((sm->mask & UL_STATMOUNT_MNT_POINT)
+		    && !(fs->target = strdup_target(sm->str + sm->mnt_point)))
+			return -ENOMEM;
+	}
+	if (fields & MNT_STATMOUNT_ROOT) {
+		free(fs->root);
+		fs->root = NULL;
+		if ((sm->mask & UL_STATMOUNT_MNT_ROOT)
+		    && !(fs->root = strdup(sm->str + sm->mnt_root)))
+			return -ENOMEM;
+	}
+	if (fields & MNT_STATMOUNT_FSTYPE) {
+		char *type = NULL;
+
+		if (sm->mask & UL_STATMOUNT_FS_SUBTYPE) {
+			if (asprintf(&type, "%s.%s", sm->str + sm->fs_type,
+					sm->str + sm->fs_subtype) < 0)
+				return -ENOMEM;
+		} else if ((sm->mask & UL_STATMOUNT_FS_TYPE)
+			   && !(type = strdup(sm->str + sm->fs_type)))
+			return -ENOMEM;
+		__mnt_fs_set_fstype_ptr(fs, type);
+	}
+	if (fields & MNT_STATMOUNT_SOURCE)
+		rc = set_source(fs, sm, cache);
+	if (!rc && (fields & MNT_STATMOUNT_OPTIONS))
+		rc = set_fs_options(fs, sm);
+	return rc;
+}
+
+/**
+ * mnt_fs_fetch_statmount:
+ * @fs: kernel mount table entry
+ * @mask: MNT_STATMOUNT_* fields
+ *
+ * Reads the fields skipped by mnt_table_parse_mtab() (see
+ * mnt_table_set_statmount_mask()). This is done automatically by the
+ * mnt_fs_get_*() functions, the function is useful to read more fields by
+ * one syscall. The fields already read are ignored.
+ *
+ * Returns: 0 on success or negative number in case of error.
+ *
+ * Since: 2.37
+ */
+int mnt_fs_fetch_statmount(struct libmnt_fs *fs, int mask)
+{
+	struct ul_statmount *sm = NULL;
+	struct libmnt_table *tb;
+	size_t smsz = 0;
+	int rc;
+
+	if (!fs || !fs->uniq_id)
+		return -EINVAL;
+
+	mask &= fs->stmnt_todo;
+	if (!mask)
+		return 0;
+
+	DBG(FS, ul_debugobj(fs, "statmount [id=%" PRIu64 ", mask=0x%x]",
+				fs->uniq_id, mask));
+
+	if (!do_statmount(fs->uniq_id, statmount_mask(mask), &sm, &smsz)) {
+		rc = -errno;
+		fs->stmnt_todo &= ~mask;	/* don't try it again */
+	} else {
+		/* the entry is not modified from the table point of view,
+		 * don't drop the table lookup index */
+		tb = fs->tab;
+		fs->tab = NULL;
+		rc = set_strings(fs, sm, mask, tb ? tb->cache : NULL);
+		fs->tab = tb;
+	}
+
+	free(sm);
+	return rc;
+}
+
+/* removes entries added after @nents on error */
+static void remove_tail(struct libmnt_table *tb, int nents)
+{
+	while (tb->nents > nents) {
+		struct libmnt_fs *fs = list_entry(tb->ents.prev,
+						  struct libmnt_fs, ents);
+		mnt_table_remove_fs(tb, fs);
+	}
+}
+
+/*
+ * Reads all mounts from the current namespace to @tb. Returns 0 on success,
+ * <0 on error or if the syscalls are not supported. The table is not modified
+ * on error.
+ */
+int __mnt_table_parse_listmount(struct libmnt_table *tb)
+{
+	uint64_t ids[LISTMOUNT_CHUNK], last = 0, mask;
+	struct ul_statmount *sm = NULL;
+	size_t smsz = 0;
+	ssize_t n, i;
+	int rc = 0, fields, nents, checked = 0;
+	pid_t tid = getpid();
+
+	if (!tb->listmount)
+		return -ENOSYS;
+
+	fields = MNT_STATMOUNT_ALL & ~tb->stmnt_lazy;
+	mask = statmount_mask(fields);
+	nents = tb->nents;
+
+	DBG(TAB, ul_debugobj(tb, "listmount: start [fields=0x%x]", fields));
+
+	do {
+		n = ul_listmount(last, ids, ARRAY_SIZE(ids));
+		if (n < 0) {
+			rc = -errno;
+			goto err;
+		}
+
+		for (i = 0; i < n; i++) {
+			struct libmnt_fs *fs;
+
+			last = ids[i];
+
+			/* the first call also checks the kernel features */
+			if (!do_statmount(ids[i], checked ? mask :
+					  mask | UL_STATMOUNT_SUPPORTED_MASK,
+					  &sm, &smsz)) {
+				if (errno == ENOENT)
+					continue;	/* umounted meanwhile */
+				rc = -errno;
+				goto err;
+			}
+			if (!checked) {
+				if (!(sm->mask & UL_STATMOUNT_SUPPORTED_MASK)
+				    || (sm->supported_mask & STATMOUNT_NEEDED)
+							!= STATMOUNT_NEEDED) {
+					rc = -ENOSYS;
+					goto err;
+				}
+				checked = 1;
+			}
+
+			fs = mnt_new_fs();
+			if (!fs) {
+				rc = -ENOMEM;
+				goto err;
+			}
+			fs->tid = tid;
+			fs->stmnt_todo = MNT_STATMOUNT_ALL;
+
+			rc = set_basic(fs, sm);
+			if (!rc)
+				rc = set_strings(fs, sm, fields, tb->cache);
+			if (!rc)
+				rc = mnt_table_add_fs(tb, fs);
+			mnt_unref_fs(fs);
+			if (rc)
+				goto err;
+		}
+	} while (n == ARRAY_SIZE(ids));
+
+	free(sm);
+	DBG(TAB, ul_debugobj(tb, "listmount: done (%d entries)", tb->nents - nents));
+	return 0;
+err:
+	DBG(TAB, ul_debugobj(tb, "listmount: failed [rc=%d]", rc));
+	free(sm);
+	remove_tail(tb, nents);
+	return rc;
+}
+
+#else /* !UL_HAVE_STATMOUNT */
+
+int mnt_fs_fetch_statmount(struct libmnt_fs *fs __attribute__((__unused__)),
+			   int mask __attribute__((__unused__)))
+{
+	return -ENOSYS;
+}
+
+int __mnt_table_parse_listmount(struct libmnt_table *tb __attribute__((__unused__)))
+{
+	return -ENOSYS;
+}
+
+#endif /* UL_HAVE_STATMOUNT */
+
+#ifdef TEST_PROGRAM
+#include <sched.h>
+#include <sys/mount.h>
+
+#include "monotonic.h"
+
+static struct libmnt_table *read_table(int listmount, int mask)
+{
+	struct libmnt_table *tb = mnt_new_table();
+
+	if (!tb)
+		return NULL;
+	mnt_table_enable_listmount(tb, listmount);
+	mnt_table_set_statmount_mask(tb, mask);
+
+	if (mnt_table_parse_mtab(tb, NULL) != 0) {
+		mnt_unref_table(tb);
+		return NULL;
+	}
+	return tb;
+}
+
+static int is_supported(void)
+{
+	struct libmnt_table *tb = mnt_new_table();
+	int rc;
+
+	if (!tb)
+		return 0;
+	mnt_table_enable_listmount(tb, TRUE);
+	rc = __mnt_table_parse_listmount(tb);
+	mnt_unref_table(tb);
+	return rc == 0;
+}
+
+static struct libmnt_fs *find_id(struct libmnt_table *tb, int id)
+{
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		if (mnt_fs_get_id(fs) == id)
+			return fs;
+	}
+	return NULL;
+}
+
+#define cmp_str(_name, _a, _b) \
+	do { \
+		const char *a = (_a), *b = (_b); \
+		if (!(a == b || (a && b && strcmp(a, b) == 0))) { \
+			printf("%d: %s: mountinfo='%s' listmount='%s'\n", \
+				mnt_fs_get_id(x), _name, a, b); \
+			rc = 1; \
+		} \
+	} while (0)
+
+/* compares mountinfo with listmount, prints differences */
+static int compare(int mask)
+{
+	struct libmnt_table *mi, *lm;
+	struct libmnt_iter itr;
+	struct libmnt_fs *x;
+	int rc = 0;
+
+	if (!is_supported()) {
+		printf("listmount unsupported\n");
+		return 0;
+	}
+
+	mi = read_table(FALSE, MNT_STATMOUNT_ALL);
+	lm = read_table(TRUE, mask);
+	if (!mi || !lm)
+		return -1;
+
+	if (mnt_table_get_nents(mi) != mnt_table_get_nents(lm)) {
+		printf("entries: mountinfo=%d listmount=%d\n",
+			mnt_table_get_nents(mi), mnt_table_get_nents(lm));
+		rc = 1;
+	}
+
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(mi, &itr, &x) == 0) {
+		struct libmnt_fs *y = find_id(lm, mnt_fs_get_id(x));
+
+		if (!y) {
+			printf("%d: missing in listmount\n", mnt_fs_get_id(x));
+			rc = 1;
+			continue;
+		}
+		if (mnt_fs_get_parent_id(x) != mnt_fs_get_parent_id(y)
+		    || mnt_fs_get_devno(x) != mnt_fs_get_devno(y)) {
+			printf("%d: parent or devno differ\n", mnt_fs_get_id(x));
+			rc = 1;
+		}
+		cmp_str("root", mnt_fs_get_root(x), mnt_fs_get_root(y));
+		cmp_str("target", mnt_fs_get_target(x), mnt_fs_get_target(y));
+		cmp_str("source", mnt_fs_get_source(x), mnt_fs_get_source(y));
+		cmp_str("fstype", mnt_fs_get_fstype(x), mnt_fs_get_fstype(y));
+		cmp_str("options", mnt_fs_get_options(x), mnt_fs_get_options(y));
+		cmp_str("vfs-options", mnt_fs_get_vfs_options(x), mnt_fs_get_vfs_options(y));
+		cmp_str("fs-options", mnt_fs_get_fs_options(x), mnt_fs_get_fs_options(y));
+		cmp_str("optional-fields", mnt_fs_get_optional_fields(x),
+					   mnt_fs_get_optional_fields(y));
+	}
+
+	mnt_unref_table(mi);
+	mnt_unref_table(lm);
+	if (rc == 0)
+		printf("equal\n");
+	return 0;
+}
+
+static int test_compare(struct libmnt_test *ts, int argc, char *argv[])
+{
+	return compare(MNT_STATMOUNT_ALL);
+}
+
+static int test_compare_lazy(struct libmnt_test *ts, int argc, char *argv[])
+{
+	return compare(0);
+}
+
+/* returns ID of the entry found in a new lazy listmount table */
+static int find_lazy(const char *what, const char *str)
+{
+	struct libmnt_table *tb = read_table(TRUE, 0);
+	struct libmnt_cache *cache = mnt_new_cache();
+	struct libmnt_fs *fs = NULL;
+	int id = -1;
+
+	if (tb && cache) {
+		mnt_table_set_cache(tb, cache);
+		if (strcmp(what, "target") == 0)
+			fs = mnt_table_find_target(tb, str, MNT_ITER_BACKWARD);
+		else
+			fs = mnt_table_find_srcpath(tb, str, MNT_ITER_BACKWARD);
+	}
+	if (fs)
+		id = mnt_fs_get_id(fs);
+	mnt_unref_cache(cache);
+	mnt_unref_table(tb);
+	return id;
+}
+
+/*
+ * Looks up all mountinfo entries by target and source in lazy listmount
+ * tables, nothing is fetched before the lookup.
+ */
+static int test_find_lazy(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_table *mi;
+	struct libmnt_cache *cache;
+	struct libmnt_iter itr;
+	struct libmnt_fs *x;
+	int rc = 0;
+
+	if (!is_supported()) {
+		printf("listmount unsupported\n");
+		return 0;
+	}
+
+	mi = read_table(FALSE, MNT_STATMOUNT_ALL);
+	cache = mnt_new_cache();
+	if (!mi || !cache)
+		return -1;
+	mnt_table_set_cache(mi, cache);
+
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(mi, &itr, &x) == 0) {
+		const char *tgt = mnt_fs_get_target(x);
+		const char *src = mnt_fs_get_srcpath(x);
+		struct libmnt_fs *y;
+
+		y = mnt_table_find_target(mi, tgt, MNT_ITER_BACKWARD);
+		if (y && mnt_fs_get_id(y) != find_lazy("target", tgt)) {
+			printf("%d: target lookup differs\n", mnt_fs_get_id(x));
+			rc = 1;
+		}
+		if (!src)
+			continue;
+		y = mnt_table_find_srcpath(mi, src, MNT_ITER_BACKWARD);
+		if (y && mnt_fs_get_id(y) != find_lazy("source", src)) {
+			printf("%d: source lookup differs\n", mnt_fs_get_id(x));
+			rc = 1;
+		}
+	}
+
+	mnt_unref_cache(cache);
+	mnt_unref_table(mi);
+	if (rc == 0)
+		printf("equal\n");
+	return 0;
+}
+
+static double bench_table(int listmount, int mask, int loops)
+{
+	struct timeval start, end;
+	int i;
+
+	gettime_monotonic(&start);
+	for (i = 0; i < loops; i++) {
+		struct libmnt_table *tb = read_table(listmount, mask);
+		struct libmnt_iter itr;
+		struct libmnt_fs *fs;
+
+		if (!tb)
+			return -1;
+
+		/* the usual findmnt-like access */
+		mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+		while (mnt_table_next_fs(tb, &itr, &fs) == 0)
+			mnt_fs_get_target(fs);
+		mnt_unref_table(tb);
+	}
+	gettime_monotonic(&end);
+
+	return ((end.tv_sec - start.tv_sec) * 1000.0
+		+ (end.tv_usec - start.tv_usec) / 1000.0) / loops;
+}
+
+/*
+ * Creates @n bind mounts in a private mount namespace and compares mountinfo
+ * and listmount speed.
+ */
+static int test_bench(struct libmnt_test *ts, int argc, char *argv[])
+{
+	char dir[] = "/tmp/libmount-bench-XXXXXX", path[PATH_MAX];
+	int i, n = argc > 1 ? atoi(argv[1]) : 50000;
+
+	if (!is_supported()) {
+		printf("listmount unsupported\n");
+		return 0;
+	}
+	if (!mkdtemp(dir))
+		return -errno;
+	if (unshare(CLONE_NEWNS) != 0
+	    || mount("none", "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0
+	    || mount("bench", dir, "tmpfs", 0, NULL) != 0) {
+		warn("cannot create mount namespace");
+		rmdir(dir);
+		return -errno;
+	}
+
+	for (i = 0; i < n; i++) {
+		snprintf(path, sizeof(path), "%s/%d", dir, i);
+		if (mkdir(path, 0700) != 0 || mount(dir, path, NULL, MS_BIND, NULL) != 0) {
+			warn("%s: cannot mount", path);
+			return -errno;
+		}
+	}
+
+	printf("mounts:              %d\n", n);
+	printf("mountinfo:           %10.2f ms\n", bench_table(FALSE, MNT_STATMOUNT_ALL, 3));
+	printf("listmount (all):     %10.2f ms\n", bench_table(TRUE, MNT_STATMOUNT_ALL, 3));
+	printf("listmount (target):  %10.2f ms\n", bench_table(TRUE, MNT_STATMOUNT_TARGET, 3));
+
+	umount2(dir, MNT_DETACH);
+	rmdir(dir);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct libmnt_test tss[] = {
+	{ "--compare",      test_compare,      "compare mountinfo and listmount" },
+	{ "--compare-lazy", test_compare_lazy, "compare mountinfo and lazy listmount" },
+	{ "--find-lazy",    test_find_lazy,    "compare lookups in mountinfo and lazy listmount" },
+	{ "--bench",        test_bench,        "[<n>] compare speed on <n> mounts (default 50000)" },
+	{ NULL }
+	};
+
+	return mnt_run_test(tss, argc, argv);
+}
+#endif /* TEST_PROGRAM */
@@ -1258,6 +1258,10 @@ int __mnt_table_parse_mtab(struct libmnt_table *tb, const char *filename,
 	if (!filename || strcmp(filename, _PATH_PROC_MOUNTINFO) == 0) {
 		filename = _PATH_PROC_MOUNTINFO;
 		tb->fmt = MNT_FMT_MOUNTINFO;
+
+		/* the same as mountinfo, but without text generation and parsing */
+		if (__mnt_table_parse_listmount(tb) == 0)
+			goto read_utab;
 		DBG(TAB, ul_debugobj(tb, "mtab parse: #1 read mountinfo"));
 	} else
 		tb->fmt = MNT_FMT_GUESS;
@@ -1274,9 +1278,7 @@ int __mnt_table_parse_mtab(struct libmnt_table *tb, const char *filename,
 
 	if (!is_mountinfo(tb))
 		return 0;
-#ifdef USE_LIBMOUNT_SUPPORT_MTAB
 read_utab:
-#endif
 	DBG(TAB, ul_debugobj(tb, "mtab parse: #2 read utab"));
 
 	if (mnt_table_get_nents(tb) == 0)
@@ -1331,6 +1333,9 @@ read_utab:
  * If libmount is compiled with classic mtab file support, and the /etc/mtab is
  * a regular file then this file is parsed.
  *
+ * The entries are read by listmount(2) and statmount(2) rather than from
+ * mountinfo file if enabled by mnt_table_enable_listmount().
+ *
  * It's strongly recommended to use NULL as a @filename to keep code portable.
  *
  * See also mnt_table_set_parser_errcb().
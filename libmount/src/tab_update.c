@@ -820,6 +820,53 @@ static int update_modify_options(struct libmnt_update *upd, struct libmnt_lock *
 	return rc;
 }
 
+/*
+ * Appends the new entry to utab. The mount only adds a line to the file, so
+ * it's unnecessary to read and rewrite the whole file; the entry is written
+ * by one write(2) under the lock. The umount, move and remount rewrite the
+ * file (and only if the entry exists).
+ */
+static int update_append_entry(struct libmnt_update *upd, struct libmnt_lock *lc)
+{
+	FILE *f;
+	int rc = 0, fd;
+
+	assert(upd);
+	assert(upd->fs);
+
+	DBG(UPDATE, ul_debugobj(upd, "%s: append entry", upd->filename));
+
+	if (lc)
+		rc = mnt_lock_file(lc);
+	if (rc)
+		return -MNT_ERR_LOCK;
+
+	fd = open(upd->filename, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+			S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+	if (fd < 0) {
+		rc = -errno;
+		goto done;
+	}
+
+	f = fdopen(fd, "a" UL_CLOEXECSTR);
+	if (!f) {
+		rc = -errno;
+		close(fd);
+		goto done;
+	}
+
+	rc = fprintf_utab_fs(f, upd->fs);
+	if (!rc && fflush(f) != 0)
+		rc = -errno;
+	if (!rc)
+		rc = fchmod(fd, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH) ? -errno : 0;
+	fclose(f);
+done:
+	if (lc)
+		mnt_unlock_file(lc);
+	return rc;
+}
+
 /**
  * mnt_update_table:
  * @upd: update
@@ -862,6 +909,8 @@ int mnt_update_table(struct libmnt_update *upd, struct libmnt_lock *lc)
 		rc = update_modify_target(upd, lc);	/* move */
 	else if (upd->mountflags & MS_REMOUNT)
 		rc = update_modify_options(upd, lc);	/* remount */
+	else if (upd->fs && upd->userspace_only)
+		rc = update_append_entry(upd, lc);	/* mount, utab */
 	else if (upd->fs)
 		rc = update_add_entry(upd, lc);	/* mount */
 
@@ -555,6 +555,22 @@ void uuid_generate(uuid_t out)
 		uuid_generate_time(out);
 }
 
+/*
+ * Set the UUID version and variant for UUID based on the hash of a name.
+ */
+static void uuid_from_hash(uuid_t out, const unsigned char *hash, int version)
+{
+	uuid_t buf;
+	struct uuid uu;
+
+	memcpy(buf, hash, sizeof(buf));
+	uuid_unpack(buf, &uu);
+
+	uu.clock_seq = (uu.clock_seq & 0x3FFF) | 0x8000;
+	uu.time_hi_and_version = (uu.time_hi_and_version & 0x0FFF) | (version << 12);
+	uuid_pack(&uu, out);
+}
+
 /*
  * Generate an MD5 hashed (predictable) UUID based on a well-known UUID
  * providing the namespace and an arbitrary binary string.
@@ -563,22 +579,15 @@ void uuid_generate_md5(uuid_t out, const uuid_t ns, const char *name, size_t len
 {
 	UL_MD5_CTX ctx;
 	char hash[UL_MD5LENGTH];
-	uuid_t buf;
-	struct uuid uu;
 
 	ul_MD5Init(&ctx);
 	ul_MD5Update(&ctx, ns, sizeof(uuid_t));
 	ul_MD5Update(&ctx, (const unsigned char *)name, len);
 	ul_MD5Final((unsigned char *)hash, &ctx);
 
-	assert(sizeof(buf) <= sizeof(hash));
+	assert(sizeof(uuid_t) <= sizeof(hash));
 
-	memcpy(buf, hash, sizeof(buf));
-	uuid_unpack(buf, &uu);
-
-	uu.clock_seq = (uu.clock_seq & 0x3FFF) | 0x8000;
-	uu.time_hi_and_version = (uu.time_hi_and_version & 0x0FFF) | 0x3000;
-	uuid_pack(&uu, out);
+	uuid_from_hash(out, (unsigned char *) hash, UUID_TYPE_DCE_MD5);
 }
 
 /*
@@ -589,20 +598,34 @@ void uuid_generate_sha1(uuid_t out, const uuid_t ns, const char *name, size_t le
 {
 	UL_SHA1_CTX ctx;
 	char hash[UL_SHA1LENGTH];
-	uuid_t buf;
-	struct uuid uu;
 
 	ul_SHA1Init(&ctx);
 	ul_SHA1Update(&ctx, ns, sizeof(uuid_t));
 	ul_SHA1Update(&ctx, (const unsigned char *)name, len);
 	ul_SHA1Final((unsigned char *)hash, &ctx);
 
-	assert(sizeof(buf) <= sizeof(hash));
+	assert(sizeof(uuid_t) <= sizeof(hash));
 
-	memcpy(buf, hash, sizeof(buf));
-	uuid_unpack(buf, &uu);
+	uuid_from_hash(out, (unsigned char *) hash, UUID_TYPE_DCE_SHA1);
+}
 
-	uu.clock_seq = (uu.clock_seq & 0x3FFF) | 0x8000;
-	uu.time_hi_and_version = (uu.time_hi_and_version & 0x0FFF) | 0x5000;
-	uuid_pack(&uu, out);
+/*
+ * Generate @n SHA1 hashed UUIDs from @names in the same namespace. The result
+ * is the same as from uuid_generate_sha1() for each name, but the names are
+ * hashed in batches by the multi-buffer SHA1 code.
+ */
+void uuid_generate_sha1_n(uuid_t *out, const uuid_t ns,
+			  const char *const *names, const size_t *lens, size_t n)
+{
+	unsigned char hash[64][UL_SHA1LENGTH];
+	size_t i, j;
+
+	for (i = 0; i < n; i += ARRAY_SIZE(hash)) {
+		size_t nh = min(n - i, ARRAY_SIZE(hash));
+
+		ul_SHA1Multi(hash, nh, ns, sizeof(uuid_t),
+			     (const unsigned char *const *) names + i, lens + i);
+		for (j = 0; j < nh; j++)
+			uuid_from_hash(out[i + j], hash[j], UUID_TYPE_DCE_SHA1);
+	}
 }
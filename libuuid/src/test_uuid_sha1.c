@@ -0,0 +1,78 @@
+/*
+ * test_uuid_sha1.c --- compare uuid_generate_sha1_n() with uuid_generate_sha1()
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c.h"
+#include "uuid.h"
+
+/*
+ * Generate @n UUIDs by one uuid_generate_sha1_n() call and compare them
+ * with uuid_generate_sha1() for every name. The names have different
+ * lengths, so the messages end in different SHA-1 blocks.
+ */
+static int test_count(const uuid_t ns, size_t n)
+{
+	uuid_t *bulk;
+	char **names;
+	size_t *lens, i;
+	int failed = 0;
+
+	bulk = calloc(n ? n : 1, sizeof(uuid_t));
+	names = calloc(n ? n : 1, sizeof(char *));
+	lens = calloc(n ? n : 1, sizeof(size_t));
+	if (!bulk || !names || !lens)
+		err(EXIT_FAILURE, "cannot allocate memory");
+
+	for (i = 0; i < n; i++) {
+		if (asprintf(&names[i], "%zu.%0*zu.example.com",
+			     i, (int) (i % 150), i) < 0)
+			err(EXIT_FAILURE, "cannot allocate memory");
+		lens[i] = strlen(names[i]);
+	}
+
+	uuid_generate_sha1_n(bulk, ns, (const char *const *) names, lens, n);
+
+	for (i = 0; i < n; i++) {
+		uuid_t one;
+
+		uuid_generate_sha1(one, ns, names[i], lens[i]);
+		if (uuid_compare(one, bulk[i]) != 0) {
+			char a[UUID_STR_LEN], b[UUID_STR_LEN];
+
+			uuid_unparse(one, a);
+			uuid_unparse(bulk[i], b);
+			printf("count %zu: name %zu: %s != %s\n", n, i, b, a);
+			failed++;
+		}
+		free(names[i]);
+	}
+	if (!failed)
+		printf("count %zu: OK\n", n);
+
+	free(bulk);
+	free(names);
+	free(lens);
+	return failed;
+}
+
+int main(void)
+{
+	static const size_t counts[] = { 0, 1, 3, 4, 5, 1000 };
+	const uuid_t *ns = uuid_get_template("dns");
+	size_t i;
+	int failed = 0;
+
+	if (!ns)
+		errx(EXIT_FAILURE, "no dns namespace");
+
+	for (i = 0; i < ARRAY_SIZE(counts); i++)
+		failed += test_count(*ns, counts[i]);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
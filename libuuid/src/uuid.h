@@ -94,6 +94,8 @@ extern int uuid_generate_time_safe(uuid_t out);
 
 extern void uuid_generate_md5(uuid_t out, const uuid_t ns, const char *name, size_t len);
 extern void uuid_generate_sha1(uuid_t out, const uuid_t ns, const char *name, size_t len);
+extern void uuid_generate_sha1_n(uuid_t *out, const uuid_t ns,
+				 const char *const *names, const size_t *lens, size_t n);
 
 /* isnull.c */
 extern int uuid_is_null(const uuid_t uu);
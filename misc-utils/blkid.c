@@ -59,6 +59,7 @@ struct blkid_control {
 		lowprobe_superblocks:1,
 		lowprobe_topology:1,
 		no_part_details:1,
+		probe_cache:1,
 		raw_chars:1;
 };
 
@@ -95,6 +96,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(	" -u, --usages <list>        filter by \"usage\" (e.g. -u filesystem,raid)\n"), out);
 	fputs(_(	" -n, --match-types <list>   filter by filesystem type (e.g. -n vfat,ext3)\n"), out);
 	fputs(_(	" -D, --no-part-details      don't print info from partition table\n"), out);
+	fputs(_(	"     --probe-cache          reuse results of the previous probing\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
 	printf(USAGE_HELP_OPTIONS(28));
@@ -668,6 +670,10 @@ int main(int argc, char **argv)
 	unsigned int i;
 	int c;
 
+	enum {
+		OPT_PROBE_CACHE = CHAR_MAX + 1
+	};
+
 	static const struct option longopts[] = {
 		{ "cache-file",	      required_argument, NULL, 'c' },
 		{ "no-encoding",      no_argument,	 NULL, 'd' },
@@ -681,6 +687,7 @@ int main(int argc, char **argv)
 		{ "label",	      required_argument, NULL, 'L' },
 		{ "uuid",	      required_argument, NULL, 'U' },
 		{ "probe",	      no_argument,	 NULL, 'p' },
+		{ "probe-cache",      no_argument,	 NULL, OPT_PROBE_CACHE },
 		{ "info",	      no_argument,	 NULL, 'i' },
 		{ "size",	      required_argument, NULL, 'S' },
 		{ "offset",	      required_argument, NULL, 'O' },
@@ -775,6 +782,9 @@ int main(int argc, char **argv)
 		case 'p':
 			ctl.lowprobe_superblocks = 1;
 			break;
+		case OPT_PROBE_CACHE:
+			ctl.probe_cache = 1;
+			break;
 		case 's':
 			if (numtag + 1 >= sizeof(ctl.show) / sizeof(*ctl.show)) {
 				warnx(_("Too many tags specified"));
@@ -869,6 +879,8 @@ int main(int argc, char **argv)
 		pr = blkid_new_probe();
 		if (!pr)
 			goto exit;
+		if (ctl.probe_cache)
+			blkid_probe_enable_cache(pr, 1);
 
 		if (ctl.lowprobe_superblocks) {
 			blkid_probe_set_superblocks_flags(pr,
@@ -7,16 +7,26 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <libmount.h>
+#include <libsmartcols.h>
 #include <blkid.h>
+#include <pthread.h>
 #include <sys/utsname.h>
 
 #include "nls.h"
 #include "c.h"
 #include "strutils.h"
 #include "xalloc.h"
+#include "monotonic.h"
 
 #include "findmnt.h"
 
+/* on-disk FS type of the source device, probed in advance by --jobs */
+struct verify_probe {
+	char	*devname;
+	char	*fstype;
+	int	ambi;
+};
+
 struct verify_context {
 	struct libmnt_fs	*fs;
 	struct libmnt_table	*tb;
@@ -25,6 +35,15 @@ struct verify_context {
 	size_t	fs_num;
 	size_t  fs_alloc;
 
+	struct verify_probe	*probes;	/* sorted by devname */
+	size_t			nprobes;
+	size_t			next_probe;	/* first unprobed (--jobs) */
+	pthread_mutex_t		probe_lock;
+
+	struct libscols_table	*out;		/* --json report */
+	struct libscols_line	*fs_line;
+	struct libscols_line	*check_line;
+
 	int	nwarnings;
 	int	nerrors;
 
@@ -32,8 +51,35 @@ struct verify_context {
 			no_fsck : 1;
 };
 
+/* --json report columns */
+enum {
+	VFY_COL_TARGET = 0,
+	VFY_COL_SOURCE,
+	VFY_COL_CHECK,
+	VFY_COL_LEVEL,
+	VFY_COL_MESSAGE,
+	VFY_COL_USEC
+};
+
 static void verify_mesg(struct verify_context *vfy, char type, const char *fmt, va_list ap)
 {
+	if (vfy->out) {
+		struct libscols_line *ln;
+		char *msg;
+
+		ln = scols_table_new_line(vfy->out, vfy->check_line);
+		if (!ln)
+			err(EXIT_FAILURE, _("failed to allocate output line"));
+
+		xvasprintf(&msg, fmt, ap);
+		if (scols_line_set_data(ln, VFY_COL_LEVEL,
+				type == 'E' ? "error" :
+				type == 'W' ? "warning" : "ok") ||
+		    scols_line_refer_data(ln, VFY_COL_MESSAGE, msg))
+			err(EXIT_FAILURE, _("failed to add output data"));
+		return;
+	}
+
 	if (!vfy->target_printed) {
 		fprintf(stdout, "%s\n", mnt_fs_get_target(vfy->fs));
 		vfy->target_printed = 1;
@@ -386,6 +432,116 @@ static int read_kernel_filesystems(struct verify_context *vfy)
 	return rc;
 }
 
+static int cmp_probes(const void *a, const void *b)
+{
+	return strcmp(((const struct verify_probe *) a)->devname,
+		      ((const struct verify_probe *) b)->devname);
+}
+
+static struct verify_probe *get_probe(struct verify_context *vfy, const char *devname)
+{
+	struct verify_probe key = { .devname = (char *) devname };
+
+	return bsearch(&key, vfy->probes, vfy->nprobes,
+			sizeof(struct verify_probe), cmp_probes);
+}
+
+static void *probe_worker(void *data)
+{
+	struct verify_context *vfy = data;
+
+	for (;;) {
+		struct verify_probe *pb = NULL;
+
+		pthread_mutex_lock(&vfy->probe_lock);
+		if (vfy->next_probe < vfy->nprobes)
+			pb = &vfy->probes[vfy->next_probe++];
+		pthread_mutex_unlock(&vfy->probe_lock);
+		if (!pb)
+			break;
+
+		/* libmount cache is not thread-safe, probe without it */
+		pb->fstype = mnt_get_fstype(pb->devname, &pb->ambi, NULL);
+	}
+	return NULL;
+}
+
+/*
+ * Probes FS types of all distinct source devices by @njobs threads before the
+ * table is verified, the slow devices are not probed one by one.
+ */
+static void probe_sources(struct verify_context *vfy, size_t njobs)
+{
+	struct libmnt_iter *itr;
+	struct libmnt_fs *fs;
+	pthread_t *threads;
+	size_t i, n;
+
+	itr = mnt_new_iter(MNT_ITER_FORWARD);
+	if (!itr) {
+		warn(_("failed to initialize libmount iterator"));
+		return;
+	}
+	while (mnt_table_next_fs(vfy->tb, itr, &fs) == 0) {
+		const char *src;
+
+		if (mnt_fs_is_pseudofs(fs) || mnt_fs_is_netfs(fs))
+			continue;
+		src = mnt_resolve_spec(mnt_fs_get_source(fs), cache);
+		if (!src)
+			continue;
+
+		vfy->probes = xrealloc(vfy->probes,
+				(vfy->nprobes + 1) * sizeof(struct verify_probe));
+		memset(&vfy->probes[vfy->nprobes], 0, sizeof(struct verify_probe));
+		vfy->probes[vfy->nprobes++].devname = cache ? xstrdup(src) : (char *) src;
+	}
+	mnt_free_iter(itr);
+
+	if (!vfy->nprobes)
+		return;
+
+	/* remove duplicate devices */
+	qsort(vfy->probes, vfy->nprobes, sizeof(struct verify_probe), cmp_probes);
+	for (i = 1, n = 1; i < vfy->nprobes; i++) {
+		if (strcmp(vfy->probes[n - 1].devname, vfy->probes[i].devname) == 0)
+			free(vfy->probes[i].devname);
+		else
+			vfy->probes[n++] = vfy->probes[i];
+	}
+	vfy->nprobes = n;
+
+	njobs = min(njobs, vfy->nprobes);
+	threads = xcalloc(njobs, sizeof(pthread_t));
+	pthread_mutex_init(&vfy->probe_lock, NULL);
+
+	for (i = 0; i < njobs; i++) {
+		errno = pthread_create(&threads[i], NULL, probe_worker, vfy);
+		if (errno) {
+			warn(_("failed to create thread"));
+			break;
+		}
+	}
+	if (i == 0)
+		probe_worker(vfy);
+	while (i > 0)
+		pthread_join(threads[--i], NULL);
+
+	pthread_mutex_destroy(&vfy->probe_lock);
+	free(threads);
+}
+
+static void free_probes(struct verify_context *vfy)
+{
+	size_t i;
+
+	for (i = 0; i < vfy->nprobes; i++) {
+		free(vfy->probes[i].devname);
+		free(vfy->probes[i].fstype);
+	}
+	free(vfy->probes);
+}
+
 static int verify_fstype(struct verify_context *vfy)
 {
 	const char *src = mnt_resolve_spec(mnt_fs_get_source(vfy->fs), cache);
@@ -417,7 +573,16 @@ static int verify_fstype(struct verify_context *vfy)
 		if (!isswap && !isauto && !none && !is_supported_filesystem(vfy, type))
 			verify_warn(vfy, _("%s seems unsupported by the current kernel"), type);
 	}
-	realtype = mnt_get_fstype(src, &ambi, cache);
+	if (vfy->nprobes) {
+		struct verify_probe *pb = get_probe(vfy, src);
+
+		if (pb) {
+			realtype = pb->fstype;
+			ambi = pb->ambi;
+		} else
+			realtype = mnt_get_fstype(src, &ambi, cache);
+	} else
+		realtype = mnt_get_fstype(src, &ambi, cache);
 
 	if (!realtype) {
 		if (isauto)
@@ -452,29 +617,91 @@ static int verify_passno(struct verify_context *vfy)
 	return 0;
 }
 
+/* sets --json report USEC column to time elapsed since @start */
+static void set_usec(struct libscols_line *ln, struct timeval *start)
+{
+	struct timeval now;
+	char *usec;
+
+	gettime_monotonic(&now);
+	xasprintf(&usec, "%llu", (unsigned long long)
+			(now.tv_sec - start->tv_sec) * 1000000
+			+ now.tv_usec - start->tv_usec);
+	if (scols_line_refer_data(ln, VFY_COL_USEC, usec))
+		err(EXIT_FAILURE, _("failed to add output data"));
+}
+
+/* runs @check, for --json adds the check and its duration to the report */
+static int run_check(struct verify_context *vfy, const char *name,
+		     int (*check)(struct verify_context *))
+{
+	struct timeval start;
+	int rc;
+
+	if (vfy->out) {
+		vfy->check_line = scols_table_new_line(vfy->out, vfy->fs_line);
+		if (!vfy->check_line)
+			err(EXIT_FAILURE, _("failed to allocate output line"));
+		if (scols_line_set_data(vfy->check_line, VFY_COL_CHECK, name))
+			err(EXIT_FAILURE, _("failed to add output data"));
+	}
+
+	gettime_monotonic(&start);
+	rc = check(vfy);
+
+	if (vfy->out)
+		set_usec(vfy->check_line, &start);
+	return rc;
+}
+
 static int verify_filesystem(struct verify_context *vfy)
 {
 	int rc = 0;
 
 	if (mnt_fs_is_swaparea(vfy->fs))
-		rc = verify_swaparea(vfy);
+		rc = run_check(vfy, "swaparea", verify_swaparea);
 	else {
-		rc = verify_target(vfy);
+		rc = run_check(vfy, "target", verify_target);
 		if (!rc)
-			rc = verify_options(vfy);
+			rc = run_check(vfy, "options", verify_options);
 	}
 
 	if (!rc)
-		rc = verify_source(vfy);
+		rc = run_check(vfy, "source", verify_source);
 	if (!rc)
-		rc = verify_fstype(vfy);
+		rc = run_check(vfy, "fstype", verify_fstype);
 	if (!rc)
-		rc = verify_passno(vfy);	/* depends on verify_fstype() */
+		rc = run_check(vfy, "passno", verify_passno);	/* depends on verify_fstype() */
 
 	return rc;
 }
 
-int verify_table(struct libmnt_table *tb)
+static struct libscols_table *new_report(void)
+{
+	struct libscols_table *out;
+	struct libscols_column *cl;
+
+	scols_init_debug(0);
+	out = scols_new_table();
+	if (!out)
+		err(EXIT_FAILURE, _("failed to allocate output table"));
+
+	scols_table_enable_json(out, 1);
+	scols_table_set_name(out, "verify");
+
+	if (!scols_table_new_column(out, "TARGET", 0, SCOLS_FL_TREE) ||
+	    !scols_table_new_column(out, "SOURCE", 0, 0) ||
+	    !scols_table_new_column(out, "CHECK", 0, 0) ||
+	    !scols_table_new_column(out, "LEVEL", 0, 0) ||
+	    !scols_table_new_column(out, "MESSAGE", 0, 0) ||
+	    !(cl = scols_table_new_column(out, "USEC", 0, SCOLS_FL_RIGHT)))
+		err(EXIT_FAILURE, _("failed to allocate output column"));
+
+	scols_column_set_json_type(cl, SCOLS_JSON_NUMBER);
+	return out;
+}
+
+int verify_table(struct libmnt_table *tb, size_t njobs)
 {
 	struct verify_context vfy = { .nerrors = 0 };
 	struct libmnt_iter *itr;
@@ -496,15 +723,38 @@ int verify_table(struct libmnt_table *tb)
 		has_read_fs = 1;
 	}
 
+	if (njobs > 1 && is_listall_mode())
+		probe_sources(&vfy, njobs);
+
+	if (flags & FL_JSON)
+		vfy.out = new_report();
+
 	while (rc == 0 && (vfy.fs = get_next_fs(tb, itr))) {
+		struct timeval start;
+
 		vfy.target_printed = 0;
 		vfy.no_fsck = 0;
 
+		if (vfy.out) {
+			vfy.fs_line = scols_table_new_line(vfy.out, NULL);
+			if (!vfy.fs_line)
+				err(EXIT_FAILURE, _("failed to allocate output line"));
+			if (scols_line_set_data(vfy.fs_line, VFY_COL_TARGET,
+						mnt_fs_get_target(vfy.fs)) ||
+			    scols_line_set_data(vfy.fs_line, VFY_COL_SOURCE,
+						mnt_fs_get_source(vfy.fs)))
+				err(EXIT_FAILURE, _("failed to add output data"));
+		}
+		gettime_monotonic(&start);
+
 		if (check_order)
-			rc = verify_order(&vfy);
+			rc = run_check(&vfy, "order", verify_order);
 		if (!rc)
 			rc = verify_filesystem(&vfy);
 
+		if (vfy.out)
+			set_usec(vfy.fs_line, &start);
+
 		if (flags & FL_FIRSTONLY)
 			break;
 		flags |= FL_NOSWAPMATCH;
@@ -512,6 +762,12 @@ int verify_table(struct libmnt_table *tb)
 
 done:
 	mnt_free_iter(itr);
+	free_probes(&vfy);
+
+	if (vfy.out) {
+		scols_print_table(vfy.out);
+		scols_unref_table(vfy.out);
+	}
 
 	/* summary */
 	if (vfy.nerrors || parse_nerrors || vfy.nwarnings) {
@@ -520,7 +776,7 @@ done:
 		fprintf(stderr, P_(", %d error",     ", %d errors", vfy.nerrors), vfy.nerrors);
 		fprintf(stderr, P_(", %d warning",   ", %d warnings", vfy.nwarnings), vfy.nwarnings);
 		fputc('\n', stderr);
-	} else
+	} else if (!vfy.out)
 		fprintf(stdout, _("Success, no errors or warnings detected\n"));
 
 	return rc != 0 ? rc : vfy.nerrors + parse_nerrors;
@@ -1262,6 +1262,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputc('\n', out);
 	fputs(_(" -x, --verify           verify mount table content (default is fstab)\n"), out);
 	fputs(_("     --verbose          print more details\n"), out);
+	fputs(_("     --jobs <num>       probe up to <num> source devices in parallel\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
 	printf(USAGE_HELP_OPTIONS(24));
@@ -1281,6 +1282,7 @@ int main(int argc, char *argv[])
 	char **tabfiles = NULL;
 	int direction = MNT_ITER_FORWARD;
 	int verify = 0;
+	size_t njobs = 1;
 	int c, rc = -1, timeout = -1;
 	int ntabfiles = 0, tabtype = 0;
 	char *outarg = NULL;
@@ -1294,7 +1296,8 @@ int main(int argc, char *argv[])
 		FINDMNT_OPT_TREE,
 		FINDMNT_OPT_OUTPUT_ALL,
 		FINDMNT_OPT_PSEUDO,
-		FINDMNT_OPT_REAL
+		FINDMNT_OPT_REAL,
+		FINDMNT_OPT_JOBS
 	};
 
 	static const struct option longopts[] = {
@@ -1338,13 +1341,14 @@ int main(int argc, char *argv[])
 		{ "tree",	    no_argument,       NULL, FINDMNT_OPT_TREE	 },
 		{ "real",	    no_argument,       NULL, FINDMNT_OPT_REAL	 },
 		{ "pseudo",	    no_argument,       NULL, FINDMNT_OPT_PSEUDO	 },
+		{ "jobs",	    required_argument, NULL, FINDMNT_OPT_JOBS	 },
 		{ NULL, 0, NULL, 0 }
 	};
 
 	static const ul_excl_t excl[] = {	/* rows and cols in ASCII order */
 		{ 'C', 'c'},			/* [no]canonicalize */
 		{ 'C', 'e' },			/* nocanonicalize, evaluate */
-		{ 'J', 'P', 'r','x' },		/* json,pairs,raw,verify */
+		{ 'J', 'P', 'r' },		/* json,pairs,raw */
 		{ 'M', 'T' },			/* mountpoint, target */
 		{ 'N','k','m','s' },		/* task,kernel,mtab,fstab */
 		{ 'P','l','r','x' },		/* pairs,list,raw,verify */
@@ -1512,6 +1516,11 @@ int main(int argc, char *argv[])
 		case FINDMNT_OPT_REAL:
 			flags |= FL_REAL;
 			break;
+		case FINDMNT_OPT_JOBS:
+			njobs = strtou32_or_err(optarg, _("failed to parse number of jobs"));
+			if (!njobs)
+				errx(EXIT_FAILURE, _("failed to parse number of jobs"));
+			break;
 
 		case 'h':
 			usage();
@@ -1621,7 +1630,7 @@ int main(int argc, char *argv[])
 		mnt_table_uniq_fs(tb, MNT_UNIQ_KEEPTREE, uniq_fs_target_cmp);
 
 	if (verify) {
-		rc = verify_table(tb);
+		rc = verify_table(tb, njobs);
 		goto leave;
 	}
 
@@ -53,6 +53,9 @@
 #include <pwd.h>
 #include <signal.h>
 #include <sys/uio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
 
 #include "all-io.h"
 #include "c.h"
@@ -100,7 +103,17 @@ enum {
 	OPT_ID,
 	OPT_STRUCTURED_DATA_ID,
 	OPT_STRUCTURED_DATA_PARAM,
-	OPT_OCTET_COUNT
+	OPT_OCTET_COUNT,
+	OPT_BATCH,
+	OPT_QUEUE,
+	OPT_QUEUE_OVERFLOW
+};
+
+/* --queue-overflow policies */
+enum {
+	QUEUE_BLOCK = 0,
+	QUEUE_DROP_OLDEST,
+	QUEUE_DROP_NEWEST
 };
 
 /* rfc5424 structured data */
@@ -123,6 +136,9 @@ struct logger_ctl {
 	char *port;
 	int socket_type;
 	size_t max_message_size;
+	size_t batch;			/* --batch <num>, zero when unwanted */
+	size_t queue;			/* --queue <num>, zero when unwanted */
+	int queue_overflow;		/* --queue-overflow QUEUE_* policy */
 	struct list_head user_sds;	/* user defined rfc5424 structured data */
 	struct list_head reserved_sds;	/* standard rfc5424 structured data */
 
@@ -137,7 +153,8 @@ struct logger_ctl {
 			rfc5424_tq:1,		/* include time quality markup */
 			rfc5424_host:1,		/* include hostname */
 			skip_empty_lines:1,	/* do not send empty lines when processing files */
-			octet_count:1;		/* use RFC6587 octet counting */
+			octet_count:1,		/* use RFC6587 octet counting */
+			async:1;		/* don't exit on connection errors (--queue) */
 };
 
 #define is_connected(_ctl)	((_ctl)->fd >= 0)
@@ -269,10 +286,10 @@ static int unix_socket(struct logger_ctl *ctl, const char *path, int *socket_typ
 	}
 
 	if (i == 0) {
-		if (ctl->unix_socket_errors)
+		if (ctl->unix_socket_errors && !ctl->async)
 			err(EXIT_FAILURE, _("socket %s"), path);
 
-		/* write_output() will try to reconnect */
+		/* write_output() or the queue sender will try to reconnect */
 		return -1;
 	}
 
@@ -282,7 +299,46 @@ static int unix_socket(struct logger_ctl *ctl, const char *path, int *socket_typ
 	return fd;
 }
 
-static int inet_socket(const char *servername, const char *port, int *socket_type)
+/*
+ * connect() with timeout for --queue, the sender thread should not wait for
+ * an unreachable server for minutes
+ */
+static int connect_timeout(int fd, const struct sockaddr *addr, socklen_t len,
+			   int timeout)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+	int flags, rc;
+
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		return connect(fd, addr, len);
+
+	rc = connect(fd, addr, len);
+	if (rc < 0 && errno == EINPROGRESS) {
+		rc = poll(&pfd, 1, timeout);
+		if (rc == 0) {
+			errno = ETIMEDOUT;
+			rc = -1;
+		} else if (rc > 0) {
+			int error = 0;
+			socklen_t sz = sizeof(error);
+
+			rc = getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &sz);
+			if (rc == 0 && error) {
+				errno = error;
+				rc = -1;
+			}
+		}
+	}
+
+	fcntl(fd, F_SETFL, flags);
+	return rc;
+}
+
+#define LOGGER_CONNECT_TIMEOUT	5000	/* msec */
+
+static int inet_socket(const struct logger_ctl *ctl, const char *servername,
+		       const char *port, int *socket_type)
 {
 	int fd, errcode, i, type = -1;
 	struct addrinfo hints, *res;
@@ -306,14 +362,19 @@ static int inet_socket(const char *servername, const char *port, int *socket_typ
 			continue;
 		hints.ai_family = AF_UNSPEC;
 		errcode = getaddrinfo(servername, p, &hints, &res);
-		if (errcode != 0)
+		if (errcode != 0) {
+			if (ctl->async)
+				return -1;	/* the queue sender will try it later */
 			errx(EXIT_FAILURE, _("failed to resolve name %s port %s: %s"),
 			     servername, p, gai_strerror(errcode));
+		}
 		if ((fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol)) == -1) {
 			freeaddrinfo(res);
 			continue;
 		}
-		if (connect(fd, res->ai_addr, res->ai_addrlen) == -1) {
+		if ((ctl->async ? connect_timeout(fd, res->ai_addr, res->ai_addrlen,
+						  LOGGER_CONNECT_TIMEOUT) :
+				  connect(fd, res->ai_addr, res->ai_addrlen)) == -1) {
 			freeaddrinfo(res);
 			close(fd);
 			continue;
@@ -323,8 +384,11 @@ static int inet_socket(const char *servername, const char *port, int *socket_typ
 		break;
 	}
 
-	if (i == 0)
+	if (i == 0) {
+		if (ctl->async)
+			return -1;	/* the queue sender will try it later */
 		errx(EXIT_FAILURE, _("failed to connect to %s port %s"), servername, p);
+	}
 
 	/* replace ALL_TYPES with the real TYPE_* */
 	if (type > 0 && type != *socket_type)
@@ -443,6 +507,42 @@ static char const *rfc3164_current_time(void)
 #define iovec_memcmp(ary, idx, str, len)		\
 		memcmp((ary)[(idx) - 1].iov_base, str, len)
 
+#ifdef SCM_CREDENTIALS
+union logger_cred {
+	struct cmsghdr cmh;
+	char   control[CMSG_SPACE(sizeof(struct ucred))];
+};
+
+/* syslog/journald may follow local socket credentials rather
+ * than in the message PID. If we use --id as root than we can
+ * force kernel to accept another valid PID than the real logger(1)
+ * PID.
+ */
+static int want_credentials(const struct logger_ctl *ctl)
+{
+	return ctl->pid && !ctl->server && ctl->pid != getpid()
+	       && geteuid() == 0 && kill(ctl->pid, 0) == 0;
+}
+
+static void set_credentials(const struct logger_ctl *ctl,
+			    struct msghdr *message, union logger_cred *cbuf)
+{
+	struct cmsghdr *cmhp;
+	struct ucred *cred;
+
+	message->msg_control = cbuf->control;
+	message->msg_controllen = CMSG_SPACE(sizeof(struct ucred));
+
+	cmhp = CMSG_FIRSTHDR(message);
+	cmhp->cmsg_len = CMSG_LEN(sizeof(struct ucred));
+	cmhp->cmsg_level = SOL_SOCKET;
+	cmhp->cmsg_type = SCM_CREDENTIALS;
+	cred = (struct ucred *) CMSG_DATA(cmhp);
+
+	cred->pid = ctl->pid;
+}
+#endif
+
 /* writes generated buffer to desired destination. For TCP syslog,
  * we use RFC6587 octet-stuffing (unless octet-counting is selected).
  * This is not great, but doing full blown RFC5425 (TLS) looks like
@@ -474,12 +574,7 @@ static void write_output(struct logger_ctl *ctl, const char *const msg)
 	if (!ctl->noact && is_connected(ctl)) {
 		struct msghdr message = { 0 };
 #ifdef SCM_CREDENTIALS
-		struct cmsghdr *cmhp;
-		struct ucred *cred;
-		union {
-			struct cmsghdr cmh;
-			char   control[CMSG_SPACE(sizeof(struct ucred))];
-		} cbuf;
+		union logger_cred cbuf;
 #endif
 
 		/* 4) add extra \n to make sure message is terminated */
@@ -490,25 +585,8 @@ static void write_output(struct logger_ctl *ctl, const char *const msg)
 		message.msg_iovlen = iovlen;
 
 #ifdef SCM_CREDENTIALS
-		/* syslog/journald may follow local socket credentials rather
-		 * than in the message PID. If we use --id as root than we can
-		 * force kernel to accept another valid PID than the real logger(1)
-		 * PID.
-		 */
-		if (ctl->pid && !ctl->server && ctl->pid != getpid()
-		    && geteuid() == 0 && kill(ctl->pid, 0) == 0) {
-
-			message.msg_control = cbuf.control;
-			message.msg_controllen = CMSG_SPACE(sizeof(struct ucred));
-
-			cmhp = CMSG_FIRSTHDR(&message);
-			cmhp->cmsg_len = CMSG_LEN(sizeof(struct ucred));
-			cmhp->cmsg_level = SOL_SOCKET;
-			cmhp->cmsg_type = SCM_CREDENTIALS;
-			cred = (struct ucred *) CMSG_DATA(cmhp);
-
-			cred->pid = ctl->pid;
-		}
+		if (want_credentials(ctl))
+			set_credentials(ctl, &message, &cbuf);
 #endif
 		/* Note that logger(1) maybe executed for long time (as pipe
 		 * reader) and connection endpoint (syslogd) may be restarted.
@@ -883,6 +961,17 @@ static int parse_unix_socket_errors_flags(char *s)
 	return AF_UNIX_ERRORS_AUTO;
 }
 
+static int parse_queue_overflow(const char *s)
+{
+	if (!strcmp(s, "block"))
+		return QUEUE_BLOCK;
+	if (!strcmp(s, "drop-oldest"))
+		return QUEUE_DROP_OLDEST;
+	if (!strcmp(s, "drop-newest"))
+		return QUEUE_DROP_NEWEST;
+	errx(EXIT_FAILURE, _("unsupported queue overflow policy: %s"), s);
+}
+
 static void syslog_local_header(struct logger_ctl *const ctl)
 {
 	char pid[32];
@@ -907,7 +996,7 @@ static void generate_syslog_header(struct logger_ctl *const ctl)
 static void __logger_open(struct logger_ctl *ctl)
 {
 	if (ctl->server) {
-		ctl->fd = inet_socket(ctl->server, ctl->port, &ctl->socket_type);
+		ctl->fd = inet_socket(ctl, ctl->server, ctl->port, &ctl->socket_type);
 	} else {
 		if (!ctl->unix_socket)
 			ctl->unix_socket = _PATH_DEVLOG;
@@ -1039,6 +1128,717 @@ static void logger_stdin(struct logger_ctl *ctl)
 	free(buf);
 }
 
+/*
+ * --batch mode for stdin
+ *
+ * The input is read by large blocks and split to lines by memchr(). The
+ * header is generated once per second and priority and up to ctl->batch
+ * messages are sent by one sendmmsg() (datagram sockets) or one sendmsg()
+ * (stream sockets).
+ */
+#define LOGGER_BATCH_BUFSZ	(64 * 1024)
+#define LOGGER_NPRIS		192		/* valid RFC PRI values */
+
+struct logger_msg {
+	const char	*hdr;
+	size_t		hdrsz;
+	const char	*data;		/* not terminated */
+	size_t		datasz;
+	char		octet[24];	/* RFC6587 octet count */
+	int		octetsz;
+};
+
+struct logger_batch {
+	struct logger_msg	*msgs;
+	size_t			nmsgs;
+
+	struct iovec		*iov;		/* 4 per message */
+	struct mmsghdr		*mmsg;
+
+	struct {
+		time_t		sec;
+		char		*str;
+		size_t		len;
+	} hdrs[LOGGER_NPRIS];			/* cached headers */
+
+	struct logger_queue	*queue;		/* --queue, sender thread */
+
+	uintmax_t		sent;
+	uintmax_t		dropped;
+};
+
+/*
+ * --queue, messages are copied to the ring buffer and sent by a separate
+ * thread, so the reader does not wait for the remote server. If the
+ * connection is lost the sender reconnects with exponential backoff and the
+ * reader blocks or drops messages (according to --queue-overflow) when the
+ * buffer is full.
+ */
+#define LOGGER_QUEUE_BACKOFF_MIN	100000		/* usec */
+#define LOGGER_QUEUE_BACKOFF_MAX	10000000	/* usec */
+#define LOGGER_QUEUE_DRAIN		10000000	/* usec, after EOF */
+
+struct logger_qslot {
+	struct logger_msg	msg;		/* refers to buf */
+	char			*buf;
+	size_t			bufsz;
+};
+
+struct logger_queue {
+	struct logger_qslot	*slots;
+	size_t			size;
+	size_t			head;
+	size_t			count;
+
+	int			policy;		/* QUEUE_* */
+	unsigned int		eof : 1;	/* no more messages */
+
+	pthread_mutex_t		lock;
+	pthread_cond_t		not_empty;
+	pthread_cond_t		not_full;
+	pthread_t		sender;
+	struct logger_ctl	*ctl;
+
+	uintmax_t		sent;		/* sender only */
+	uintmax_t		dropped;
+};
+
+/* returns number of iovecs used for @m */
+static int batch_msg_to_iovec(struct logger_msg *m, struct iovec *iov, int eol)
+{
+	int n = 0;
+
+	if (m->octetsz) {
+		iov[n].iov_base = m->octet;
+		iov[n++].iov_len = m->octetsz;
+	}
+	iov[n].iov_base = (void *) m->hdr;
+	iov[n++].iov_len = m->hdrsz;
+	iov[n].iov_base = (void *) m->data;
+	iov[n++].iov_len = m->datasz;
+
+	if (eol) {
+		iov[n].iov_base = (void *) "\n";
+		iov[n++].iov_len = 1;
+	}
+	return n;
+}
+
+#ifdef HAVE_SENDMMSG
+static size_t batch_send_dgram(struct logger_ctl *ctl, struct logger_batch *b,
+			       size_t first, struct msghdr *tmpl)
+{
+	size_t i, done = first;
+
+	for (i = first; i < b->nmsgs; i++) {
+		struct msghdr *h = &b->mmsg[i].msg_hdr;
+
+		*h = *tmpl;
+		h->msg_iov = &b->iov[i * 4];
+		h->msg_iovlen = batch_msg_to_iovec(&b->msgs[i], h->msg_iov, 0);
+	}
+
+	while (done < b->nmsgs) {
+		int rc = sendmmsg(ctl->fd, &b->mmsg[done], b->nmsgs - done, MSG_NOSIGNAL);
+		if (rc <= 0) {
+			if (rc < 0 && errno == EINTR)
+				continue;
+			break;
+		}
+		done += rc;
+	}
+	return done;
+}
+#else
+static size_t batch_send_dgram(struct logger_ctl *ctl, struct logger_batch *b,
+			       size_t first, struct msghdr *tmpl)
+{
+	size_t done;
+
+	for (done = first; done < b->nmsgs; done++) {
+		struct msghdr h = *tmpl;
+
+		h.msg_iov = b->iov;
+		h.msg_iovlen = batch_msg_to_iovec(&b->msgs[done], b->iov, 0);
+		if (sendmsg(ctl->fd, &h, MSG_NOSIGNAL) < 0)
+			break;
+	}
+	return done;
+}
+#endif
+
+/* returns number of completely written messages */
+static size_t batch_send_stream(struct logger_ctl *ctl, struct logger_batch *b,
+				size_t first, struct msghdr *tmpl)
+{
+	struct iovec *iov = b->iov;
+	size_t i, written = 0, done;
+	int n = 0;
+
+	for (i = first; i < b->nmsgs; i++)
+		n += batch_msg_to_iovec(&b->msgs[i], &b->iov[n], !ctl->octet_count);
+
+	while (n > 0) {
+		struct msghdr h = *tmpl;
+		ssize_t rc;
+
+		h.msg_iov = iov;
+		h.msg_iovlen = min(n, IOV_MAX);
+
+		rc = sendmsg(ctl->fd, &h, MSG_NOSIGNAL);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		written += rc;
+
+		/* skip written iovecs */
+		while (n > 0 && (size_t) rc >= iov->iov_len) {
+			rc -= iov->iov_len;
+			iov++;
+			n--;
+		}
+		if (n > 0 && rc) {
+			iov->iov_base = (char *) iov->iov_base + rc;
+			iov->iov_len -= rc;
+		}
+	}
+
+	/* convert written bytes to messages */
+	for (done = first; done < b->nmsgs; done++) {
+		struct logger_msg *m = &b->msgs[done];
+		size_t sz = m->octetsz + m->hdrsz + m->datasz + !ctl->octet_count;
+
+		if (written < sz)
+			break;
+		written -= sz;
+	}
+	return done;
+}
+
+/* --stderr, writes messages from @first to @last (exclusive) of the batch */
+static void batch_echo(struct logger_batch *b, size_t first, size_t last)
+{
+	size_t i;
+
+	for (i = first; i < last; i++) {
+		int x = batch_msg_to_iovec(&b->msgs[i], b->iov, 1);
+		ignore_result( writev(STDERR_FILENO, b->iov, x) );
+	}
+}
+
+static void queue_push(struct logger_queue *q, const struct logger_msg *m)
+{
+	struct logger_qslot *s;
+	size_t sz = m->hdrsz + m->datasz;
+
+	pthread_mutex_lock(&q->lock);
+
+	if (q->count == q->size) {
+		switch (q->policy) {
+		case QUEUE_BLOCK:
+			while (q->count == q->size)
+				pthread_cond_wait(&q->not_full, &q->lock);
+			break;
+		case QUEUE_DROP_OLDEST:
+			q->head = (q->head + 1) % q->size;
+			q->count--;
+			q->dropped++;
+			break;
+		case QUEUE_DROP_NEWEST:
+			q->dropped++;
+			pthread_mutex_unlock(&q->lock);
+			return;
+		}
+	}
+
+	s = &q->slots[(q->head + q->count) % q->size];
+	if (s->bufsz < sz) {
+		s->buf = xrealloc(s->buf, sz);
+		s->bufsz = sz;
+	}
+	memcpy(s->buf, m->hdr, m->hdrsz);
+	memcpy(s->buf + m->hdrsz, m->data, m->datasz);
+
+	s->msg = *m;
+	s->msg.hdr = s->buf;
+	s->msg.data = s->buf + m->hdrsz;
+
+	q->count++;
+	pthread_cond_signal(&q->not_empty);
+	pthread_mutex_unlock(&q->lock);
+}
+
+/*
+ * Moves up to @max messages from the queue to @slots. The buffers are swapped,
+ * so the queue reuses the buffers of the already sent messages. Returns 0 on
+ * EOF.
+ */
+static size_t queue_get(struct logger_queue *q, struct logger_qslot *slots, size_t max)
+{
+	size_t i, n;
+
+	pthread_mutex_lock(&q->lock);
+	while (!q->count && !q->eof)
+		pthread_cond_wait(&q->not_empty, &q->lock);
+
+	n = min(q->count, max);
+	for (i = 0; i < n; i++) {
+		struct logger_qslot tmp = slots[i];
+
+		slots[i] = q->slots[q->head];
+		q->slots[q->head] = tmp;
+		q->head = (q->head + 1) % q->size;
+	}
+	q->count -= n;
+
+	pthread_cond_broadcast(&q->not_full);
+	pthread_mutex_unlock(&q->lock);
+	return n;
+}
+
+static int queue_is_eof(struct logger_queue *q)
+{
+	int eof;
+
+	pthread_mutex_lock(&q->lock);
+	eof = q->eof;
+	pthread_mutex_unlock(&q->lock);
+	return eof;
+}
+
+/* drops @n messages hold by sender and all messages still in the queue */
+static void queue_discard(struct logger_queue *q, size_t n)
+{
+	pthread_mutex_lock(&q->lock);
+	q->dropped += n + q->count;
+	q->count = 0;
+	pthread_cond_broadcast(&q->not_full);
+	pthread_mutex_unlock(&q->lock);
+}
+
+/* the message has been rejected by the sender */
+static void queue_drop(struct logger_queue *q)
+{
+	pthread_mutex_lock(&q->lock);
+	q->dropped++;
+	pthread_mutex_unlock(&q->lock);
+}
+
+/* returns 1 if send error @errsv is probably caused by the connection */
+static int is_connection_error(int errsv)
+{
+	switch (errsv) {
+	case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+	case EWOULDBLOCK:
+#endif
+	case ENOBUFS:
+	case EPIPE:
+	case ECONNREFUSED:
+	case ECONNRESET:
+	case ECONNABORTED:
+	case ENOTCONN:
+	case ENETDOWN:
+	case ENETUNREACH:
+	case EHOSTUNREACH:
+	case ETIMEDOUT:
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * The first write to the closed TCP connection does not fail, check the peer
+ * is still there. Syslog servers don't send anything, so readable socket means
+ * EOF or error.
+ */
+static int stream_is_alive(const struct logger_ctl *ctl)
+{
+	struct pollfd pfd = { .fd = ctl->fd, .events = POLLIN };
+
+	if (ctl->socket_type != TYPE_TCP)
+		return 1;
+	return poll(&pfd, 1, 0) == 0;
+}
+
+static void *queue_sender(void *data)
+{
+	struct logger_queue *q = data;
+	struct logger_ctl *ctl = q->ctl;
+	struct logger_batch *b = xcalloc(1, sizeof(*b));
+	struct logger_qslot *slots;
+	struct msghdr tmpl = { 0 };
+	unsigned long delay = 0, drain = 0;
+	int outage = 0, stop = 0;
+	size_t i, n;
+#ifdef SCM_CREDENTIALS
+	union logger_cred cbuf;
+
+	if (want_credentials(ctl))
+		set_credentials(ctl, &tmpl, &cbuf);
+#endif
+	slots = xcalloc(ctl->batch, sizeof(struct logger_qslot));
+	b->msgs = xcalloc(ctl->batch, sizeof(struct logger_msg));
+	b->iov = xcalloc(ctl->batch * 4, sizeof(struct iovec));
+#ifdef HAVE_SENDMMSG
+	b->mmsg = xcalloc(ctl->batch, sizeof(struct mmsghdr));
+#endif
+
+	while (!stop && (n = queue_get(q, slots, ctl->batch)) > 0) {
+		size_t done = 0;
+		int retry = 1;
+
+		for (i = 0; i < n; i++)
+			b->msgs[i] = slots[i].msg;
+		b->nmsgs = n;
+
+		if (ctl->noact && ctl->stderr_printout)
+			batch_echo(b, 0, n);
+
+		while (!ctl->noact && done < n) {
+			if (!is_connected(ctl) || !stream_is_alive(ctl))
+				logger_reopen(ctl);
+			if (is_connected(ctl)) {
+				size_t x;
+				int errsv;
+
+				if (ctl->socket_type == TYPE_TCP)
+					x = batch_send_stream(ctl, b, done, &tmpl);
+				else
+					x = batch_send_dgram(ctl, b, done, &tmpl);
+				errsv = errno;
+
+				/* echo only the messages really sent, not the dropped ones */
+				if (ctl->stderr_printout)
+					batch_echo(b, done, x);
+				q->sent += x - done;
+				if (x > done)
+					retry = 1;
+				done = x;
+				if (done == n)
+					break;
+
+				if (retry == 0 && !is_connection_error(errsv)) {
+					/* rejected also by the new connection (e.g. too
+					 * long datagram), drop the message and continue */
+					errno = errsv;
+					warn(_("send message failed"));
+					queue_drop(q);
+					done++;
+					retry = 1;
+					continue;
+				}
+
+				/* reconnect and send the rest again, see write_output() */
+				close(ctl->fd);
+				ctl->fd = -1;
+				if (retry > 0) {
+					retry--;
+					continue;
+				}
+			}
+
+			if (!outage)
+				warnx(_("cannot send messages to %s, queueing"),
+				      ctl->server ? ctl->server : ctl->unix_socket);
+			outage = 1;
+
+			if (drain >= LOGGER_QUEUE_DRAIN) {
+				/* EOF and still disconnected, give up */
+				queue_discard(q, n - done);
+				stop = 1;
+				break;
+			}
+
+			delay = delay ? min(delay * 2, (unsigned long) LOGGER_QUEUE_BACKOFF_MAX)
+				      : LOGGER_QUEUE_BACKOFF_MIN;
+			xusleep(delay);
+			if (queue_is_eof(q))
+				drain += delay;
+		}
+
+		if (!stop && outage) {
+			warnx(_("connection to %s restored"),
+			      ctl->server ? ctl->server : ctl->unix_socket);
+			outage = 0;
+			delay = 0;
+		}
+	}
+
+	for (i = 0; i < ctl->batch; i++)
+		free(slots[i].buf);
+	free(slots);
+	free(b->msgs);
+	free(b->iov);
+	free(b->mmsg);
+	free(b);
+	return NULL;
+}
+
+static void queue_start(struct logger_ctl *ctl, struct logger_batch *b)
+{
+	struct logger_queue *q = xcalloc(1, sizeof(*q));
+
+	q->slots = xcalloc(ctl->queue, sizeof(struct logger_qslot));
+	q->size = ctl->queue;
+	q->policy = ctl->queue_overflow;
+
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_cond_init(&q->not_empty, NULL);
+	pthread_cond_init(&q->not_full, NULL);
+
+	q->ctl = ctl;
+
+	b->queue = q;
+	if (pthread_create(&q->sender, NULL, queue_sender, q) != 0)
+		err(EXIT_FAILURE, _("failed to create thread"));
+}
+
+/* waits for the sender, the counters are copied to @b */
+static void queue_finish(struct logger_batch *b)
+{
+	struct logger_queue *q = b->queue;
+	size_t i;
+
+	pthread_mutex_lock(&q->lock);
+	q->eof = 1;
+	pthread_cond_signal(&q->not_empty);
+	pthread_mutex_unlock(&q->lock);
+
+	pthread_join(q->sender, NULL);
+
+	b->sent = q->sent;
+	b->dropped = q->dropped;
+
+	for (i = 0; i < q->size; i++)
+		free(q->slots[i].buf);
+	free(q->slots);
+	pthread_mutex_destroy(&q->lock);
+	pthread_cond_destroy(&q->not_empty);
+	pthread_cond_destroy(&q->not_full);
+	free(q);
+
+	b->queue = NULL;
+}
+
+static void batch_flush(struct logger_ctl *ctl, struct logger_batch *b)
+{
+	size_t i;
+
+	if (!b->nmsgs)
+		return;
+
+	if (b->queue) {
+		for (i = 0; i < b->nmsgs; i++)
+			queue_push(b->queue, &b->msgs[i]);
+	} else if (!ctl->noact) {
+		struct msghdr tmpl = { 0 };
+		size_t done = 0;
+		int retry = 1;
+#ifdef SCM_CREDENTIALS
+		union logger_cred cbuf;
+
+		if (want_credentials(ctl))
+			set_credentials(ctl, &tmpl, &cbuf);
+#endif
+		/* initial connect failed? */
+		if (!is_connected(ctl))
+			logger_reopen(ctl);
+
+		while (done < b->nmsgs && is_connected(ctl)) {
+			size_t x;
+
+			if (ctl->socket_type == TYPE_TCP)
+				x = batch_send_stream(ctl, b, done, &tmpl);
+			else
+				x = batch_send_dgram(ctl, b, done, &tmpl);
+
+			b->sent += x - done;
+			if (x > done)
+				retry = 1;
+			done = x;
+			if (done == b->nmsgs)
+				break;
+
+			if (retry > 0) {
+				/* reconnect and send the rest again, see write_output() */
+				retry--;
+				logger_reopen(ctl);
+				continue;
+			}
+
+			/* rejected also by the new connection (e.g. too long
+			 * datagram), drop the message and continue */
+			warn(_("send message failed"));
+			b->dropped++;
+			done++;
+			retry = 1;
+		}
+
+		if (done < b->nmsgs) {
+			warn(_("send message failed"));
+			b->dropped += b->nmsgs - done;
+		}
+	}
+
+	/* with --queue the messages are echoed by the sender */
+	if (ctl->stderr_printout && !b->queue)
+		batch_echo(b, 0, b->nmsgs);
+
+	b->nmsgs = 0;
+}
+
+static const char *batch_get_header(struct logger_ctl *ctl,
+				    struct logger_batch *b, size_t *len)
+{
+	struct timeval tv;
+	int pri = ctl->pri < LOGGER_NPRIS ? ctl->pri : 0;
+
+	logger_gettimeofday(&tv, NULL);
+
+	if (!b->hdrs[pri].str || b->hdrs[pri].sec != tv.tv_sec) {
+		/* the pending messages may use the old header */
+		batch_flush(ctl, b);
+
+		generate_syslog_header(ctl);
+		free(b->hdrs[pri].str);
+		b->hdrs[pri].str = xstrdup(ctl->hdr);
+		b->hdrs[pri].len = strlen(ctl->hdr);
+		b->hdrs[pri].sec = tv.tv_sec;
+	}
+
+	*len = b->hdrs[pri].len;
+	return b->hdrs[pri].str;
+}
+
+static void batch_add(struct logger_ctl *ctl, struct logger_batch *b,
+		      const char *hdr, size_t hdrsz, const char *data, size_t datasz)
+{
+	struct logger_msg *m = &b->msgs[b->nmsgs++];
+
+	m->hdr = hdr;
+	m->hdrsz = hdrsz;
+	m->data = data;
+	m->datasz = datasz;
+	m->octetsz = ctl->octet_count ?
+		snprintf(m->octet, sizeof(m->octet), "%zu ", hdrsz + datasz) : 0;
+
+	if (b->nmsgs == ctl->batch)
+		batch_flush(ctl, b);
+}
+
+/* parses "<pri>" prefix, returns size of the prefix or 0 */
+static size_t batch_parse_prefix(struct logger_ctl *ctl, const char *p,
+				 const char *end, int default_priority)
+{
+	const char *x = p + 1;
+	int pri = 0;
+
+	while (x < end && isdigit((unsigned char) *x) && pri <= 191)
+		pri = pri * 10 + *x++ - '0';
+
+	if (x < end && *x == '>' && x > p + 1 && pri <= 191) {
+		if (pri < 8)	/* kern facility is forbidden */
+			pri |= 8;
+		ctl->pri = pri;
+		return x + 1 - p;
+	}
+	ctl->pri = default_priority;
+	return 0;
+}
+
+static void logger_stdin_batch(struct logger_ctl *ctl)
+{
+	struct logger_batch b = { .nmsgs = 0 };
+	size_t bufsz = LOGGER_BATCH_BUFSZ + ctl->max_message_size;
+	char *buf = xmalloc(bufsz);
+	int default_priority = ctl->pri;
+	int eof = 0, line_start = 1;
+	size_t len = 0, i;
+
+	b.msgs = xcalloc(ctl->batch, sizeof(struct logger_msg));
+	b.iov = xcalloc(ctl->batch * 4, sizeof(struct iovec));
+#ifdef HAVE_SENDMMSG
+	b.mmsg = xcalloc(ctl->batch, sizeof(struct mmsghdr));
+#endif
+	if (ctl->queue)
+		queue_start(ctl, &b);
+
+	while (!eof || len) {
+		char *p = buf, *end;
+
+		if (!eof && len < bufsz) {
+			ssize_t rc = read(STDIN_FILENO, buf + len, bufsz - len);
+
+			if (rc < 0) {
+				if (errno == EINTR || errno == EAGAIN)
+					continue;
+				err(EXIT_FAILURE, _("read failed"));
+			}
+			if (rc == 0)
+				eof = 1;
+			len += rc;
+		}
+		end = buf + len;
+
+		while (p < end) {
+			char *nl = memchr(p, '\n', end - p);
+			const char *hdr;
+			size_t hdrsz, max, sz;
+
+			/* incomplete line, read more */
+			if (!nl && !eof && (size_t) (end - p) <= ctl->max_message_size)
+				break;
+
+			if (line_start && ctl->prio_prefix && *p == '<')
+				p += batch_parse_prefix(ctl, p, nl ? nl : end,
+							default_priority);
+
+			hdr = batch_get_header(ctl, &b, &hdrsz);
+			max = ctl->max_message_size > hdrsz ?
+				ctl->max_message_size - hdrsz : 1;
+
+			sz = (nl ? (size_t) (nl - p) : (size_t) (end - p));
+			if (sz > max) {
+				/* too long, the rest is the next message */
+				sz = max;
+				nl = NULL;
+			}
+
+			if (sz > 0 || !ctl->skip_empty_lines)
+				batch_add(ctl, &b, hdr, hdrsz, p, sz);
+
+			p += sz;
+			line_start = 0;
+			if (nl) {
+				p++;		/* discard line terminator */
+				line_start = 1;
+			}
+		}
+
+		/* the messages refer to the buffer */
+		batch_flush(ctl, &b);
+
+		len = end - p;
+		if (len && p != buf)
+			memmove(buf, p, len);
+	}
+
+	if (b.queue)
+		queue_finish(&b);
+	if (b.dropped)
+		warnx(_("%ju messages sent, %ju dropped"), b.sent, b.dropped);
+
+	for (i = 0; i < ARRAY_SIZE(b.hdrs); i++)
+		free(b.hdrs[i].str);
+	free(b.msgs);
+	free(b.iov);
+	free(b.mmsg);
+	free(buf);
+}
+
 static void logger_close(const struct logger_ctl *ctl)
 {
 	if (ctl->fd != -1 && close(ctl->fd) != 0)
@@ -1064,6 +1864,11 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -p, --priority <prio>    mark given message with this priority\n"), out);
 	fputs(_("     --octet-count        use rfc6587 octet counting\n"), out);
 	fputs(_("     --prio-prefix        look for a prefix on every line read from stdin\n"), out);
+	fputs(_("     --batch[=<num>]      send up to <num> lines read from stdin at once\n"), out);
+	fputs(_("     --queue <num>        queue up to <num> lines for a sender thread\n"), out);
+	fputs(_("     --queue-overflow <policy>\n"
+		"                          what to do if the queue is full;\n"
+		"                            <policy> can be block, drop-oldest or drop-newest\n"), out);
 	fputs(_(" -s, --stderr             output message to standard error as well\n"), out);
 	fputs(_(" -S, --size <size>        maximum size for a single message\n"), out);
 	fputs(_(" -t, --tag <tag>          mark every line with this tag\n"), out);
@@ -1141,6 +1946,9 @@ int main(int argc, char **argv)
 		{ "help",	   no_argument,	      0, 'h'		   },
 		{ "octet-count",   no_argument,	      0, OPT_OCTET_COUNT   },
 		{ "prio-prefix",   no_argument,	      0, OPT_PRIO_PREFIX   },
+		{ "batch",	   optional_argument, 0, OPT_BATCH	   },
+		{ "queue",	   required_argument, 0, OPT_QUEUE	   },
+		{ "queue-overflow", required_argument, 0, OPT_QUEUE_OVERFLOW },
 		{ "rfc3164",	   no_argument,	      0, OPT_RFC3164	   },
 		{ "rfc5424",	   optional_argument, 0, OPT_RFC5424	   },
 		{ "size",	   required_argument, 0, 'S'		   },
@@ -1220,6 +2028,26 @@ int main(int argc, char **argv)
 		case OPT_PRIO_PREFIX:
 			ctl.prio_prefix = 1;
 			break;
+		case OPT_BATCH:
+			ctl.batch = 256;
+			if (optarg) {
+				const char *p = optarg;
+
+				if (*p == '=')
+					p++;
+				ctl.batch = strtou32_or_err(p, _("failed to parse batch size"));
+				if (!ctl.batch || ctl.batch > IOV_MAX)
+					errx(EXIT_FAILURE, _("batch size out of range: %s"), p);
+			}
+			break;
+		case OPT_QUEUE:
+			ctl.queue = strtou32_or_err(optarg, _("failed to parse queue size"));
+			if (!ctl.queue)
+				errx(EXIT_FAILURE, _("queue size out of range: %s"), optarg);
+			break;
+		case OPT_QUEUE_OVERFLOW:
+			ctl.queue_overflow = parse_queue_overflow(optarg);
+			break;
 		case OPT_RFC3164:
 			ctl.syslogfp = syslog_rfc3164_header;
 			break;
@@ -1288,6 +2116,13 @@ int main(int argc, char **argv)
 	if (has_structured_data_id(get_user_structured_data(&ctl), "timeQuality"))
 		ctl.rfc5424_tq = 0;
 
+	/* --queue is implemented on top of --batch */
+	if (ctl.queue) {
+		if (!ctl.batch)
+			ctl.batch = 256;
+		ctl.async = 1;
+	}
+
 	switch (unix_socket_errors_mode) {
 	case AF_UNIX_ERRORS_OFF:
 		ctl.unix_socket_errors = 0;
@@ -1310,7 +2145,10 @@ int main(int argc, char **argv)
 	else
 		/* Note. --file <arg> reopens stdin making the below
 		 * function to be used for file inputs. */
-		logger_stdin(&ctl);
+		if (ctl.batch)
+			logger_stdin_batch(&ctl);
+		else
+			logger_stdin(&ctl);
 	logger_close(&ctl);
 	return EXIT_SUCCESS;
 }
@@ -105,6 +105,7 @@ void lsblk_unref_device(struct lsblk_device *dev)
 
 		device_remove_dependences(dev);
 		lsblk_device_free_properties(dev->properties);
+		blkid_free_topology(dev->topology);
 
 		lsblk_unref_device(dev->wholedisk);
 
@@ -706,6 +706,39 @@ static uint64_t device_get_discard_granularity(struct lsblk_device *dev)
 	return dev->discard_granularity;
 }
 
+/*
+ * Reads all I/O limits attributes at once by libblkid and keeps the result
+ * for the next columns. The per-attribute reading is used for --sysroot.
+ */
+static char *get_topology_value(struct lsblk_device *dev,
+				unsigned long (*get)(blkid_topology),
+				const char *attr, uint64_t *sortdata)
+{
+	char *str = NULL;
+
+	if (!dev->topology_requested && !lsblk->sysroot)
+		dev->topology = blkid_new_topology_from_devno(
+					makedev(dev->maj, dev->min));
+	dev->topology_requested = 1;
+
+	/* libblkid returns 0 also for missing attributes, use sysfs then */
+	if (dev->topology) {
+		unsigned long x = get(dev->topology);
+
+		if (x) {
+			xasprintf(&str, "%lu", x);
+			if (sortdata)
+				*sortdata = x;
+			return str;
+		}
+	}
+
+	ul_path_read_string(dev->sysfs, &str, attr);
+	if (sortdata)
+		str2u64(str, sortdata);
+	return str;
+}
+
 /*
  * Generates data (string) for column specified by column ID for specified device. If sortdata
  * is not NULL then returns number usable to sort the column if the data are available for the
@@ -930,24 +963,20 @@ static char *device_get_data(
 			str2u64(str, sortdata);
 		break;
 	case COL_MINIO:
-		ul_path_read_string(dev->sysfs, &str, "queue/minimum_io_size");
-		if (sortdata)
-			str2u64(str, sortdata);
+		str = get_topology_value(dev, blkid_topology_get_minimum_io_size,
+				"queue/minimum_io_size", sortdata);
 		break;
 	case COL_OPTIO:
-		ul_path_read_string(dev->sysfs, &str, "queue/optimal_io_size");
-		if (sortdata)
-			str2u64(str, sortdata);
+		str = get_topology_value(dev, blkid_topology_get_optimal_io_size,
+				"queue/optimal_io_size", sortdata);
 		break;
 	case COL_PHYSEC:
-		ul_path_read_string(dev->sysfs, &str, "queue/physical_block_size");
-		if (sortdata)
-			str2u64(str, sortdata);
+		str = get_topology_value(dev, blkid_topology_get_physical_sector_size,
+				"queue/physical_block_size", sortdata);
 		break;
 	case COL_LOGSEC:
-		ul_path_read_string(dev->sysfs, &str, "queue/logical_block_size");
-		if (sortdata)
-			str2u64(str, sortdata);
+		str = get_topology_value(dev, blkid_topology_get_logical_sector_size,
+				"queue/logical_block_size", sortdata);
 		break;
 	case COL_SCHED:
 		str = get_scheduler(dev);
@@ -1034,7 +1063,8 @@ static char *device_get_data(
 		ul_path_read_string(dev->sysfs, &str, "queue/zoned");
 		break;
 	case COL_DAX:
-		ul_path_read_string(dev->sysfs, &str, "queue/dax");
+		str = get_topology_value(dev, blkid_topology_get_dax,
+				"queue/dax", NULL);
 		break;
 	};
 
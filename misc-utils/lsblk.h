@@ -12,6 +12,7 @@
 #include <sys/statvfs.h>
 
 #include <libsmartcols.h>
+#include <blkid.h>
 
 #include "c.h"
 #include "list.h"
@@ -106,6 +107,7 @@ struct lsblk_device {
 	struct libscols_line	*scols_line;
 
 	struct lsblk_devprop	*properties;
+	blkid_topology		topology;	/* sysfs queue/ attributes */
 	struct stat	st;
 
 	char *name;		/* kernel name in /sys/block */
@@ -135,6 +137,7 @@ struct lsblk_device {
 			is_printed : 1,
 			udev_requested : 1,
 			blkid_requested : 1,
+			topology_requested : 1,
 			file_requested : 1;
 };
 
@@ -30,6 +30,7 @@
 #include <string.h>
 #include <limits.h>
 #include <libgen.h>
+#include <pthread.h>
 
 #include <blkid.h>
 #include <libsmartcols.h>
@@ -67,9 +68,14 @@ struct wipe_control {
 	const char	*lockmode;
 
 	struct libscols_table *outtab;
+	const int	*outcols;		/* columns of outtab */
+	size_t		noutcols;
+
 	struct wipe_desc *offsets;		/* -o <offset> -o <offset> ... */
 
-	size_t		ndevs;			/* number of devices to probe */
+	size_t		njobs;			/* --jobs <num> */
+
+	struct wipe_desc *erased;		/* wiped (or to be wiped) signatures */
 
 	char		**reread;		/* devices to BLKRRPART */
 	size_t		nrereads;		/* size of reread */
@@ -81,9 +87,14 @@ struct wipe_control {
 			force : 1,
 			json : 1,
 			no_headings : 1,
-			parsable : 1;
+			parsable : 1,
+			need_force : 1,		/* something skipped, --force required */
+			need_reread : 1;	/* BLKRRPART after all is done */
 };
 
+/* erase areas closer than this are written by one read-modify-write */
+#define WIPE_MERGE_GAP	4096
+
 
 /* column IDs */
 enum {
@@ -118,6 +129,11 @@ static const struct colinfo infos[] = {
 static int columns[ARRAY_SIZE(infos) * 2];
 static size_t ncolumns;
 
+/* --json summary of erased signatures, independent on -O */
+static const int summary_columns[] = {
+	COL_DEVICE, COL_OFFSET, COL_LEN, COL_TYPE, COL_USAGE
+};
+
 static int column_name_to_id(const char *name, size_t namesz)
 {
 	size_t i;
@@ -133,20 +149,20 @@ static int column_name_to_id(const char *name, size_t namesz)
 	return -1;
 }
 
-static int get_column_id(size_t num)
+static int get_column_id(struct wipe_control *ctl, size_t num)
 {
-	assert(num < ncolumns);
-	assert(columns[num] < (int)ARRAY_SIZE(infos));
-	return columns[num];
+	assert(num < ctl->noutcols);
+	assert(ctl->outcols[num] < (int)ARRAY_SIZE(infos));
+	return ctl->outcols[num];
 }
 
-static const struct colinfo *get_column_info(int num)
+static const struct colinfo *get_column_info(struct wipe_control *ctl, size_t num)
 {
-	return &infos[get_column_id(num)];
+	return &infos[get_column_id(ctl, num)];
 }
 
 
-static void init_output(struct wipe_control *ctl)
+static void init_output(struct wipe_control *ctl, const int *cols, size_t ncols)
 {
 	struct libscols_table *tb;
 	size_t i;
@@ -167,8 +183,11 @@ static void init_output(struct wipe_control *ctl)
 		scols_table_set_column_separator(tb, ",");
 	}
 
-	for (i = 0; i < ncolumns; i++) {
-		const struct colinfo *col = get_column_info(i);
+	ctl->outcols = cols;
+	ctl->noutcols = ncols;
+
+	for (i = 0; i < ncols; i++) {
+		const struct colinfo *col = get_column_info(ctl, i);
 		struct libscols_column *cl;
 
 		cl = scols_table_new_column(tb, col->name, col->whint,
@@ -177,7 +196,7 @@ static void init_output(struct wipe_control *ctl)
 			err(EXIT_FAILURE,
 			    _("failed to initialize output column"));
 		if (ctl->json) {
-			int id = get_column_id(i);
+			int id = get_column_id(ctl, i);
 
 			if (id == COL_LEN)
 				scols_column_set_json_type(cl, SCOLS_JSON_NUMBER);
@@ -223,10 +242,10 @@ static void fill_table_row(struct wipe_control *ctl, struct wipe_desc *wp)
 	if (!ln)
 		errx(EXIT_FAILURE, _("failed to allocate output line"));
 
-	for (i = 0; i < ncolumns; i++) {
+	for (i = 0; i < ctl->noutcols; i++) {
 		char *str = NULL;
 
-		switch (get_column_id(i)) {
+		switch (get_column_id(ctl, i)) {
 		case COL_UUID:
 			if (wp->uuid)
 				str = xstrdup(wp->uuid);
@@ -416,8 +435,9 @@ new_probe(const char *devname, int mode)
 					     BLKID_PARTS_FORCE_GPT);
 	return pr;
 error:
+	warn(_("error: %s: probing initialization failed"), devname);
 	blkid_free_probe(pr);
-	err(EXIT_FAILURE, _("error: %s: probing initialization failed"), devname);
+	return NULL;
 }
 
 static struct wipe_desc *read_offsets(struct wipe_control *ctl)
@@ -426,7 +446,7 @@ static struct wipe_desc *read_offsets(struct wipe_control *ctl)
 	struct wipe_desc *wp0 = NULL;
 
 	if (!pr)
-		return NULL;
+		exit(EXIT_FAILURE);
 
 	while (blkid_do_probe(pr) == 0) {
 		size_t len = 0;
@@ -462,18 +482,10 @@ static void free_wipe(struct wipe_desc *wp)
 	}
 }
 
-static void do_wipe_real(struct wipe_control *ctl, blkid_probe pr,
-			struct wipe_desc *w)
+static void print_erased(struct wipe_control *ctl, struct wipe_desc *w)
 {
 	size_t i;
 
-	if (blkid_do_wipe(pr, ctl->noact) != 0)
-		err(EXIT_FAILURE, _("%s: failed to erase %s magic string at offset 0x%08jx"),
-		     ctl->devname, w->type, (intmax_t)w->offset);
-
-	if (ctl->quiet)
-		return;
-
 	printf(P_("%s: %zd byte was erased at offset 0x%08jx (%s): ",
 		  "%s: %zd bytes were erased at offset 0x%08jx (%s): ",
 		  w->len),
@@ -487,6 +499,78 @@ static void do_wipe_real(struct wipe_control *ctl, blkid_probe pr,
 	putchar('\n');
 }
 
+static int cmp_wipe_offsets(const void *a, const void *b)
+{
+	const struct wipe_desc *wa = *(struct wipe_desc * const *) a,
+			       *wb = *(struct wipe_desc * const *) b;
+
+	return wa->offset < wb->offset ? -1 : wa->offset > wb->offset;
+}
+
+/*
+ * Writes zeros to all the signatures from the ctl->erased list. The close
+ * signatures are merged to one area; the bytes between signatures are read
+ * from the device and written back unchanged. The device is synced only once.
+ */
+static int write_erased(struct wipe_control *ctl, int fd)
+{
+	struct wipe_desc **ary, *wp;
+	unsigned char *buf = NULL;
+	size_t n = 0, i, j, k, bufsz = 0;
+	int rc = 0;
+
+	for (wp = ctl->erased; wp; wp = wp->next)
+		n++;
+	if (!n)
+		return 0;
+
+	ary = xmalloc(n * sizeof(struct wipe_desc *));
+	for (n = 0, wp = ctl->erased; wp; wp = wp->next)
+		ary[n++] = wp;
+	qsort(ary, n, sizeof(struct wipe_desc *), cmp_wipe_offsets);
+
+	for (i = 0; i < n; i = j) {
+		loff_t start = ary[i]->offset, end = start + ary[i]->len;
+		size_t size;
+		int gaps = 0;
+
+		for (j = i + 1; j < n && ary[j]->offset <= end + WIPE_MERGE_GAP; j++) {
+			if (ary[j]->offset > end)
+				gaps = 1;
+			end = max(end, ary[j]->offset + (loff_t) ary[j]->len);
+		}
+
+		size = end - start;
+		if (size > bufsz) {
+			buf = xrealloc(buf, size);
+			bufsz = size;
+		}
+
+		if (gaps) {
+			if (pread(fd, buf, size, start) != (ssize_t) size)
+				goto err;
+			for (k = i; k < j; k++)
+				memset(buf + (ary[k]->offset - start), 0, ary[k]->len);
+		} else
+			memset(buf, 0, size);
+
+		if (pwrite(fd, buf, size, start) != (ssize_t) size)
+			goto err;
+	}
+
+	if (fsync(fd) != 0)
+		warn(_("%s: fsync failed"), ctl->devname);
+done:
+	free(buf);
+	free(ary);
+	return rc;
+err:
+	warn(_("%s: failed to erase %s magic string at offset 0x%08jx"),
+	     ctl->devname, ary[i]->type, (intmax_t)ary[i]->offset);
+	rc = -1;
+	goto done;
+}
+
 static void do_backup(struct wipe_desc *wp, const char *base)
 {
 	char *fname = NULL;
@@ -533,22 +617,29 @@ static void rereadpt(int fd, const char *devname)
 }
 #endif
 
+/*
+ * The signatures are wiped in memory only (libblkid hides the area in its
+ * buffers, so the rest of the probing does not need to read the device
+ * again) and collected in ctl->erased. All is written at the end by
+ * write_erased().
+ */
 static int do_wipe(struct wipe_control *ctl)
 {
-	int mode = O_RDWR, reread = 0, need_force = 0;
+	int mode = O_RDWR, rc = 0;
 	blkid_probe pr;
 	char *backup = NULL;
-	struct wipe_desc *w;
+	struct wipe_desc *last = NULL;
 
 	if (!ctl->force)
 		mode |= O_EXCL;
 
 	pr = new_probe(ctl->devname, mode);
 	if (!pr)
-		return -errno;
+		return -1;
 
 	if (blkdev_lock(blkid_probe_get_fd(pr),
 			ctl->devname, ctl->lockmode) != 0) {
+		close(blkid_probe_get_fd(pr));
 		blkid_free_probe(pr);
 		return -1;
 	}
@@ -578,15 +669,29 @@ static int do_wipe(struct wipe_control *ctl)
 		    && !blkid_probe_is_wholedisk(pr)) {
 			warnx(_("%s: ignoring nested \"%s\" partition table "
 				"on non-whole disk device"), ctl->devname, wp->type);
-			need_force = 1;
+			ctl->need_force = 1;
 			goto done;
 		}
 
 		if (backup)
 			do_backup(wp, backup);
-		do_wipe_real(ctl, pr, wp);
+
+		/* in-memory only, hides the area and steps back */
+		if (blkid_do_wipe(pr, 1) != 0) {
+			warn(_("%s: failed to erase %s magic string at offset 0x%08jx"),
+			     ctl->devname, wp->type, (intmax_t)wp->offset);
+			free_wipe(wp);
+			rc = -1;
+			break;
+		}
 		if (wp->is_parttable)
-			reread = 1;
+			ctl->need_reread = 1;
+		if (last)
+			last->next = wp;
+		else
+			ctl->erased = wp;
+		last = wp;
+		wp = NULL;
 		wiped = 1;
 	done:
 		if (!wiped && len) {
@@ -603,41 +708,150 @@ static int do_wipe(struct wipe_control *ctl)
 		free_wipe(wp);
 	}
 
+	/* nothing is written if any of the signatures cannot be erased */
+	if (!rc && !ctl->noact)
+		rc = write_erased(ctl, blkid_probe_get_fd(pr));
+
+	/* re-read partition table only if we own the device, see main() */
+	if (!(mode & O_EXCL))
+		ctl->need_reread = 0;
+
+	close(blkid_probe_get_fd(pr));
+	blkid_free_probe(pr);
+	free(backup);
+	return rc;
+}
+
+/* prints do_wipe() result, called in the devices order also for --jobs */
+static void report_wipe(struct wipe_control *ctl, int rc)
+{
+	struct wipe_desc *w;
+
+	if (!rc && !ctl->quiet && !ctl->json) {
+		for (w = ctl->erased; w; w = w->next)
+			print_erased(ctl, w);
+	}
 	for (w = ctl->offsets; w; w = w->next) {
 		if (!w->on_disk && !ctl->quiet)
 			warnx(_("%s: offset 0x%jx not found"),
 					ctl->devname, (uintmax_t)w->offset);
 	}
-
-	if (need_force)
+	if (ctl->need_force)
 		warnx(_("Use the --force option to force erase."));
+}
 
-	fsync(blkid_probe_get_fd(pr));
+/* per-device wipe, used for --jobs */
+struct wipe_job {
+	struct wipe_control	ctl;	/* private copy of the main control struct */
+	int			rc;
+};
 
-#ifdef BLKRRPART
-	if (reread && (mode & O_EXCL)) {
-		if (ctl->ndevs > 1) {
-			/*
-			 * We're going to probe more device, let's postpone
-			 * re-read PT ioctl until all is erased to avoid
-			 * situation we erase PT on /dev/sda before /dev/sdaN
-			 * devices are processed.
-			 */
-			if (!ctl->reread)
-				ctl->reread = xcalloc(ctl->ndevs, sizeof(char *));
+struct wipe_batch {
+	struct wipe_job		*jobs;
+	size_t			njobs;
+	size_t			next;	/* next job to do */
+	pthread_mutex_t		lock;
+};
 
-			ctl->reread[ctl->nrereads++] = ctl->devname;
-		} else
-			rereadpt(blkid_probe_get_fd(pr), ctl->devname);
+static void *wipe_worker(void *data)
+{
+	struct wipe_batch *b = (struct wipe_batch *) data;
+
+	do {
+		struct wipe_job *job = NULL;
+
+		pthread_mutex_lock(&b->lock);
+		if (b->next < b->njobs)
+			job = &b->jobs[b->next++];
+		pthread_mutex_unlock(&b->lock);
+
+		if (!job)
+			break;
+		job->rc = do_wipe(&job->ctl);
+	} while (1);
+
+	return NULL;
+}
+
+/* every job needs own -o list, the list is used to mark found offsets */
+static struct wipe_desc *clone_offsets(struct wipe_desc *wp)
+{
+	struct wipe_desc *res = NULL;
+
+	for (/*nothing*/; wp; wp = wp->next)
+		add_offset(&res, wp->offset);
+	return res;
+}
+
+static int wipe_devices(struct wipe_control *ctl, int ndevs, char **devs)
+{
+	struct wipe_batch batch = { .njobs = ndevs };
+	pthread_t *threads;
+	size_t i, nthreads;
+	int rc = 0;
+
+	batch.jobs = xcalloc(ndevs, sizeof(struct wipe_job));
+
+	for (i = 0; i < batch.njobs; i++) {
+		struct wipe_job *job = &batch.jobs[i];
+
+		job->ctl = *ctl;
+		job->ctl.devname = devs[i];
+		job->ctl.offsets = clone_offsets(ctl->offsets);
 	}
+
+	nthreads = min(ctl->njobs ? ctl->njobs : 1, batch.njobs);
+	if (nthreads == 1)
+		wipe_worker(&batch);
+	else {
+		/* libblkid initializes debug mask on the first use */
+		blkid_init_debug(0);
+
+		threads = xcalloc(nthreads, sizeof(pthread_t));
+		pthread_mutex_init(&batch.lock, NULL);
+
+		for (i = 0; i < nthreads; i++) {
+			errno = pthread_create(&threads[i], NULL, wipe_worker, &batch);
+			if (errno)
+				err(EXIT_FAILURE, _("failed to create thread"));
+		}
+		for (i = 0; i < nthreads; i++)
+			pthread_join(threads[i], NULL);
+
+		pthread_mutex_destroy(&batch.lock);
+		free(threads);
+	}
+
+	if (ctl->json)
+		init_output(ctl, summary_columns, ARRAY_SIZE(summary_columns));
+
+	for (i = 0; i < batch.njobs; i++) {
+		struct wipe_job *job = &batch.jobs[i];
+
+		report_wipe(&job->ctl, job->rc);
+		if (job->rc)
+			rc = -1;
+		if (ctl->json && !job->rc) {
+			ctl->devname = job->ctl.devname;
+			add_to_output(ctl, job->ctl.erased);
+		}
+#ifdef BLKRRPART
+		if (job->ctl.need_reread) {
+			if (!ctl->reread)
+				ctl->reread = xcalloc(batch.njobs, sizeof(char *));
+			ctl->reread[ctl->nrereads++] = job->ctl.devname;
+		}
 #endif
+		free_wipe(job->ctl.erased);
+		free_wipe(job->ctl.offsets);
+	}
 
-	close(blkid_probe_get_fd(pr));
-	blkid_free_probe(pr);
-	free(backup);
-	return 0;
-}
+	if (ctl->json)
+		finalize_output(ctl);
 
+	free(batch.jobs);
+	return rc;
+}
 
 static void __attribute__((__noreturn__))
 usage(void)
@@ -662,6 +876,7 @@ usage(void)
 	puts(_(" -p, --parsable      print out in parsable instead of printable format"));
 	puts(_(" -q, --quiet         suppress output messages"));
 	puts(_(" -t, --types <list>  limit the set of filesystem, RAIDs or partition tables"));
+	puts(_("     --jobs <num>    number of devices to erase in parallel"));
 	printf(
 	     _("     --lock[=<mode>] use exclusive device lock (%s, %s or %s)\n"), "yes", "no", "nonblock");
 
@@ -683,16 +898,18 @@ int
 main(int argc, char **argv)
 {
 	struct wipe_control ctl = { .devname = NULL };
-	int c;
+	int c, rc = 0;
 	char *outarg = NULL;
 	enum {
 		OPT_LOCK = CHAR_MAX + 1,
+		OPT_JOBS
 	};
 	static const struct option longopts[] = {
 	    { "all",       no_argument,       NULL, 'a' },
 	    { "backup",    no_argument,       NULL, 'b' },
 	    { "force",     no_argument,       NULL, 'f' },
 	    { "help",      no_argument,       NULL, 'h' },
+	    { "jobs",      required_argument, NULL, OPT_JOBS },
 	    { "lock",      optional_argument, NULL, OPT_LOCK },
 	    { "no-act",    no_argument,       NULL, 'n' },
 	    { "offset",    required_argument, NULL, 'o' },
@@ -757,6 +974,11 @@ main(int argc, char **argv)
 		case 't':
 			ctl.type_pattern = optarg;
 			break;
+		case OPT_JOBS:
+			ctl.njobs = strtou32_or_err(optarg, _("failed to parse number of jobs"));
+			if (!ctl.njobs)
+				errx(EXIT_FAILURE, _("failed to parse number of jobs"));
+			break;
 		case OPT_LOCK:
 			ctl.lockmode = "1";
 			if (optarg) {
@@ -807,7 +1029,7 @@ main(int argc, char **argv)
 					     &ncolumns, column_name_to_id) < 0)
 			return EXIT_FAILURE;
 
-		init_output(&ctl);
+		init_output(&ctl, columns, ncolumns);
 
 		while (optind < argc) {
 			struct wipe_desc *wp;
@@ -823,17 +1045,12 @@ main(int argc, char **argv)
 		/*
 		 * Erase
 		 */
-		ctl.ndevs = argc - optind;
-
-		while (optind < argc) {
-			ctl.devname = argv[optind++];
-			do_wipe(&ctl);
-			ctl.ndevs--;
-		}
+		rc = wipe_devices(&ctl, argc - optind, argv + optind);
 
 #ifdef BLKRRPART
 		/* Re-read partition tables on whole-disk devices. This is
-		 * postponed until all is done to avoid conflicts.
+		 * postponed until all is done to avoid conflicts (e.g. we
+		 * erase PT on /dev/sda before /dev/sdaN devices are processed).
 		 */
 		for (size_t i = 0; i < ctl.nrereads; i++) {
 			char *devname = ctl.reread[i];
@@ -847,5 +1064,5 @@ main(int argc, char **argv)
 		free(ctl.reread);
 #endif
 	}
-	return EXIT_SUCCESS;
+	return rc ? EXIT_FAILURE : EXIT_SUCCESS;
 }
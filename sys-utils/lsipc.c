@@ -40,6 +40,7 @@
 #include "procutils.h"
 #include "ipcutils.h"
 #include "timeutils.h"
+#include "idcache.h"
 
 /*
  * time modes
@@ -246,20 +247,34 @@ static const struct lsipc_coldesc *get_column_desc(int num)
 	return &coldescs[ get_column_id(num) ];
 }
 
-static char *get_username(struct passwd **pw, uid_t id)
+/* owners are usually shared by many IPC objects */
+static struct idcache *uid_cache;
+static struct idcache *gid_cache;
+
+static char *get_username(uid_t id)
 {
-	if (!*pw || (*pw)->pw_uid != id)
-		*pw = getpwuid(id);
+	struct identry *ent;
+
+	if (!uid_cache && !(uid_cache = new_idcache()))
+		err_oom();
 
-	return *pw ? xstrdup((*pw)->pw_name) : NULL;
+	add_uid(uid_cache, id);
+	ent = get_id(uid_cache, id);
+
+	return ent && !ent->numeric ? xstrdup(ent->name) : NULL;
 }
 
-static char *get_groupname(struct group **gr, gid_t id)
+static char *get_groupname(gid_t id)
 {
-	if (!*gr || (*gr)->gr_gid != id)
-		*gr = getgrgid(id);
+	struct identry *ent;
 
-	return *gr ? xstrdup((*gr)->gr_name) : NULL;
+	if (!gid_cache && !(gid_cache = new_idcache()))
+		err_oom();
+
+	add_gid(gid_cache, id);
+	ent = get_id(gid_cache, id);
+
+	return ent && !ent->numeric ? xstrdup(ent->name) : NULL;
 }
 
 static int parse_time_mode(const char *s)
@@ -535,8 +550,6 @@ static void setup_sem_elements_columns(struct libscols_table *tb)
 static void do_sem(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 {
 	struct libscols_line *ln;
-	struct passwd *pw = NULL, *cpw = NULL;
-	struct group *gr = NULL, *cgr = NULL;
 	struct sem_data *semds, *semdsp;
 	char *arg = NULL;
 
@@ -566,7 +579,7 @@ static void do_sem(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_OWNER:
-				arg = get_username(&pw, semdsp->sem_perm.uid);
+				arg = get_username(semdsp->sem_perm.uid);
 				if (!arg)
 					xasprintf(&arg, "%u", semdsp->sem_perm.uid);
 				rc = scols_line_refer_data(ln, n, arg);
@@ -585,7 +598,7 @@ static void do_sem(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_CUSER:
-				arg = get_username(&cpw, semdsp->sem_perm.cuid);
+				arg = get_username(semdsp->sem_perm.cuid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -594,7 +607,7 @@ static void do_sem(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_CGROUP:
-				arg = get_groupname(&cgr, semdsp->sem_perm.cgid);
+				arg = get_groupname(semdsp->sem_perm.cgid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -603,7 +616,7 @@ static void do_sem(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_USER:
-				arg = get_username(&pw, semdsp->sem_perm.uid);
+				arg = get_username(semdsp->sem_perm.uid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -612,7 +625,7 @@ static void do_sem(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_GROUP:
-				arg = get_groupname(&gr, semdsp->sem_perm.gid);
+				arg = get_groupname(semdsp->sem_perm.gid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -729,8 +742,6 @@ static void do_sem_global(struct libscols_table *tb)
 static void do_msg(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 {
 	struct libscols_line *ln;
-	struct passwd *pw = NULL;
-	struct group *gr = NULL;
 	struct msg_data *msgds, *msgdsp;
 	char *arg = NULL;
 
@@ -748,14 +759,6 @@ static void do_msg(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 		if (!ln)
 			err(EXIT_FAILURE, _("failed to allocate output line"));
 
-		/* no need to call getpwuid() for the same user */
-		if (!(pw && pw->pw_uid == msgdsp->msg_perm.uid))
-			pw = getpwuid(msgdsp->msg_perm.uid);
-
-		/* no need to call getgrgid() for the same user */
-		if (!(gr && gr->gr_gid == msgdsp->msg_perm.gid))
-			gr = getgrgid(msgdsp->msg_perm.gid);
-
 		for (n = 0; n < ncolumns; n++) {
 			int rc = 0;
 
@@ -769,7 +772,7 @@ static void do_msg(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_OWNER:
-				arg = get_username(&pw, msgdsp->msg_perm.uid);
+				arg = get_username(msgdsp->msg_perm.uid);
 				if (!arg)
 					xasprintf(&arg, "%u", msgdsp->msg_perm.uid);
 				rc = scols_line_refer_data(ln, n, arg);
@@ -788,7 +791,7 @@ static void do_msg(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_CUSER:
-				arg = get_username(&pw, msgdsp->msg_perm.cuid);
+				arg = get_username(msgdsp->msg_perm.cuid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -797,7 +800,7 @@ static void do_msg(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_CGROUP:
-				arg = get_groupname(&gr, msgdsp->msg_perm.cgid);
+				arg = get_groupname(msgdsp->msg_perm.cgid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -806,7 +809,7 @@ static void do_msg(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_USER:
-				arg = get_username(&pw, msgdsp->msg_perm.uid);
+				arg = get_username(msgdsp->msg_perm.uid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -815,7 +818,7 @@ static void do_msg(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_GROUP:
-				arg = get_groupname(&gr,msgdsp->msg_perm.gid);
+				arg = get_groupname(msgdsp->msg_perm.gid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -889,8 +892,6 @@ static void do_msg_global(struct libscols_table *tb)
 static void do_shm(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 {
 	struct libscols_line *ln;
-	struct passwd *pw = NULL;
-	struct group *gr = NULL;
 	struct shm_data *shmds, *shmdsp;
 	char *arg = NULL;
 
@@ -922,7 +923,7 @@ static void do_shm(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_OWNER:
-				arg = get_username(&pw, shmdsp->shm_perm.uid);
+				arg = get_username(shmdsp->shm_perm.uid);
 				if (!arg)
 					xasprintf(&arg, "%u", shmdsp->shm_perm.uid);
 				rc = scols_line_refer_data(ln, n, arg);
@@ -941,7 +942,7 @@ static void do_shm(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_CUSER:
-				arg = get_username(&pw, shmdsp->shm_perm.cuid);
+				arg = get_username(shmdsp->shm_perm.cuid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -950,7 +951,7 @@ static void do_shm(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_CGROUP:
-				arg = get_groupname(&gr, shmdsp->shm_perm.cgid);
+				arg = get_groupname(shmdsp->shm_perm.cgid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -959,7 +960,7 @@ static void do_shm(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_USER:
-				arg = get_username(&pw, shmdsp->shm_perm.uid);
+				arg = get_username(shmdsp->shm_perm.uid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -968,7 +969,7 @@ static void do_shm(int id, struct lsipc_control *ctl, struct libscols_table *tb)
 				rc = scols_line_refer_data(ln, n, arg);
 				break;
 			case COL_GROUP:
-				arg = get_groupname(&gr, shmdsp->shm_perm.gid);
+				arg = get_groupname(shmdsp->shm_perm.gid);
 				if (arg)
 					rc = scols_line_refer_data(ln, n, arg);
 				break;
@@ -1331,6 +1332,8 @@ int main(int argc, char *argv[])
 	print_table(ctl, tb);
 
 	scols_unref_table(tb);
+	free_idcache(uid_cache);
+	free_idcache(gid_cache);
 	free(ctl);
 
 	return EXIT_SUCCESS;
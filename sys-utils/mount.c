@@ -162,6 +162,71 @@ static void print_all(struct libmnt_context *cxt, char *pattern, int show_label)
 /*
  * mount -a [-F]
  */
+static int mount_all_nsucc, mount_all_nerrs;
+
+/* called in the child process by mnt_context_mount_all() */
+static int mount_all_child(struct libmnt_context *cxt, struct libmnt_fs *fs,
+			   int mntrc)
+{
+	int rc = mk_exit_code(cxt, mntrc);
+
+	/* Note that MNT_EX_SUCCESS return code does not mean that FS has
+	 * been really mounted (e.g. nofail option) */
+	if (rc == MNT_EX_SUCCESS && mnt_context_get_status(cxt)
+	    && mnt_context_is_verbose(cxt))
+		printf("%-25s: successfully mounted\n", mnt_fs_get_target(fs));
+	return rc;
+}
+
+/* called in the parent process by mnt_context_mount_all() */
+static void mount_all_done(struct libmnt_context *cxt, struct libmnt_fs *fs,
+			   int status, int ignored, unsigned long long usec)
+{
+	const char *tgt = mnt_fs_get_target(fs);
+
+	if (ignored) {
+		if (mnt_context_is_verbose(cxt))
+			printf(ignored == 1 ? _("%-25s: ignored\n") :
+					      _("%-25s: already mounted\n"),
+					tgt);
+		return;
+	}
+
+	if (status == MNT_EX_SUCCESS)
+		mount_all_nsucc++;
+	else {
+		if (status < 0)
+			warnx(_("%s: mount process terminated"), tgt);
+		mount_all_nerrs++;
+	}
+
+	if (mnt_context_is_verbose(cxt))
+		printf(_("%-25s: done in %llu.%03llu seconds\n"), tgt,
+				usec / 1000000, (usec % 1000000) / 1000);
+}
+
+/*
+ * mount -a --fork or --jobs; mount independent filesystems concurrently
+ */
+static int mount_all_parallel(struct libmnt_context *cxt, size_t jobs)
+{
+	int rc;
+
+	mount_all_nsucc = mount_all_nerrs = 0;
+
+	rc = mnt_context_mount_all(cxt, jobs, mount_all_child, mount_all_done);
+	if (rc) {
+		warnx(_("failed to mount all filesystems: %s"), strerror(-rc));
+		return MNT_EX_SYSERR;
+	}
+
+	if (mount_all_nerrs == 0)
+		return MNT_EX_SUCCESS;		/* all success */
+	if (mount_all_nsucc == 0)
+		return MNT_EX_FAIL;		/* all failed */
+	return MNT_EX_SOMEOK;			/* some success, some failed */
+}
+
 static int mount_all(struct libmnt_context *cxt)
 {
 	struct libmnt_iter *itr;
@@ -451,6 +516,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	" -c, --no-canonicalize   don't canonicalize paths\n"
 	" -f, --fake              dry run; skip the mount(2) syscall\n"
 	" -F, --fork              fork off for each device (use with -a)\n"
+	"     --jobs <num>        mount at most <num> devices in parallel (use with -a)\n"
 	" -T, --fstab <path>      alternative file to /etc/fstab\n"));
 	fprintf(out, _(
 	" -i, --internal-only     don't call the mount.<type> helpers\n"));
@@ -585,6 +651,7 @@ int main(int argc, char **argv)
 	int oper = 0, is_move = 0;
 	int propa = 0;
 	int optmode = 0, optmode_mode = 0, optmode_src = 0;
+	size_t jobs = 0;
 
 	enum {
 		MOUNT_OPT_SHARED = CHAR_MAX + 1,
@@ -600,7 +667,8 @@ int main(int argc, char **argv)
 		MOUNT_OPT_SOURCE,
 		MOUNT_OPT_OPTMODE,
 		MOUNT_OPT_OPTSRC,
-		MOUNT_OPT_OPTSRC_FORCE
+		MOUNT_OPT_OPTSRC_FORCE,
+		MOUNT_OPT_JOBS
 	};
 
 	static const struct option longopts[] = {
@@ -608,6 +676,7 @@ int main(int argc, char **argv)
 		{ "fake",             no_argument,       NULL, 'f'                   },
 		{ "fstab",            required_argument, NULL, 'T'                   },
 		{ "fork",             no_argument,       NULL, 'F'                   },
+		{ "jobs",             required_argument, NULL, MOUNT_OPT_JOBS        },
 		{ "help",             no_argument,       NULL, 'h'                   },
 		{ "no-mtab",          no_argument,       NULL, 'n'                   },
 		{ "read-only",        no_argument,       NULL, 'r'                   },
@@ -838,6 +907,11 @@ int main(int argc, char **argv)
 		case MOUNT_OPT_OPTSRC_FORCE:
 			optmode |= MNT_OMODE_FORCE;
 			break;
+		case MOUNT_OPT_JOBS:
+			jobs = strtou32_or_err(optarg, _("invalid jobs argument"));
+			if (!jobs)
+				errx(MNT_EX_USAGE, _("invalid jobs argument"));
+			break;
 
 		case 'h':
 			mnt_free_context(cxt);
@@ -905,6 +979,8 @@ int main(int argc, char **argv)
 		 */
 		if (has_remount_flag(cxt))
 			rc = remount_all(cxt);
+		else if (jobs || mnt_context_is_fork(cxt))
+			rc = mount_all_parallel(cxt, jobs);
 		else
 			rc = mount_all(cxt);
 		goto done;
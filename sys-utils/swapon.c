@@ -11,6 +11,7 @@
 #include <fcntl.h>
 #include <stdint.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include <libsmartcols.h>
 
@@ -23,6 +24,8 @@
 #include "strutils.h"
 #include "optutils.h"
 #include "closestream.h"
+#include "sysfs.h"
+#include "monotonic.h"
 
 #include "swapheader.h"
 #include "swapprober.h"
@@ -124,14 +127,17 @@ struct swapon_ctl {
 	int ncolumns;				/* number of columns */
 
 	struct swap_prop props;		/* global settings for all devices */
+	size_t njobs;			/* --jobs <num> */
 
 	unsigned int
 		all:1,			/* turn on all swap devices */
+		auto_priority:1,	/* --auto-priority */
 		bytes:1,		/* display --show in bytes */
 		fix_page_size:1,	/* reinitialize page size */
 		no_heading:1,		/* toggle --show headers */
 		raw:1,			/* toggle --show alignment */
 		show:1,			/* display --show information */
+		timing:1,		/* --timing report for --all */
 		verbose:1;		/* be chatty */
 };
 
@@ -721,11 +727,279 @@ static int parse_options(struct swap_prop *props, const char *options)
 }
 
 
+/* swap area from fstab, see swapon_all() */
+struct swap_job {
+	const char		*device;
+	struct swap_prop	prop;		/* per device setting */
+	dev_t			disk;		/* whole disk or 0 */
+	char			diskname[NAME_MAX + 1];
+	int			rc;
+	unsigned long long	usec;		/* activation time */
+	unsigned int		done : 1;
+};
+
+/* swap areas on the same disk, activated one by one */
+struct swap_group {
+	size_t			*jobs;
+	size_t			njobs;
+};
+
+struct swap_batch {
+	const struct swapon_ctl	*ctl;
+	struct swap_job		*jobs;
+	size_t			njobs;
+	struct swap_group	*groups;
+	size_t			ngroups;
+	size_t			next;		/* next group to activate */
+	pthread_mutex_t		lock;
+};
+
+/* speed classes for --auto-priority, faster class gets higher priority */
+enum {
+	SWAP_TIER_ROTATIONAL = 1,
+	SWAP_TIER_SOLID,
+	SWAP_TIER_MEMORY
+};
+
+static void swap_job_set_disk(struct swap_job *job)
+{
+	struct stat st;
+	dev_t devno;
+
+	if (stat(job->device, &st) != 0)
+		return;
+	devno = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+
+	if (sysfs_devno_to_wholedisk(devno, job->diskname,
+				sizeof(job->diskname), &job->disk) != 0) {
+		job->disk = 0;
+		*job->diskname = '\0';
+	}
+}
+
+static int swap_job_get_tier(const struct swap_job *job)
+{
+	struct path_cxt *pc;
+	int rota = 1;
+
+	if (!job->disk)
+		return SWAP_TIER_ROTATIONAL;
+	if (startswith(job->diskname, "zram")
+	    || startswith(job->diskname, "pmem")
+	    || startswith(job->diskname, "ram"))
+		return SWAP_TIER_MEMORY;
+
+	pc = ul_new_sysfs_path(job->disk, NULL, NULL);
+	if (!pc || ul_path_read_s32(pc, &rota, "queue/rotational") != 0)
+		rota = 1;
+	ul_unref_path(pc);
+
+	return rota ? SWAP_TIER_ROTATIONAL : SWAP_TIER_SOLID;
+}
+
+/*
+ * The kernel uses swap areas with the same priority in round-robin, so the
+ * first area on every disk of the same speed class gets the same priority
+ * (10 for rotational disks, 20 for SSDs and 30 for zram and similar memory
+ * devices), the next area on the same disk gets one less, etc.
+ */
+static void plan_priorities(struct swap_batch *b)
+{
+	size_t g, i;
+
+	for (g = 0; g < b->ngroups; g++) {
+		struct swap_group *grp = &b->groups[g];
+		int base = swap_job_get_tier(&b->jobs[grp->jobs[0]]) * 10;
+
+		for (i = 0; i < grp->njobs; i++) {
+			struct swap_job *job = &b->jobs[grp->jobs[i]];
+
+			if (job->prop.priority >= 0)
+				continue;	/* pri= from fstab or --priority */
+			job->prop.priority = base - (int) min(i, (size_t) 9);
+		}
+	}
+}
+
+static void add_to_group(struct swap_batch *b, size_t idx)
+{
+	struct swap_job *job = &b->jobs[idx];
+	struct swap_group *grp = NULL;
+	size_t g;
+
+	if (job->disk) {
+		for (g = 0; g < b->ngroups; g++) {
+			if (b->jobs[b->groups[g].jobs[0]].disk == job->disk) {
+				grp = &b->groups[g];
+				break;
+			}
+		}
+	}
+	if (!grp)
+		grp = &b->groups[b->ngroups++];
+
+	grp->jobs = xrealloc(grp->jobs, (grp->njobs + 1) * sizeof(size_t));
+	grp->jobs[grp->njobs++] = idx;
+}
+
+static void run_job(const struct swapon_ctl *ctl, struct swap_job *job)
+{
+	struct timeval start, end;
+
+	gettime_monotonic(&start);
+	job->rc = do_swapon(ctl, &job->prop, job->device, TRUE);
+	gettime_monotonic(&end);
+
+	job->usec = (unsigned long long) (end.tv_sec - start.tv_sec) * 1000000
+		+ end.tv_usec - start.tv_usec;
+	job->done = 1;
+}
+
+static void *swapon_worker(void *data)
+{
+	struct swap_batch *b = (struct swap_batch *) data;
+
+	do {
+		struct swap_group *grp = NULL;
+		size_t i;
+
+		pthread_mutex_lock(&b->lock);
+		if (b->next < b->ngroups)
+			grp = &b->groups[b->next++];
+		pthread_mutex_unlock(&b->lock);
+
+		if (!grp)
+			break;
+		for (i = 0; i < grp->njobs; i++)
+			run_job(b->ctl, &b->jobs[grp->jobs[i]]);
+	} while (1);
+
+	return NULL;
+}
+
+static const char *discard_to_string(int discard)
+{
+	if (!discard)
+		return NULL;
+	if ((discard & SWAP_FLAG_DISCARD_ONCE) && !(discard & SWAP_FLAG_DISCARD_PAGES))
+		return "once";
+	if ((discard & SWAP_FLAG_DISCARD_PAGES) && !(discard & SWAP_FLAG_DISCARD_ONCE))
+		return "pages";
+	return "both";
+}
+
+static void print_timing(const struct swap_batch *b, unsigned long long total)
+{
+	struct libscols_table *table;
+	size_t i;
+
+	scols_init_debug(0);
+
+	table = scols_new_table();
+	if (!table)
+		err(EXIT_FAILURE, _("failed to allocate output table"));
+
+	if (!scols_table_new_column(table, "NAME", 0.30, 0)
+	    || !scols_table_new_column(table, "DISK", 0.20, 0)
+	    || !scols_table_new_column(table, "PRIO", 0.10, SCOLS_FL_RIGHT)
+	    || !scols_table_new_column(table, "DISCARD", 0.10, 0)
+	    || !scols_table_new_column(table, "USEC", 0.10, SCOLS_FL_RIGHT)
+	    || !scols_table_new_column(table, "STATUS", 0.10, 0))
+		err(EXIT_FAILURE, _("failed to allocate output column"));
+
+	for (i = 0; i < b->njobs; i++) {
+		const struct swap_job *job = &b->jobs[i];
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		char *str;
+
+		if (!line)
+			err(EXIT_FAILURE, _("failed to allocate output line"));
+
+		scols_line_set_data(line, 0, job->device);
+		scols_line_set_data(line, 1, job->diskname);
+		if (job->prop.priority >= 0) {
+			xasprintf(&str, "%d", job->prop.priority);
+			scols_line_refer_data(line, 2, str);
+		}
+		scols_line_set_data(line, 3, discard_to_string(job->prop.discard));
+		xasprintf(&str, "%llu", job->usec);
+		scols_line_refer_data(line, 4, str);
+		scols_line_set_data(line, 5, !job->done ? _("skipped") :
+					     job->rc ? _("failed") : _("ok"));
+	}
+
+	scols_print_table(table);
+	scols_unref_table(table);
+
+	printf(_("total: %llu usec\n"), total);
+}
+
+/* activates the swap areas, returns the swapon status */
+static int swapon_jobs(const struct swapon_ctl *ctl, struct swap_job *jobs, size_t njobs)
+{
+	struct swap_batch b = { .ctl = ctl, .jobs = jobs, .njobs = njobs };
+	struct timeval start, end;
+	size_t i, nthreads;
+	int status = 0;
+
+	if (!njobs)
+		return 0;
+
+	b.groups = xcalloc(njobs, sizeof(struct swap_group));
+	for (i = 0; i < njobs; i++) {
+		swap_job_set_disk(&jobs[i]);
+		add_to_group(&b, i);
+	}
+	if (ctl->auto_priority)
+		plan_priorities(&b);
+
+	nthreads = min(ctl->njobs ? ctl->njobs : 1, b.ngroups);
+
+	gettime_monotonic(&start);
+	if (nthreads <= 1) {
+		/* in fstab order */
+		for (i = 0; i < njobs; i++)
+			run_job(ctl, &jobs[i]);
+	} else {
+		pthread_t *threads = xcalloc(nthreads, sizeof(pthread_t));
+
+		/* libblkid initializes debug mask on the first use */
+		blkid_init_debug(0);
+		pthread_mutex_init(&b.lock, NULL);
+
+		for (i = 0; i < nthreads; i++) {
+			errno = pthread_create(&threads[i], NULL, swapon_worker, &b);
+			if (errno)
+				err(EXIT_FAILURE, _("failed to create thread"));
+		}
+		for (i = 0; i < nthreads; i++)
+			pthread_join(threads[i], NULL);
+
+		pthread_mutex_destroy(&b.lock);
+		free(threads);
+	}
+	gettime_monotonic(&end);
+
+	for (i = 0; i < njobs; i++)
+		status |= jobs[i].rc;
+
+	if (ctl->timing)
+		print_timing(&b, (unsigned long long) (end.tv_sec - start.tv_sec) * 1000000
+				 + end.tv_usec - start.tv_usec);
+
+	for (i = 0; i < b.ngroups; i++)
+		free(b.groups[i].jobs);
+	free(b.groups);
+	return status;
+}
+
 static int swapon_all(struct swapon_ctl *ctl)
 {
 	struct libmnt_table *tb = get_fstab();
 	struct libmnt_iter *itr;
 	struct libmnt_fs *fs;
+	struct swap_job *jobs = NULL;
+	size_t njobs = 0;
 	int status = 0;
 
 	if (!tb)
@@ -775,11 +1049,19 @@ static int swapon_all(struct swapon_ctl *ctl)
 			continue;
 		}
 
-		/* swapon */
-		status |= do_swapon(ctl, &prop, device, TRUE);
+		/* swapon later, the device names are resolved by the
+		 * (not thread-safe) libmount cache */
+		jobs = xrealloc(jobs, (njobs + 1) * sizeof(struct swap_job));
+		memset(&jobs[njobs], 0, sizeof(struct swap_job));
+		jobs[njobs].device = device;
+		jobs[njobs].prop = prop;
+		njobs++;
 	}
 
 	mnt_free_iter(itr);
+
+	status |= swapon_jobs(ctl, jobs, njobs);
+	free(jobs);
 	return status;
 }
 
@@ -800,6 +1082,9 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -d, --discard[=<policy>] enable swap discards, if supported by device\n"), out);
 	fputs(_(" -e, --ifexists           silently skip devices that do not exist\n"), out);
 	fputs(_(" -f, --fixpgsz            reinitialize the swap space if necessary\n"), out);
+	fputs(_("     --jobs <num>         enable swaps on up to <num> disks in parallel (with --all)\n"), out);
+	fputs(_("     --auto-priority      stripe swaps over disks of similar speed (with --all)\n"), out);
+	fputs(_("     --timing             report time spent on every swap (with --all)\n"), out);
 	fputs(_(" -o, --options <list>     comma-separated list of swap options\n"), out);
 	fputs(_(" -p, --priority <prio>    specify the priority of the swap device\n"), out);
 	fputs(_(" -s, --summary            display summary about used swap devices (DEPRECATED)\n"), out);
@@ -846,7 +1131,10 @@ int main(int argc, char *argv[])
 		NOHEADINGS_OPTION,
 		RAW_OPTION,
 		SHOW_OPTION,
-		OPT_LIST_TYPES
+		OPT_LIST_TYPES,
+		JOBS_OPTION,
+		AUTOPRIO_OPTION,
+		TIMING_OPTION
 	};
 
 	static const struct option long_opts[] = {
@@ -865,6 +1153,9 @@ int main(int argc, char *argv[])
 		{ "noheadings", no_argument,       NULL, NOHEADINGS_OPTION },
 		{ "raw",        no_argument,       NULL, RAW_OPTION        },
 		{ "bytes",      no_argument,       NULL, BYTES_OPTION      },
+		{ "jobs",       required_argument, NULL, JOBS_OPTION       },
+		{ "auto-priority", no_argument,    NULL, AUTOPRIO_OPTION   },
+		{ "timing",     no_argument,       NULL, TIMING_OPTION     },
 		{ NULL, 0, NULL, 0 }
 	};
 
@@ -962,6 +1253,17 @@ int main(int argc, char *argv[])
 		case BYTES_OPTION:
 			ctl.bytes = 1;
 			break;
+		case JOBS_OPTION:
+			ctl.njobs = strtou32_or_err(optarg, _("failed to parse number of jobs"));
+			if (!ctl.njobs)
+				errx(EXIT_FAILURE, _("failed to parse number of jobs"));
+			break;
+		case AUTOPRIO_OPTION:
+			ctl.auto_priority = 1;
+			break;
+		case TIMING_OPTION:
+			ctl.timing = 1;
+			break;
 		case 0:
 			break;
 
@@ -988,7 +1290,8 @@ int main(int argc, char *argv[])
 		return status;
 	}
 
-	if (ctl.props.no_fail && !ctl.all) {
+	if ((ctl.props.no_fail || ctl.njobs || ctl.auto_priority || ctl.timing)
+	    && !ctl.all) {
 		warnx(_("bad usage"));
 		errtryhelp(EXIT_FAILURE);
 	}
@@ -35,6 +35,7 @@
 #include "closestream.h"
 #include "pathnames.h"
 #include "canonicalize.h"
+#include "strutils.h"
 
 #define XALLOC_EXIT_CODE MNT_EX_SYSERR
 #include "xalloc.h"
@@ -43,6 +44,7 @@
 #include "optutils.h"
 
 static int quiet;
+static int progress;
 
 static int table_parser_errcb(struct libmnt_table *tb __attribute__((__unused__)),
 			const char *filename, int line)
@@ -95,9 +97,12 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_("     --fake              dry run; skip the umount(2) syscall\n"), out);
 	fputs(_(" -f, --force             force unmount (in case of an unreachable NFS system)\n"), out);
 	fputs(_(" -i, --internal-only     don't call the umount.<type> helpers\n"), out);
+	fputs(_("     --jobs <num>        unmount at most <num> filesystems in parallel\n"
+	        "                           (use with -a or -R)\n"), out);
 	fputs(_(" -n, --no-mtab           don't write to /etc/mtab\n"), out);
 	fputs(_(" -l, --lazy              detach the filesystem now, clean up things later\n"), out);
 	fputs(_(" -O, --test-opts <list>  limit the set of filesystems (use with -a)\n"), out);
+	fputs(_("     --progress          report progress (use with -a or -R)\n"), out);
 	fputs(_(" -R, --recursive         recursively unmount a target with all its children\n"), out);
 	fputs(_(" -r, --read-only         in case unmounting fails, try to remount read-only\n"), out);
 	fputs(_(" -t, --types <list>      limit the set of filesystem types\n"), out);
@@ -209,6 +214,70 @@ static int umount_all(struct libmnt_context *cxt)
 	return rc;
 }
 
+/* called by mnt_context_umount_tree() after umount, maybe in child process */
+static int umount_tree_child(struct libmnt_context *cxt,
+			     struct libmnt_fs *fs __attribute__((__unused__)),
+			     int umntrc)
+{
+	int rc = mk_exit_code(cxt, umntrc);
+
+	if (rc == MNT_EX_SUCCESS && mnt_context_is_verbose(cxt))
+		success_message(cxt);
+	return rc;
+}
+
+static int umount_tree_rc;
+
+static void umount_tree_done(struct libmnt_context *cxt __attribute__((__unused__)),
+			     struct libmnt_fs *fs __attribute__((__unused__)),
+			     int status, size_t ndone, size_t ntotal)
+{
+	if (status > 0)
+		umount_tree_rc |= status;
+	else if (status < 0 && status != -ECANCELED)
+		umount_tree_rc |= MNT_EX_FAIL;
+
+	if (progress && isatty(STDERR_FILENO))
+		fprintf(stderr, _("\runmounted %zu of %zu"), ndone, ntotal);
+	if (progress && ndone == ntotal) {
+		if (isatty(STDERR_FILENO))
+			fputc('\n', stderr);
+		else
+			fprintf(stderr, _("unmounted %zu of %zu\n"), ndone, ntotal);
+	}
+}
+
+/*
+ * umount -a or umount -R by one mount tree scan; returns -1 if unsupported
+ */
+static int umount_tree(struct libmnt_context *cxt, const char *spec, size_t jobs)
+{
+	int rc;
+
+	if (mnt_context_is_restricted(cxt))
+		return -1;
+
+	umount_tree_rc = MNT_EX_SUCCESS;
+
+	rc = mnt_context_umount_tree(cxt, spec, jobs,
+				umount_tree_child, umount_tree_done);
+	if (rc == -ENOTSUP)
+		return -1;
+	if (rc == 1) {
+		if (!quiet)
+			warnx(access(spec, F_OK) == 0 ?
+				_("%s: not mounted") :
+				_("%s: not found"), spec);
+		return MNT_EX_USAGE;
+	}
+	if (rc < 0) {
+		errno = -rc;
+		warn(_("failed to unmount %s"), spec ? spec : _("filesystems"));
+		return MNT_EX_SYSERR;
+	}
+	return umount_tree_rc;
+}
+
 static int umount_one(struct libmnt_context *cxt, const char *spec)
 {
 	int rc;
@@ -450,9 +519,12 @@ int main(int argc, char **argv)
 	int c, rc = 0, all = 0, recursive = 0, alltargets = 0;
 	struct libmnt_context *cxt;
 	char *types = NULL;
+	size_t jobs = 1;
 
 	enum {
 		UMOUNT_OPT_FAKE = CHAR_MAX + 1,
+		UMOUNT_OPT_JOBS,
+		UMOUNT_OPT_PROGRESS
 	};
 
 	static const struct option longopts[] = {
@@ -463,9 +535,11 @@ int main(int argc, char **argv)
 		{ "force",           no_argument,       NULL, 'f'             },
 		{ "help",            no_argument,       NULL, 'h'             },
 		{ "internal-only",   no_argument,       NULL, 'i'             },
+		{ "jobs",            required_argument, NULL, UMOUNT_OPT_JOBS },
 		{ "lazy",            no_argument,       NULL, 'l'             },
 		{ "no-canonicalize", no_argument,       NULL, 'c'             },
 		{ "no-mtab",         no_argument,       NULL, 'n'             },
+		{ "progress",        no_argument,       NULL, UMOUNT_OPT_PROGRESS },
 		{ "quiet",           no_argument,       NULL, 'q'             },
 		{ "read-only",       no_argument,       NULL, 'r'             },
 		{ "recursive",       no_argument,       NULL, 'R'             },
@@ -531,6 +605,14 @@ int main(int argc, char **argv)
 		case 'i':
 			mnt_context_disable_helpers(cxt, TRUE);
 			break;
+		case UMOUNT_OPT_JOBS:
+			jobs = strtou32_or_err(optarg, _("invalid jobs argument"));
+			if (!jobs)
+				errx(MNT_EX_USAGE, _("invalid jobs argument"));
+			break;
+		case UMOUNT_OPT_PROGRESS:
+			progress = 1;
+			break;
 		case 'l':
 			mnt_context_enable_lazy(cxt, TRUE);
 			break;
@@ -592,7 +674,9 @@ int main(int argc, char **argv)
 			types = "noproc,nodevfs,nodevpts,nosysfs,norpc_pipefs,nonfsd,noselinuxfs";
 
 		mnt_context_set_fstype_pattern(cxt, types);
-		rc = umount_all(cxt);
+		rc = umount_tree(cxt, NULL, jobs);
+		if (rc < 0)
+			rc = umount_all(cxt);
 
 	} else if (argc < 1) {
 		warnx(_("bad usage"));
@@ -602,8 +686,15 @@ int main(int argc, char **argv)
 		while (argc--)
 			rc += umount_alltargets(cxt, *argv++, recursive);
 	} else if (recursive) {
-		while (argc--)
-			rc += umount_recursive(cxt, *argv++);
+		/* it's always real mountpoint, don't assume that the target maybe a device */
+		mnt_context_disable_swapmatch(cxt, 1);
+
+		while (argc--) {
+			int xrc = umount_tree(cxt, *argv, jobs);
+
+			rc += xrc < 0 ? umount_recursive(cxt, *argv) : xrc;
+			argv++;
+		}
 	} else {
 		while (argc--) {
 			char *path = *argv;
@@ -8,13 +8,16 @@
 #include <math.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <sys/stat.h>
 
 #include "c.h"
 #include "xalloc.h"
 #include "closestream.h"
 #include "nls.h"
 #include "strutils.h"
+#include "fileutils.h"
 #include "script-playutils.h"
+#include "script-timing.h"
 
 UL_DEBUG_DEFINE_MASK(scriptreplay);
 UL_DEBUG_DEFINE_MASKNAMES(scriptreplay) = UL_DEBUG_EMPTY_MASKNAMES;
@@ -32,17 +35,34 @@ UL_DEBUG_DEFINE_MASKNAMES(scriptreplay) = UL_DEBUG_EMPTY_MASKNAMES;
  */
 enum {
 	REPLAY_TIMING_SIMPLE,		/* timing info in classic "<delta> <offset>" format */
-	REPLAY_TIMING_MULTI		/* multiple streams in format "<type> <delta> <offset|etc> */
+	REPLAY_TIMING_MULTI,		/* multiple streams in format "<type> <delta> <offset|etc> */
+	REPLAY_TIMING_BINARY		/* multiple streams in binary format, see script-timing.h */
 };
 
 struct replay_log {
 	const char	*streams;	/* 'I'nput, 'O'utput or both */
 	const char	*filename;
 	FILE		*fp;
+	off_t		base;		/* data begin (after the first line) */
 
 	unsigned int	noseek : 1;	/* do not seek in this log */
 };
 
+/*
+ * Seek index, one entry for every REPLAY_INDEX_STEP timing file entries. The
+ * index is stored to <timingfile>.idx to avoid parsing of the whole timing
+ * file next time.
+ */
+#define REPLAY_INDEX_STEP	256
+
+struct replay_index {
+	struct timeval	time;		/* recording time before the entry */
+	off_t		timing_off;	/* timing file offset */
+	int		timing_line;
+	uint64_t	in;		/* bytes in input data log */
+	uint64_t	out;		/* bytes in output data log */
+};
+
 struct replay_step {
 	char	type;		/* 'I'nput, 'O'utput, ... */
 	size_t	size;
@@ -64,6 +84,15 @@ struct replay_setup {
 	const char		*timing_filename;
 	int			timing_format;
 	int			timing_line;
+	off_t			timing_start;	/* first entry offset */
+
+	struct replay_index	*index;
+	size_t			nindex;
+
+	struct timeval		time;		/* recording time of the read entries */
+	struct timeval		time_from;	/* replay window */
+	struct timeval		time_to;
+	unsigned int		need_seek : 1;
 
 	struct timeval		delay_max;
 	struct timeval		delay_min;
@@ -111,6 +140,7 @@ void replay_free_setup(struct replay_setup *stp)
 		return;
 
 	free(stp->logs);
+	free(stp->index);
 	free(stp->step.name);
 	free(stp->step.value);
 	free(stp);
@@ -154,6 +184,24 @@ int replay_set_delay_div(struct replay_setup *stp, const double divi)
 	return 0;
 }
 
+/* skip everything recorded before @tv, the seek is done on the first
+ * replay_get_next_step() call */
+int replay_set_time_from(struct replay_setup *stp, const struct timeval *tv)
+{
+	stp->time_from.tv_sec = tv->tv_sec;
+	stp->time_from.tv_usec = tv->tv_usec;
+	stp->need_seek = timerisset(tv) ? 1 : 0;
+	return 0;
+}
+
+/* stop replay on entries recorded after @tv */
+int replay_set_time_to(struct replay_setup *stp, const struct timeval *tv)
+{
+	stp->time_to.tv_sec = tv->tv_sec;
+	stp->time_to.tv_usec = tv->tv_usec;
+	return 0;
+}
+
 static struct replay_log *replay_new_log(struct replay_setup *stp,
 					 const char *streams,
 					 const char *filename,
@@ -193,7 +241,17 @@ int replay_set_timing_file(struct replay_setup *stp, const char *filename)
 	else {
 		/* detect timing file format */
 		c = fgetc(stp->timing_fp);
-		if (c != EOF) {
+		if (c == SCRIPT_TIMING_MAGIC[0]) {
+			char magic[SCRIPT_TIMING_MAGICSZ];
+
+			magic[0] = c;
+			if (fread(magic + 1, 1, sizeof(magic) - 1, stp->timing_fp)
+						!= sizeof(magic) - 1
+			    || memcmp(magic, SCRIPT_TIMING_MAGIC, sizeof(magic)) != 0)
+				rc = -EINVAL;
+			else
+				stp->timing_format = REPLAY_TIMING_BINARY;
+		} else if (c != EOF) {
 			if (isdigit((unsigned int) c))
 				stp->timing_format = REPLAY_TIMING_SIMPLE;
 			else
@@ -207,9 +265,14 @@ int replay_set_timing_file(struct replay_setup *stp, const char *filename)
 		fclose(stp->timing_fp);
 		stp->timing_fp = NULL;
 	}
+	if (rc == 0) {
+		stp->timing_start = ftello(stp->timing_fp);
+		if (stp->timing_start < 0)
+			stp->timing_start = 0;
+	}
 
 	/* create quasi-log for signals, headers, etc. */
-	if (rc == 0 && stp->timing_format == REPLAY_TIMING_MULTI) {
+	if (rc == 0 && stp->timing_format != REPLAY_TIMING_SIMPLE) {
 		struct replay_log *log = replay_new_log(stp, "SH",
 						filename, stp->timing_fp);
 		if (!log)
@@ -250,8 +313,11 @@ int replay_associate_log(struct replay_setup *stp,
 	f = fopen(filename, "r");
 	rc = f == NULL ? -errno : ignore_line(f);
 
-	if (rc == 0)
-		replay_new_log(stp, streams, filename, f);
+	if (rc == 0) {
+		struct replay_log *log = replay_new_log(stp, streams, filename, f);
+
+		log->base = ftello(f);
+	}
 
 	DBG(LOG, ul_debug("associate log file '%s', streams '%s' [rc=%d]", filename, streams, rc));
 	return rc;
@@ -355,6 +421,69 @@ static int read_multistream_step(struct replay_step *step, FILE *f, char type)
 	return rc;
 }
 
+/* reads <size> <string> from binary timing file */
+static int read_binary_string(FILE *f, char **str)
+{
+	char buf[BUFSIZ];
+	uint64_t sz;
+	int rc;
+
+	rc = script_varint_read(f, &sz);
+	if (rc)
+		return rc < 0 ? rc : -EINVAL;
+	if (sz >= sizeof(buf))
+		return -EINVAL;
+	if (sz && fread(buf, 1, sz, f) != sz)
+		return ferror(f) ? -errno : -EINVAL;
+	buf[sz] = '\0';
+
+	*str = strrealloc(*str, buf);
+	if (!*str)
+		err_oom();
+	return 0;
+}
+
+static int read_binary_step(struct replay_step *step, FILE *f)
+{
+	uint64_t delta, sz;
+	int c, rc;
+
+	c = getc(f);
+	if (c == EOF)
+		return ferror(f) ? -errno : 1;
+
+	step->type = c;
+	rc = script_varint_read(f, &delta);
+	if (rc)
+		return rc < 0 ? rc : -EINVAL;
+
+	step->delay.tv_sec = delta / 1000000;
+	step->delay.tv_usec = delta % 1000000;
+
+	switch (step->type) {
+	case 'O': /* output */
+	case 'I': /* input */
+		rc = script_varint_read(f, &sz);
+		if (rc)
+			rc = rc < 0 ? rc : -EINVAL;
+		else
+			step->size = sz;
+		break;
+	case 'S': /* signal */
+	case 'H': /* header */
+		rc = read_binary_string(f, &step->name);
+		if (!rc)
+			rc = read_binary_string(f, &step->value);
+		break;
+	default:
+		rc = -EINVAL;	/* unknown entry size */
+		break;
+	}
+
+	DBG(TIMING, ul_debug(" read binary step [rc=%d]", rc));
+	return rc;
+}
+
 static struct replay_log *replay_get_stream_log(struct replay_setup *stp, char stream)
 {
 	size_t i;
@@ -376,6 +505,300 @@ static int replay_seek_log(struct replay_log *log, size_t move)
 	return fseek(log->fp, move, SEEK_CUR) == (off_t) -1 ? -errno : 0;
 }
 
+/* reads the next timing file entry, returns 0 = success, <0 = error, 1 = EOF */
+static int read_step(struct replay_setup *stp, struct replay_step *step)
+{
+	int rc = -EINVAL;
+
+	switch (stp->timing_format) {
+	case REPLAY_TIMING_SIMPLE:
+		/* old format is the same as new format, but without <type> prefix */
+		rc = read_multistream_step(step, stp->timing_fp, stp->default_type);
+		if (rc == 0)
+			step->type = stp->default_type;
+		break;
+	case REPLAY_TIMING_MULTI:
+		rc = fscanf(stp->timing_fp, "%c ", &step->type);
+		if (rc != 1)
+			rc = -EINVAL;
+		else
+			rc = read_multistream_step(step,
+					stp->timing_fp,
+					step->type);
+		break;
+	case REPLAY_TIMING_BINARY:
+		rc = read_binary_step(step, stp->timing_fp);
+		break;
+	}
+
+	if (rc < 0 && feof(stp->timing_fp))
+		rc = 1;
+	return rc;
+}
+
+static char *get_index_filename(struct replay_setup *stp)
+{
+	char *name = NULL;
+
+	xasprintf(&name, "%s.idx", stp->timing_filename);
+	return name;
+}
+
+static void add_index_entry(struct replay_setup *stp, const struct replay_index *ent)
+{
+	if ((stp->nindex % 64) == 0)
+		stp->index = xrealloc(stp->index,
+				(stp->nindex + 64) * sizeof(struct replay_index));
+	stp->index[stp->nindex++] = *ent;
+}
+
+/* reads the whole timing file and creates the index */
+static int build_index(struct replay_setup *stp)
+{
+	struct replay_step step = { .type = 0 };
+	struct replay_index ent = { .timing_line = 0 };
+	size_t n;
+	int rc;
+
+	DBG(TIMING, ul_debug("building index"));
+
+	if (fseeko(stp->timing_fp, stp->timing_start, SEEK_SET) != 0)
+		return -errno;
+
+	for (n = 0; ; n++) {
+		if ((n % REPLAY_INDEX_STEP) == 0) {
+			ent.timing_off = ftello(stp->timing_fp);
+			add_index_entry(stp, &ent);
+		}
+
+		replay_reset_step(&step);
+		rc = read_step(stp, &step);
+		if (rc)
+			break;
+
+		ent.timing_line++;
+		timerinc(&ent.time, &step.delay);
+
+		/* the classic format has only one stream */
+		if (step.type == 'I' && stp->timing_format != REPLAY_TIMING_SIMPLE)
+			ent.in += step.size;
+		else if (step.type == 'I' || step.type == 'O')
+			ent.out += step.size;
+	}
+
+	free(step.name);
+	free(step.value);
+	return rc < 0 ? rc : 0;
+}
+
+static int read_index(struct replay_setup *stp, const char *filename,
+		      const struct stat *st)
+{
+	struct replay_index ent;
+	long long size, sec, nsec;
+	long long off, in, out;
+	int format, rc = -EINVAL;
+	FILE *f;
+
+	f = fopen(filename, "r" UL_CLOEXECSTR);
+	if (!f)
+		return -errno;
+
+	/* the index is valid for the same timing file only */
+	if (fscanf(f, "# scriptreplay index, don't edit\n"
+		      "SIZE %lld MTIME %lld.%lld FORMAT %d\n",
+			&size, &sec, &nsec, &format) != 4
+	    || size != (long long) st->st_size
+	    || sec != (long long) st->st_mtim.tv_sec
+	    || nsec != (long long) st->st_mtim.tv_nsec
+	    || format != stp->timing_format)
+		goto done;
+
+	memset(&ent, 0, sizeof(ent));
+	while (fscanf(f, "%ld.%06ld %lld %d %lld %lld\n",
+			&ent.time.tv_sec, &ent.time.tv_usec,
+			&off, &ent.timing_line, &in, &out) == 6) {
+		ent.timing_off = off;
+		ent.in = in;
+		ent.out = out;
+		add_index_entry(stp, &ent);
+	}
+	if (feof(f) && stp->nindex)
+		rc = 0;
+done:
+	fclose(f);
+	if (rc) {
+		free(stp->index);
+		stp->index = NULL;
+		stp->nindex = 0;
+	}
+	DBG(TIMING, ul_debug("read index %s [rc=%d, entries=%zu]", filename, rc, stp->nindex));
+	return rc;
+}
+
+/* the index is optional, all errors are ignored */
+static void write_index(struct replay_setup *stp, const char *filename,
+			const struct stat *st)
+{
+	char *tmp = NULL;
+	FILE *f = NULL;
+	size_t i;
+	int fd;
+
+	xasprintf(&tmp, "%s-XXXXXX", filename);
+	fd = mkstemp_cloexec(tmp);
+	if (fd < 0)
+		goto done;
+	if (!(f = fdopen(fd, "w" UL_CLOEXECSTR))) {
+		close(fd);
+		goto fail;
+	}
+
+	fprintf(f, "# scriptreplay index, don't edit\n"
+		   "SIZE %lld MTIME %lld.%09lld FORMAT %d\n",
+			(long long) st->st_size,
+			(long long) st->st_mtim.tv_sec,
+			(long long) st->st_mtim.tv_nsec,
+			stp->timing_format);
+
+	for (i = 0; i < stp->nindex; i++) {
+		struct replay_index *ent = &stp->index[i];
+
+		fprintf(f, "%ld.%06ld %lld %d %llu %llu\n",
+			(long) ent->time.tv_sec, (long) ent->time.tv_usec,
+			(long long) ent->timing_off, ent->timing_line,
+			(unsigned long long) ent->in,
+			(unsigned long long) ent->out);
+	}
+
+	if (close_stream(f) != 0 || rename(tmp, filename) != 0)
+		goto fail;
+
+	DBG(TIMING, ul_debug("index %s written", filename));
+	goto done;
+fail:
+	unlink(tmp);
+done:
+	free(tmp);
+}
+
+static int load_index(struct replay_setup *stp)
+{
+	struct stat st;
+	char *filename;
+	int rc = 0;
+
+	if (stp->index)
+		return 0;
+
+	/* for example /dev/stdin */
+	if (fstat(fileno(stp->timing_fp), &st) != 0 || !S_ISREG(st.st_mode))
+		return build_index(stp);
+
+	filename = get_index_filename(stp);
+	if (read_index(stp, filename, &st) != 0) {
+		rc = build_index(stp);
+		if (rc == 0)
+			write_index(stp, filename, &st);
+	}
+	free(filename);
+	return rc;
+}
+
+/* returns data log offset for the index entry */
+static off_t get_log_offset(struct replay_setup *stp, struct replay_log *log,
+			    struct replay_index *ent)
+{
+	off_t off = log->base;
+
+	if (stp->timing_format == REPLAY_TIMING_SIMPLE) {
+		if (is_wanted_stream(stp->default_type, log->streams))
+			off += ent->out;
+		return off;
+	}
+	if (is_wanted_stream('I', log->streams))
+		off += ent->in;
+	if (is_wanted_stream('O', log->streams))
+		off += ent->out;
+	return off;
+}
+
+/*
+ * Moves all files to the first entry recorded at @time_from or later. The
+ * index is used to find the nearest entry, the rest is read sequentially.
+ */
+static int replay_seek(struct replay_setup *stp)
+{
+	struct replay_step step = { .type = 0 };
+	struct replay_index *ent;
+	size_t lo, hi, i;
+	int rc;
+
+	rc = load_index(stp);
+	if (rc)
+		return rc;
+
+	/* last index entry before @from */
+	lo = 0, hi = stp->nindex;
+	while (hi - lo > 1) {
+		size_t mid = (lo + hi) / 2;
+
+		if (timercmp(&stp->index[mid].time, &stp->time_from, <))
+			lo = mid;
+		else
+			hi = mid;
+	}
+	ent = &stp->index[lo];
+
+	DBG(TIMING, ul_debug("seek to %ld.%06ld: using index %zu [time=%ld.%06ld, line=%d]",
+				stp->time_from.tv_sec, stp->time_from.tv_usec, lo,
+				ent->time.tv_sec, ent->time.tv_usec, ent->timing_line));
+
+	if (fseeko(stp->timing_fp, ent->timing_off, SEEK_SET) != 0)
+		return -errno;
+	for (i = 0; i < stp->nlogs; i++) {
+		struct replay_log *log = &stp->logs[i];
+
+		if (log->noseek)
+			continue;
+		if (fseeko(log->fp, get_log_offset(stp, log, ent), SEEK_SET) != 0)
+			return -errno;
+	}
+	stp->time = ent->time;
+	stp->timing_line = ent->timing_line;
+
+	/* skip entries before @from */
+	do {
+		struct replay_log *log;
+		struct timeval t;
+		off_t off = ftello(stp->timing_fp);
+
+		replay_reset_step(&step);
+		rc = read_step(stp, &step);
+		if (rc)
+			break;
+
+		timeradd(&stp->time, &step.delay, &t);
+		if (!timercmp(&t, &stp->time_from, <)) {
+			/* the entry will be replayed */
+			if (fseeko(stp->timing_fp, off, SEEK_SET) != 0)
+				rc = -errno;
+			break;
+		}
+
+		stp->time = t;
+		stp->timing_line++;
+
+		log = replay_get_stream_log(stp, step.type);
+		if (log)
+			rc = replay_seek_log(log, step.size);
+	} while (rc == 0);
+
+	free(step.name);
+	free(step.value);
+	return rc < 0 ? rc : 0;
+}
+
 /* returns next step with pointer to the right log file for specified streams (e.g.
  * "IOS" for in/out/signals) or all streams if stream is NULL.
  *
@@ -384,7 +807,7 @@ static int replay_seek_log(struct replay_log *log, size_t move)
 int replay_get_next_step(struct replay_setup *stp, char *streams, struct replay_step **xstep)
 {
 	struct replay_step *step;
-	int rc;
+	int rc, seeked = 0;
 	struct timeval ignored_delay;
 
 	assert(stp);
@@ -396,6 +819,14 @@ int replay_get_next_step(struct replay_setup *stp, char *streams, struct replay_
 
 	timerclear(&ignored_delay);
 
+	if (stp->need_seek) {
+		stp->need_seek = 0;
+		rc = replay_seek(stp);
+		if (rc)
+			return rc;
+		seeked = 1;
+	}
+
 	do {
 		struct replay_log *log = NULL;
 
@@ -408,28 +839,16 @@ int replay_get_next_step(struct replay_setup *stp, char *streams, struct replay_
 		replay_reset_step(step);
 		stp->timing_line++;
 
-		switch (stp->timing_format) {
-		case REPLAY_TIMING_SIMPLE:
-			/* old format is the same as new format, but without <type> prefix */
-			rc = read_multistream_step(step, stp->timing_fp, stp->default_type);
-			if (rc == 0)
-				step->type = stp->default_type;
-			break;
-		case REPLAY_TIMING_MULTI:
-			rc = fscanf(stp->timing_fp, "%c ", &step->type);
-			if (rc != 1)
-				rc = -EINVAL;
-			else
-				rc = read_multistream_step(step,
-						stp->timing_fp,
-						step->type);
-			break;
-		}
-
-		if (rc) {
-			if (rc < 0 && feof(stp->timing_fp))
-				rc = 1;
+		rc = read_step(stp, step);
+		if (rc)
 			break;		/* error or EOF */
+
+		timerinc(&stp->time, &step->delay);
+		if (timerisset(&stp->time_to)
+		    && timercmp(&stp->time, &stp->time_to, >)) {
+			DBG(TIMING, ul_debug(" end of replay window"));
+			rc = 1;
+			break;
 		}
 
 		DBG(TIMING, ul_debug(" step entry is '%c'", step->type));
@@ -467,6 +886,12 @@ done:
 				ignored_delay.tv_sec, ignored_delay.tv_usec,
 				step->size));
 
+	/* the first step after seek is replayed immediately */
+	if (seeked) {
+		DBG(TIMING, ul_debug(" first step after seek"));
+		timerclear(&step->delay);
+	}
+
 	/* normalize delay */
 	if (stp->delay_div) {
 		DBG(TIMING, ul_debug(" normalize delay: divide"));
@@ -39,6 +39,8 @@ int replay_associate_log(struct replay_setup *stp, const char *streams, const ch
 int replay_set_delay_min(struct replay_setup *stp, const struct timeval *tv);
 int replay_set_delay_max(struct replay_setup *stp, const struct timeval *tv);
 int replay_set_delay_div(struct replay_setup *stp, const double divi);
+int replay_set_time_from(struct replay_setup *stp, const struct timeval *tv);
+int replay_set_time_to(struct replay_setup *stp, const struct timeval *tv);
 
 struct timeval *replay_step_get_delay(struct replay_step *step);
 const char *replay_step_get_filename(struct replay_step *step);
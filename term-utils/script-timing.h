@@ -0,0 +1,59 @@
+/*
+ * No copyright is claimed.  This code is in the public domain; do with
+ * it what you wish.
+ *
+ * Binary timing file format used by script(1), scriptreplay(1) and
+ * scriptlive(1).
+ */
+#ifndef UTIL_LINUX_SCRIPT_TIMING_H
+#define UTIL_LINUX_SCRIPT_TIMING_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+
+/*
+ * The file starts with SCRIPT_TIMING_MAGIC followed by entries:
+ *
+ *   <type> <delta> <size>                              'I'nput and 'O'utput
+ *   <type> <delta> <namesz> <name> <valuesz> <value>   'S'ignal and 'H'eader
+ *
+ * The <type> is one byte, <delta> is time since the previous entry in
+ * microseconds, the numbers are unsigned LEB128 varints and the strings are
+ * not terminated. The typical output entry is 3-5 bytes long.
+ */
+#define SCRIPT_TIMING_MAGIC	"\177SCRIPTTM1"
+#define SCRIPT_TIMING_MAGICSZ	(sizeof(SCRIPT_TIMING_MAGIC) - 1)
+
+#define SCRIPT_VARINT_MAX	10	/* bytes for uint64_t */
+
+static inline size_t script_varint_encode(uint64_t x, unsigned char *buf)
+{
+	size_t n = 0;
+
+	while (x >= 0x80) {
+		buf[n++] = (x & 0x7f) | 0x80;
+		x >>= 7;
+	}
+	buf[n++] = x;
+	return n;
+}
+
+/* returns 0 on success, 1 on EOF, <0 on error */
+static inline int script_varint_read(FILE *f, uint64_t *x)
+{
+	int c, shift = 0;
+
+	*x = 0;
+	while ((c = getc(f)) != EOF) {
+		if (shift > 63)
+			return -EINVAL;
+		*x |= (uint64_t) (c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return 0;
+		shift += 7;
+	}
+	return ferror(f) ? -errno : 1;
+}
+
+#endif /* UTIL_LINUX_SCRIPT_TIMING_H */
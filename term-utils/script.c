@@ -68,6 +68,7 @@
 #include "signames.h"
 #include "pty-session.h"
 #include "debug.h"
+#include "script-timing.h"
 
 static UL_DEBUG_DEFINE_MASK(script);
 UL_DEBUG_DEFINE_MASKNAMES(script) = UL_DEBUG_EMPTY_MASKNAMES;
@@ -88,6 +89,10 @@ UL_DEBUG_DEFINE_MASKNAMES(script) = UL_DEBUG_EMPTY_MASKNAMES;
 
 #define DEFAULT_TYPESCRIPT_FILENAME "typescript"
 
+/* stdio buffer for the logs, the default BUFSIZ means too many write(2) calls
+ * for high-rate output */
+#define SCRIPT_LOG_BUFSIZ	(64 * 1024)
+
 /*
  * Script is driven by stream (stdout/stdin) activity. It's possible to
  * associate arbitrary number of log files with the stream. We have two basic
@@ -101,8 +106,12 @@ enum {
 	SCRIPT_FMT_RAW = 1,		/* raw slave/master data */
 	SCRIPT_FMT_TIMING_SIMPLE,	/* (classic) in format "<delta> <offset>" */
 	SCRIPT_FMT_TIMING_MULTI,	/* (advanced) multiple streams in format "<type> <delta> <offset|etc> */
+	SCRIPT_FMT_TIMING_BINARY,	/* (binary) multiple streams, see script-timing.h */
 };
 
+#define is_multistream_format(_f)	((_f) == SCRIPT_FMT_TIMING_MULTI || \
+					 (_f) == SCRIPT_FMT_TIMING_BINARY)
+
 struct script_log {
 	FILE	*fp;			/* file pointer (handler) */
 	int	format;			/* SCRIPT_FMT_* */
@@ -200,7 +209,7 @@ static void __attribute__((__noreturn__)) usage(void)
 
 	fputs(_(" -T, --log-timing <file>       log timing information to file\n"), out);
 	fputs(_(" -t[<file>], --timing[=<file>] deprecated alias to -T (default file is stderr)\n"), out);
-	fputs(_(" -m, --logging-format <name>   force to 'classic' or 'advanced' format\n"), out);
+	fputs(_(" -m, --logging-format <name>   force to 'classic', 'advanced' or 'binary' format\n"), out);
 	fputs(USAGE_SEPARATOR, out);
 
 	fputs(_(" -a, --append                  append to the log file\n"), out);
@@ -263,7 +272,7 @@ static struct script_log *log_associate(struct script_control *ctl,
 	stream->nlogs++;
 
 	/* remember where to write info about signals */
-	if (format == SCRIPT_FMT_TIMING_MULTI) {
+	if (is_multistream_format(format)) {
 		if (!ctl->siglog)
 			ctl->siglog = log;
 		if (!ctl->infolog)
@@ -299,6 +308,7 @@ static int log_close(struct script_control *ctl,
 		break;
 	}
 	case SCRIPT_FMT_TIMING_MULTI:
+	case SCRIPT_FMT_TIMING_BINARY:
 	{
 		struct timeval now, delta;
 
@@ -382,6 +392,8 @@ static int log_start(struct script_control *ctl,
 		warn(_("cannot open %s"), log->filename);
 		return -errno;
 	}
+	if (!ctl->flush)
+		setvbuf(log->fp, NULL, _IOFBF, SCRIPT_LOG_BUFSIZ);
 
 	/* write header, etc. */
 	switch (log->format) {
@@ -408,6 +420,13 @@ static int log_start(struct script_control *ctl,
 		fputs("]\n", log->fp);
 		break;
 	}
+	case SCRIPT_FMT_TIMING_BINARY:
+		if (fwrite_all(SCRIPT_TIMING_MAGIC, 1,
+			       SCRIPT_TIMING_MAGICSZ, log->fp) != 0) {
+			warn(_("cannot write %s"), log->filename);
+			return -errno;
+		}
+		/* fallthrough */
 	case SCRIPT_FMT_TIMING_SIMPLE:
 	case SCRIPT_FMT_TIMING_MULTI:
 		gettime_monotonic(&log->oldtime);
@@ -439,6 +458,41 @@ static int logging_start(struct script_control *ctl)
 	return 0;
 }
 
+/*
+ * Writes binary timing entry, @name and @value are used for signals and
+ * headers, @size for input and output.
+ */
+static ssize_t log_binary_entry(struct script_log *log, char type,
+				const struct timeval *delta, size_t size,
+				const char *name, const char *value)
+{
+	unsigned char buf[1 + 2 * SCRIPT_VARINT_MAX];
+	size_t n = 0, namesz, valuesz, vn;
+
+	buf[n++] = type;
+	n += script_varint_encode((uint64_t) delta->tv_sec * 1000000
+				  + delta->tv_usec, buf + n);
+	if (!name) {
+		n += script_varint_encode(size, buf + n);
+		return fwrite_all(buf, 1, n, log->fp) ? -errno : (ssize_t) n;
+	}
+
+	namesz = strlen(name);
+	valuesz = value ? strlen(value) : 0;
+
+	n += script_varint_encode(namesz, buf + n);
+	if (fwrite_all(buf, 1, n, log->fp) != 0
+	    || fwrite_all(name, 1, namesz, log->fp) != 0)
+		return -errno;
+
+	vn = script_varint_encode(valuesz, buf);
+	if (fwrite_all(buf, 1, vn, log->fp) != 0
+	    || (valuesz && fwrite_all(value, 1, valuesz, log->fp) != 0))
+		return -errno;
+
+	return n + namesz + vn + valuesz;
+}
+
 static ssize_t log_write(struct script_control *ctl,
 		      struct script_stream *stream,
 		      struct script_log *log,
@@ -490,6 +544,18 @@ static ssize_t log_write(struct script_control *ctl,
 
 		log->oldtime = now;
 		break;
+
+	case SCRIPT_FMT_TIMING_BINARY:
+		DBG(IO, ul_debug("  log binary timing info"));
+
+		gettime_monotonic(&now);
+		timersub(&now, &log->oldtime, &delta);
+		ssz = log_binary_entry(log, stream->ident, &delta, bytes, NULL, NULL);
+		if (ssz < 0)
+			return ssz;
+
+		log->oldtime = now;
+		break;
 	default:
 		break;
 	}
@@ -532,7 +598,7 @@ static ssize_t log_signal(struct script_control *ctl, int signum, char *msgfmt,
 	if (!log)
 		return 0;
 
-	assert(log->format == SCRIPT_FMT_TIMING_MULTI);
+	assert(is_multistream_format(log->format));
 	DBG(IO, ul_debug("  writing signal to multi-stream timing"));
 
 	gettime_monotonic(&now);
@@ -547,7 +613,12 @@ static ssize_t log_signal(struct script_control *ctl, int signum, char *msgfmt,
 			*msg = '\0';;
 	}
 
-	if (*msg)
+	if (log->format == SCRIPT_FMT_TIMING_BINARY) {
+		char name[32];
+
+		snprintf(name, sizeof(name), "SIG%s", signum_to_signame(signum));
+		sz = log_binary_entry(log, 'S', &delta, 0, name, msg);
+	} else if (*msg)
 		sz = fprintf(log->fp, "S %ld.%06ld SIG%s %s\n",
 			(long)delta.tv_sec, (long)delta.tv_usec,
 			signum_to_signame(signum), msg);
@@ -573,7 +644,7 @@ static ssize_t log_info(struct script_control *ctl, const char *name, const char
 	if (!log)
 		return 0;
 
-	assert(log->format == SCRIPT_FMT_TIMING_MULTI);
+	assert(is_multistream_format(log->format));
 	DBG(IO, ul_debug("  writing info to multi-stream log"));
 
 	if (msgfmt) {
@@ -585,7 +656,11 @@ static ssize_t log_info(struct script_control *ctl, const char *name, const char
 			*msg = '\0';;
 	}
 
-	if (*msg)
+	if (log->format == SCRIPT_FMT_TIMING_BINARY) {
+		struct timeval zero = { 0 };
+
+		sz = log_binary_entry(log, 'H', &zero, 0, name, msg);
+	} else if (*msg)
 		sz = fprintf(log->fp, "H %f %s %s\n", 0.0, name, msg);
 	else
 		sz = fprintf(log->fp, "H %f %s\n", 0.0, name);
@@ -859,6 +934,8 @@ int main(int argc, char **argv)
 				format = SCRIPT_FMT_TIMING_SIMPLE;
 			else if (strcasecmp(optarg, "advanced") == 0)
 				format = SCRIPT_FMT_TIMING_MULTI;
+			else if (strcasecmp(optarg, "binary") == 0)
+				format = SCRIPT_FMT_TIMING_BINARY;
 			else
 				errx(EXIT_FAILURE, _("unsupported logging format: '%s'"), optarg);
 			break;
@@ -998,7 +1075,7 @@ int main(int argc, char **argv)
 		goto done;
 
 	/* add extra info to advanced timing file */
-	if (timingfile && format == SCRIPT_FMT_TIMING_MULTI) {
+	if (timingfile && is_multistream_format(format)) {
 		char buf[FORMAT_TIMESTAMP_MAX];
 		time_t tvec = script_time((time_t *)NULL);
 
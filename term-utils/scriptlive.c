@@ -73,6 +73,8 @@ usage(void)
 	fputs(_(" -c, --command <command> run command rather than interactive shell\n"), out);
 	fputs(_(" -d, --divisor <num>     speed up or slow down execution with time divisor\n"), out);
 	fputs(_(" -m, --maxdelay <num>    wait at most this many seconds between updates\n"), out);
+	fputs(_("     --from <time>       start at the given time of the recording\n"), out);
+	fputs(_("     --to <time>         stop at the given time of the recording\n"), out);
 	printf(USAGE_HELP_OPTIONS(25));
 
 	printf(USAGE_MAN_TAIL("scriptlive(1)"));
@@ -158,7 +160,7 @@ int
 main(int argc, char *argv[])
 {
 	static const struct timeval mindelay = { .tv_sec = 0, .tv_usec = 100 };
-	struct timeval maxdelay;
+	struct timeval maxdelay, from, to;
 
 	const char *log_in = NULL, *log_io = NULL, *log_tm = NULL,
 		   *shell = NULL, *command = NULL;
@@ -168,6 +170,10 @@ main(int argc, char *argv[])
 	struct ul_pty_callbacks *cb;
 	struct scriptlive ss = { .pty = NULL };
 	pid_t child;
+	enum {
+		OPT_FROM = CHAR_MAX + 1,
+		OPT_TO
+	};
 
 	static const struct option longopts[] = {
 		{ "command",    required_argument,      0, 'c' },
@@ -177,6 +183,8 @@ main(int argc, char *argv[])
 		{ "log-io",     required_argument,      0, 'B'},
 		{ "divisor",	required_argument,	0, 'd' },
 		{ "maxdelay",	required_argument,	0, 'm' },
+		{ "from",       required_argument,      0, OPT_FROM },
+		{ "to",         required_argument,      0, OPT_TO },
 		{ "version",	no_argument,		0, 'V' },
 		{ "help",	no_argument,		0, 'h' },
 		{ NULL,		0, 0, 0 }
@@ -199,6 +207,8 @@ main(int argc, char *argv[])
 
 	replay_init_debug();
 	timerclear(&maxdelay);
+	timerclear(&from);
+	timerclear(&to);
 
 	while ((ch = getopt_long(argc, argv, "c:B:I:T:t:d:m:Vh", longopts, NULL)) != -1) {
 
@@ -225,6 +235,12 @@ main(int argc, char *argv[])
 		case 'm':
 			strtotimeval_or_err(optarg, &maxdelay, _("failed to parse maximal delay argument"));
 			break;
+		case OPT_FROM:
+			strtotimeval_or_err(optarg, &from, _("failed to parse start time argument"));
+			break;
+		case OPT_TO:
+			strtotimeval_or_err(optarg, &to, _("failed to parse end time argument"));
+			break;
 		case 'V':
 			print_version(EXIT_SUCCESS);
 		case 'h':
@@ -270,6 +286,11 @@ main(int argc, char *argv[])
 		replay_set_delay_max(ss.setup, &maxdelay);
 	replay_set_delay_min(ss.setup, &mindelay);
 
+	if (timerisset(&from))
+		replay_set_time_from(ss.setup, &from);
+	if (timerisset(&to))
+		replay_set_time_to(ss.setup, &to);
+
 	shell = getenv("SHELL");
 	if (shell == NULL)
 		shell = _PATH_BSHELL;
@@ -65,6 +65,8 @@ usage(void)
 	fputs(_("     --summary           display overview about recorded session and exit\n"), out);
 	fputs(_(" -d, --divisor <num>     speed up or slow down execution with time divisor\n"), out);
 	fputs(_(" -m, --maxdelay <num>    wait at most this many seconds between updates\n"), out);
+	fputs(_("     --from <time>       start at the given time of the recording\n"), out);
+	fputs(_("     --to <time>         stop at the given time of the recording\n"), out);
 	fputs(_(" -x, --stream <name>     stream type (out, in, signal or info)\n"), out);
 	fputs(_(" -c, --cr-mode <type>    CR char mode (auto, never, always)\n"), out);
 	printf(USAGE_HELP_OPTIONS(25));
@@ -136,8 +138,11 @@ main(int argc, char *argv[])
 	double divi = 1;
 	int diviopt = FALSE, idx;
 	int ch, rc, crmode = REPLAY_CRMODE_AUTO, summary = 0;
+	struct timeval from, to;
 	enum {
-		OPT_SUMMARY = CHAR_MAX + 1
+		OPT_SUMMARY = CHAR_MAX + 1,
+		OPT_FROM,
+		OPT_TO
 	};
 
 	static const struct option longopts[] = {
@@ -152,6 +157,8 @@ main(int argc, char *argv[])
 		{ "maxdelay",	required_argument,	0, 'm' },
 		{ "stream",     required_argument,	0, 'x' },
 		{ "summary",    no_argument,            0, OPT_SUMMARY },
+		{ "from",       required_argument,      0, OPT_FROM },
+		{ "to",         required_argument,      0, OPT_TO },
 		{ "version",	no_argument,		0, 'V' },
 		{ "help",	no_argument,		0, 'h' },
 		{ NULL,		0, 0, 0 }
@@ -174,6 +181,8 @@ main(int argc, char *argv[])
 
 	replay_init_debug();
 	timerclear(&maxdelay);
+	timerclear(&from);
+	timerclear(&to);
 
 	while ((ch = getopt_long(argc, argv, "B:c:I:O:T:t:s:d:m:x:Vh", longopts, NULL)) != -1) {
 
@@ -226,6 +235,12 @@ main(int argc, char *argv[])
 		case OPT_SUMMARY:
 			summary = 1;
 			break;
+		case OPT_FROM:
+			strtotimeval_or_err(optarg, &from, _("failed to parse start time argument"));
+			break;
+		case OPT_TO:
+			strtotimeval_or_err(optarg, &to, _("failed to parse end time argument"));
+			break;
 		case 'V':
 			print_version(EXIT_SUCCESS);
 		case 'h':
@@ -286,6 +301,11 @@ main(int argc, char *argv[])
 		replay_set_delay_max(setup, &maxdelay);
 	replay_set_delay_min(setup, &mindelay);
 
+	if (timerisset(&from))
+		replay_set_time_from(setup, &from);
+	if (timerisset(&to))
+		replay_set_time_to(setup, &to);
+
 	do {
 		rc = replay_get_next_step(setup, streams, &step);
 		if (rc)
@@ -0,0 +1,168 @@
+/*
+ * test_crc32 - check and benchmark crc32 and crc32c kernels
+ *
+ * Usage: test_crc32 [--crc32c] [--verify | --bench [<size> [<loops>]]]
+ *
+ * Without --verify and --bench it prints the standard (inverted seed and
+ * result) checksum of stdin, calculated by all usable kernels. The kernels
+ * have to agree, otherwise the program fails.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation.
+ */
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "c.h"
+#include "crc32.h"
+#include "crc32c.h"
+
+static int checksum(const struct ul_crc_kernel *kernels)
+{
+	const struct ul_crc_kernel *best = ul_crc_best_kernel(kernels), *k;
+	unsigned char *data = NULL;
+	size_t sz = 0, len = 0;
+	uint32_t crc;
+
+	while (!feof(stdin) && !ferror(stdin)) {
+		if (len == sz) {
+			sz = sz ? sz * 2 : BUFSIZ;
+			data = realloc(data, sz);
+			if (!data)
+				err(EXIT_FAILURE, "cannot allocate buffer");
+		}
+		len += fread(data + len, 1, sz - len, stdin);
+	}
+
+	crc = best->func(~0U, data, len) ^ ~0U;
+
+	for (k = kernels; k->name; k++) {
+		if (k->usable && !k->usable())
+			continue;
+		if ((k->func(~0U, data, len) ^ ~0U) != crc)
+			errx(EXIT_FAILURE, "%s: checksum mismatch", k->name);
+	}
+
+	printf("%08x\n", crc);
+	free(data);
+	return EXIT_SUCCESS;
+}
+
+/*
+ * Compare all kernels with the reference (the last, bytewise) kernel for
+ * all lengths up to 1KiB and all misalignments up to 15 bytes.
+ */
+static int verify(const struct ul_crc_kernel *kernels, int is_crc32)
+{
+	const struct ul_crc_kernel *ref = kernels, *k;
+	unsigned char buf[1024 + 16];
+	size_t len, off, i;
+	int rc = EXIT_SUCCESS;
+
+	while ((ref + 1)->name)
+		ref++;
+
+	srandom(42);
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = random();
+
+	for (k = kernels; k->name; k++) {
+		if (k == ref || (k->usable && !k->usable()))
+			continue;
+		for (off = 0; off < 16; off++) {
+			for (len = 0; len <= 1024; len++) {
+				uint32_t seed = random();
+
+				if (k->func(seed, buf + off, len) !=
+				    ref->func(seed, buf + off, len)) {
+					warnx("%s: mismatch [off=%zu, len=%zu]",
+							k->name, off, len);
+					rc = EXIT_FAILURE;
+					break;
+				}
+			}
+		}
+	}
+
+	if (is_crc32) {
+		/* ul_crc32_exclude_offset() vs. zeroed buffer */
+		unsigned char tmp[1024];
+
+		for (off = 0; off < 300; off += 7) {
+			for (len = 0; len < 300; len += 13) {
+				memcpy(tmp, buf, sizeof(tmp));
+				if (off < sizeof(tmp))
+					memset(tmp + off, 0, min(len, sizeof(tmp) - off));
+				if (ul_crc32_exclude_offset(~0U, buf, sizeof(tmp), off, len) !=
+				    ref->func(~0U, tmp, sizeof(tmp))) {
+					warnx("exclude_offset: mismatch [off=%zu, len=%zu]",
+							off, len);
+					rc = EXIT_FAILURE;
+				}
+			}
+		}
+	}
+	return rc;
+}
+
+static int bench(const struct ul_crc_kernel *kernels, size_t size, size_t loops)
+{
+	const struct ul_crc_kernel *k;
+	unsigned char *buf;
+	size_t i;
+
+	buf = malloc(size);
+	if (!buf)
+		err(EXIT_FAILURE, "cannot allocate buffer");
+	for (i = 0; i < size; i++)
+		buf[i] = i * 31;
+
+	for (k = kernels; k->name; k++) {
+		struct timespec a, b;
+		uint32_t crc = 0;
+		double sec;
+
+		if (k->usable && !k->usable()) {
+			printf("%-10s unsupported\n", k->name);
+			continue;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &a);
+		for (i = 0; i < loops; i++)
+			crc = k->func(crc, buf, size);
+		clock_gettime(CLOCK_MONOTONIC, &b);
+
+		sec = (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+		printf("%-10s %10.1f MiB/s [crc=%08x]\n", k->name,
+			sec > 0 ? (double) size * loops / sec / (1 << 20) : 0.0, crc);
+	}
+	free(buf);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	const struct ul_crc_kernel *kernels = ul_crc32_kernels;
+	int is_crc32 = 1;
+
+	if (argc > 1 && strcmp(argv[1], "--crc32c") == 0) {
+		kernels = ul_crc32c_kernels;
+		is_crc32 = 0;
+		argc--, argv++;
+	}
+
+	if (argc > 1 && strcmp(argv[1], "--verify") == 0)
+		return verify(kernels, is_crc32);
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		return bench(kernels,
+			     argc > 2 ? strtoul(argv[2], NULL, 10) : 64 * 1024,
+			     argc > 3 ? strtoul(argv[3], NULL, 10) : 16 * 1024);
+	if (argc > 1) {
+		fputs("Usage: test_crc32 [--crc32c] [--verify | --bench [<size> [<loops>]]]\n", stderr);
+		return EXIT_FAILURE;
+	}
+	return checksum(kernels);
+}
@@ -1,16 +1,241 @@
-
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "sha1.h"
 
-int main(void)
+static void print_digest(const unsigned char *digest)
+{
+	int i;
+
+	for (i = 0; i < UL_SHA1LENGTH; i++)
+		printf( "%02x", digest[i] );
+	printf("\n");
+}
+
+/*
+ * Hash every line of stdin (without '\n') as a separate message by
+ * ul_SHA1Multi(); the optional @prefix is prepended to all messages.
+ */
+static int hash_lines(const char *prefix)
 {
-	int i, ret;
+	unsigned char (*digests)[UL_SHA1LENGTH];
+	char **lines = NULL, *line = NULL;
+	size_t *lens = NULL, n = 0, i, sz = 0;
+	ssize_t len;
+
+	while ((len = getline(&line, &sz, stdin)) >= 0) {
+		if (len && line[len - 1] == '\n')
+			line[--len] = '\0';
+		lines = realloc(lines, (n + 1) * sizeof(char *));
+		lens = realloc(lens, (n + 1) * sizeof(size_t));
+		if (!lines || !lens)
+			return EXIT_FAILURE;
+		lines[n] = strdup(line);
+		lens[n++] = len;
+	}
+	free(line);
+
+	digests = malloc((n ? n : 1) * UL_SHA1LENGTH);
+	if (!digests)
+		return EXIT_FAILURE;
+
+	ul_SHA1Multi(digests, n, (const unsigned char *) prefix,
+		     prefix ? strlen(prefix) : 0,
+		     (const unsigned char *const *) lines, lens);
+
+	for (i = 0; i < n; i++) {
+		print_digest(digests[i]);
+		free(lines[i]);
+	}
+	free(digests);
+	free(lines);
+	free(lens);
+	return EXIT_SUCCESS;
+}
+
+/*
+ * Hash the same messages by all kernels usable on the CPU, by single and
+ * multi-buffer API, and compare the digests with the portable code. With
+ * the "generic" kernel ul_SHA1Multi() uses the vector code.
+ */
+static int check_kernels(void)
+{
+	static const unsigned char prefix[] = "kernels-check-prefix:";
+	const struct ul_sha1_kernel *k, *generic = NULL;
+	unsigned char (*ref)[UL_SHA1LENGTH], (*digests)[UL_SHA1LENGTH];
+	unsigned char *pool, **data;
+	size_t *lens, i, n = 2 * 203;
+	int p, rc = EXIT_SUCCESS;
+
+	for (k = ul_sha1_kernels; k->name; k++)
+		if (strcmp(k->name, "generic") == 0)
+			generic = k;
+
+	/* lengths 0..202 cover all the padding cases up to four blocks, the
+	 * second half of the messages is hashed with the prefix */
+	pool = malloc(n / 2);
+	data = malloc(n * sizeof(unsigned char *));
+	lens = malloc(n * sizeof(size_t));
+	ref = malloc(n * UL_SHA1LENGTH);
+	digests = malloc(n * UL_SHA1LENGTH);
+	if (!generic || !pool || !data || !lens || !ref || !digests)
+		return EXIT_FAILURE;
+
+	for (i = 0; i < n / 2; i++)
+		pool[i] = (unsigned char) (i * 131 + 7);
+	for (i = 0; i < n; i++) {
+		data[i] = pool;
+		lens[i] = i % (n / 2);
+	}
+
+	ul_sha1_set_kernel(generic);
+	for (i = 0; i < n; i++) {
+		UL_SHA1_CTX ctx;
+
+		ul_SHA1Init(&ctx);
+		if (i >= n / 2)
+			ul_SHA1Update(&ctx, prefix, sizeof(prefix) - 1);
+		ul_SHA1Update(&ctx, data[i], lens[i]);
+		ul_SHA1Final(ref[i], &ctx);
+	}
+
+	for (k = ul_sha1_kernels; k->name; k++) {
+		if (ul_sha1_set_kernel(k) != 0)
+			continue;
+
+		for (i = 0; i < n; i++) {
+			UL_SHA1_CTX ctx;
+
+			ul_SHA1Init(&ctx);
+			if (i >= n / 2)
+				ul_SHA1Update(&ctx, prefix, sizeof(prefix) - 1);
+			ul_SHA1Update(&ctx, data[i], lens[i]);
+			ul_SHA1Final(digests[i], &ctx);
+			if (memcmp(digests[i], ref[i], UL_SHA1LENGTH) != 0) {
+				printf("%s: single: message %zu differs\n", k->name, i);
+				rc = EXIT_FAILURE;
+			}
+		}
+
+		for (p = 0; p < 2; p++) {
+			size_t off = p * n / 2;
+
+			ul_SHA1Multi(digests + off, n / 2, p ? prefix : NULL,
+				     p ? sizeof(prefix) - 1 : 0,
+				     (const unsigned char *const *) data + off, lens + off);
+		}
+		for (i = 0; i < n; i++) {
+			if (memcmp(digests[i], ref[i], UL_SHA1LENGTH) != 0) {
+				printf("%s: multi: message %zu differs\n", k->name, i);
+				rc = EXIT_FAILURE;
+			}
+		}
+	}
+
+	if (rc == EXIT_SUCCESS)
+		printf("kernels: OK\n");
+
+	free(pool);
+	free(data);
+	free(lens);
+	free(ref);
+	free(digests);
+	return rc;
+}
+
+static double elapsed(struct timespec *a)
+{
+	struct timespec b;
+
+	clock_gettime(CLOCK_MONOTONIC, &b);
+	return (b.tv_sec - a->tv_sec) + (b.tv_nsec - a->tv_nsec) / 1e9;
+}
+
+/*
+ * Bulk throughput of the block functions and the rate of short messages
+ * (UUID namespace + 36 bytes name) by single and multi-buffer API.
+ */
+static int bench(size_t nmsgs)
+{
+	const struct ul_sha1_kernel *k;
+	static unsigned char buf[64 * 1024];
+	static const unsigned char ns[16] = { 0x6b, 0xa7, 0xb8, 0x10 };
+	unsigned char (*digests)[UL_SHA1LENGTH];
+	unsigned char **names, *pool;
+	size_t *lens, i;
+	struct timespec ts;
+	double sec;
+
+	for (k = ul_sha1_kernels; k->name; k++) {
+		uint32_t state[5] = { 0 };
+
+		if (k->usable && !k->usable()) {
+			printf("%-12s unsupported\n", k->name);
+			continue;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		for (i = 0; i < 2048; i++)
+			k->blocks(state, buf, sizeof(buf) / 64);
+		sec = elapsed(&ts);
+		printf("%-12s %10.1f MiB/s\n", k->name,
+			2048.0 * sizeof(buf) / sec / (1 << 20));
+	}
+
+	names = malloc(nmsgs * sizeof(unsigned char *));
+	lens = malloc(nmsgs * sizeof(size_t));
+	pool = malloc(nmsgs * 37);
+	digests = malloc(nmsgs * UL_SHA1LENGTH);
+	if (!names || !lens || !pool || !digests)
+		return EXIT_FAILURE;
+
+	for (i = 0; i < nmsgs; i++) {
+		names[i] = pool + i * 37;
+		lens[i] = snprintf((char *) names[i], 37,
+				"%08zx-0000-0000-0000-%012zx", i, i * 7919);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	for (i = 0; i < nmsgs; i++) {
+		UL_SHA1_CTX ctx;
+
+		ul_SHA1Init(&ctx);
+		ul_SHA1Update(&ctx, ns, sizeof(ns));
+		ul_SHA1Update(&ctx, names[i], lens[i]);
+		ul_SHA1Final(digests[i], &ctx);
+	}
+	sec = elapsed(&ts);
+	printf("%-12s %10.0f msgs/s\n", "single", nmsgs / sec);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ul_SHA1Multi(digests, nmsgs, ns, sizeof(ns),
+		     (const unsigned char *const *) names, lens);
+	sec = elapsed(&ts);
+	printf("%-12s %10.0f msgs/s\n", "multi", nmsgs / sec);
+
+	free(names);
+	free(lens);
+	free(pool);
+	free(digests);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	int ret;
 	UL_SHA1_CTX ctx;
 	unsigned char digest[UL_SHA1LENGTH];
 	unsigned char buf[BUFSIZ];
 
+	if (argc > 1 && strcmp(argv[1], "--multi") == 0)
+		return hash_lines(argc > 2 ? argv[2] : NULL);
+	if (argc > 1 && strcmp(argv[1], "--kernels") == 0)
+		return check_kernels();
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		return bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000);
+
 	ul_SHA1Init( &ctx );
 
 	while(!feof(stdin) && !ferror(stdin)) {
@@ -22,8 +247,6 @@ int main(void)
 	fclose(stdin);
 	ul_SHA1Final( digest, &ctx );
 
-	for (i = 0; i < UL_SHA1LENGTH; i++)
-		printf( "%02x", digest[i] );
-	printf("\n");
+	print_digest(digest);
 	return 0;
 }